@@ -346,6 +346,7 @@ extern "C" int gtatool_combine(int argc, char *argv[])
 
             gta::header hdro = hdri[0];
             hdro.set_compression(gta::none);
+            min_max_tags_unset(hdro);
             std::string nameo;
             array_loops[0].write(hdro, nameo);
             if (hdro.data_size() == 0)
@@ -360,32 +361,36 @@ extern "C" int gtatool_combine(int argc, char *argv[])
             }
             blob element_buf(checked_cast<size_t>(hdro.element_size()));
             std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t c = 0; c < hdro.components(); c++)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
-                {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
-                }
+                component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
+                    - element_buf.ptr<const char>();
             }
-            std::vector<const void*> element_ptrs(arguments.size());
+            const size_t element_size = element_buf.size();
+            std::vector<const char*> element_ptrs(arguments.size());
             std::vector<const void*> component_ptrs(arguments.size());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t e0 = 0; e0 < hdro.elements();)
             {
+                size_t n = element_loops[0].batch_size(hdro.elements() - e0);
                 for (size_t i = 0; i < arguments.size(); i++)
                 {
-                    element_ptrs[i] = element_loops[i].read();
+                    element_ptrs[i] = static_cast<const char*>(element_loops[i].read(n));
                 }
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                char *elements = static_cast<char*>(element_loops[0].write_buffer(n));
+                for (size_t k = 0; k < n; k++)
                 {
-                    for (size_t i = 0; i < arguments.size(); i++)
+                    for (uintmax_t c = 0; c < hdro.components(); c++)
                     {
-                        component_ptrs[i] = static_cast<const char*>(element_ptrs[i]) + component_offsets[c];
+                        for (size_t i = 0; i < arguments.size(); i++)
+                        {
+                            component_ptrs[i] = element_ptrs[i] + k * element_size + component_offsets[c];
+                        }
+                        combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
+                                static_cast<void*>(elements + k * element_size + component_offsets[c]));
                     }
-                    combine(hdro.component_type(c), m, force.value(), arguments.size(), &component_ptrs[0],
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
                 }
-                element_loops[0].write(element_buf.ptr());
+                element_loops[0].write(elements, n);
+                e0 += n;
             }
         }
         array_loops[0].finish();
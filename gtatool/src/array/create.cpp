@@ -25,12 +25,16 @@
 #include <cstdio>
 #include <cctype>
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
 
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
 #include "base/blb.h"
 #include "base/opt.h"
+#include "base/fio.h"
 #include "base/str.h"
 #include "base/chk.h"
 
@@ -48,7 +52,8 @@ extern "C" void gtatool_create_help(void)
             "The dimensions and components must be given as comma-separated lists. "
             "An initial value for all array elements can be given as a comma-separated list, "
             "with one entry for each element component. "
-            "The default initial value is zero for all element components.\n"
+            "The default initial value is zero for all element components. "
+            "If the output is a file, the array data is written by all processor cores in parallel.\n"
             "Example: -d 256,128 -c uint8,uint8,uint8 -v 32,64,128");
 }
 
@@ -105,11 +110,56 @@ extern "C" int gtatool_create(int argc, char *argv[])
         for (uintmax_t i = 0; i < n.value(); i++)
         {
             array_loop.write(hdr, name);
-            element_loop_t element_loop;
-            array_loop.start_element_loop(element_loop, gta::header(), hdr);
-            for (uintmax_t j = 0; j < hdr.elements(); j++)
+            bool written = false;
+            if (hdr.data_size() > 0 && planned_output_t::possible(array_loop))
             {
-                element_loop.write(v.ptr());
+                // Fill the data section with positioned writes from all cores
+                FILE *fo = array_loop.file_out();
+                fio::flush(fo, array_loop.filename_out());
+                uintmax_t data_offset = fio::tell(fo, array_loop.filename_out());
+                size_t element_size = checked_cast<size_t>(hdr.element_size());
+                uintmax_t part_elements = std::max(static_cast<size_t>(1), 1024 * 1024 / element_size);
+                size_t k = checked_cast<size_t>(std::min(hdr.elements(), part_elements));
+                blob buf(element_size, k);
+                for (size_t j = 0; j < k; j++)
+                {
+                    std::memcpy(buf.ptr(j * element_size), v.ptr(), element_size);
+                }
+                // The first part is written here: if libgta was built without
+                // positioned output, the element loop is used instead.
+                try
+                {
+                    hdr.pwrite_elements(fileno(fo), data_offset, 0, k, buf.ptr());
+                    written = true;
+                }
+                catch (gta::exception &e)
+                {
+                    if (e.result() != gta::system_error || e.sys_errno() != ENOSYS)
+                    {
+                        throw;
+                    }
+                }
+                if (written)
+                {
+                    parallel_for(hdr.elements() - k, part_elements, [&](uintmax_t begin, uintmax_t end)
+                            {
+                                for (uintmax_t e = k + begin; e < k + end; e += part_elements)
+                                {
+                                    hdr.pwrite_elements(fileno(fo), data_offset, e,
+                                            std::min(k + end - e, part_elements), buf.ptr());
+                                }
+                            });
+                    fio::seek(fo, checked_add(data_offset, hdr.data_size()), SEEK_SET, array_loop.filename_out());
+                }
+            }
+            if (!written)
+            {
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, gta::header(), hdr);
+                for (uintmax_t j = 0; j < hdr.elements(); j++)
+                {
+                    element_loop.write(v.ptr());
+                }
             }
         }
         array_loop.finish();
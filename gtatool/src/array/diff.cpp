@@ -253,6 +253,7 @@ extern "C" int gtatool_diff(int argc, char *argv[])
             
             gta::header hdro = hdri[0];
             hdro.set_compression(gta::none);
+            min_max_tags_unset(hdro);
             std::string nameo;
             array_loops[0].write(hdro, nameo);
             if (hdri[1].data_size() == 0)
@@ -263,28 +264,30 @@ extern "C" int gtatool_diff(int argc, char *argv[])
             element_loop_t element_loops[2];
             array_loops[0].start_element_loop(element_loops[0], hdri[0], hdro);
             array_loops[1].start_element_loop(element_loops[1], hdri[1], hdro);
-            blob element_buf(checked_cast<size_t>(hdro.element_size()));
             std::vector<size_t> component_offsets(hdro.components());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t c = 1; c < hdro.components(); c++)
             {
-                for (uintmax_t c = 0; c < hdro.components(); c++)
-                {
-                    component_offsets[c] = static_cast<const char*>(hdro.component(element_buf.ptr(), c))
-                        - element_buf.ptr<const char>();
-                }
+                component_offsets[c] = component_offsets[c - 1] + hdro.component_size(c - 1);
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t e = 0; e < hdro.elements(); )
             {
-                const void* e0 = element_loops[0].read();
-                const void* e1 = element_loops[1].read();
-                for (uintmax_t c = 0; c < hdro.components(); c++)
+                size_t n = element_loops[0].batch_size(hdro.elements() - e);
+                char* elements_out = static_cast<char*>(element_loops[0].write_buffer(n));
+                const char* elements_0 = static_cast<const char*>(element_loops[0].read(n));
+                const char* elements_1 = static_cast<const char*>(element_loops[1].read(n));
+                for (size_t k = 0; k < n; k++)
                 {
-                    diff(hdro.component_type(c), absolute.value(), force.value(),
-                            static_cast<const void*>(static_cast<const char*>(e0) + component_offsets[c]),
-                            static_cast<const void*>(static_cast<const char*>(e1) + component_offsets[c]),
-                            static_cast<void*>(element_buf.ptr<char>(component_offsets[c])));
+                    size_t offset = k * hdro.element_size();
+                    for (uintmax_t c = 0; c < hdro.components(); c++)
+                    {
+                        diff(hdro.component_type(c), absolute.value(), force.value(),
+                                static_cast<const void*>(elements_0 + offset + component_offsets[c]),
+                                static_cast<const void*>(elements_1 + offset + component_offsets[c]),
+                                static_cast<void*>(elements_out + offset + component_offsets[c]));
+                    }
                 }
-                element_loops[0].write(element_buf.ptr());
+                element_loops[0].write(elements_out, n);
+                e += n;
             }
         }
         array_loops[0].finish();
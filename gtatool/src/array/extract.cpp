@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <sstream>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cctype>
@@ -29,9 +30,9 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 #include "base/chk.h"
 
 #include "lib.h"
@@ -47,6 +48,135 @@ extern "C" void gtatool_extract_help(void)
             "Example: extract -l 10,10 -h 19,19 image.gta > image-10x10.gta");
 }
 
+/* Read the sub-array from a seekable, uncompressed input with block reads.
+ * The sub-array is read in slabs of at most one element loop batch: a slab
+ * covers the sub-array completely in the dimensions below k, and a range in
+ * dimension k. The slabs are the bricks of a brick cache, so that the next
+ * slab is read while the current one is written. */
+static void extract_blocks(const gta::header &hdri, FILE *f, uintmax_t data_offset,
+        element_loop_t &element_loop, const gta::header &hdro,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    const size_t dims = hdri.dimensions();
+    const uintmax_t max_elements = element_loop.batch_size(hdro.elements());
+    size_t k = 0;
+    uintmax_t slab_base = 1;
+    while (k < dims && slab_base * hdro.dimension_size(k) <= max_elements)
+    {
+        slab_base *= hdro.dimension_size(k);
+        k++;
+    }
+    uintmax_t k_step = (k < dims ? std::max(max_elements / slab_base, static_cast<uintmax_t>(1)) : 1);
+    std::vector<uintmax_t> lo(low), hi(high);
+    for (size_t d = k; d < dims; d++)
+    {
+        hi[d] = lo[d];
+    }
+    if (k < dims)
+    {
+        hi[k] = std::min(lo[k] + k_step - 1, high[k]);
+    }
+    std::vector<uintmax_t> brick_size(dims);
+    for (size_t d = 0; d < dims; d++)
+    {
+        brick_size[d] = hi[d] - lo[d] + 1;
+    }
+    brick_cache_t cache(hdri, f, data_offset, 2 * max_elements * hdri.element_size(), brick_size, low);
+    for (;;)
+    {
+        size_t n = checked_cast<size_t>(slab_base * (k < dims ? hi[k] - lo[k] + 1 : 1));
+        void *p = element_loop.write_buffer(n);
+        cache.read_block(&(lo[0]), &(hi[0]), p);
+        element_loop.write(p, n);
+        if (k == dims)
+        {
+            break;
+        }
+        if (hi[k] < high[k])
+        {
+            lo[k] = hi[k] + 1;
+            hi[k] = std::min(lo[k] + k_step - 1, high[k]);
+            continue;
+        }
+        lo[k] = low[k];
+        hi[k] = std::min(lo[k] + k_step - 1, high[k]);
+        size_t d;
+        for (d = k + 1; d < dims; d++)
+        {
+            if (lo[d] < high[d])
+            {
+                lo[d]++;
+                hi[d]++;
+                break;
+            }
+            lo[d] = low[d];
+            hi[d] = low[d];
+        }
+        if (d == dims)
+        {
+            break;
+        }
+    }
+}
+
+/* Read n input elements and either throw them away or copy them to the output. */
+static void pass_elements(element_loop_t &element_loop, uintmax_t n, bool copy)
+{
+    while (n > 0)
+    {
+        size_t k = element_loop.batch_size(n);
+        const void *src = element_loop.read(k);
+        if (copy)
+        {
+            element_loop.write(src, k);
+        }
+        n -= k;
+    }
+}
+
+/* Extract the sub-array from a sequential input. The sub-array consists of
+ * runs of elements that are contiguous in the input: a run covers the
+ * sub-array range in the lowest dimension that the sub-array does not span
+ * completely, and all dimensions below it. Everything between the runs is
+ * skipped in bulk. */
+static void extract_runs(const gta::header &hdri, element_loop_t &element_loop,
+        const std::vector<uintmax_t> &low, const std::vector<uintmax_t> &high)
+{
+    const size_t dims = hdri.dimensions();
+    size_t run_dim = 0;
+    uintmax_t run_base = 1;
+    while (run_dim + 1 < dims && low[run_dim] == 0 && high[run_dim] == hdri.dimension_size(run_dim) - 1)
+    {
+        run_base *= hdri.dimension_size(run_dim);
+        run_dim++;
+    }
+    uintmax_t run_length = run_base * (high[run_dim] - low[run_dim] + 1);
+    std::vector<uintmax_t> coords(low);
+    uintmax_t pos = 0;
+    for (;;)
+    {
+        uintmax_t start = hdri.indices_to_linear_index(&(coords[0]));
+        pass_elements(element_loop, start - pos, false);
+        pass_elements(element_loop, run_length, true);
+        pos = start + run_length;
+        size_t d;
+        for (d = run_dim + 1; d < dims; d++)
+        {
+            if (coords[d] < high[d])
+            {
+                coords[d]++;
+                break;
+            }
+            coords[d] = low[d];
+        }
+        if (d >= dims)
+        {
+            break;
+        }
+    }
+    pass_elements(element_loop, hdri.elements() - pos, false);
+}
+
 extern "C" int gtatool_extract(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -112,28 +242,29 @@ extern "C" int gtatool_extract(int argc, char *argv[])
             {
                 hdro.dimension_taglist(i) = hdri.dimension_taglist(i);
             }
+            if (hdro.elements() < hdri.elements())
+            {
+                min_max_tags_unset(hdro);
+            }
             array_loop.write(hdro, nameo);
 
             element_loop_t element_loop;
-            std::vector<uintmax_t> index(hdro.dimensions());
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            for (uintmax_t e = 0; e < hdri.elements(); e++)
+            if (hdri.data_size() == 0)
             {
-                const void *src = element_loop.read();
-                hdri.linear_index_to_indices(e, &(index[0]));
-                bool in_sub_array = true;
-                for (size_t i = 0; i < index.size(); i++)
-                {
-                    if (index[i] < low.value()[i] || index[i] > high.value()[i])
-                    {
-                        in_sub_array = false;
-                        break;
-                    }
-                }
-                if (in_sub_array)
-                {
-                    element_loop.write(src);
-                }
+                array_loop.skip_data(hdri);
+            }
+            else if (hdri.compression() == gta::none && fio::seekable(array_loop.file_in()))
+            {
+                uintmax_t data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                extract_blocks(hdri, array_loop.file_in(), data_offset, element_loop, hdro,
+                        low.value(), high.value());
+                fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                array_loop.skip_data(hdri);
+            }
+            else
+            {
+                extract_runs(hdri, element_loop, low.value(), high.value());
             }
         }
         array_loop.finish();
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
 
 #include <gta/gta.hpp>
 
@@ -119,6 +120,22 @@ extern "C" int gtatool_fill(int argc, char *argv[])
             }
             hdro = hdri;
             hdro.set_compression(gta::none);
+            bool fill_all = true;
+            for (size_t i = 0; i < low.value().size(); i++)
+            {
+                if (low.value()[i] > 0 || high.value()[i] < hdri.dimension_size(i) - 1)
+                {
+                    fill_all = false;
+                    break;
+                }
+            }
+            if (hdro.elements() > 0)
+            {
+                if (fill_all)
+                    min_max_tags_set_constant(hdro, v.ptr());
+                else
+                    min_max_tags_unset(hdro);
+            }
             array_loop.write(hdro, nameo);
 
             if (hdro.data_size() > 0)
@@ -126,23 +143,34 @@ extern "C" int gtatool_fill(int argc, char *argv[])
                 element_loop_t element_loop;
                 std::vector<uintmax_t> index(hdri.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                for (uintmax_t e0 = 0; e0 < hdro.elements(); )
                 {
-                    const void *src = element_loop.read();
-                    hdro.linear_index_to_indices(e, &(index[0]));
-                    bool replace = true;
-                    if (!low.values().empty())
+                    size_t n = element_loop.batch_size(hdro.elements() - e0);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    std::memcpy(elements, element_loop.read(n), n * hdro.element_size());
+                    for (size_t k = 0; k < n; k++)
                     {
-                        for (size_t i = 0; i < index.size(); i++)
+                        uintmax_t e = e0 + k;
+                        hdro.linear_index_to_indices(e, &(index[0]));
+                        bool replace = true;
+                        if (!low.values().empty())
                         {
-                            if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                            for (size_t i = 0; i < index.size(); i++)
                             {
-                                replace = false;
-                                break;
+                                if (index[i] < low.value()[i] || index[i] > high.value()[i])
+                                {
+                                    replace = false;
+                                    break;
+                                }
                             }
                         }
+                        if (replace)
+                        {
+                            std::memcpy(elements + k * hdro.element_size(), v.ptr(), hdro.element_size());
+                        }
                     }
-                    element_loop.write(replace ? v.ptr() : src);
+                    element_loop.write(elements, n);
+                    e0 += n;
                 }
             }
         }
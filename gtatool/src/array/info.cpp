@@ -25,6 +25,8 @@
 #include <cstdio>
 #include <cctype>
 #include <cmath>
+#include <memory>
+#include <limits>
 
 #include <gta/gta.hpp>
 
@@ -38,12 +40,17 @@
 extern "C" void gtatool_info_help(void)
 {
     msg::req_txt(
-            "info [-s|--statistics] [<files...>]\n"
+            "info [-s|--statistics] [-p|--percentiles=<p0>[,<p1>...]] [--histogram=<bins>] [<files...>]\n"
             "\n"
             "Print information about GTAs.\n"
             "If --statistics is given, simple statistics about the values in each component "
             "are computed and printed (in double precision, regardless of input type). Values "
-            "that are not finite numbers are ignored.");
+            "that are not finite numbers and values that match the NO_DATA_VALUE tag of the "
+            "component are ignored. For complex components, only the real part is used.\n"
+            "The --percentiles and --histogram options additionally compute the given percentiles "
+            "(in [0,100]) and a histogram with the given number of bins between the minimum and maximum "
+            "value. These are exact for 8 and 16 bit integer components and approximations with a relative "
+            "error of less than 1%% otherwise. Both options imply --statistics.");
 }
 
 extern "C" int gtatool_info(int argc, char *argv[])
@@ -53,6 +60,10 @@ extern "C" int gtatool_info(int argc, char *argv[])
     options.push_back(&help);
     opt::flag statistics("statistics", 's', opt::optional);
     options.push_back(&statistics);
+    opt::tuple<double> percentiles("percentiles", 'p', opt::optional, 0.0, 100.0);
+    options.push_back(&percentiles);
+    opt::val<size_t> histogram("histogram", '\0', opt::optional, 1, std::numeric_limits<size_t>::max());
+    options.push_back(&histogram);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -63,6 +74,7 @@ extern "C" int gtatool_info(int argc, char *argv[])
         gtatool_info_help();
         return 0;
     }
+    bool compute_statistics = (statistics.value() || percentiles.is_set() || histogram.is_set());
 
     try
     {
@@ -70,257 +82,19 @@ extern "C" int gtatool_info(int argc, char *argv[])
         gta::header hdr;
         std::string name;
         array_loop.start(arguments, "");
-        std::vector<double> minima;
-        std::vector<double> maxima;
-        std::vector<double> sum;
-        std::vector<double> squaresum;
-        std::vector<uintmax_t> valid_values;
+        std::unique_ptr<statistics_t> stats;
         while (array_loop.read(hdr, name))
         {
-            if (statistics.value() && hdr.data_size() != 0)
+            if (compute_statistics && hdr.data_size() != 0)
             {
-                minima.clear();
-                maxima.clear();
-                sum.clear();
-                squaresum.clear();
-                valid_values.clear();
-                minima.resize(checked_cast<size_t>(hdr.components()), +std::numeric_limits<double>::max());
-                maxima.resize(checked_cast<size_t>(hdr.components()), -std::numeric_limits<double>::max());
-                sum.resize(checked_cast<size_t>(hdr.components()), 0.0);
-                squaresum.resize(checked_cast<size_t>(hdr.components()), 0.0);
-                valid_values.resize(checked_cast<size_t>(hdr.components()), 0);
+                stats.reset(new statistics_t(hdr, percentiles.is_set() || histogram.is_set()));
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdr, hdr);
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                for (uintmax_t e = 0; e < hdr.elements(); )
                 {
-                    const void *element = element_loop.read();
-                    for (uintmax_t c = 0; c < hdr.components(); c++)
-                    {
-                        union
-                        {
-                            int8_t int8_v;
-                            uint8_t uint8_v;
-                            int16_t int16_v;
-                            uint16_t uint16_v;
-                            int32_t int32_v;
-                            uint32_t uint32_v;
-                            int64_t int64_v;
-                            uint64_t uint64_v;
-#ifdef HAVE_INT128_T
-                            int128_t int128_v;
-#endif
-#ifdef HAVE_UINT128_T
-                            uint128_t uint128_v;
-#endif
-                            float float_v;
-                            double double_v;
-#ifdef HAVE_FLOAT128_T
-                            float128_t float128_v;
-#endif
-                        } nodata_value;
-                        bool have_nodata_value = false;
-                        const char* tagval = hdr.component_taglist(c).get("NO_DATA_VALUE");
-                        if (tagval)
-                        {
-                            switch (hdr.component_type(c))
-                            {
-                            case gta::int8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int8_v) == 0);
-                                break;
-                            case gta::uint8:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint8_v) == 0);
-                                break;
-                            case gta::int16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int16_v) == 0);
-                                break;
-                            case gta::uint16:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint16_v) == 0);
-                                break;
-                            case gta::int32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int32_v) == 0);
-                                break;
-                            case gta::uint32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint32_v) == 0);
-                                break;
-                            case gta::int64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int64_v) == 0);
-                                break;
-                            case gta::uint64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint64_v) == 0);
-                                break;
-#ifdef HAVE_INT128_T
-                            case gta::int128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.int128_v) == 0);
-                                break;
-#endif
-#ifdef HAVE_UINT128_T
-                            case gta::uint128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.uint128_v) == 0);
-                                break;
-#endif
-                            case gta::float32:
-                            case gta::cfloat32:
-                                have_nodata_value = (str::to(tagval, &nodata_value.float_v) == 0);
-                                break;
-                            case gta::float64:
-                            case gta::cfloat64:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
-#ifdef HAVE_FLOAT128_T
-                            case gta::float128:
-                            case gta::cfloat128:
-                                have_nodata_value = (str::to(tagval, &nodata_value.double_v) == 0);
-                                break;
-#endif
-                            default:
-                                throw exc(std::string("cannot handle NO_DATA_VALUE for component type ")
-                                        + type_to_string(hdr.component_type(c), hdr.component_size(c)));
-                                break;
-                            }
-                        }
-                        const void *component = hdr.component(element, c);
-                        double val = std::numeric_limits<double>::quiet_NaN();
-                        switch (hdr.component_type(c))
-                        {
-                        case gta::int8:
-                            {
-                                int8_t v;
-                                memcpy(&v, component, sizeof(int8_t));
-                                if (!have_nodata_value || v != nodata_value.int8_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v;
-                                memcpy(&v, component, sizeof(uint8_t));
-                                if (!have_nodata_value || v != nodata_value.uint8_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v;
-                                memcpy(&v, component, sizeof(int16_t));
-                                if (!have_nodata_value || v != nodata_value.int16_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v;
-                                memcpy(&v, component, sizeof(uint16_t));
-                                if (!have_nodata_value || v != nodata_value.uint16_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v;
-                                memcpy(&v, component, sizeof(int32_t));
-                                if (!have_nodata_value || v != nodata_value.int32_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v;
-                                memcpy(&v, component, sizeof(uint32_t));
-                                if (!have_nodata_value || v != nodata_value.uint32_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v;
-                                memcpy(&v, component, sizeof(int64_t));
-                                if (!have_nodata_value || v != nodata_value.int64_v)
-                                    val = v;
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v;
-                                memcpy(&v, component, sizeof(uint64_t));
-                                if (!have_nodata_value || v != nodata_value.uint64_v)
-                                    val = v;
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v;
-                                memcpy(&v, component, sizeof(int128_t));
-                                if (!have_nodata_value || v != nodata_value.int128_v)
-                                    val = v;
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v;
-                                memcpy(&v, component, sizeof(uint128_t));
-                                if (!have_nodata_value || v != nodata_value.uint128_v)
-                                    val = v;
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                        case gta::cfloat32:
-                            {
-                                float v;
-                                memcpy(&v, component, sizeof(float));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.float_v, sizeof(float)) != 0)
-                                    val = v;
-                            }
-                            break;
-                        case gta::float64:
-                        case gta::cfloat64:
-                            {
-                                double v;
-                                memcpy(&v, component, sizeof(double));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(double)) != 0)
-                                    val = v;
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                        case gta::cfloat128:
-                            {
-                                float128_t v;
-                                memcpy(&v, component, sizeof(float128_t));
-                                if (!have_nodata_value || std::memcmp(&v, &nodata_value.double_v, sizeof(float128_t)) != 0)
-                                    val = v;
-                            }
-                            break;
-#endif
-                        default:
-                            throw exc(std::string("cannot compute minimum/maximum for component type ")
-                                    + type_to_string(hdr.component_type(c), hdr.component_size(c)));
-                            break;
-                        }
-                        if (std::isfinite(val))
-                        {
-                            if (valid_values[c] == 0)
-                            {
-                                minima[c] = val;
-                                maxima[c] = val;
-                                sum[c] = val;
-                                squaresum[c] = val * val;
-                            }
-                            else
-                            {
-                                if (val < minima[c])
-                                    minima[c] = val;
-                                else if (val > maxima[c])
-                                    maxima[c] = val;
-                                sum[c] += val;
-                                squaresum[c] += val * val;
-                            }
-                            valid_values[c]++;
-                        }
-                    }
+                    size_t n = element_loop.batch_size(hdr.elements() - e);
+                    stats->add(element_loop.read(n), n);
+                    e += n;
                 }
             }
             else
@@ -410,21 +184,33 @@ extern "C" int gtatool_info(int argc, char *argv[])
                 msg::req(4, std::string("element component ") + str::from(i) + ": "
                         + type_to_string(hdr.component_type(i), hdr.component_size(i)) + ", "
                         + str::human_readable_memsize(hdr.component_size(i)));
-                if (statistics.value() && hdr.data_size() != 0)
+                if (compute_statistics && hdr.data_size() != 0)
                 {
-                    msg::req(8, std::string("minimum value = ") + (valid_values[i] > 0 ? str::from(minima[i]) : "unavailable"));
-                    msg::req(8, std::string("maximum value = ") + (valid_values[i] > 0 ? str::from(maxima[i]) : "unavailable"));
-                    double mean = 0.0, variance = 0.0, deviation = 0.0;
-                    if (valid_values[i] > 0) {
-                        mean = sum[i] / valid_values[i];
+                    const statistics_t::component_statistics &cs = stats->get(i);
+                    double variance = stats->variance(i);
+                    msg::req(8, std::string("minimum value = ") + (cs.values > 0 ? str::from(cs.minimum) : "unavailable"));
+                    msg::req(8, std::string("maximum value = ") + (cs.values > 0 ? str::from(cs.maximum) : "unavailable"));
+                    msg::req(8, std::string("sample mean = ") + (cs.values > 0 ? str::from(cs.mean) : "unavailable"));
+                    msg::req(8, std::string("sample variance = ") + (cs.values > 1 ? str::from(variance) : "unavailable"));
+                    msg::req(8, std::string("sample deviation = ") + (cs.values > 1 ? str::from(std::sqrt(variance)) : "unavailable"));
+                    for (size_t j = 0; j < percentiles.value().size(); j++)
+                    {
+                        msg::req(8, std::string("percentile ") + str::from(percentiles.value()[j]) + " = "
+                                + (cs.values > 0 ? str::from(stats->percentile(i, percentiles.value()[j])) : "unavailable"));
                     }
-                    if (valid_values[i] > 1) {
-                        variance = (squaresum[i] - sum[i] / hdr.elements() * sum[i]) / (valid_values[i] - 1);
-                        deviation = std::sqrt(variance);
+                    if (histogram.is_set() && cs.values > 0)
+                    {
+                        std::vector<uintmax_t> bins = stats->histogram(i, histogram.value());
+                        msg::req(8, std::string("histogram:"));
+                        for (size_t j = 0; j < bins.size(); j++)
+                        {
+                            double t0 = static_cast<double>(j) / bins.size();
+                            double t1 = static_cast<double>(j + 1) / bins.size();
+                            msg::req(12, str::from(cs.minimum * (1.0 - t0) + cs.maximum * t0) + " - "
+                                    + str::from(cs.minimum * (1.0 - t1) + cs.maximum * t1)
+                                    + ": " + str::from(bins[j]));
+                        }
                     }
-                    msg::req(8, std::string("sample mean = ") + (valid_values[i] > 0 ? str::from(mean) : "unavailable"));
-                    msg::req(8, std::string("sample variance = ") + (valid_values[i] > 1 ? str::from(variance) : "unavailable"));
-                    msg::req(8, std::string("sample deviation = ") + (valid_values[i] > 1 ? str::from(deviation) : "unavailable"));
                 }
                 for (uintmax_t j = 0; j < hdr.component_taglist(i).tags(); j++)
                 {
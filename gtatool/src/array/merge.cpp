@@ -173,6 +173,10 @@ extern "C" int gtatool_merge(int argc, char *argv[])
             {
                 hdro.component_taglist(c) = hdri[0].component_taglist(c);
             }
+            for (size_t j = 1; j < arguments.size(); j++)
+            {
+                min_max_tags_merge(hdro, hdri[j]);
+            }
             array_loops[0].write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
 
 #include <gta/gta.hpp>
 
@@ -113,59 +114,91 @@ extern "C" int gtatool_resize(int argc, char *argv[])
             {
                 hdro.dimension_taglist(i) = hdri.dimension_taglist(i);
             }
+            // The value range stays known if the input array is kept
+            // completely; the fill value of new elements then extends it.
+            bool keep_input = true;
+            for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+            {
+                intmax_t idx = (index.values().empty() ? 0 : index.value()[i]);
+                if (idx < 0 || static_cast<uintmax_t>(idx) + hdri.dimension_size(i) > hdro.dimension_size(i))
+                {
+                    keep_input = false;
+                    break;
+                }
+            }
+            if (!keep_input)
+            {
+                min_max_tags_unset(hdro);
+            }
+            else if (hdro.elements() > hdri.elements())
+            {
+                min_max_tags_extend(hdro, v.ptr());
+            }
             array_loop.write(hdro, nameo);
 
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
+                const size_t element_size = checked_cast<size_t>(hdro.element_size());
+                const char *in_batch = NULL;
+                uintmax_t in_batch_begin = 0;   // linear index of the first input element in in_batch
                 uintmax_t read_in_elements = 0;
                 std::vector<intmax_t> in_index(hdri.dimensions());
+                std::vector<uintmax_t> requested_in_index(hdri.dimensions());
                 std::vector<uintmax_t> out_index(hdro.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
+                for (uintmax_t e0 = 0; e0 < hdro.elements(); )
                 {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_input = true;
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+                    size_t n = element_loop.batch_size(hdro.elements() - e0);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    for (size_t k = 0; k < n; k++)
                     {
-                        if (!index.values().empty())
+                        hdro.linear_index_to_indices(e0 + k, &(out_index[0]));
+                        bool from_input = true;
+                        for (uintmax_t i = 0; i < hdri.dimensions(); i++)
                         {
-                            in_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
-                        }
-                        else
-                        {
-                            in_index[i] = out_index[i];
-                        }
-                        if (in_index[i] < 0 || static_cast<uintmax_t>(in_index[i]) >= hdri.dimension_size(i))
-                        {
-                            from_input = false;
+                            if (!index.values().empty())
+                            {
+                                in_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            }
+                            else
+                            {
+                                in_index[i] = out_index[i];
+                            }
+                            if (in_index[i] < 0 || static_cast<uintmax_t>(in_index[i]) >= hdri.dimension_size(i))
+                            {
+                                from_input = false;
+                            }
+                            requested_in_index[i] = in_index[i];
                         }
-                    }
-                    const void *src = NULL;
-                    if (from_input)
-                    {
-                        std::vector<uintmax_t> requested_in_index(in_index.size());
-                        for (size_t i = 0; i < requested_in_index.size(); i++)
+                        const void *src = NULL;
+                        if (from_input)
                         {
-                            requested_in_index[i] = in_index[i];
+                            uintmax_t requested_linear_in_index = hdri.indices_to_linear_index(&(requested_in_index[0]));
+                            // elements are guaranteed to be in ascending order
+                            while (requested_linear_in_index >= read_in_elements)
+                            {
+                                size_t m = element_loop.batch_size(hdri.elements() - read_in_elements);
+                                in_batch = static_cast<const char *>(element_loop.read(m));
+                                in_batch_begin = read_in_elements;
+                                read_in_elements += m;
+                            }
+                            src = in_batch + (requested_linear_in_index - in_batch_begin) * element_size;
                         }
-                        uintmax_t requested_linear_in_index = hdri.indices_to_linear_index(&(requested_in_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_in_elements; i <= requested_linear_in_index; i++)
+                        else
                         {
-                            src = element_loop.read();
+                            src = v.ptr();
                         }
-                        read_in_elements = requested_linear_in_index + 1;
-                    }
-                    else
-                    {
-                        src = v.ptr();
+                        std::memcpy(elements + k * element_size, src, element_size);
                     }
-                    element_loop.write(src);
+                    element_loop.write(elements, n);
+                    e0 += n;
                 }
-                for (uintmax_t i = read_in_elements; i < hdri.elements(); i++)
+                while (read_in_elements < hdri.elements())
                 {
-                    element_loop.read();
+                    size_t m = element_loop.batch_size(hdri.elements() - read_in_elements);
+                    element_loop.read(m);
+                    read_in_elements += m;
                 }
             }
         }
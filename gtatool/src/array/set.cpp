@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
 
 #include <gta/gta.hpp>
 
@@ -108,57 +109,71 @@ extern "C" int gtatool_set(int argc, char *argv[])
             }
             hdro = hdri;
             hdro.set_compression(gta::none);
+            min_max_tags_unset(hdro);
             array_loop.write(hdro, nameo);
 
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
                 element_loop_t element_loop_src;
+                const size_t element_size = checked_cast<size_t>(hdro.element_size());
+                const char *src_batch = NULL;
+                uintmax_t src_batch_begin = 0;  // linear index of the first source element in src_batch
                 uintmax_t read_src_elements = 0;
                 std::vector<intmax_t> src_index(hdr_src.dimensions());
+                std::vector<uintmax_t> requested_src_index(hdr_src.dimensions());
                 std::vector<uintmax_t> out_index(hdro.dimensions());
                 array_loop.start_element_loop(element_loop, hdri, hdro);
                 array_loop_src.start_element_loop(element_loop_src, hdr_src, gta::header());
-                for (uintmax_t linear_out_index = 0; linear_out_index < hdro.elements(); linear_out_index++)
+                for (uintmax_t e0 = 0; e0 < hdro.elements(); )
                 {
-                    hdro.linear_index_to_indices(linear_out_index, &(out_index[0]));
-                    bool from_src = true;
-                    for (uintmax_t i = 0; i < hdr_src.dimensions(); i++)
+                    size_t n = element_loop.batch_size(hdro.elements() - e0);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    std::memcpy(elements, element_loop.read(n), n * element_size);
+                    for (size_t k = 0; k < n; k++)
                     {
-                        if (!index.values().empty())
-                        {
-                            src_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
-                        }
-                        else
-                        {
-                            src_index[i] = out_index[i];
-                        }
-                        if (src_index[i] < 0 || static_cast<uintmax_t>(src_index[i]) >= hdr_src.dimension_size(i))
-                        {
-                            from_src = false;
-                        }
-                    }
-                    const void *src = element_loop.read();
-                    if (from_src)
-                    {
-                        std::vector<uintmax_t> requested_src_index(src_index.size());
-                        for (size_t i = 0; i < requested_src_index.size(); i++)
+                        hdro.linear_index_to_indices(e0 + k, &(out_index[0]));
+                        bool from_src = true;
+                        for (uintmax_t i = 0; i < hdr_src.dimensions(); i++)
                         {
+                            if (!index.values().empty())
+                            {
+                                src_index[i] = checked_sub(checked_cast<intmax_t>(out_index[i]), index.value()[i]);
+                            }
+                            else
+                            {
+                                src_index[i] = out_index[i];
+                            }
+                            if (src_index[i] < 0 || static_cast<uintmax_t>(src_index[i]) >= hdr_src.dimension_size(i))
+                            {
+                                from_src = false;
+                            }
                             requested_src_index[i] = src_index[i];
                         }
-                        uintmax_t requested_linear_src_index = hdr_src.indices_to_linear_index(&(requested_src_index[0]));
-                        // elements are guaranteed to be in ascending order
-                        for (uintmax_t i = read_src_elements; i <= requested_linear_src_index; i++)
+                        if (from_src)
                         {
-                            src = element_loop_src.read();
+                            uintmax_t requested_linear_src_index = hdr_src.indices_to_linear_index(&(requested_src_index[0]));
+                            // elements are guaranteed to be in ascending order
+                            while (requested_linear_src_index >= read_src_elements)
+                            {
+                                size_t m = element_loop_src.batch_size(hdr_src.elements() - read_src_elements);
+                                src_batch = static_cast<const char *>(element_loop_src.read(m));
+                                src_batch_begin = read_src_elements;
+                                read_src_elements += m;
+                            }
+                            std::memcpy(elements + k * element_size,
+                                    src_batch + (requested_linear_src_index - src_batch_begin) * element_size,
+                                    element_size);
                         }
-                        read_src_elements = requested_linear_src_index + 1;
                     }
-                    element_loop.write(src);
+                    element_loop.write(elements, n);
+                    e0 += n;
                 }
-                for (uintmax_t i = read_src_elements; i < hdr_src.elements(); i++)
+                while (read_src_elements < hdr_src.elements())
                 {
-                    element_loop_src.read();
+                    size_t m = element_loop_src.batch_size(hdr_src.elements() - read_src_elements);
+                    element_loop_src.read(m);
+                    read_src_elements += m;
                 }
             }
             array_loop_src.finish();
@@ -24,11 +24,22 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
+#include "base/exc.h"
 #include "base/opt.h"
+#include "base/fio.h"
 #include "base/str.h"
 
 #include "lib.h"
@@ -40,14 +51,26 @@ extern "C" void gtatool_tag_help(void)
             "tag [--get-global=<name>] [--set-global=<name=value>] [--unset-global=<name>] [--unset-global-all] "
             "[--get-dimension=<dim>,<name>] [--set-dimension=<dim>,<name=value>] [--unset-dimension=<dim>,<name>] [--unset-dimension-all=<dim>] "
             "[--get-component=<cmp>,<name>] [--set-component=<cmp>,<name=value>] [--unset-component=<cmp>,<name>] [--unset-component-all=<cmp>] "
-            "[--unset-all] [<files...>]\n"
+            "[--unset-all] [--set-min-max=<cmp>] [--padding=<n>] [-i|--in-place] [<files...>]\n"
             "\n"
             "Read GTAs, get or set tags as requested, and write the GTAs to standard output.\n"
+            "With --in-place, the given files are modified instead. The headers are rewritten in place "
+            "if the new headers fit into the space of the old ones (using the padding reserved in them) "
+            "and the data is stored in native form; otherwise each file is rewritten completely, "
+            "with a header padding of at least <n> bytes (default 4096) so that later changes fit. "
+            "In this case, the padding is chosen so that the array data starts at a multiple of 4096 bytes.\n"
+            "Without --in-place, --padding sets the header padding of the output arrays; by default, "
+            "the padding of the input arrays is kept. A padding must be 0 or at least 13 bytes.\n"
             "Control characters are automatically stripped from the beginning and end of tag names and values.\n"
             "A tag name must not be empty, and must not contain control characters or the character '='.\n"
             "A tag value must not contain control characters (but can be empty or contain '=').\n"
+            "The global tag GTA/PADDING is reserved for the header padding and cannot be set.\n"
             "Options that require a dimension index <dim> or a component index <cmp> also accept the keyword 'all' instead, "
-            "with the effect that the option is applied to all dimensions or components.");
+            "with the effect that the option is applied to all dimensions or components.\n"
+            "The --set-min-max option sets the MIN_VALUE and MAX_VALUE tags of a component to the range of its values "
+            "(see the --statistics option of the info command), or removes them if the component has no such values "
+            "or if the range cannot be represented exactly (complex components, large 64 and 128 bit integers). "
+            "Other commands keep these tags current or remove them when they change the data.");
 }
 
 class tag_command
@@ -76,7 +99,8 @@ public:
         SET_COMPONENT,
         UNSET_COMPONENT,
         UNSET_COMPONENT_ALL,
-        UNSET_ALL
+        UNSET_ALL,
+        SET_MIN_MAX
     };
 
     tag_command(int cmd, uintmax_t index, bool index_all, const std::string &name, const std::string &value) throw ()
@@ -84,7 +108,13 @@ public:
     {
     }
 
-    void apply(gta::header &hdr, const std::string &array_name)
+    int cmd() const throw ()
+    {
+        return _cmd;
+    }
+
+    // stats are the statistics of the array data, or NULL if the array is empty
+    void apply(gta::header &hdr, const std::string &array_name, statistics_t *stats)
     {
         switch (_cmd)
         {
@@ -98,6 +128,10 @@ public:
         case SET_GLOBAL:
             {
                 hdr.global_taglist().set(to_utf8(_name).c_str(), to_utf8(_value).c_str());
+                if (hdr.global_taglist().get("GTA/PADDING"))
+                {
+                    throw exc(array_name + ": the global tag GTA/PADDING is reserved for the header padding");
+                }
             }
             break;
 
@@ -315,6 +349,32 @@ public:
             }
             break;
 
+        case SET_MIN_MAX:
+            {
+                if (hdr.components() == 0)
+                {
+                    throw exc(array_name + ": array has no components");
+                }
+                uintmax_t a = 0, b = hdr.components() - 1;
+                if (!_index_all)
+                {
+                    if (_index >= hdr.components())
+                    {
+                        throw exc(array_name + ": component index too big");
+                    }
+                    a = _index;
+                    b = _index;
+                }
+                for (uintmax_t i = a; i <= b; i++)
+                {
+                    if (stats)
+                        min_max_tags_set(hdr, i, *stats);
+                    else
+                        min_max_tags_unset(hdr, i);
+                }
+            }
+            break;
+
         default:
             /* cannot happen */
             break;
@@ -324,6 +384,162 @@ public:
 
 std::vector<tag_command> tag_commands;
 
+static void apply_tag_commands(gta::header &hdr, const std::string &array_name, statistics_t *stats)
+{
+    for (uintmax_t i = 0; i < tag_commands.size(); i++)
+    {
+        tag_commands[i].apply(hdr, array_name, stats);
+    }
+}
+
+// Try to give the header the given size by adjusting its padding
+static bool fit_header(gta::header &hdr, uintmax_t size)
+{
+    hdr.set_header_padding(0);
+    uintmax_t size0 = hdr.header_size();
+    if (size0 == size)
+    {
+        return true;
+    }
+    if (size0 > size || size - size0 < 13)
+    {
+        return false;
+    }
+    hdr.set_header_padding(size - size0);
+    if (hdr.header_size() > size && size - size0 >= 13 + 9)
+    {
+        // The padding added a chunk (9 bytes of chunk information) to the header
+        hdr.set_header_padding(size - size0 - 9);
+    }
+    return (hdr.header_size() == size);
+}
+
+// Get the file that a path refers to, with all symbolic links resolved
+static std::string resolve_symlinks(const std::string &filename)
+{
+#if W32
+    return filename;
+#else
+    char *resolved = ::realpath(fio::to_sys(filename).c_str(), NULL);
+    if (!resolved)
+    {
+        throw exc(std::string("Cannot resolve ") + fio::to_sys(filename) + ": " + std::strerror(errno), errno);
+    }
+    std::string s(resolved);
+    std::free(resolved);
+    return fio::from_sys(s);
+#endif
+}
+
+static void tag_in_place(const std::string &filename, bool need_statistics, uintmax_t padding)
+{
+    FILE *f = fio::open(filename, "r+");
+    FILE *ft = NULL;
+    std::string tmpname;
+    try
+    {
+        std::vector<gta::header> headers;
+        std::vector<off_t> offsets;
+        bool fits = true;
+        while (fio::has_more(f, filename))
+        {
+            std::string array_name = filename + " array " + str::from(headers.size());
+            off_t offset = fio::tell(f, filename);
+            gta::header hdri;
+            hdri.read_from(f);
+            off_t data_offset = fio::tell(f, filename);
+            std::unique_ptr<statistics_t> stats;
+            if (need_statistics && hdri.data_size() > 0)
+            {
+                element_loop_t element_loop;
+                element_loop.start(hdri, array_name, f, hdri, array_name, NULL);
+                stats.reset(new statistics_t(hdri));
+                for (uintmax_t e = 0; e < hdri.elements(); )
+                {
+                    size_t n = element_loop.batch_size(hdri.elements() - e);
+                    stats->add(element_loop.read(n), n);
+                    e += n;
+                }
+            }
+            fio::seek(f, data_offset, SEEK_SET, filename);
+            hdri.skip_data(f);
+            gta::header hdro = hdri;
+            hdro.set_compression(gta::none);
+            apply_tag_commands(hdro, array_name, stats.get());
+            // The header is written in host endianness, so the data must be too
+            fits = fits && hdri.data_is_native() && fit_header(hdro, data_offset - offset);
+            headers.push_back(std::move(hdro));
+            offsets.push_back(offset);
+        }
+        if (fits)
+        {
+            for (size_t i = 0; i < headers.size(); i++)
+            {
+                fio::seek(f, offsets[i], SEEK_SET, filename);
+                headers[i].write_to(f);
+            }
+            FILE *tmpf = f;
+            f = NULL;
+            fio::close(tmpf, filename);
+        }
+        else
+        {
+            // Write a new file next to the file that filename refers to, give it
+            // the owner and permissions of the old one, and replace the old one.
+            std::string target = resolve_symlinks(filename);
+            struct stat st;
+            fio::stat(f, &st, filename);
+            tmpname = fio::mktempfile(&ft, fio::dirname(target));
+#if !W32
+            if (::fchown(fileno(ft), st.st_uid, st.st_gid) != 0)
+            {
+                msg::wrn_txt("%s: cannot keep the owner of the file: %s", filename.c_str(), std::strerror(errno));
+            }
+            if (::fchmod(fileno(ft), st.st_mode & 07777) != 0)
+            {
+                throw exc(std::string("Cannot set permissions of ") + fio::to_sys(tmpname)
+                        + ": " + std::strerror(errno), errno);
+            }
+#endif
+            fio::rewind(f, filename);
+            for (size_t i = 0; i < headers.size(); i++)
+            {
+                gta::header hdri;
+                hdri.read_from(f);
+                if (padding > 0)
+                {
+                    headers[i].align(fio::tell(ft, tmpname), padding, 4096);
+                }
+                else
+                {
+                    headers[i].set_header_padding(0);
+                }
+                headers[i].write_to(ft);
+                hdri.copy_data(f, headers[i], ft);
+            }
+            FILE *tmpf = ft;
+            ft = NULL;
+            fio::close(tmpf, tmpname);
+            tmpf = f;
+            f = NULL;
+            fio::close(tmpf, filename);
+            fio::rename(tmpname, target);
+        }
+    }
+    catch (...)
+    {
+        if (f)
+            std::fclose(f);
+        if (ft)
+            std::fclose(ft);
+        if (!tmpname.empty())
+        {
+            try { fio::remove(tmpname); } catch (...) { }
+        }
+        throw;
+    }
+}
+
 class opt_tag_command : public opt::option
 {
     private:
@@ -508,6 +724,12 @@ class opt_tag_command : public opt::option
                 tag_commands.push_back(tag_command(_tag_cmd, 0, false, "", ""));
                 break;
 
+            case tag_command::SET_MIN_MAX:
+                if (!parse_index(s, &index, &index_all))
+                    return false;
+                tag_commands.push_back(tag_command(_tag_cmd, index, index_all, "", ""));
+                break;
+
             default:
                 /* cannot happen */
                 break;
@@ -547,6 +769,12 @@ extern "C" int gtatool_tag(int argc, char *argv[])
     options.push_back(&unset_component_all);
     opt_tag_command unset_all("unset-all", tag_command::UNSET_ALL);
     options.push_back(&unset_all);
+    opt_tag_command set_min_max("set-min-max", tag_command::SET_MIN_MAX);
+    options.push_back(&set_min_max);
+    opt::val<uintmax_t> padding("padding", '\0', opt::optional, 4096);
+    options.push_back(&padding);
+    opt::flag in_place("in-place", 'i', opt::optional);
+    options.push_back(&in_place);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -558,22 +786,90 @@ extern "C" int gtatool_tag(int argc, char *argv[])
         return 0;
     }
 
+    if (in_place.value() && arguments.empty())
+    {
+        msg::err_txt("in-place mode requires file names");
+        return 1;
+    }
+
     try
     {
+        bool need_statistics = false;
+        for (uintmax_t i = 0; i < tag_commands.size(); i++)
+        {
+            if (tag_commands[i].cmd() == tag_command::SET_MIN_MAX)
+            {
+                need_statistics = true;
+            }
+        }
+        if (in_place.value())
+        {
+            for (size_t i = 0; i < arguments.size(); i++)
+            {
+                tag_in_place(arguments[i], need_statistics, padding.value());
+            }
+            return 0;
+        }
         array_loop_t array_loop;
         gta::header hdri, hdro;
         std::string namei, nameo;
         array_loop.start(arguments, "");
         while (array_loop.read(hdri, namei))
         {
+            // The header precedes the data, so the data is read twice to
+            // compute statistics: from the input if it can be seeked to,
+            // and from a temporary buffer otherwise.
+            std::unique_ptr<statistics_t> stats;
+            uintmax_t data_offset = 0;
+            FILE *fbuf = NULL;
+            gta::header hbuf;
+            if (need_statistics && hdri.data_size() > 0)
+            {
+                element_loop_t element_loop;
+                if (!fio::seekable(array_loop.file_in()) || hdri.compression() != gta::none)
+                {
+                    buffer_data(hdri, array_loop.file_in(), hbuf, &fbuf);
+                    fio::rewind(fbuf);
+                    element_loop.start(hbuf, namei, fbuf, hbuf, namei, NULL);
+                }
+                else
+                {
+                    data_offset = fio::tell(array_loop.file_in(), array_loop.filename_in());
+                    array_loop.start_element_loop(element_loop, hdri, hdri);
+                }
+                stats.reset(new statistics_t(hdri));
+                for (uintmax_t e = 0; e < hdri.elements(); )
+                {
+                    size_t n = element_loop.batch_size(hdri.elements() - e);
+                    stats->add(element_loop.read(n), n);
+                    e += n;
+                }
+                if (fbuf)
+                {
+                    fio::rewind(fbuf);
+                }
+                else
+                {
+                    fio::seek(array_loop.file_in(), data_offset, SEEK_SET, array_loop.filename_in());
+                }
+            }
             hdro = hdri;
             hdro.set_compression(gta::none);
-            for (uintmax_t i = 0; i < tag_commands.size(); i++)
+            apply_tag_commands(hdro, namei, stats.get());
+            if (!padding.values().empty())
             {
-                tag_commands[i].apply(hdro, namei);
+                hdro.set_header_padding(padding.value());
             }
             array_loop.write(hdro, nameo);
-            array_loop.copy_data(hdri, hdro);
+            if (fbuf)
+            {
+                hbuf.copy_data(fbuf, hdro, array_loop.file_out());
+                fclose(fbuf);
+            }
+            else
+            {
+                array_loop.copy_data(hdri, hdro);
+            }
         }
         array_loop.finish();
     }
@@ -739,6 +739,40 @@ error_exit:
         }
     }
 
+    void pwrite(const void *src, size_t s, off_t offset, FILE *f, const std::string &filename)
+    {
+#if HAVE_PWRITE
+        const char *p = static_cast<const char *>(src);
+        int fd = fileno(f);
+        while (s > 0)
+        {
+            ssize_t r = ::pwrite(fd, p, s, offset);
+            if (r < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (r <= 0)
+            {
+                throw exc(std::string("Cannot write to ")
+                        + (!filename.empty() ? to_sys(filename) : "temporary file")
+                        + ": " + std::strerror(r < 0 ? errno : EIO), r < 0 ? errno : EIO);
+            }
+            p += r;
+            s -= r;
+            offset += r;
+        }
+#else
+        if (s > 0)
+        {
+            off_t pos = tell(f, filename);
+            seek(f, offset, SEEK_SET, filename);
+            write(src, s, 1, f, filename);
+            flush(f, filename);
+            seek(f, pos, SEEK_SET, filename);
+        }
+#endif
+    }
+
     void flush(FILE *f, const std::string &filename)
     {
         if (::fflush(f) != 0)
@@ -901,14 +935,16 @@ error_exit:
     {
 #if HAVE_MMAP
 
+        // mmap() needs an offset that is a multiple of the page size
+        off_t pad = offset % ::sysconf(_SC_PAGESIZE);
         void *retval;
-        if ((retval = ::mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(f), offset)) == MAP_FAILED)
+        if ((retval = ::mmap(NULL, length + pad, PROT_READ, MAP_PRIVATE, fileno(f), offset - pad)) == MAP_FAILED)
         {
             throw exc(std::string("Cannot map ")
                     + (!filename.empty() ? to_sys(filename) : "temporary file")
                     + " to memory: " + std::strerror(errno), errno);
         }
-        return retval;
+        return static_cast<uint8_t *>(retval) + pad;
 
 #else
 
@@ -933,7 +969,8 @@ error_exit:
     {
 #if HAVE_MMAP
 
-        if (::munmap(start, length) != 0)
+        size_t pad = reinterpret_cast<uintptr_t>(start) % ::sysconf(_SC_PAGESIZE);
+        if (::munmap(static_cast<uint8_t *>(start) - pad, length + pad) != 0)
         {
             throw exc(std::string("Cannot unmap ")
                     + (!filename.empty() ? to_sys(filename) : "temporary file")
@@ -1066,6 +1103,16 @@ error_exit:
         return r == 0;
     }
 
+    void stat(FILE *f, struct stat *buf, const std::string &filename)
+    {
+        if (::fstat(fileno(f), buf) != 0)
+        {
+            throw exc(std::string("Cannot stat ")
+                    + (!filename.empty() ? to_sys(filename) : "temporary file")
+                    + ": " + std::strerror(errno), errno);
+        }
+    }
+
     void mkdir_p(const std::string &prefix, const std::string &dirname)
     {
         std::string p(to_sys(prefix));
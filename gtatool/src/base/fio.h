@@ -109,6 +109,10 @@ namespace fio
     void read(void *dest, size_t s, size_t n, FILE *f, const std::string &filename = std::string(""));
     void write(const void *src, size_t s, size_t n, FILE *f, const std::string &filename = std::string(""));
 
+    // pwrite replacement: write s bytes at the given offset without changing
+    // the file position. The stream must have been flushed.
+    void pwrite(const void *src, size_t s, off_t offset, FILE *f, const std::string &filename = std::string(""));
+
     // flush
     void flush(FILE *f, const std::string &filename = std::string(""));
 
@@ -139,6 +143,7 @@ namespace fio
     // mmap/munmap replacements
     // These wrappers support only a very limited subset of the real mmap/munmap:
     // - Mapping happens always with MAP_PRIVATE, PROT_READ
+    // - The offset does not need to be a multiple of the page size
     // - The region of the file must exist; it is not automatically created
     // - The length argument must be the same for both functions
     void *map(FILE *f, off_t offset, size_t length, const std::string &filename = std::string(""));
@@ -165,8 +170,9 @@ namespace fio
     // those that match the given glob pattern (empty pattern: return all).
     std::vector<std::string> readdir(const std::string &dirname, const std::string &pattern = "");
 
-    // stat
+    // stat and fstat
     bool stat(const std::string &pathname, struct stat *buf);
+    void stat(FILE *f, struct stat *buf, const std::string &filename = std::string(""));
 
     // replacements for shell utilities:
     // mkdir -p  (with a variant that assumes that a given prefix already exists)
@@ -131,6 +131,7 @@ CMD_DECL(set)
 CMD_DECL(stream_extract)
 CMD_DECL(stream_foreach)
 CMD_DECL(stream_grep)
+CMD_DECL(stream_index)
 CMD_DECL(stream_merge)
 CMD_DECL(stream_split)
 CMD_DECL(tag)
@@ -262,6 +263,8 @@ static cmd_t cmds[] =
             "Run a command for each array in a stream"),
     CMD("stream-grep",       cmd_stream,     stream_grep,       true,          BUILTIN,
             "Select arrays from stream based on checks"),
+    CMD("stream-index",      cmd_stream,     stream_index,      true,          BUILTIN,
+            "Build index for direct access to arrays in streams"),
     CMD("stream-merge",      cmd_stream,     stream_merge,      true,          BUILTIN,
             "Merge arrays into stream"),
     CMD("stream-split",      cmd_stream,     stream_split,      true,          BUILTIN,
@@ -156,31 +156,37 @@ extern "C" int gtatool_component_add(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
             size_t old_comp_pre_size = 0;
             for (uintmax_t i = 0; i < hdro_new_comp_index; i++)
             {
                 old_comp_pre_size += hdro.component_size(i);
             }
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t e = 0; e < hdro.elements(); )
             {
-                const void *element_in = NULL;
+                size_t n = element_loop.batch_size(hdro.elements() - e);
+                char *elements_out = static_cast<char *>(element_loop.write_buffer(n));
+                const char *elements_in = NULL;
                 if (hdri.element_size() > 0)
                 {
-                    element_in = element_loop.read();
+                    elements_in = static_cast<const char *>(element_loop.read(n));
                 }
-                if (element_in)
+                for (size_t k = 0; k < n; k++)
                 {
-                    std::memcpy(element_out.ptr(), element_in, old_comp_pre_size);
+                    char *element_out = elements_out + k * hdro.element_size();
+                    if (elements_in)
+                    {
+                        std::memcpy(element_out, elements_in + k * hdri.element_size(), old_comp_pre_size);
+                    }
+                    std::memcpy(element_out + old_comp_pre_size, comp_values.ptr(), hdrt.element_size());
+                    if (elements_in)
+                    {
+                        std::memcpy(element_out + old_comp_pre_size + hdrt.element_size(),
+                                elements_in + k * hdri.element_size() + old_comp_pre_size,
+                                hdri.element_size() - old_comp_pre_size);
+                    }
                 }
-                std::memcpy(element_out.ptr(old_comp_pre_size), comp_values.ptr(), hdrt.element_size());
-                if (element_in)
-                {
-                    std::memcpy(element_out.ptr(old_comp_pre_size + hdrt.element_size()),
-                            static_cast<const char *>(element_in) + old_comp_pre_size,
-                            hdri.element_size() - old_comp_pre_size);
-                }
-                element_loop.write(element_out.ptr());
+                element_loop.write(elements_out, n);
+                e += n;
             }
         }
         array_loop.finish();
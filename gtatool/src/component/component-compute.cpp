@@ -22,6 +22,10 @@
 #include "config.h"
 
 #include <sstream>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
@@ -56,6 +60,12 @@ extern "C" void gtatool_component_compute_help(void)
             "non-modifiable variables are defined: c (the number of components of an array element), "
             "d (the number of dimensions of the array), d0..d(d-1) (the array size in each dimension), "
             "i0..i(d-1) (the index of the current array element).\n"
+            "Neighboring elements can be accessed for stencil computations: comp(k, j0, ..., j(d-1)) and "
+            "compim(k, j0, ..., j(d-1)) return the real and imaginary part of component k of the input element "
+            "with indices j0..j(d-1); indices outside of the array are clamped to its bounds. "
+            "Using these functions requires the input array to fit into memory.\n"
+            "Expressions are evaluated for blocks of elements, distributed over all available processor cores, "
+            "unless they use one of the random number functions.\n"
             "The expressions are evaluated using the muParser library, with additions taken from mucalc. See "
             "<https://git.marlam.de/gitweb/?p=mucalc.git> for an overview "
             "of functions and operators that can be used.\n"
@@ -160,6 +170,467 @@ static double my_random()
 }
 
 
+/* Stencil access to the input array: comp(k, i0, ..., i(d-1)) and
+ * compim(k, i0, ..., i(d-1)) return the real and imaginary part of component k
+ * of the input element at the given indices, which are clamped to the array
+ * bounds. They read from an unmodified copy of the input array, so that their
+ * results do not depend on the order in which elements are computed. */
+
+static const gta::header *stencil_header = NULL;
+static const unsigned char *stencil_data = NULL;
+
+template<typename T>
+static double get_value(const unsigned char *p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+static double component_value(const gta::header &hdr, const unsigned char *element, uintmax_t i, bool imag)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(hdr.component(element, i));
+    gta::type t = hdr.component_type(i);
+    if (imag)
+    {
+        if (t != gta::cfloat32 && t != gta::cfloat64 && t != gta::cfloat128)
+            return 0.0;
+        p += hdr.component_size(i) / 2;
+    }
+    switch (t)
+    {
+    case gta::int8:
+        return get_value<int8_t>(p);
+    case gta::uint8:
+        return get_value<uint8_t>(p);
+    case gta::int16:
+        return get_value<int16_t>(p);
+    case gta::uint16:
+        return get_value<uint16_t>(p);
+    case gta::int32:
+        return get_value<int32_t>(p);
+    case gta::uint32:
+        return get_value<uint32_t>(p);
+    case gta::int64:
+        return get_value<int64_t>(p);
+    case gta::uint64:
+        return get_value<uint64_t>(p);
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        return get_value<int128_t>(p);
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        return get_value<uint128_t>(p);
+#endif
+    case gta::float32:
+    case gta::cfloat32:
+        return get_value<float>(p);
+    case gta::float64:
+    case gta::cfloat64:
+        return get_value<double>(p);
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+    case gta::cfloat128:
+        return get_value<float128_t>(p);
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        return 0.0;
+    }
+}
+
+static double stencil_value(const double *args, int n, bool imag)
+{
+    const gta::header &hdr = *stencil_header;
+    std::string name = (imag ? "compim" : "comp");
+    if (n < 1 || static_cast<uintmax_t>(n - 1) != hdr.dimensions())
+    {
+        throw mu::Parser::exception_type(name + "(): expected a component number and "
+                + str::from(hdr.dimensions()) + " indices");
+    }
+    if (!(args[0] >= 0.0 && args[0] < hdr.components()))
+    {
+        throw mu::Parser::exception_type(name + "(): invalid component number");
+    }
+    uintmax_t k = args[0];
+    uintmax_t linear_index = 0;
+    uintmax_t factor = 1;
+    for (uintmax_t j = 0; j < hdr.dimensions(); j++)
+    {
+        double x = args[1 + j];
+        uintmax_t size = hdr.dimension_size(j);
+        uintmax_t index = (!(x > 0.0) ? 0 : x >= size - 1 ? size - 1 : static_cast<uintmax_t>(x));
+        linear_index += index * factor;
+        factor *= size;
+    }
+    return component_value(hdr, stencil_data + linear_index * hdr.element_size(), k, imag);
+}
+
+static double comp(const double *args, int n)
+{
+    return stencil_value(args, n, false);
+}
+
+static double compim(const double *args, int n)
+{
+    return stencil_value(args, n, true);
+}
+
+/* Collect the names of all identifiers used in an expression */
+static void get_identifiers(const std::string &expression, std::set<std::string> &identifiers)
+{
+    for (size_t i = 0; i < expression.length(); )
+    {
+        if (std::isalpha(static_cast<unsigned char>(expression[i])) || expression[i] == '_')
+        {
+            size_t j = i + 1;
+            while (j < expression.length()
+                    && (std::isalnum(static_cast<unsigned char>(expression[j])) || expression[j] == '_'))
+            {
+                j++;
+            }
+            identifiers.insert(expression.substr(i, j - i));
+            i = j;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(expression[i])))
+        {
+            // skip numbers such as 1e5
+            while (i < expression.length()
+                    && (std::isalnum(static_cast<unsigned char>(expression[i])) || expression[i] == '.'))
+            {
+                i++;
+            }
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/* Conversion between component values and the double variables of a block */
+
+template<typename T>
+static void load_values(const unsigned char *src, size_t stride, size_t n, double *dst)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        T v;
+        std::memcpy(&v, src + k * stride, sizeof(T));
+        dst[k] = v;
+    }
+}
+
+template<typename T>
+static void store_values(const double *src, size_t n, unsigned char *dst, size_t stride)
+{
+    for (size_t k = 0; k < n; k++)
+    {
+        T v = src[k];
+        std::memcpy(dst + k * stride, &v, sizeof(T));
+    }
+}
+
+static void load_component(gta::type t, const unsigned char *src, size_t stride, size_t n, double *re, double *im)
+{
+    switch (t)
+    {
+    case gta::int8:
+        load_values<int8_t>(src, stride, n, re);
+        break;
+    case gta::uint8:
+        load_values<uint8_t>(src, stride, n, re);
+        break;
+    case gta::int16:
+        load_values<int16_t>(src, stride, n, re);
+        break;
+    case gta::uint16:
+        load_values<uint16_t>(src, stride, n, re);
+        break;
+    case gta::int32:
+        load_values<int32_t>(src, stride, n, re);
+        break;
+    case gta::uint32:
+        load_values<uint32_t>(src, stride, n, re);
+        break;
+    case gta::int64:
+        load_values<int64_t>(src, stride, n, re);
+        break;
+    case gta::uint64:
+        load_values<uint64_t>(src, stride, n, re);
+        break;
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        load_values<int128_t>(src, stride, n, re);
+        break;
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        load_values<uint128_t>(src, stride, n, re);
+        break;
+#endif
+    case gta::float32:
+        load_values<float>(src, stride, n, re);
+        break;
+    case gta::float64:
+        load_values<double>(src, stride, n, re);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+        load_values<float128_t>(src, stride, n, re);
+        break;
+#endif
+    case gta::cfloat32:
+        load_values<float>(src, stride, n, re);
+        load_values<float>(src + sizeof(float), stride, n, im);
+        break;
+    case gta::cfloat64:
+        load_values<double>(src, stride, n, re);
+        load_values<double>(src + sizeof(double), stride, n, im);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::cfloat128:
+        load_values<float128_t>(src, stride, n, re);
+        load_values<float128_t>(src + sizeof(float128_t), stride, n, im);
+        break;
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        break;
+    }
+}
+
+static void store_component(gta::type t, const double *re, const double *im, size_t n, unsigned char *dst, size_t stride)
+{
+    switch (t)
+    {
+    case gta::int8:
+        store_values<int8_t>(re, n, dst, stride);
+        break;
+    case gta::uint8:
+        store_values<uint8_t>(re, n, dst, stride);
+        break;
+    case gta::int16:
+        store_values<int16_t>(re, n, dst, stride);
+        break;
+    case gta::uint16:
+        store_values<uint16_t>(re, n, dst, stride);
+        break;
+    case gta::int32:
+        store_values<int32_t>(re, n, dst, stride);
+        break;
+    case gta::uint32:
+        store_values<uint32_t>(re, n, dst, stride);
+        break;
+    case gta::int64:
+        store_values<int64_t>(re, n, dst, stride);
+        break;
+    case gta::uint64:
+        store_values<uint64_t>(re, n, dst, stride);
+        break;
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        store_values<int128_t>(re, n, dst, stride);
+        break;
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        store_values<uint128_t>(re, n, dst, stride);
+        break;
+#endif
+    case gta::float32:
+        store_values<float>(re, n, dst, stride);
+        break;
+    case gta::float64:
+        store_values<double>(re, n, dst, stride);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+        store_values<float128_t>(re, n, dst, stride);
+        break;
+#endif
+    case gta::cfloat32:
+        store_values<float>(re, n, dst, stride);
+        store_values<float>(im, n, dst + sizeof(float), stride);
+        break;
+    case gta::cfloat64:
+        store_values<double>(re, n, dst, stride);
+        store_values<double>(im, n, dst + sizeof(double), stride);
+        break;
+#ifdef HAVE_FLOAT128_T
+    case gta::cfloat128:
+        store_values<float128_t>(re, n, dst, stride);
+        store_values<float128_t>(im, n, dst + sizeof(float128_t), stride);
+        break;
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        break;
+    }
+}
+
+static bool is_complex(gta::type t)
+{
+    return (t == gta::cfloat32 || t == gta::cfloat64 || t == gta::cfloat128);
+}
+
+/* Evaluates the expressions on blocks of elements, using the bulk mode of
+ * muParser: each variable is an array that holds one value per element of
+ * the block, and one Eval() call computes the whole block.
+ * An evaluator must only be used by one thread at a time. */
+class evaluator
+{
+private:
+    static const size_t _block_size = 4096;
+
+    const gta::header &_hdr;
+    std::vector<size_t> _offsets;               // component offsets in an element
+    std::vector<mu::Parser> _parsers;
+    std::vector<std::vector<double>> _comp_vars;
+    std::vector<double> _components_var;
+    std::vector<double> _dimensions_var;
+    std::vector<std::vector<double>> _dim_vars;
+    std::vector<std::vector<double>> _index_vars;
+    std::vector<uintmax_t> _indices;
+    std::vector<double> _results;
+
+public:
+    evaluator(const gta::header &hdr, const std::vector<std::string> &expressions) :
+        _hdr(hdr),
+        _offsets(checked_cast<size_t>(hdr.components())),
+        _parsers(expressions.size()),
+        _components_var(_block_size, hdr.components()),
+        _dimensions_var(_block_size, hdr.dimensions()),
+        _dim_vars(checked_cast<size_t>(hdr.dimensions())),
+        _index_vars(checked_cast<size_t>(hdr.dimensions()), std::vector<double>(_block_size)),
+        _indices(checked_cast<size_t>(hdr.dimensions())),
+        _results(_block_size)
+    {
+        for (uintmax_t i = 0; i < hdr.components(); i++)
+        {
+            _offsets[i] = (i == 0 ? 0 : _offsets[i - 1] + hdr.component_size(i - 1));
+            _comp_vars.push_back(std::vector<double>(_block_size));
+            if (is_complex(hdr.component_type(i)))
+                _comp_vars.push_back(std::vector<double>(_block_size));
+        }
+        for (uintmax_t i = 0; i < hdr.dimensions(); i++)
+        {
+            _dim_vars[i].resize(_block_size, hdr.dimension_size(i));
+        }
+        for (size_t p = 0; p < expressions.size(); p++)
+        {
+            _parsers[p].ClearConst();
+            _parsers[p].DefineConst("e", e);
+            _parsers[p].DefineConst("pi", pi);
+            _parsers[p].DefineOprt("%", mod, mu::prMUL_DIV, mu::oaLEFT, true);
+            _parsers[p].DefineFun("deg", deg);
+            _parsers[p].DefineFun("rad", rad);
+            _parsers[p].DefineFun("atan2", atan2);
+            _parsers[p].DefineFun("fract", fract);
+            _parsers[p].DefineFun("pow", pow);
+            _parsers[p].DefineFun("exp2", exp2);
+            _parsers[p].DefineFun("cbrt", cbrt);
+            _parsers[p].DefineFun("int", int_);
+            _parsers[p].DefineFun("ceil", ceil);
+            _parsers[p].DefineFun("floor", floor);
+            _parsers[p].DefineFun("round", round);
+            _parsers[p].DefineFun("trunc", trunc);
+            _parsers[p].DefineFun("med", med);
+            _parsers[p].DefineFun("clamp", clamp);
+            _parsers[p].DefineFun("step", step);
+            _parsers[p].DefineFun("smoothstep", smoothstep);
+            _parsers[p].DefineFun("mix", mix);
+            _parsers[p].DefineFun("random", my_random, false);
+            _parsers[p].DefineFun("srand48", my_srand48, false);
+            _parsers[p].DefineFun("drand48", drand48, false);
+            _parsers[p].DefineFun("comp", comp, false);
+            _parsers[p].DefineFun("compim", compim, false);
+            _parsers[p].DefineInfixOprt("+", unary_plus);
+            size_t comp_vars_index = 0;
+            for (uintmax_t i = 0; i < hdr.components(); i++)
+            {
+                if (is_complex(hdr.component_type(i)))
+                {
+                    _parsers[p].DefineVar(std::string("c") + str::from(i) + "re", &(_comp_vars[comp_vars_index++][0]));
+                    _parsers[p].DefineVar(std::string("c") + str::from(i) + "im", &(_comp_vars[comp_vars_index++][0]));
+                }
+                else
+                {
+                    _parsers[p].DefineVar(std::string("c") + str::from(i), &(_comp_vars[comp_vars_index++][0]));
+                }
+            }
+            _parsers[p].DefineVar("c", &(_components_var[0]));
+            _parsers[p].DefineVar("d", &(_dimensions_var[0]));
+            for (uintmax_t i = 0; i < hdr.dimensions(); i++)
+            {
+                _parsers[p].DefineVar(std::string("d") + str::from(i), &(_dim_vars[i][0]));
+                _parsers[p].DefineVar(std::string("i") + str::from(i), &(_index_vars[i][0]));
+            }
+            _parsers[p].SetExpr(expressions[p]);
+        }
+    }
+
+    /* Recompute the n elements starting at the given linear index in place */
+    void evaluate(unsigned char *elements, uintmax_t index, size_t n)
+    {
+        size_t element_size = _hdr.element_size();
+        for (size_t b = 0; b < n; b += _block_size)
+        {
+            size_t m = std::min(_block_size, n - b);
+            unsigned char *block = elements + b * element_size;
+            // set the variables
+            _hdr.linear_index_to_indices(index + b, &(_indices[0]));
+            for (size_t k = 0; k < m; k++)
+            {
+                for (size_t i = 0; i < _indices.size(); i++)
+                {
+                    _index_vars[i][k] = _indices[i];
+                }
+                for (size_t i = 0; i < _indices.size(); i++)
+                {
+                    if (++_indices[i] < _hdr.dimension_size(i))
+                        break;
+                    _indices[i] = 0;
+                }
+            }
+            size_t comp_var_index = 0;
+            for (uintmax_t i = 0; i < _hdr.components(); i++)
+            {
+                gta::type t = _hdr.component_type(i);
+                load_component(t, block + _offsets[i], element_size, m, &(_comp_vars[comp_var_index][0]),
+                        is_complex(t) ? &(_comp_vars[comp_var_index + 1][0]) : NULL);
+                comp_var_index += (is_complex(t) ? 2 : 1);
+            }
+            // evaluate the expressions
+            for (size_t p = 0; p < _parsers.size(); p++)
+            {
+                _parsers[p].Eval(&(_results[0]), m);
+            }
+            // read back the component variables
+            comp_var_index = 0;
+            for (uintmax_t i = 0; i < _hdr.components(); i++)
+            {
+                gta::type t = _hdr.component_type(i);
+                store_component(t, &(_comp_vars[comp_var_index][0]),
+                        is_complex(t) ? &(_comp_vars[comp_var_index + 1][0]) : NULL,
+                        m, block + _offsets[i], element_size);
+                comp_var_index += (is_complex(t) ? 2 : 1);
+            }
+        }
+    }
+
+    static size_t block_size()
+    {
+        return _block_size;
+    }
+};
+
+const size_t evaluator::_block_size;
+
 extern "C" int gtatool_component_compute(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -178,6 +649,18 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
         return 0;
     }
 
+    // Stencil functions need random access to the whole input array.
+    // Random number functions keep a global state, so that expressions using
+    // them are evaluated by a single thread to get reproducible results.
+    std::set<std::string> identifiers;
+    for (size_t p = 0; p < expressions.values().size(); p++)
+    {
+        get_identifiers(expressions.values()[p], identifiers);
+    }
+    bool stencil = (identifiers.count("comp") > 0 || identifiers.count("compim") > 0);
+    bool serial = (identifiers.count("random") > 0 || identifiers.count("srand48") > 0
+            || identifiers.count("drand48") > 0);
+
     try
     {
         array_loop_t array_loop;
@@ -186,8 +669,6 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
         array_loop.start(arguments, "");
         while (array_loop.read(hdri, namei))
         {
-            // Set up variables
-            std::vector<double> comp_vars;
             for (uintmax_t i = 0; i < hdri.components(); i++)
             {
                 if (hdri.component_type(i) == gta::blob)
@@ -212,358 +693,79 @@ extern "C" int gtatool_component_compute(int argc, char *argv[])
                             + type_to_string(hdri.component_type(i), hdri.component_size(i))
                             + " on this platform");
                 }
-                if (hdri.component_type(i) == gta::cfloat32
-                        || hdri.component_type(i) == gta::cfloat64
-                        || hdri.component_type(i) == gta::cfloat128)
-                {
-                    comp_vars.push_back(0.0);
-                    comp_vars.push_back(0.0);
-                }
-                else
-                {
-                    comp_vars.push_back(0.0);
-                }
-            }
-            double components_var;
-            double dimensions_var;
-            std::vector<double> dim_vars(checked_cast<size_t>(hdri.dimensions()));
-            std::vector<uintmax_t> index_vars_orig(hdri.dimensions());
-            std::vector<double> index_vars(hdri.dimensions());
-            std::vector<mu::Parser> parsers;
-            parsers.resize(expressions.values().size());
-            for (size_t p = 0; p < expressions.values().size(); p++)
-            {
-                parsers[p].ClearConst();
-                parsers[p].DefineConst("e", e);
-                parsers[p].DefineConst("pi", pi);
-                parsers[p].DefineOprt("%", mod, mu::prMUL_DIV, mu::oaLEFT, true);
-                parsers[p].DefineFun("deg", deg);
-                parsers[p].DefineFun("rad", rad);
-                parsers[p].DefineFun("atan2", atan2);
-                parsers[p].DefineFun("fract", fract);
-                parsers[p].DefineFun("pow", pow);
-                parsers[p].DefineFun("exp2", exp2);
-                parsers[p].DefineFun("cbrt", cbrt);
-                parsers[p].DefineFun("int", int_);
-                parsers[p].DefineFun("ceil", ceil);
-                parsers[p].DefineFun("floor", floor);
-                parsers[p].DefineFun("round", round);
-                parsers[p].DefineFun("trunc", trunc);
-                parsers[p].DefineFun("med", med);
-                parsers[p].DefineFun("clamp", clamp);
-                parsers[p].DefineFun("step", step);
-                parsers[p].DefineFun("smoothstep", smoothstep);
-                parsers[p].DefineFun("mix", mix);
-                parsers[p].DefineFun("random", my_random, false);
-                parsers[p].DefineFun("srand48", my_srand48, false);
-                parsers[p].DefineFun("drand48", drand48, false);
-                parsers[p].DefineInfixOprt("+", unary_plus);
-                size_t comp_vars_index = 0;
-                for (uintmax_t i = 0; i < hdri.components(); i++)
-                {
-                    if (hdri.component_type(i) == gta::cfloat32 || hdri.component_type(i) == gta::cfloat64)
-                    {
-                        parsers[p].DefineVar(std::string("c") + str::from(i) + "re", &(comp_vars[comp_vars_index++]));
-                        parsers[p].DefineVar(std::string("c") + str::from(i) + "im", &(comp_vars[comp_vars_index++]));
-                    }
-                    else
-                    {
-                        parsers[p].DefineVar(std::string("c") + str::from(i), &(comp_vars[comp_vars_index++]));
-                    }
-                }
-                parsers[p].DefineVar("c", &components_var);
-                parsers[p].DefineVar("d", &dimensions_var);
-                for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                {
-                    parsers[p].DefineVar(std::string("d") + str::from(i), &(dim_vars[i]));
-                    parsers[p].DefineVar(std::string("i") + str::from(i), &(index_vars[i]));
-                }
-                parsers[p].SetExpr(expressions.values()[p]);
             }
 
             hdro = hdri;
             hdro.set_compression(gta::none);
+            min_max_tags_unset(hdro);
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                blob input;
+                if (stencil)
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    // set the variables
-                    components_var = hdri.components();
-                    dimensions_var = hdri.dimensions();
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
-                    {
-                        dim_vars[i] = hdri.dimension_size(i);
-                    }
-                    hdri.linear_index_to_indices(e, &(index_vars_orig[0]));
-                    for (uintmax_t i = 0; i < hdri.dimensions(); i++)
+                    input.resize(checked_cast<size_t>(hdri.data_size()));
+                    for (uintmax_t e0 = 0; e0 < hdri.elements(); )
                     {
-                        index_vars[i] = index_vars_orig[i];
+                        size_t n = element_loop.batch_size(hdri.elements() - e0);
+                        std::memcpy(input.ptr(e0 * element_size), element_loop.read(n), n * element_size);
+                        e0 += n;
                     }
-                    size_t comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdri.components(); i++)
+                    stencil_header = &hdri;
+                    stencil_data = input.ptr<unsigned char>();
+                }
+                // Each thread takes an idle evaluator (with its own parsers and
+                // variables) for the range of elements it works on.
+                std::mutex evaluators_mutex;
+                std::vector<std::unique_ptr<evaluator>> evaluators;
+                std::vector<evaluator *> idle_evaluators;
+                blob elements;
+                for (uintmax_t e0 = 0; e0 < hdro.elements(); )
+                {
+                    size_t n = element_loop.batch_size(hdro.elements() - e0);
+                    elements.resize(element_size, n);
+                    std::memcpy(elements.ptr(),
+                            stencil ? input.ptr(e0 * element_size) : element_loop.read(n),
+                            elements.size());
+                    auto compute = [&](uintmax_t begin, uintmax_t end)
                     {
-                        switch (hdri.component_type(i))
+                        evaluator *ev;
                         {
-                        case gta::int8:
-                            {
-                                int8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint8_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint16_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint32_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::int64:
+                            std::lock_guard<std::mutex> lock(evaluators_mutex);
+                            if (idle_evaluators.empty())
                             {
-                                int64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int64_t));
-                                comp_vars[comp_var_index++] = v;
+                                evaluators.push_back(std::unique_ptr<evaluator>(
+                                            new evaluator(hdri, expressions.values())));
+                                idle_evaluators.push_back(evaluators.back().get());
                             }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint64_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(int128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(uint128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                            {
-                                float v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(double));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v;
-                                std::memcpy(&v, hdri.component(element.ptr(), i), sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v;
-                            }
-                            break;
-#endif
-                        case gta::cfloat32:
-                            {
-                                float v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(double));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2];
-                                std::memcpy(v, hdri.component(element.ptr(), i), 2 * sizeof(float128_t));
-                                comp_vars[comp_var_index++] = v[0];
-                                comp_vars[comp_var_index++] = v[1];
-                            }
-                            break;
-#endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
+                            ev = idle_evaluators.back();
+                            idle_evaluators.pop_back();
                         }
-                    }
-                    // evaluate the expressions
-                    for (size_t p = 0; p < parsers.size(); p++)
-                    {
-                        parsers[p].Eval();
-                    }
-                    // read back the component variables
-                    comp_var_index = 0;
-                    for (uintmax_t i = 0; i < hdro.components(); i++)
-                    {
-                        switch (hdro.component_type(i))
+                        try
                         {
-                        case gta::int8:
-                            {
-                                int8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int8_t));
-                            }
-                            break;
-                        case gta::uint8:
-                            {
-                                uint8_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint8_t));
-                            }
-                            break;
-                        case gta::int16:
-                            {
-                                int16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int16_t));
-                            }
-                            break;
-                        case gta::uint16:
-                            {
-                                uint16_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint16_t));
-                            }
-                            break;
-                        case gta::int32:
-                            {
-                                int32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int32_t));
-                            }
-                            break;
-                        case gta::uint32:
-                            {
-                                uint32_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint32_t));
-                            }
-                            break;
-                        case gta::int64:
-                            {
-                                int64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int64_t));
-                            }
-                            break;
-                        case gta::uint64:
-                            {
-                                uint64_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint64_t));
-                            }
-                            break;
-#ifdef HAVE_INT128_T
-                        case gta::int128:
-                            {
-                                int128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(int128_t));
-                            }
-                            break;
-#endif
-#ifdef HAVE_UINT128_T
-                        case gta::uint128:
-                            {
-                                uint128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(uint128_t));
-                            }
-                            break;
-#endif
-                        case gta::float32:
-                            {
-                                float v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float));
-                            }
-                            break;
-                        case gta::float64:
-                            {
-                                double v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(double));
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::float128:
-                            {
-                                float128_t v = comp_vars[comp_var_index++];
-                                std::memcpy(hdri.component(element.ptr(), i), &v, sizeof(float128_t));
-                            }
-                            break;
-#endif
-                        case gta::cfloat32:
-                            {
-                                float v[2] = { static_cast<float>(comp_vars[comp_var_index]), static_cast<float>(comp_vars[comp_var_index + 1]) };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float));
-                            }
-                            break;
-                        case gta::cfloat64:
-                            {
-                                double v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(double));
-                            }
-                            break;
-#ifdef HAVE_FLOAT128_T
-                        case gta::cfloat128:
-                            {
-                                float128_t v[2] = { comp_vars[comp_var_index], comp_vars[comp_var_index + 1] };
-                                comp_var_index += 2;
-                                std::memcpy(hdri.component(element.ptr(), i), v, 2 * sizeof(float128_t));
-                            }
-                            break;
-#endif
-                        default:
-                            // cannot happen
-                            assert(false);
-                            break;
+                            ev->evaluate(elements.ptr<unsigned char>(begin * element_size), e0 + begin, end - begin);
                         }
-                    }
-                    element_loop.write(element.ptr());
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(evaluators_mutex);
+                            idle_evaluators.push_back(ev);
+                            throw;
+                        }
+                        std::lock_guard<std::mutex> lock(evaluators_mutex);
+                        idle_evaluators.push_back(ev);
+                    };
+                    if (serial)
+                        compute(0, n);
+                    else
+                        parallel_for(n, evaluator::block_size(), compute);
+                    element_loop.write(elements.ptr(), n);
+                    e0 += n;
                 }
+                stencil_header = NULL;
+                stencil_data = NULL;
             }
         }
         array_loop.finish();
@@ -23,6 +23,7 @@
 
 #include <sstream>
 #include <limits>
+#include <type_traits>
 #include <cstdio>
 #include <cstdint>
 #include <cctype>
@@ -32,7 +33,6 @@
 
 #include "base/dbg.h"
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/fio.h"
 #include "base/str.h"
@@ -51,8 +51,10 @@ typedef uintmax_t max_uint_t;
 #endif
 #ifdef HAVE___FLOAT128
 typedef __float128 max_float_t;
+static const int max_float_digits = 113;
 #else
 typedef long double max_float_t;
+static const int max_float_digits = std::numeric_limits<long double>::digits;
 #endif
 
 #include "lib.h"
@@ -158,11 +160,11 @@ static max_uint_t to_max_uint(const void *val, gta::type type, max_uint_t normal
             double v;
             std::memcpy(&v, val, sizeof(double));
             if (normalization_max) {
-                v *= normalization_max;
                 if (v < 0.0)
                     v = 0.0;
                 else if (v > 1.0)
                     v = 1.0;
+                v *= normalization_max;
             }
             x = ((!std::isfinite(v) || v < 0) ? 0 : v);
         }
@@ -183,7 +185,7 @@ static max_uint_t to_max_uint(const void *val, gta::type type, max_uint_t normal
 #ifdef LONG_DOUBLE_IS_IEEE_754_QUAD
             x = ((!std::isfinite(v) || v < 0) ? 0 : v);
 #else
-            x = ((!isinfq(v) || v < 0) ? 0 : v);
+            x = ((isinfq(v) || isnanq(v) || v < 0) ? 0 : v);
 #endif
         }
         break;
@@ -331,7 +333,7 @@ static max_int_t to_max_int(const void *val, gta::type type, max_int_t normaliza
 #ifdef LONG_DOUBLE_IS_IEEE_754_QUAD
             x = (!std::isfinite(v) ? 0 : v);
 #else
-            x = (!isinfq(v) ? 0 : v);
+            x = ((isinfq(v) || isnanq(v)) ? 0 : v);
 #endif
         }
         break;
@@ -817,6 +819,319 @@ static void convert(void *dst, gta::type dst_type, const void *src, gta::type sr
     }
 }
 
+/*
+ * Batch conversion kernels.
+ *
+ * The convert() function above handles all types, but it goes through the
+ * widest available types for every single value. For all combinations of
+ * types that do not involve a 128 bit type, there is a kernel that converts
+ * one component of a batch of elements. It is instantiated for each pair of
+ * source and destination type and for both normalization modes, so that the
+ * compiler can turn the inner loop into vector code. The results match those
+ * of convert().
+ */
+
+template<typename T> struct cplx
+{
+    T re, im;
+};
+
+struct float_tag {};
+struct sint_tag {};
+struct uint_tag {};
+
+template<typename T> struct real_traits
+{
+    typedef typename std::conditional<!std::numeric_limits<T>::is_integer, float_tag,
+            typename std::conditional<std::numeric_limits<T>::is_signed, sint_tag, uint_tag>::type>::type tag;
+};
+
+/* The floating point type for the normalization of integers of type S to
+ * floating point values of type D. convert() divides in max_float_t and rounds
+ * the quotient to D, which can differ from the correctly rounded quotient
+ * (double rounding). But a quotient of integers with a divisor below 2^k is
+ * either exact or differs from each rounding boundary of D by more than
+ * 2^-(k+1) ulps of D, so rounding it first to a type with at least
+ * digits(D) + k + 1 digits does not change the result. If max_float_t gives
+ * the correctly rounded result this way, use the fastest type that does, too. */
+template<typename D, typename S> struct norm_traits
+{
+    static const int digits = std::numeric_limits<D>::digits + 8 * sizeof(S) + 1;
+    static const bool exact = (max_float_digits >= digits);
+    typedef typename std::conditional<
+        (exact && (sizeof(D) == sizeof(double) || std::numeric_limits<double>::digits >= digits)), double,
+        typename std::conditional<(exact && std::numeric_limits<long double>::digits >= digits),
+            long double, max_float_t>::type>::type type;
+};
+
+template<typename T> struct component_traits
+{
+    typedef T real_type;
+    static T re(const T &v) { return v; }
+    static T im(const T &) { return 0; }
+    static void set(T &v, T re, T) { v = re; }
+};
+
+template<typename T> struct component_traits<cplx<T> >
+{
+    typedef T real_type;
+    static T re(const cplx<T> &v) { return v.re; }
+    static T im(const cplx<T> &v) { return v.im; }
+    static void set(cplx<T> &v, T re, T im) { v.re = re; v.im = im; }
+};
+
+/* Convert floating point values that may exceed the 64 bit range like
+ * convert() does, via the widest integer types. */
+template<typename F>
+static inline intmax_t float_to_int(F v)
+{
+    const F limit = static_cast<F>(9223372036854775808.0);
+    return (v > -limit && v < limit ? static_cast<intmax_t>(v) : static_cast<intmax_t>(static_cast<max_int_t>(v)));
+}
+
+template<typename F>
+static inline uintmax_t float_to_uint(F v)
+{
+    const F limit = static_cast<F>(18446744073709551616.0);
+    return (v < limit ? static_cast<uintmax_t>(v) : static_cast<uintmax_t>(static_cast<max_uint_t>(v)));
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, float_tag, float_tag)
+{
+    return v;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, float_tag, sint_tag)
+{
+    typedef typename norm_traits<D, S>::type F;
+    F x = v;
+    if (N)
+        x /= (v < 0 ? -static_cast<F>(std::numeric_limits<S>::min()) : static_cast<F>(std::numeric_limits<S>::max()));
+    return x;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, float_tag, uint_tag)
+{
+    typedef typename norm_traits<D, S>::type F;
+    F x = v;
+    if (N)
+        x /= static_cast<F>(std::numeric_limits<S>::max());
+    return x;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, sint_tag, float_tag)
+{
+    if (N) {
+        if (v < -1)
+            v = -1;
+        else if (v > 1)
+            v = 1;
+        if (v < 0)
+            v *= -static_cast<S>(std::numeric_limits<D>::min());
+        if (v > 0)
+            v *= static_cast<S>(std::numeric_limits<D>::max());
+    }
+    return (std::isfinite(v) ? float_to_int(v) : 0);
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, uint_tag, float_tag)
+{
+    if (N) {
+        if (v < 0)
+            v = 0;
+        else if (v > 1)
+            v = 1;
+        v *= static_cast<S>(std::numeric_limits<D>::max());
+    }
+    return ((!std::isfinite(v) || v < 0) ? 0 : float_to_uint(v));
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, sint_tag, sint_tag)
+{
+    return v;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, sint_tag, uint_tag)
+{
+    return v;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, uint_tag, sint_tag)
+{
+    return (v < 0 ? 0 : v);
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_real(S v, uint_tag, uint_tag)
+{
+    return v;
+}
+
+template<typename D, typename S, bool N>
+static inline D convert_value(const S &s)
+{
+    typedef typename component_traits<D>::real_type DR;
+    typedef typename component_traits<S>::real_type SR;
+    D d;
+    component_traits<D>::set(d,
+            convert_real<DR, SR, N>(component_traits<S>::re(s),
+                typename real_traits<DR>::tag(), typename real_traits<SR>::tag()),
+            static_cast<DR>(component_traits<S>::im(s)));
+    return d;
+}
+
+/* Convert one component of n elements. The strides are the element sizes. */
+typedef void (*convert_kernel_t)(char *dst, size_t dst_stride, const char *src, size_t src_stride, size_t n);
+
+template<typename D, typename S, bool N>
+static void convert_kernel(char *dst, size_t dst_stride, const char *src, size_t src_stride, size_t n)
+{
+    if (dst_stride == sizeof(D) && src_stride == sizeof(S))
+    {
+        // single-component elements: fixed strides allow vectorization
+        for (size_t i = 0; i < n; i++)
+        {
+            S s;
+            std::memcpy(&s, src + i * sizeof(S), sizeof(S));
+            D d = convert_value<D, S, N>(s);
+            std::memcpy(dst + i * sizeof(D), &d, sizeof(D));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            S s;
+            std::memcpy(&s, src + i * src_stride, sizeof(S));
+            D d = convert_value<D, S, N>(s);
+            std::memcpy(dst + i * dst_stride, &d, sizeof(D));
+        }
+    }
+}
+
+template<typename D, typename S>
+static convert_kernel_t get_convert_kernel(bool normalize)
+{
+    return normalize ? convert_kernel<D, S, true> : convert_kernel<D, S, false>;
+}
+
+template<typename D>
+static convert_kernel_t get_convert_kernel(gta::type src_type, bool normalize)
+{
+    switch (src_type)
+    {
+    case gta::int8:
+        return get_convert_kernel<D, int8_t>(normalize);
+    case gta::uint8:
+        return get_convert_kernel<D, uint8_t>(normalize);
+    case gta::int16:
+        return get_convert_kernel<D, int16_t>(normalize);
+    case gta::uint16:
+        return get_convert_kernel<D, uint16_t>(normalize);
+    case gta::int32:
+        return get_convert_kernel<D, int32_t>(normalize);
+    case gta::uint32:
+        return get_convert_kernel<D, uint32_t>(normalize);
+    case gta::int64:
+        return get_convert_kernel<D, int64_t>(normalize);
+    case gta::uint64:
+        return get_convert_kernel<D, uint64_t>(normalize);
+    case gta::float32:
+        return get_convert_kernel<D, float>(normalize);
+    case gta::float64:
+        return get_convert_kernel<D, double>(normalize);
+    case gta::cfloat32:
+        return get_convert_kernel<D, cplx<float> >(normalize);
+    case gta::cfloat64:
+        return get_convert_kernel<D, cplx<double> >(normalize);
+    default:
+        // 128 bit types: use convert()
+        return NULL;
+    }
+}
+
+static convert_kernel_t get_convert_kernel(gta::type dst_type, gta::type src_type, bool normalize)
+{
+    switch (dst_type)
+    {
+    case gta::int8:
+        return get_convert_kernel<int8_t>(src_type, normalize);
+    case gta::uint8:
+        return get_convert_kernel<uint8_t>(src_type, normalize);
+    case gta::int16:
+        return get_convert_kernel<int16_t>(src_type, normalize);
+    case gta::uint16:
+        return get_convert_kernel<uint16_t>(src_type, normalize);
+    case gta::int32:
+        return get_convert_kernel<int32_t>(src_type, normalize);
+    case gta::uint32:
+        return get_convert_kernel<uint32_t>(src_type, normalize);
+    case gta::int64:
+        return get_convert_kernel<int64_t>(src_type, normalize);
+    case gta::uint64:
+        return get_convert_kernel<uint64_t>(src_type, normalize);
+    case gta::float32:
+        return get_convert_kernel<float>(src_type, normalize);
+    case gta::float64:
+        return get_convert_kernel<double>(src_type, normalize);
+    case gta::cfloat32:
+        return get_convert_kernel<cplx<float> >(src_type, normalize);
+    case gta::cfloat64:
+        return get_convert_kernel<cplx<double> >(src_type, normalize);
+    default:
+        // 128 bit types: use convert()
+        return NULL;
+    }
+}
+
+/* Convert the MIN_VALUE and MAX_VALUE tags of component i of hdro, which are
+ * still those of the source component. The range is converted like the
+ * values if the conversion preserves their order; otherwise the tags are
+ * removed. Order is not preserved for complex types, for floating point to
+ * integer conversions (non-finite values become zero), and for integer
+ * conversions that overflow. */
+static void convert_min_max_tags(gta::header &hdro, uintmax_t i,
+        gta::type src_type, size_t src_size, bool normalize)
+{
+    gta::type dst_type = hdro.component_type(i);
+    bool src_float = (src_type == gta::float32 || src_type == gta::float64 || src_type == gta::float128);
+    bool dst_float = (dst_type == gta::float32 || dst_type == gta::float64 || dst_type == gta::float128);
+    double range[2];
+    if (!min_max_tags_get(hdro, i, &range[0], &range[1])
+            || src_type == gta::cfloat32 || src_type == gta::cfloat64 || src_type == gta::cfloat128
+            || dst_type == gta::cfloat32 || dst_type == gta::cfloat64 || dst_type == gta::cfloat128
+            || (src_float && !dst_float))
+    {
+        min_max_tags_unset(hdro, i);
+        return;
+    }
+    for (int j = 0; j < 2; j++)
+    {
+        // max_float_t has the size and alignment of the largest real type
+        max_float_t src, dst, chk;
+        double x;
+        convert(&src, src_type, &range[j], gta::float64, false);
+        convert(&x, gta::float64, &src, src_type, false);
+        convert(&dst, dst_type, &src, src_type, normalize);
+        convert(&chk, src_type, &dst, dst_type, false);
+        if (x != range[j] || (!dst_float && std::memcmp(&chk, &src, src_size) != 0))
+        {
+            min_max_tags_unset(hdro, i);
+            return;
+        }
+        convert(&range[j], gta::float64, &dst, dst_type, false);
+    }
+    min_max_tags_set(hdro, i, range[0], range[1]);
+}
+
 extern "C" void gtatool_component_convert_help(void)
 {
     msg::req_txt(
@@ -927,23 +1242,54 @@ extern "C" int gtatool_component_convert(int argc, char *argv[])
             for (uintmax_t i = 0; i < hdro.components(); i++)
             {
                 hdro.component_taglist(i) = hdri.component_taglist(i);
+                convert_min_max_tags(hdro, i, hdri.component_type(i),
+                        checked_cast<size_t>(hdri.component_size(i)), normalize.value());
             }
             array_loop.write(hdro, nameo);
+            size_t element_size_in = checked_cast<size_t>(hdri.element_size());
+            size_t element_size_out = checked_cast<size_t>(hdro.element_size());
+            std::vector<convert_kernel_t> kernels(hdro.components());
+            std::vector<size_t> offsets_in(hdri.components());
+            std::vector<size_t> offsets_out(hdro.components());
+            for (uintmax_t i = 0; i < hdro.components(); i++)
+            {
+                kernels[i] = get_convert_kernel(hdro.component_type(i), hdri.component_type(i), normalize.value());
+                offsets_in[i] = (i == 0 ? 0 : offsets_in[i - 1] + hdri.component_size(i - 1));
+                offsets_out[i] = (i == 0 ? 0 : offsets_out[i - 1] + hdro.component_size(i - 1));
+            }
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element_out(checked_cast<size_t>(hdro.element_size()));
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            for (uintmax_t e = 0; e < hdro.elements(); )
             {
-                const void *src = element_loop.read();
-                for (uintmax_t i = 0; i < hdro.components(); i++)
+                size_t n = element_loop.batch_size(hdro.elements() - e);
+                char *elements_out = static_cast<char *>(element_loop.write_buffer(n));
+                const char *src = static_cast<const char *>(element_loop.read(n));
+                parallel_for(n, 4096, [&](uintmax_t begin, uintmax_t end)
                 {
-                    convert(hdro.component(element_out.ptr(), i),
-                            hdro.component_type(i),
-                            hdri.component(src, i),
-                            hdri.component_type(i),
-                            normalize.value());
-                }
-                element_loop.write(element_out.ptr());
+                    const char *s = src + begin * element_size_in;
+                    char *d = elements_out + begin * element_size_out;
+                    for (uintmax_t i = 0; i < hdro.components(); i++)
+                    {
+                        if (kernels[i])
+                        {
+                            kernels[i](d + offsets_out[i], element_size_out,
+                                    s + offsets_in[i], element_size_in, end - begin);
+                        }
+                        else
+                        {
+                            for (uintmax_t k = 0; k < end - begin; k++)
+                            {
+                                convert(d + k * element_size_out + offsets_out[i],
+                                        hdro.component_type(i),
+                                        s + k * element_size_in + offsets_in[i],
+                                        hdri.component_type(i),
+                                        normalize.value());
+                            }
+                        }
+                    }
+                });
+                element_loop.write(elements_out, n);
+                e += n;
             }
         }
         array_loop.finish();
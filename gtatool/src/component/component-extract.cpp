@@ -149,20 +149,28 @@ extern "C" int gtatool_component_extract(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                blob elements_out;
+                for (uintmax_t e = 0; e < hdro.elements(); )
                 {
-                    const void *element_in = element_loop.read();
-                    for (uintmax_t i = 0; i < hdro.components(); i++)
+                    size_t n = element_loop.batch_size(hdro.elements() - e);
+                    elements_out.resize(checked_cast<size_t>(hdro.element_size()), n);
+                    const char *elements_in = static_cast<const char *>(element_loop.read(n));
+                    for (size_t k = 0; k < n; k++)
                     {
-                        std::memcpy(hdro.component(element_out.ptr(), i),
-                                hdri.component(element_in, hdro_comp_indices[i]),
-                                hdro.component_size(i));
+                        const void *element_in = elements_in + k * hdri.element_size();
+                        void *element_out = elements_out.ptr(k * hdro.element_size());
+                        for (uintmax_t i = 0; i < hdro.components(); i++)
+                        {
+                            std::memcpy(hdro.component(element_out, i),
+                                    hdri.component(element_in, hdro_comp_indices[i]),
+                                    hdro.component_size(i));
+                        }
                     }
                     if (hdro.data_size() > 0)
                     {
-                        element_loop.write(element_out.ptr());
+                        element_loop.write(elements_out.ptr(), n);
                     }
+                    e += n;
                 }
             }
         }
@@ -29,7 +29,6 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/fio.h"
 #include "base/str.h"
@@ -149,18 +148,27 @@ extern "C" int gtatool_component_merge(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loops[0].start_element_loop(element_loop, hdris[0], hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                std::vector<const char *> elements_in(arguments.size());
+                for (uintmax_t e = 0; e < hdro.elements(); )
                 {
-                    void *p = element_out.ptr();
-                    std::memcpy(p, element_loop.read(), hdris[0].element_size());
-                    p = static_cast<void *>(static_cast<char *>(p) + hdris[0].element_size());
+                    size_t n = element_loop.batch_size(hdro.elements() - e);
+                    char *elements_out = static_cast<char *>(element_loop.write_buffer(n));
+                    elements_in[0] = static_cast<const char *>(element_loop.read(n));
                     for (size_t i = 1; i < arguments.size(); i++)
                     {
-                        std::memcpy(p, element_loops[i].read(), hdris[i].element_size());
-                        p = static_cast<void *>(static_cast<char *>(p) + hdris[i].element_size());
+                        elements_in[i] = static_cast<const char *>(element_loops[i].read(n));
                     }
-                    element_loop.write(element_out.ptr());
+                    char *p = elements_out;
+                    for (size_t k = 0; k < n; k++)
+                    {
+                        for (size_t i = 0; i < arguments.size(); i++)
+                        {
+                            std::memcpy(p, elements_in[i] + k * hdris[i].element_size(), hdris[i].element_size());
+                            p += hdris[i].element_size();
+                        }
+                    }
+                    element_loop.write(elements_out, n);
+                    e += n;
                 }
             }
         }
@@ -28,7 +28,6 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/fio.h"
 #include "base/str.h"
@@ -124,24 +123,31 @@ extern "C" int gtatool_component_reorder(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element_out(checked_cast<size_t>(hdro.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                for (uintmax_t e = 0; e < hdro.elements(); )
                 {
-                    const void *element_in = element_loop.read();
+                    size_t n = element_loop.batch_size(hdro.elements() - e);
+                    const char *elements_in = static_cast<const char *>(element_loop.read(n));
                     if (!indices.value().empty())
                     {
-                        for (uintmax_t i = 0; i < hdro.components(); i++)
+                        char *elements_out = static_cast<char *>(element_loop.write_buffer(n));
+                        for (size_t k = 0; k < n; k++)
                         {
-                            std::memcpy(hdro.component(element_out.ptr(), i),
-                                    hdri.component(element_in, indices.value()[i]),
-                                hdro.component_size(i));
+                            const void *element_in = elements_in + k * hdri.element_size();
+                            void *element_out = elements_out + k * hdro.element_size();
+                            for (uintmax_t i = 0; i < hdro.components(); i++)
+                            {
+                                std::memcpy(hdro.component(element_out, i),
+                                        hdri.component(element_in, indices.value()[i]),
+                                        hdro.component_size(i));
+                            }
                         }
+                        element_loop.write(elements_out, n);
                     }
                     else
                     {
-                        std::memcpy(element_out.ptr(), element_in, hdro.element_size());
+                        element_loop.write(elements_in, n);
                     }
-                    element_loop.write(element_out.ptr());
+                    e += n;
                 }
             }
         }
@@ -116,22 +116,44 @@ extern "C" int gtatool_component_set(int argc, char *argv[])
 
             hdro = hdri;
             hdro.set_compression(gta::none);
+            if (hdro.elements() > 0)
+            {
+                for (size_t i = 0; i < current_indices.size(); i++)
+                {
+                    hdrt.component_taglist(i) = hdri.component_taglist(current_indices[i]);
+                }
+                min_max_tags_set_constant(hdrt, comp_values.ptr());
+                for (size_t i = 0; i < current_indices.size(); i++)
+                {
+                    double min_value, max_value;
+                    if (min_max_tags_get(hdrt, i, &min_value, &max_value))
+                        min_max_tags_set(hdro, current_indices[i], min_value, max_value);
+                    else
+                        min_max_tags_unset(hdro, current_indices[i]);
+                }
+            }
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdro.elements(); e++)
+                for (uintmax_t e = 0; e < hdro.elements(); )
                 {
-                    std::memcpy(element.ptr(), element_loop.read(), hdri.element_size());
-                    for (size_t i = 0; i < current_indices.size(); i++)
+                    size_t n = element_loop.batch_size(hdro.elements() - e);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    std::memcpy(elements, element_loop.read(n), n * hdri.element_size());
+                    for (size_t k = 0; k < n; k++)
                     {
-                        void *component_dst = hdri.component(element.ptr(), current_indices[i]);
-                        void *component_src = hdrt.component(comp_values.ptr(), i);
-                        memcpy(component_dst, component_src, hdri.component_size(current_indices[i]));
+                        void *element = elements + k * hdri.element_size();
+                        for (size_t i = 0; i < current_indices.size(); i++)
+                        {
+                            void *component_dst = hdri.component(element, current_indices[i]);
+                            void *component_src = hdrt.component(comp_values.ptr(), i);
+                            memcpy(component_dst, component_src, hdri.component_size(current_indices[i]));
+                        }
                     }
-                    element_loop.write(element.ptr());
+                    element_loop.write(elements, n);
+                    e += n;
                 }
             }
         }
@@ -102,32 +102,52 @@ extern "C" int gtatool_component_split(int argc, char *argv[])
                 }
                 comp_indices.push_back(i);
             }
-            // Define the GTA headers and create temporary files
+            // Define the GTA headers
             std::vector<gta::header> hdros(comp_indices.size());
             std::vector<std::string> nameos(hdros.size());
-            std::vector<FILE *> tmpfiles(hdros.size());
-            std::vector<std::string> tmpfilenames(hdros.size());
-            std::vector<array_loop_t> tmpaloops(hdros.size());
-            std::vector<element_loop_t> tmpeloops(hdros.size());
-            std::vector<std::string> tmpnameos(hdros.size());
             for (size_t i = 0; i < hdros.size(); i++)
             {
                 hdros[i] = hdri;
                 hdros[i].set_compression(gta::none);
                 hdros[i].set_components(hdri.component_type(comp_indices[i]), hdri.component_size(comp_indices[i]));
                 hdros[i].component_taglist(0) = hdri.component_taglist(comp_indices[i]);
-                tmpfilenames[i] = fio::mktempfile(&(tmpfiles[i]));
-                tmpaloops[i].start("", tmpfilenames[i]);
-                tmpaloops[i].start_element_loop(tmpeloops[i], hdri, hdros[i]);
             }
-            // Write the GTA data to temporary files
+            // If the output is seekable, write the data of each output GTA
+            // directly to its final position. Otherwise, write it to
+            // temporary files first.
+            bool planned = (hdri.data_size() > 0 && planned_output_t::possible(array_loop));
+            planned_output_t planned_output;
+            std::vector<FILE *> tmpfiles;
+            std::vector<std::string> tmpfilenames;
+            std::vector<array_loop_t> tmpaloops;
+            std::vector<element_loop_t> tmpeloops;
+            if (planned)
+            {
+                planned_output.start(array_loop, hdros, nameos);
+            }
+            else
+            {
+                tmpfiles.resize(hdros.size());
+                tmpfilenames.resize(hdros.size());
+                tmpaloops.resize(hdros.size());
+                tmpeloops.resize(hdros.size());
+                for (size_t i = 0; i < hdros.size(); i++)
+                {
+                    tmpfilenames[i] = fio::mktempfile(&(tmpfiles[i]));
+                    tmpaloops[i].start("", tmpfilenames[i]);
+                    tmpaloops[i].start_element_loop(tmpeloops[i], hdri, hdros[i]);
+                }
+            }
+            // Write the GTA data
             if (hdri.data_size() > 0)
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                blob components;
+                for (uintmax_t e = 0; e < hdri.elements(); )
                 {
-                    const void *element = element_loop.read();
+                    size_t n = element_loop.batch_size(hdri.elements() - e);
+                    const char *elements = static_cast<const char *>(element_loop.read(n));
                     if (hdros.size() > 0)
                     {
                         size_t out_index = 0;
@@ -136,14 +156,30 @@ extern "C" int gtatool_component_split(int argc, char *argv[])
                         {
                             if (out_index < comp_indices.size() && i == comp_indices[out_index])
                             {
-                                tmpeloops[out_index].write(static_cast<const char *>(element) + out_comp_offset);
+                                size_t comp_size = checked_cast<size_t>(hdri.component_size(i));
+                                components.resize(comp_size, n);
+                                for (size_t k = 0; k < n; k++)
+                                {
+                                    std::memcpy(components.ptr(k * comp_size),
+                                            elements + k * hdri.element_size() + out_comp_offset, comp_size);
+                                }
+                                if (planned)
+                                    planned_output.write(out_index, components.ptr(), n * comp_size);
+                                else
+                                    tmpeloops[out_index].write(components.ptr(), n);
                                 out_index++;
                             }
                             out_comp_offset += hdri.component_size(i);
                         }
                     }
+                    e += n;
                 }
             }
+            if (planned)
+            {
+                planned_output.finish();
+                continue;
+            }
             // Combine the GTA data to a single output stream
             for (size_t i = 0; i < hdros.size(); i++)
             {
@@ -196,44 +196,51 @@ extern "C" int gtatool_to_csv(int argc, char *argv[])
             std::string s;
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdr, gta::header());
-            for (uintmax_t e = 0; e < hdr.elements(); e++)
+            for (uintmax_t e0 = 0; e0 < hdr.elements(); )
             {
-                const void *p = element_loop.read();
-                for (uintmax_t c = 0; c < hdr.components(); c++)
+                size_t n = element_loop.batch_size(hdr.elements() - e0);
+                const char *elements = static_cast<const char *>(element_loop.read(n));
+                for (size_t k = 0; k < n; k++)
                 {
-                    if (no_data_values[c].size() != 0
-                            && std::memcmp(no_data_values[c].ptr(), hdr.component(p, c), no_data_values[c].size()) == 0)
+                    uintmax_t e = e0 + k;
+                    const void *p = elements + k * hdr.element_size();
+                    for (uintmax_t c = 0; c < hdr.components(); c++)
                     {
-                        s = std::string();
+                        if (no_data_values[c].size() != 0
+                                && std::memcmp(no_data_values[c].ptr(), hdr.component(p, c), no_data_values[c].size()) == 0)
+                        {
+                            s = std::string();
+                        }
+                        else
+                        {
+                            s = write_component(hdr.component(p, c), hdr.component_type(c));
+                        }
+                        if (std::fputs(s.c_str(), fo) == EOF)
+                        {
+                            throw exc(nameo + ": output error.");
+                        }
+                        if (c < hdr.components() - 1 && std::fputs(delimiter.value().c_str(), fo) == EOF)
+                        {
+                            throw exc(nameo + ": output error.");
+                        }
                     }
-                    else
-                    {
-                        s = write_component(hdr.component(p, c), hdr.component_type(c));
-                    }
-                    if (std::fputs(s.c_str(), fo) == EOF)
-                    {
-                        throw exc(nameo + ": output error.");
-                    }
-                    if (c < hdr.components() - 1 && std::fputs(delimiter.value().c_str(), fo) == EOF)
-                    {
-                        throw exc(nameo + ": output error.");
-                    }
-                }
-                if (e == hdr.elements() - 1 ||
-                        (hdr.dimensions() == 2 && e % hdr.dimension_size(0) == hdr.dimension_size(0) - 1))
-                {
-                    if (std::fputs("\r\n", fo) == EOF)
+                    if (e == hdr.elements() - 1 ||
+                            (hdr.dimensions() == 2 && e % hdr.dimension_size(0) == hdr.dimension_size(0) - 1))
                     {
-                        throw exc(nameo + ": output error.");
+                        if (std::fputs("\r\n", fo) == EOF)
+                        {
+                            throw exc(nameo + ": output error.");
+                        }
                     }
-                }
-                else
-                {
-                    if (std::fputs(delimiter.value().c_str(), fo) == EOF)
+                    else
                     {
-                        throw exc(nameo + ": output error.");
+                        if (std::fputs(delimiter.value().c_str(), fo) == EOF)
+                        {
+                            throw exc(nameo + ": output error.");
+                        }
                     }
                 }
+                e0 += n;
             }
         }
         fio::flush(fo, nameo);
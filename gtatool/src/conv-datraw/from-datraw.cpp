@@ -27,7 +27,6 @@
 
 #include "base/msg.h"
 #include "base/str.h"
-#include "base/blb.h"
 #include "base/fio.h"
 #include "base/opt.h"
 #include "base/chk.h"
@@ -159,12 +158,14 @@ extern "C" int gtatool_from_datraw(int argc, char *argv[])
         {
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdr, hdr);
-            blob element(checked_cast<size_t>(hdr.element_size()));
-            for (uintmax_t e = 0; e < hdr.elements(); e++)
+            for (uintmax_t e = 0; e < hdr.elements(); )
             {
-                std::memcpy(element.ptr(), element_loop.read(1), hdr.element_size());
-                swap_element_endianness(hdr, element.ptr());
-                element_loop.write(element.ptr());
+                size_t n = element_loop.batch_size(hdr.elements() - e);
+                char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                std::memcpy(elements, element_loop.read(n), n * hdr.element_size());
+                swap_elements_endianness(hdr, elements, n);
+                element_loop.write(elements, n);
+                e += n;
             }
         }
         array_loop.finish();
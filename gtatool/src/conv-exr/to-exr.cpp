@@ -66,28 +66,24 @@ extern "C" int gtatool_to_exr(int argc, char *argv[])
         return 0;
     }
 
-    FILE *fi = gtatool_stdin;
     std::string ifilename("standard input");
     std::string ofilename(arguments[0]);
-    try
-    {
-        if (arguments.size() == 2)
-        {
-            ifilename = arguments[0];
-            fi = fio::open(ifilename, "r");
-            ofilename = arguments[1];
-        }
-    }
-    catch (std::exception &e)
+    if (arguments.size() == 2)
     {
-        msg::err_txt("%s", e.what());
-        return 1;
+        ifilename = arguments[0];
+        ofilename = arguments[1];
     }
 
     try
     {
+        array_loop_t array_loop;
         gta::header hdr;
-        hdr.read_from(fi);
+        std::string name;
+        array_loop.start(arguments.size() == 1 ? std::vector<std::string>() : std::vector<std::string>(1, arguments[0]), "");
+        if (!array_loop.read(hdr, name))
+        {
+            throw exc("cannot export " + ifilename + ": no array found");
+        }
         if (hdr.dimensions() != 2)
         {
             throw exc("cannot export " + ifilename + ": only two-dimensional arrays can be exported to images");
@@ -137,8 +133,7 @@ extern "C" int gtatool_to_exr(int argc, char *argv[])
         {
             throw exc("cannot export " + ifilename + ": array too large");
         }
-        blob data(checked_cast<size_t>(hdr.data_size()));
-        hdr.read_data(fi, data.ptr());
+        const void *data = array_loop.read_data(hdr);
         gta::header float_hdr;
         gta::type float_types[] = { gta::float32, gta::float32, gta::float32, gta::float32 };
         float_hdr.set_components(hdr.components(), float_types);
@@ -148,11 +143,11 @@ extern "C" int gtatool_to_exr(int argc, char *argv[])
         {
             for (uintmax_t x = 0; x < hdr.dimension_size(0); x++)
             {
-                void *element = hdr.element(data.ptr(), x, y);
+                const void *element = hdr.element(data, x, y);
                 void *float_element = float_hdr.element(float_data.ptr(), x, y);
                 for (uintmax_t i = 0; i < hdr.components(); i++)
                 {
-                    void *component = hdr.component(element, i);
+                    const void *component = hdr.component(element, i);
                     float *float_component = static_cast<float *>(float_hdr.component(float_element, i));
                     if (hdr.component_type(i) == gta::int8)
                     {
@@ -286,6 +281,7 @@ extern "C" int gtatool_to_exr(int argc, char *argv[])
         }
         file.setFrameBuffer(framebuffer);
         file.writePixels(float_hdr.dimension_size(1));
+        array_loop.finish();
     }
     catch (std::exception &e)
     {
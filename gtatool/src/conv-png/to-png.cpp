@@ -31,7 +31,6 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/fio.h"
 #include "base/opt.h"
 #include "base/str.h"
@@ -104,11 +103,11 @@ extern "C" int gtatool_to_png(int argc, char *argv[])
                 if (hdr.component_type(i) != hdr.component_type(0))
                     throw exc(name + ": only arrays with uniform element component types can be converted to PNG.");
 
-            blob data(checked_cast<size_t>(hdr.data_size()));
+            const png_byte *data = static_cast<const png_byte *>(array_loop.read_data(hdr));
             std::vector<png_bytep> row_pointers(hdr.dimension_size(1));
             size_t row_size = hdr.dimension_size(0) * hdr.element_size();
             for (uintmax_t i = 0; i < hdr.dimension_size(1); i++)
-                row_pointers[i] = data.ptr<png_byte>(i * row_size);
+                row_pointers[i] = const_cast<png_bytep>(data + i * row_size);
             std::vector<struct png_text_struct> text;
             for (uintmax_t i = 0; i < hdr.global_taglist().tags(); i++) {
                 std::string key = hdr.global_taglist().name(i);
@@ -170,7 +169,6 @@ extern "C" int gtatool_to_png(int argc, char *argv[])
                 png_set_text(png_ptr, info_ptr, &(text[0]), text.size());
             png_set_rows(png_ptr, info_ptr, &(row_pointers[0]));
 
-            array_loop.read_data(hdr, data.ptr());
             png_write_png(png_ptr, info_ptr,
                     endianness::endianness == endianness::big
                     ? PNG_TRANSFORM_IDENTITY : PNG_TRANSFORM_SWAP_ENDIAN,
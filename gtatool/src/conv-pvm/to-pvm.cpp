@@ -28,7 +28,6 @@
 #include "base/exc.h"
 #include "base/opt.h"
 #include "base/chk.h"
-#include "base/blb.h"
 
 #include "lib.h"
 
@@ -89,8 +88,7 @@ extern "C" int gtatool_to_pvm(int argc, char *argv[])
                 throw exc(name + ": unsupported number of dimensions");
             }
 
-            blob data(checked_cast<size_t>(hdr.data_size()));
-            array_loop.read_data(hdr, data.ptr());
+            const void *data = array_loop.read_data(hdr);
 
             unsigned int pvm_width = checked_cast<unsigned int>(hdr.dimension_size(0));
             unsigned int pvm_height = 1;
@@ -144,7 +142,7 @@ extern "C" int gtatool_to_pvm(int argc, char *argv[])
 
             try
             {
-                writePVMvolume(nameo.c_str(), data.ptr<unsigned char>(),
+                writePVMvolume(nameo.c_str(), static_cast<unsigned char *>(const_cast<void *>(data)),
                         pvm_width, pvm_height, pvm_depth, pvm_components,
                         pvm_scalex, pvm_scaley, pvm_scalez,
                         pvm_description, pvm_courtesy, pvm_parameter, pvm_comment);
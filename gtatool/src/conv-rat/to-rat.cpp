@@ -67,10 +67,10 @@ static void reorder_rat_data(gta::header &dsthdr, void *dst, const gta::header &
         }
         uintmax_t k = srchdr.indices_to_linear_index(&(srcindices[0]));
         memcpy(dsthdr.element(dst, i), srchdr.element(src, k), dsthdr.element_size());
-        if (endianness::endianness == endianness::little)
-        {
-            swap_element_endianness(dsthdr, dsthdr.element(dst, i));
-        }
+    }
+    if (endianness::endianness == endianness::little)
+    {
+        swap_elements_endianness(dsthdr, dst, checked_cast<size_t>(dsthdr.elements()));
     }
 }
 
@@ -26,7 +26,6 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/fio.h"
 #include "base/opt.h"
 #include "base/chk.h"
@@ -133,12 +132,14 @@ extern "C" int gtatool_from_raw(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdr, hdr);
-                blob element(checked_cast<size_t>(hdr.element_size()));
-                for (uintmax_t e = 0; e < hdr.elements(); e++)
+                for (uintmax_t e = 0; e < hdr.elements(); )
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdr.element_size());
-                    swap_element_endianness(hdr, element.ptr());
-                    element_loop.write(element.ptr());
+                    size_t n = element_loop.batch_size(hdr.elements() - e);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    std::memcpy(elements, element_loop.read(n), n * hdr.element_size());
+                    swap_elements_endianness(hdr, elements, n);
+                    element_loop.write(elements, n);
+                    e += n;
                 }
             }
             if (array_post_skip.value() > 0)
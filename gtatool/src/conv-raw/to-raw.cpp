@@ -27,7 +27,6 @@
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/fio.h"
 #include "base/opt.h"
 #include "base/chk.h"
@@ -96,12 +95,14 @@ extern "C" int gtatool_to_raw(int argc, char *argv[])
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                blob element(checked_cast<size_t>(hdri.element_size()));
-                for (uintmax_t e = 0; e < hdri.elements(); e++)
+                for (uintmax_t e = 0; e < hdri.elements(); )
                 {
-                    std::memcpy(element.ptr(), element_loop.read(1), hdri.element_size());
-                    swap_element_endianness(hdri, element.ptr());
-                    element_loop.write(element.ptr());
+                    size_t n = element_loop.batch_size(hdri.elements() - e);
+                    char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                    std::memcpy(elements, element_loop.read(n), n * hdri.element_size());
+                    swap_elements_endianness(hdri, elements, n);
+                    element_loop.write(elements, n);
+                    e += n;
                 }
             }
         }
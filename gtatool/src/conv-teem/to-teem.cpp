@@ -30,7 +30,6 @@
 #include <teem/nrrd.h>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/str.h"
 #include "base/chk.h"
@@ -102,8 +101,7 @@ extern "C" int gtatool_to_teem(int argc, char *argv[])
                 dimensions.push_back(checked_cast<size_t>(hdr.dimension_size(i)));
             }
 
-            blob data(checked_cast<size_t>(hdr.data_size()));
-            array_loop.read_data(hdr, data.ptr());
+            const void *data = array_loop.read_data(hdr);
 
             int nrrdo_type;
             switch (type)
@@ -146,7 +144,7 @@ extern "C" int gtatool_to_teem(int argc, char *argv[])
             }
 
             nrrdo = nrrdNew();
-            if (nrrdWrap_nva(nrrdo, data.ptr(), nrrdo_type,
+            if (nrrdWrap_nva(nrrdo, const_cast<void *>(data), nrrdo_type,
                         checked_cast<unsigned int>(dimensions.size()), &(dimensions[0])))
             {
                 char* errptr = biffGetDone(NRRD);
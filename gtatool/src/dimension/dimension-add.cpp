@@ -121,9 +121,11 @@ extern "C" int gtatool_dimension_add(int argc, char *argv[])
                 {
                     element_loop_t element_loop;
                     array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t i = 0; i < hdri.elements(); i++)
+                    for (uintmax_t i = 0; i < hdri.elements(); )
                     {
-                        element_loop.write(element_loop.read());
+                        size_t n = element_loop.batch_size(hdri.elements() - i);
+                        element_loop.write(element_loop.read(n), n);
+                        i += n;
                     }
                 }
             }
@@ -24,6 +24,8 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -109,20 +111,45 @@ extern "C" int gtatool_dimension_extract(int argc, char *argv[])
                     hdro.dimension_taglist(hdro_dim++) = hdri.dimension_taglist(i);
                 }
             }
+            if (hdri.dimension_size(dim) > 1)
+            {
+                min_max_tags_unset(hdro);
+            }
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
                 element_loop_t element_loop;
                 array_loop.start_element_loop(element_loop, hdri, hdro);
-                std::vector<uintmax_t> indices(hdri.dimensions());
-                for (uintmax_t i = 0; i < hdri.elements(); i++)
+                // The elements with the given index in dimension dim form runs of
+                // the size of one slice of the dimensions below dim.
+                uintmax_t run = 1;
+                for (uintmax_t i = 0; i < dim; i++)
+                {
+                    run *= hdri.dimension_size(i);
+                }
+                const size_t element_size = checked_cast<size_t>(hdri.element_size());
+                blob buf(element_size, element_loop.batch_size(hdri.elements()));
+                for (uintmax_t e0 = 0; e0 < hdri.elements(); )
                 {
-                    const void *e = element_loop.read();
-                    hdri.linear_index_to_indices(i, &(indices[0]));
-                    if (indices[dim] == ind)
+                    size_t n = element_loop.batch_size(hdri.elements() - e0);
+                    const char *elements = static_cast<const char *>(element_loop.read(n));
+                    size_t m = 0;
+                    for (size_t k = 0; k < n; )
+                    {
+                        uintmax_t e = e0 + k;
+                        size_t l = checked_cast<size_t>(std::min(run - e % run, static_cast<uintmax_t>(n - k)));
+                        if ((e / run) % hdri.dimension_size(dim) == ind)
+                        {
+                            std::memcpy(buf.ptr<char>(m * element_size), elements + k * element_size, l * element_size);
+                            m += l;
+                        }
+                        k += l;
+                    }
+                    if (m > 0)
                     {
-                        element_loop.write(e);
+                        element_loop.write(buf.ptr(), m);
                     }
+                    e0 += n;
                 }
             }
             else
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <cstring>
 
 #include <gta/gta.hpp>
 
@@ -70,7 +71,6 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
         array_loop_t array_loop;
         gta::header hdri, hdro;
         std::string namei, nameo;
-        blob eo;
         std::vector<uintmax_t> index;
 
         array_loop.start(arguments, "");
@@ -101,49 +101,51 @@ extern "C" int gtatool_dimension_flatten(int argc, char *argv[])
                 {
                     hdro.component_taglist(hdri.dimensions() + c) = hdri.component_taglist(c);
                 }
-                eo.resize(checked_cast<size_t>(hdro.element_size()));
                 index.resize(hdri.dimensions());
             }
             array_loop.write(hdro, nameo);
             if (hdro.data_size() > 0)
             {
-                if (hdri.element_size() > 0)
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdri, hdro);
+                if (hdri.element_size() > 0 && !prepend_coordinates.value())
                 {
-                    element_loop_t element_loop;
-                    array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t e = 0; e < hdro.elements(); e++)
+                    for (uintmax_t e0 = 0; e0 < hdro.elements(); )
                     {
-                        if (prepend_coordinates.value())
-                        {
-                            hdri.linear_index_to_indices(e, &(index[0]));
-                            for (size_t i = 0; i < index.size(); i++)
-                            {
-                                eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
-                            }
-                            std::memcpy(eo.ptr(hdro.element_size() - hdri.element_size()),
-                                    element_loop.read(), hdri.element_size());
-                            element_loop.write(eo.ptr());
-                        }
-                        else
-                        {
-                            element_loop.write(element_loop.read());
-                        }
+                        size_t n = element_loop.batch_size(hdro.elements() - e0);
+                        element_loop.write(element_loop.read(n), n);
+                        e0 += n;
                     }
                 }
                 else
                 {
-                    // There were no element components, and now there are only the prepended
-                    // coordinates. Generate them.
-                    element_loop_t element_loop;
-                    array_loop.start_element_loop(element_loop, hdri, hdro);
-                    for (uintmax_t e = 0; e < hdro.elements(); e++)
+                    // Prepend the coordinates to the input elements. If there were no
+                    // element components, the output elements consist of the coordinates only.
+                    const size_t element_size_in = checked_cast<size_t>(hdri.element_size());
+                    const size_t element_size_out = checked_cast<size_t>(hdro.element_size());
+                    const size_t coordinates_size = element_size_out - element_size_in;
+                    for (uintmax_t e0 = 0; e0 < hdro.elements(); )
                     {
-                        hdri.linear_index_to_indices(e, &(index[0]));
-                        for (size_t i = 0; i < index.size(); i++)
+                        size_t n = element_loop.batch_size(hdro.elements() - e0);
+                        char *elements = static_cast<char *>(element_loop.write_buffer(n));
+                        const char *elements_in = (element_size_in > 0
+                                ? static_cast<const char *>(element_loop.read(n)) : NULL);
+                        for (size_t k = 0; k < n; k++)
                         {
-                            eo.ptr<uint64_t>()[i] = checked_cast<uint64_t>(index[i]);
+                            char *eo = elements + k * element_size_out;
+                            hdri.linear_index_to_indices(e0 + k, &(index[0]));
+                            for (size_t i = 0; i < index.size(); i++)
+                            {
+                                uint64_t coordinate = checked_cast<uint64_t>(index[i]);
+                                std::memcpy(eo + i * sizeof(uint64_t), &coordinate, sizeof(uint64_t));
+                            }
+                            if (elements_in)
+                            {
+                                std::memcpy(eo + coordinates_size, elements_in + k * element_size_in, element_size_in);
+                            }
                         }
-                        element_loop.write(eo.ptr());
+                        element_loop.write(elements, n);
+                        e0 += n;
                     }
                 }
             }
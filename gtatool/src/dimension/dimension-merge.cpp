@@ -147,6 +147,10 @@ extern "C" int gtatool_dimension_merge(int argc, char *argv[])
             {
                 hdro.component_taglist(c) = hdris[0].component_taglist(c);
             }
+            for (size_t i = 1; i < arguments.size(); i++)
+            {
+                min_max_tags_merge(hdro, hdris[i]);
+            }
             array_loops[0].write(hdro, nameo);
             element_loop_t element_loop;
             array_loops[0].start_element_loop(element_loop, hdris[0], hdro);
@@ -154,9 +158,11 @@ extern "C" int gtatool_dimension_merge(int argc, char *argv[])
             {
                 element_loop_t element_loop_2;
                 array_loops[i].start_element_loop(element_loop_2, hdris[i], hdro);
-                for (uintmax_t j = 0; j < hdris[i].elements(); j++)
+                for (uintmax_t j = 0; j < hdris[i].elements(); )
                 {
-                    element_loop.write(element_loop_2.read());
+                    size_t n = element_loop_2.batch_size(hdris[i].elements() - j);
+                    element_loop.write(element_loop_2.read(n), n);
+                    j += n;
                 }
             }
         }
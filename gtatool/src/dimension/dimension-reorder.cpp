@@ -22,17 +22,16 @@
 #include "config.h"
 
 #include <sstream>
+#include <limits>
 #include <cstdio>
 #include <cctype>
 
 #include <gta/gta.hpp>
 
 #include "base/msg.h"
-#include "base/blb.h"
 #include "base/opt.h"
 #include "base/fio.h"
 #include "base/str.h"
-#include "base/chk.h"
 
 #include "lib.h"
 
@@ -40,10 +39,12 @@
 extern "C" void gtatool_dimension_reorder_help(void)
 {
     msg::req_txt(
-            "dimension-reorder [-i|--indices=<i0>[,<i1>[,...]]] [<files>...]\n"
+            "dimension-reorder [-i|--indices=<i0>[,<i1>[,...]]] [-m|--memory=<MiB>] [<files>...]\n"
             "\n"
             "Reorders the dimensions of the input GTAs into the given new order.\n"
             "The default is to make no changes.\n"
+            "The data is rearranged in tiles that use at most the given amount of memory\n"
+            "(default 256 MiB).\n"
             "Example: dimension-reorder -i 1,0 matrix.gta > transposed.gta");
 }
 
@@ -54,6 +55,8 @@ extern "C" int gtatool_dimension_reorder(int argc, char *argv[])
     options.push_back(&help);
     opt::tuple<uintmax_t> indices("indices", 'i', opt::optional);
     options.push_back(&indices);
+    opt::val<uintmax_t> memory("memory", 'm', opt::optional, 1, std::numeric_limits<uintmax_t>::max() / (1024 * 1024), 256);
+    options.push_back(&memory);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, -1, -1, arguments))
     {
@@ -126,32 +129,21 @@ extern "C" int gtatool_dimension_reorder(int argc, char *argv[])
             array_loop.write(hdro, nameo);
             element_loop_t element_loop;
             array_loop.start_element_loop(element_loop, hdri, hdro);
-            blob element(checked_cast<size_t>(hdri.element_size()));
-            std::vector<uintmax_t> in_indices(hdri.dimensions());
-            std::vector<uintmax_t> out_indices(hdro.dimensions());
-            for (uintmax_t e = 0; e < hdro.elements(); e++)
+            std::vector<uintmax_t> dim_map(hdri.dimensions());
+            for (size_t i = 0; i < dim_map.size(); i++)
             {
-                hdro.linear_index_to_indices(e, &(out_indices[0]));
-                for (size_t i = 0; i < out_indices.size(); i++)
-                {
-                    if (!indices.value().empty())
-                    {
-                        in_indices[indices.value()[i]] = out_indices[i];
-                    }
-                    else
-                    {
-                        in_indices[i] = out_indices[i];
-                    }
-                }
-                if (fbuf)
-                {
-                    hbuf.read_block(fbuf, 0, &(in_indices[0]), &(in_indices[0]), element.ptr());
-                }
-                else
-                {
-                    hdri.read_block(array_loop.file_in(), data_offset, &(in_indices[0]), &(in_indices[0]), element.ptr());
-                }
-                element_loop.write(element.ptr());
+                dim_map[i] = (indices.value().empty() ? i : indices.value()[i]);
+            }
+            std::vector<bool> reverse(hdri.dimensions(), false);
+            if (fbuf)
+            {
+                permute_dimensions(hbuf, fbuf, 0, element_loop, hdro,
+                        dim_map, reverse, memory.value() * 1024 * 1024);
+            }
+            else
+            {
+                permute_dimensions(hdri, array_loop.file_in(), data_offset, element_loop, hdro,
+                        dim_map, reverse, memory.value() * 1024 * 1024);
             }
             if (fbuf)
             {
@@ -24,6 +24,7 @@
 #include <sstream>
 #include <cstdio>
 #include <cctype>
+#include <algorithm>
 
 #include <gta/gta.hpp>
 
@@ -124,7 +125,44 @@ extern "C" int gtatool_dimension_split(int argc, char *argv[])
                     }
                 }
             }
-            if (hdri.element_size() > 0)
+            if (dim_size > 1)
+            {
+                min_max_tags_unset(hdro);
+            }
+            if (hdri.data_size() > 0 && planned_output_t::possible(array_loop))
+            {
+                // Write the GTA data directly to its final position in the
+                // output. The input elements belong to runs of stride
+                // consecutive elements that have the same index in the split
+                // dimension.
+                std::vector<gta::header> hdros(checked_cast<size_t>(dim_size), hdro);
+                std::vector<std::string> nameos;
+                planned_output_t planned_output;
+                planned_output.start(array_loop, hdros, nameos);
+                uintmax_t stride = 1;
+                for (uintmax_t i = 0; i < dim; i++)
+                {
+                    stride *= hdri.dimension_size(i);
+                }
+                size_t element_size = checked_cast<size_t>(hdri.element_size());
+                element_loop_t element_loop;
+                array_loop.start_element_loop(element_loop, hdri, hdro);
+                for (uintmax_t e = 0; e < hdri.elements(); )
+                {
+                    size_t n = element_loop.batch_size(hdri.elements() - e);
+                    const char *elements = static_cast<const char *>(element_loop.read(n));
+                    for (size_t k = 0; k < n; )
+                    {
+                        uintmax_t i = e + k;
+                        size_t run = std::min(static_cast<uintmax_t>(n - k), stride - i % stride);
+                        planned_output.write((i / stride) % dim_size, elements + k * element_size, run * element_size);
+                        k += run;
+                    }
+                    e += n;
+                }
+                planned_output.finish();
+            }
+            else if (hdri.element_size() > 0)
             {
                 // Write the GTA data to temporary files "tempdir/index"
                 tempdir = fio::mktempdir();
@@ -1318,14 +1318,25 @@ void GUI::open(const std::string &file_name, const std::string &save_name, int t
     try
     {
         const std::string &name = (save_name.length() == 0 ? file_name : save_name);
+        gta::stream_index index;
+        bool have_index = stream_index_load(name, index);
         FILE *f = fio::open(name, "r");
         try {
-            while (fio::has_more(f, name)) {
-                gta::header *hdr = new gta::header;
-                hdr->read_from(f);
-                headers.push_back(hdr);
-                offsets.push_back(fio::tell(f, name));
-                hdr->skip_data(f);
+            if (have_index) {
+                for (uintmax_t i = 0; i < index.arrays(); i++) {
+                    gta::header *hdr = new gta::header;
+                    headers.push_back(hdr);
+                    hdr->read_from(index, i, f);
+                    offsets.push_back(index.data_offset(i));
+                }
+            } else {
+                while (fio::has_more(f, name)) {
+                    gta::header *hdr = new gta::header;
+                    hdr->read_from(f);
+                    headers.push_back(hdr);
+                    offsets.push_back(fio::tell(f, name));
+                    hdr->skip_data(f);
+                }
             }
         }
         catch (...) {
@@ -22,10 +22,25 @@
 #include "config.h"
 
 #include <limits>
+#include <algorithm>
 #include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <future>
+#include <cmath>
 #include <cstring>
 #include <cstddef>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_WAIT_H
+# include <sys/wait.h>
+#endif
+
 #include "base/str.h"
 #include "base/fio.h"
 #include "base/msg.h"
@@ -484,11 +499,135 @@ void swap_component_endianness(const gta::header &header, uintmax_t i, void *com
 
 void swap_element_endianness(const gta::header &header, void *element)
 {
-    char *ptr = static_cast<char *>(element);
+    swap_elements_endianness(header, element, 1);
+}
+
+/* Swap the endianness of n values of the given size that are stride bytes apart.
+ * The loops do nothing else, so that the compiler can generate byte swap
+ * instructions or vectorize them. */
+static void swap_values_endianness(char *ptr, int size, size_t stride, size_t n)
+{
+    switch (size)
+    {
+    case 2:
+        for (size_t i = 0; i < n; i++)
+        {
+            endianness::swap16(ptr + i * stride);
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < n; i++)
+        {
+            endianness::swap32(ptr + i * stride);
+        }
+        break;
+    case 8:
+        for (size_t i = 0; i < n; i++)
+        {
+            endianness::swap64(ptr + i * stride);
+        }
+        break;
+    case 16:
+        for (size_t i = 0; i < n; i++)
+        {
+            endianness::swap128(ptr + i * stride);
+        }
+        break;
+    }
+}
+
+void swap_elements_endianness(const gta::header &header, void *elements, size_t n)
+{
+    /* Plan the swapping: find the runs of adjacent values of the same size
+     * that need swapping inside an element. Blobs and bytes are skipped. */
+    struct run
+    {
+        size_t offset;
+        size_t count;
+        int size;
+    };
+    std::vector<run> plan;
+    size_t offset = 0;
     for (uintmax_t i = 0; i < header.components(); i++)
     {
-        swap_component_endianness(header, i, ptr);
-        ptr += header.component_size(i);
+        int size = 0;
+        size_t count = 1;
+        switch (header.component_type(i))
+        {
+        case gta::blob:
+        case gta::int8:
+        case gta::uint8:
+            break;
+        case gta::int16:
+        case gta::uint16:
+            size = 2;
+            break;
+        case gta::int32:
+        case gta::uint32:
+        case gta::float32:
+            size = 4;
+            break;
+        case gta::int64:
+        case gta::uint64:
+        case gta::float64:
+            size = 8;
+            break;
+        case gta::int128:
+        case gta::uint128:
+        case gta::float128:
+            size = 16;
+            break;
+        case gta::cfloat32:
+            size = 4;
+            count = 2;
+            break;
+        case gta::cfloat64:
+            size = 8;
+            count = 2;
+            break;
+        case gta::cfloat128:
+            size = 16;
+            count = 2;
+            break;
+        }
+        if (size > 0)
+        {
+            if (!plan.empty() && plan.back().size == size
+                    && plan.back().offset + plan.back().count * size == offset)
+            {
+                plan.back().count += count;
+            }
+            else
+            {
+                run r = { offset, count, size };
+                plan.push_back(r);
+            }
+        }
+        offset += checked_cast<size_t>(header.component_size(i));
+    }
+
+    /* Execute the plan: elements that consist of values of a single size
+     * are swapped in one go; otherwise each run is swapped in each element. */
+    char *ptr = static_cast<char *>(elements);
+    size_t element_size = offset;
+    if (plan.size() == 1 && plan[0].count * plan[0].size == element_size)
+    {
+        swap_values_endianness(ptr, plan[0].size, plan[0].size, n * plan[0].count);
+    }
+    else if (plan.size() == 1 && plan[0].count == 1)
+    {
+        swap_values_endianness(ptr + plan[0].offset, plan[0].size, element_size, n);
+    }
+    else if (!plan.empty())
+    {
+        for (size_t e = 0; e < n; e++)
+        {
+            for (size_t j = 0; j < plan.size(); j++)
+            {
+                swap_values_endianness(ptr + plan[j].offset, plan[j].size, plan[j].size, plan[j].count);
+            }
+            ptr += element_size;
+        }
     }
 }
 
@@ -526,11 +665,217 @@ std::string to_utf8(const std::string &s)
     return r;
 }
 
+/* A pool of worker threads for parallel_for(). Only one range is processed at
+ * a time; the calling thread takes part in the work. */
+class thread_pool
+{
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _run_mutex;              // serializes calls of run()
+    std::mutex _mutex;                  // protects the members below
+    std::condition_variable _job_cond;
+    std::condition_variable _done_cond;
+    const std::function<void (uintmax_t, uintmax_t)> *_f;
+    uintmax_t _n;
+    uintmax_t _part;
+    uintmax_t _next;                    // start of the next unprocessed part
+    unsigned int _active;               // number of workers inside work()
+    unsigned long _job;                 // counts the jobs, to wake up the workers
+    bool _stop;
+    std::exception_ptr _exception;
+
+    static thread_local bool _in_pool;  // whether this thread is already working on a range
+
+    void work()
+    {
+        for (;;)
+        {
+            uintmax_t begin, end;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_next >= _n)
+                {
+                    return;
+                }
+                begin = _next;
+                end = std::min(_n, begin + _part);
+                _next = end;
+            }
+            try
+            {
+                (*_f)(begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_exception)
+                {
+                    _exception = std::current_exception();
+                }
+                _next = _n;
+            }
+        }
+    }
+
+    void worker()
+    {
+        _in_pool = true;
+        unsigned long job = 0;
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            _job_cond.wait(lock, [&] { return _stop || _job != job; });
+            if (_stop)
+            {
+                return;
+            }
+            job = _job;
+            _active++;
+            lock.unlock();
+            work();
+            lock.lock();
+            _active--;
+            if (_active == 0)
+            {
+                _done_cond.notify_all();
+            }
+        }
+    }
+
+public:
+    thread_pool() : _f(NULL), _n(0), _part(1), _next(0), _active(0), _job(0), _stop(false)
+    {
+        unsigned int n = std::thread::hardware_concurrency();
+        for (unsigned int i = 1; i < n; i++)
+        {
+            _threads.push_back(std::thread(&thread_pool::worker, this));
+        }
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _job_cond.notify_all();
+        for (size_t i = 0; i < _threads.size(); i++)
+        {
+            _threads[i].join();
+        }
+    }
+
+    void run(uintmax_t n, uintmax_t min_part, const std::function<void (uintmax_t, uintmax_t)> &f)
+    {
+        uintmax_t threads = _threads.size() + 1;
+        if (_in_pool || threads == 1 || n <= min_part)
+        {
+            if (n > 0)
+            {
+                f(0, n);
+            }
+            return;
+        }
+        std::lock_guard<std::mutex> run_lock(_run_mutex);
+        _in_pool = true;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _f = &f;
+            _n = n;
+            // a few parts per thread for load balancing
+            _part = std::max(min_part, (n + 4 * threads - 1) / (4 * threads));
+            _next = 0;
+            _exception = std::exception_ptr();
+            _job++;
+        }
+        _job_cond.notify_all();
+        work();
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done_cond.wait(lock, [&] { return _active == 0; });
+            _f = NULL;
+            exception = _exception;
+        }
+        _in_pool = false;
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+thread_local bool thread_pool::_in_pool = false;
+
+void parallel_for(uintmax_t n, uintmax_t min_part, const std::function<void (uintmax_t, uintmax_t)> &f)
+{
+    static thread_pool pool;
+    pool.run(n, min_part, f);
+}
+
+#ifdef HAVE_SYS_WAIT_H
+static void set_cloexec(int fd)
+{
+    int flags = fcntl(fd, F_GETFD);
+    if (flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+    {
+        throw exc(std::string("cannot set close-on-exec flag: ") + std::strerror(errno), errno);
+    }
+}
+
+pid_t start_command(const std::string &cmd, FILE *out, FILE **in)
+{
+    set_cloexec(fileno(out));
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        throw exc(std::string("cannot create pipe: ") + std::strerror(errno), errno);
+    }
+    fflush(msg::file());
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (dup2(fds[0], 0) < 0 || dup2(fileno(out), 1) < 0)
+            _exit(127);
+        close(fds[0]);
+        close(fds[1]);
+        execl("/bin/sh", "sh", "-c", cmd.c_str(), static_cast<char *>(NULL));
+        _exit(127);
+    }
+    int errsv = errno;
+    close(fds[0]);
+    if (pid < 0)
+    {
+        close(fds[1]);
+        throw exc(std::string("cannot run command '") + cmd + "': " + std::strerror(errsv), errsv);
+    }
+    *in = NULL;
+    try
+    {
+        set_cloexec(fds[1]);
+        *in = fdopen(fds[1], "w");
+        if (!*in)
+        {
+            throw exc(std::string("cannot open pipe: ") + std::strerror(errno), errno);
+        }
+    }
+    catch (...)
+    {
+        close(fds[1]);
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        throw;
+    }
+    return pid;
+}
+#endif
+
 const size_t element_loop_t::_max_iobuf_size = 1024 * 1024;
 
 element_loop_t::element_loop_t() throw ()
     : _header_in(), _name_in(), _file_in(NULL), _state_in(),
-    _header_out(), _name_out(), _file_out(NULL), _state_out(), _buf()
+    _header_out(), _name_out(), _file_out(NULL), _state_out(), _array_loop(NULL), _data_in(NULL), _buf(),
+    _read_counter(0), _in_lent(false), _out_view(NULL), _out_lent(0), _out_buf()
 {
 }
 
@@ -540,32 +885,119 @@ element_loop_t::~element_loop_t()
 
 void element_loop_t::start(
         const gta::header &header_in, const std::string &name_in, FILE *file_in,
-        const gta::header &header_out, const std::string &name_out, FILE *file_out)
+        const gta::header &header_out, const std::string &name_out, FILE *file_out,
+        array_loop_t *array_loop)
 {
     _header_in = header_in;
     _name_in = name_in;
     _file_in = file_in;
     _state_in = gta::io_state();
+    _state_in.set_async(true);
     _header_out = header_out;
     _name_out = name_out;
     _file_out = file_out;
     _state_out = gta::io_state();
+    _state_out.set_async(true);
+    _array_loop = array_loop;
+    _data_in = NULL;
     _buf.resize(0);
+    _read_counter = 0;
+    _in_lent = false;
+    _out_view = NULL;
+    _out_lent = 0;
+    _out_buf.resize(0);
+}
+
+size_t element_loop_t::batch_size(uintmax_t remaining) const
+{
+    uintmax_t element_size = std::max(_header_in.element_size(), _header_out.element_size());
+    uintmax_t n = _max_iobuf_size / std::max(element_size, static_cast<uintmax_t>(1));
+    return checked_cast<size_t>(std::max(std::min(n, remaining), static_cast<uintmax_t>(1)));
 }
 
 const void *element_loop_t::read(size_t n)
 {
-    if (_buf.size() < checked_cast<size_t>(n * _header_in.element_size()))
+    if (_read_counter == 0 && _array_loop)
+    {
+        // Map the input data only when it is actually read: some commands
+        // use an element loop only for output.
+        _data_in = static_cast<const char *>(_array_loop->map_data(_header_in));
+    }
+    if (_data_in)
+    {
+        const void *p = _data_in + _read_counter * _header_in.element_size();
+        _read_counter += n;
+        return p;
+    }
+    if (_in_lent)
+    {
+        _header_in.commit_read_elements(_state_in, _file_in);
+        _in_lent = false;
+    }
+    const void *view = NULL;
+    uintmax_t lent = 0;
+    // The commit after the last element may need to read from the input,
+    // so the last batch is copied and committed right away.
+    if (n < _header_in.elements() - _read_counter)
+    {
+        view = _header_in.lend_read_elements(_state_in, _file_in, n, &lent);
+        if (lent == n)
+        {
+            _in_lent = true;
+            _read_counter += n;
+            return view;
+        }
+    }
+    size_t element_size = checked_cast<size_t>(_header_in.element_size());
+    if (_buf.size() < checked_mul(n, element_size))
+    {
+        _buf.resize(n * element_size);
+    }
+    if (lent > 0)
     {
-        _buf.resize(n * _header_in.element_size());
+        std::memcpy(_buf.ptr(), view, lent * element_size);
+        _header_in.commit_read_elements(_state_in, _file_in);
     }
-    _header_in.read_elements(_state_in, _file_in, n, _buf.ptr());
+    _header_in.read_elements(_state_in, _file_in, n - lent, _buf.ptr(lent * element_size));
+    _read_counter += n;
     return _buf.ptr();
 }
 
+void *element_loop_t::write_buffer(size_t n)
+{
+    _out_view = _header_out.lend_write_elements(_state_out, _file_out, n, &_out_lent);
+    if (_out_lent == n)
+    {
+        return _out_view;
+    }
+    size_t element_size = checked_cast<size_t>(_header_out.element_size());
+    if (_out_buf.size() < checked_mul(n, element_size))
+    {
+        _out_buf.resize(n * element_size);
+    }
+    return _out_buf.ptr();
+}
+
 void element_loop_t::write(const void *element, size_t n)
 {
-    _header_out.write_elements(_state_out, _file_out, n, element);
+    if (_out_lent > 0)
+    {
+        // Elements were lent by write_buffer(); they are the first elements to write.
+        size_t lent_size = checked_cast<size_t>(_out_lent * _header_out.element_size());
+        if (element != _out_view)
+        {
+            std::memcpy(_out_view, element, lent_size);
+        }
+        _header_out.commit_write_elements(_state_out, _file_out);
+        element = static_cast<const char *>(element) + lent_size;
+        n -= _out_lent;
+        _out_view = NULL;
+        _out_lent = 0;
+    }
+    if (n > 0)
+    {
+        _header_out.write_elements(_state_out, _file_out, n, element);
+    }
 }
 
 const std::string array_loop_t::_stdin_name = "standard input";
@@ -576,12 +1008,22 @@ array_loop_t::array_loop_t() throw ()
     _file_in(NULL), _file_out(NULL),
     _filename_index(0), _file_index_in(0),
     _index_in(0), _index_out(0),
-    _array_name_in(), _array_name_out()
+    _array_name_in(), _array_name_out(),
+    _map(NULL), _map_size(0), _data_buf(),
+    _stream_index(NULL), _stream_index_file(0), _stream_index_loaded(false)
 {
 }
 
 array_loop_t::~array_loop_t()
 {
+    try
+    {
+        unmap_data();
+    }
+    catch (...)
+    {
+    }
+    delete _stream_index;
     if (_file_in && _file_in != gtatool_stdin)
     {
         try
@@ -617,6 +1059,9 @@ void array_loop_t::start(const std::vector<std::string> &filenames_in,
     _index_out = 0;
     _array_name_in = "";
     _array_name_out = "";
+    delete _stream_index;
+    _stream_index = NULL;
+    _stream_index_loaded = false;
     if (_filenames_in.size() == 0)
     {
         _file_in = gtatool_stdin;
@@ -637,6 +1082,7 @@ void array_loop_t::start(const std::vector<std::string> &filenames_in,
 
 void array_loop_t::finish()
 {
+    unmap_data();
     if (_file_out && _file_out != gtatool_stdout)
     {
         FILE *f = _file_out;
@@ -663,7 +1109,37 @@ const std::string &array_loop_t::filename_out() throw ()
     return (_file_out == gtatool_stdout ? _stdout_name : _filename_out);
 }
 
-bool array_loop_t::read(gta::header &header_in, std::string &name_in)
+std::string stream_index_name(const std::string &filename)
+{
+    return filename + ".idx";
+}
+
+bool stream_index_load(const std::string &filename, gta::stream_index &index)
+{
+    std::string index_name = stream_index_name(filename);
+    struct stat file_stat, index_stat;
+    if (!fio::stat(filename, &file_stat) || !S_ISREG(file_stat.st_mode)
+            || !fio::stat(index_name, &index_stat)
+            || index_stat.st_mtime < file_stat.st_mtime)
+    {
+        return false;
+    }
+    FILE *f = fio::open(index_name, "r");
+    try
+    {
+        index.read_from(f);
+    }
+    catch (std::exception &e)
+    {
+        fio::close(f, index_name);
+        msg::wrn_txt("%s: ignoring stream index: %s", index_name.c_str(), e.what());
+        return false;
+    }
+    fio::close(f, index_name);
+    return (index.file_size() == static_cast<uintmax_t>(file_stat.st_size));
+}
+
+bool array_loop_t::next_input()
 {
     while (!fio::has_more(_file_in, filename_in()))
     {
@@ -685,6 +1161,17 @@ bool array_loop_t::read(gta::header &header_in, std::string &name_in)
             _file_index_in = 0;
         }
     }
+    return true;
+}
+
+bool array_loop_t::read(gta::header &header_in, std::string &name_in)
+{
+    unmap_data();
+    _data_buf.resize(0);
+    if (!next_input())
+    {
+        return false;
+    }
     _array_name_in = filename_in() + " array " + str::from(_file_index_in);
     name_in = _array_name_in;
     try
@@ -700,6 +1187,62 @@ bool array_loop_t::read(gta::header &header_in, std::string &name_in)
     return true;
 }
 
+uintmax_t array_loop_t::skip_arrays(uintmax_t n)
+{
+    unmap_data();
+    _data_buf.resize(0);
+    uintmax_t skipped = 0;
+    while (skipped < n && next_input())
+    {
+        const gta::stream_index *index = stream_index_in();
+        if (index && _file_index_in < index->arrays())
+        {
+            uintmax_t k = std::min(n - skipped, index->arrays() - _file_index_in);
+            uintmax_t target = _file_index_in + k;
+            fio::seek(_file_in, target < index->arrays()
+                    ? index->header_offset(target) : index->file_size(),
+                    SEEK_SET, filename_in());
+            _file_index_in += k;
+            _index_in += k;
+            skipped += k;
+        }
+        else
+        {
+            gta::header hdr;
+            std::string name;
+            read(hdr, name);
+            skip_data(hdr);
+            skipped++;
+        }
+    }
+    return skipped;
+}
+
+const gta::stream_index *array_loop_t::stream_index_in()
+{
+    if (_file_in == gtatool_stdin)
+    {
+        return NULL;
+    }
+    if (!_stream_index_loaded || _stream_index_file != _filename_index)
+    {
+        delete _stream_index;
+        _stream_index = NULL;
+        _stream_index_loaded = true;
+        _stream_index_file = _filename_index;
+        gta::stream_index *index = new gta::stream_index;
+        if (stream_index_load(_filenames_in[_filename_index], *index))
+        {
+            _stream_index = index;
+        }
+        else
+        {
+            delete index;
+        }
+    }
+    return _stream_index;
+}
+
 void array_loop_t::write(const gta::header &header_out, std::string &name_out)
 {
     if (fio::isatty(_file_out))
@@ -767,6 +1310,62 @@ void array_loop_t::read_data(const gta::header &header_in, void *data)
     }
 }
 
+const void *array_loop_t::read_data(const gta::header &header_in)
+{
+    const void *data = map_data(header_in);
+    if (!data)
+    {
+        _data_buf.resize(checked_cast<size_t>(header_in.data_size()));
+        read_data(header_in, _data_buf.ptr());
+        data = _data_buf.ptr();
+    }
+    return data;
+}
+
+const void *array_loop_t::map_data(const gta::header &header_in)
+{
+    unmap_data();
+    if (!header_in.data_is_native()
+            || header_in.data_size() == 0
+            || header_in.data_size() > std::numeric_limits<size_t>::max()
+            || header_in.data_size() > static_cast<uintmax_t>(std::numeric_limits<off_t>::max())
+            || !fio::seekable(_file_in))
+    {
+        return NULL;
+    }
+    struct stat buf;
+    fio::stat(_file_in, &buf, filename_in());
+    off_t offset = fio::tell(_file_in, filename_in());
+    off_t size = header_in.data_size();
+    if (!S_ISREG(buf.st_mode) || buf.st_size < offset || buf.st_size - offset < size)
+    {
+        // let the normal read path report truncated input
+        return NULL;
+    }
+    try
+    {
+        _map = fio::map(_file_in, offset, size, filename_in());
+    }
+    catch (...)
+    {
+        // e.g. not enough address space; fall back to reading
+        return NULL;
+    }
+    _map_size = size;
+    fio::seek(_file_in, size, SEEK_CUR, filename_in());
+    return _map;
+}
+
+void array_loop_t::unmap_data()
+{
+    if (_map)
+    {
+        void *map = _map;
+        _map = NULL;
+        fio::unmap(map, _map_size, filename_in());
+    }
+}
+
 void array_loop_t::write_data(const gta::header &header_out, const void *data)
 {
     try
@@ -783,7 +1382,7 @@ void array_loop_t::start_element_loop(element_loop_t &element_loop,
         const gta::header &header_in, const gta::header &header_out)
 {
     element_loop.start(header_in, _array_name_in, _file_in,
-            header_out, _array_name_out, _file_out);
+            header_out, _array_name_out, _file_out, this);
 }
 
 void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FILE **buf_f)
@@ -793,3 +1392,1305 @@ void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FI
     buf_header.set_compression(gta::none);
     header.copy_data(f, buf_header, *buf_f);
 }
+
+/* Brick cache */
+
+brick_cache_t::brick_cache_t(const gta::header &header, FILE *f, uintmax_t data_offset, uintmax_t memory,
+        const std::string &filename) :
+    _header(header), _fd(fileno(f)), _data_offset(data_offset), _memory(memory), _filename(filename), _size(0)
+{
+    // Grow the bricks to about 1 MiB (but at most an eighth of the memory):
+    // first dimension 0 until the contiguous runs are long enough for
+    // efficient input, then all dimensions alternately.
+    const size_t n = header.dimensions();
+    const uintmax_t es = std::max(header.element_size(), static_cast<uintmax_t>(1));
+    const uintmax_t target = std::max(std::min(memory / 8, static_cast<uintmax_t>(1024 * 1024)), es);
+    std::vector<uintmax_t> e(n, 1);
+    uintmax_t bytes = es;
+    while (n > 0 && bytes < 4096 && e[0] < header.dimension_size(0) && 2 * bytes <= target)
+    {
+        uintmax_t new_e = std::min(2 * e[0], header.dimension_size(0));
+        bytes = bytes / e[0] * new_e;
+        e[0] = new_e;
+    }
+    for (bool grown = true; grown;)
+    {
+        grown = false;
+        for (size_t d = 0; d < n; d++)
+        {
+            uintmax_t new_e = std::min(2 * e[d], header.dimension_size(d));
+            if (new_e > e[d] && bytes / e[d] * new_e <= target)
+            {
+                bytes = bytes / e[d] * new_e;
+                e[d] = new_e;
+                grown = true;
+            }
+        }
+    }
+    init_grid(e, std::vector<uintmax_t>(n, 0));
+    fio::flush(f, filename);
+}
+
+brick_cache_t::brick_cache_t(const gta::header &header, FILE *f, uintmax_t data_offset, uintmax_t memory,
+        const std::vector<uintmax_t> &brick_size, const std::vector<uintmax_t> &brick_start,
+        const std::string &filename) :
+    _header(header), _fd(fileno(f)), _data_offset(data_offset), _memory(memory), _filename(filename), _size(0)
+{
+    init_grid(brick_size, brick_start);
+    fio::flush(f, filename);
+}
+
+brick_cache_t::~brick_cache_t()
+{
+    if (_prefetch.valid())
+    {
+        _prefetch.wait();
+    }
+}
+
+void brick_cache_t::init_grid(const std::vector<uintmax_t> &brick_size, const std::vector<uintmax_t> &brick_start)
+{
+    const size_t n = _header.dimensions();
+    _brick_size.resize(n);
+    _brick_shift.resize(n);
+    _bricks.resize(n);
+    for (size_t d = 0; d < n; d++)
+    {
+        uintmax_t size = _header.dimension_size(d);
+        _brick_size[d] = std::max(std::min(brick_size[d], size), static_cast<uintmax_t>(1));
+        _brick_shift[d] = (_brick_size[d] - brick_start[d] % _brick_size[d]) % _brick_size[d];
+        _bricks[d] = (size - 1 + _brick_shift[d]) / _brick_size[d] + 1;
+    }
+}
+
+void brick_cache_t::brick_range(uintmax_t index, uintmax_t *lower, uintmax_t *higher) const
+{
+    for (size_t d = 0; d < _bricks.size(); d++)
+    {
+        uintmax_t j = index % _bricks[d];
+        index /= _bricks[d];
+        uintmax_t start = j * _brick_size[d];
+        lower[d] = (start < _brick_shift[d] ? 0 : start - _brick_shift[d]);
+        higher[d] = std::min(start + _brick_size[d] - _brick_shift[d], _header.dimension_size(d)) - 1;
+    }
+}
+
+void brick_cache_t::read_brick(uintmax_t index, blob &data) const
+{
+    const size_t n = _bricks.size();
+    std::vector<uintmax_t> lower(n), higher(n);
+    brick_range(index, &(lower[0]), &(higher[0]));
+    uintmax_t elements = 1;
+    for (size_t d = 0; d < n; d++)
+    {
+        elements *= higher[d] - lower[d] + 1;
+    }
+    data.resize(checked_cast<size_t>(_header.element_size()), checked_cast<size_t>(elements));
+    try
+    {
+        _header.pread_block(_fd, _data_offset, &(lower[0]), &(higher[0]), data.ptr());
+    }
+    catch (std::exception &e)
+    {
+        throw exc(_filename.empty() ? std::string(e.what()) : _filename + ": " + e.what());
+    }
+}
+
+void brick_cache_t::insert(std::list<brick> &bricks)
+{
+    while (!bricks.empty())
+    {
+        if (_index.find(bricks.front().index) != _index.end())
+        {
+            bricks.pop_front();
+            continue;
+        }
+        _lru.splice(_lru.begin(), bricks, bricks.begin());
+        _index[_lru.front().index] = _lru.begin();
+        _size += _lru.front().data.size();
+    }
+    // Evict the least recently used bricks, but keep the newest one
+    while (_size > _memory && _lru.size() > 1)
+    {
+        _size -= _lru.back().data.size();
+        _index.erase(_lru.back().index);
+        _lru.pop_back();
+    }
+}
+
+void brick_cache_t::finish_prefetch()
+{
+    if (_prefetch.valid())
+    {
+        try
+        {
+            std::list<brick> bricks = _prefetch.get();
+            insert(bricks);
+        }
+        catch (...)
+        {
+            // Ignore the error here; it is reported if the brick is needed
+        }
+    }
+}
+
+void brick_cache_t::start_prefetch(const uintmax_t *lower, const uintmax_t *higher)
+{
+    const size_t n = _bricks.size();
+    if (_prev_lower.size() != n)
+    {
+        return;
+    }
+    // Find the single dimension in which the block moved
+    size_t dim = n;
+    for (size_t d = 0; d < n; d++)
+    {
+        if (lower[d] != _prev_lower[d] || higher[d] != _prev_higher[d])
+        {
+            if (dim < n)
+            {
+                return;
+            }
+            dim = d;
+        }
+    }
+    if (dim == n)
+    {
+        return;
+    }
+    // The next block in the same direction, clamped to the array
+    std::vector<uintmax_t> next_lower(lower, lower + n), next_higher(higher, higher + n);
+    uintmax_t size = _header.dimension_size(dim);
+    if (lower[dim] > _prev_lower[dim])
+    {
+        uintmax_t delta = lower[dim] - _prev_lower[dim];
+        if (higher[dim] == size - 1)
+        {
+            return;
+        }
+        next_lower[dim] = std::min(lower[dim] + delta, size - 1);
+        next_higher[dim] = std::min(higher[dim] + delta, size - 1);
+    }
+    else
+    {
+        uintmax_t delta = _prev_lower[dim] - lower[dim];
+        if (delta == 0 || lower[dim] == 0)
+        {
+            return;
+        }
+        next_lower[dim] = (lower[dim] > delta ? lower[dim] - delta : 0);
+        next_higher[dim] = (higher[dim] > delta ? higher[dim] - delta : 0);
+    }
+    // Collect the bricks that are not cached yet, if they fit into half of the memory
+    std::vector<uintmax_t> j_lo(n), j_hi(n), j(n);
+    for (size_t d = 0; d < n; d++)
+    {
+        j_lo[d] = (next_lower[d] + _brick_shift[d]) / _brick_size[d];
+        j_hi[d] = (next_higher[d] + _brick_shift[d]) / _brick_size[d];
+    }
+    j = j_lo;
+    std::vector<uintmax_t> indices;
+    std::vector<uintmax_t> blo(n), bhi(n);
+    uintmax_t bytes = 0;
+    for (;;)
+    {
+        uintmax_t index = 0;
+        for (size_t d = n; d > 0; d--)
+        {
+            index = index * _bricks[d - 1] + j[d - 1];
+        }
+        if (_index.find(index) == _index.end())
+        {
+            brick_range(index, &(blo[0]), &(bhi[0]));
+            uintmax_t elements = 1;
+            for (size_t d = 0; d < n; d++)
+            {
+                elements *= bhi[d] - blo[d] + 1;
+            }
+            bytes += elements * _header.element_size();
+            if (bytes > _memory / 2)
+            {
+                return;
+            }
+            indices.push_back(index);
+        }
+        size_t d;
+        for (d = 0; d < n; d++)
+        {
+            if (j[d] < j_hi[d])
+            {
+                j[d]++;
+                break;
+            }
+            j[d] = j_lo[d];
+        }
+        if (d == n)
+        {
+            break;
+        }
+    }
+    if (indices.size() > 0)
+    {
+        _prefetch = std::async(std::launch::async, [this, indices]()
+                {
+                    std::list<brick> bricks;
+                    for (size_t i = 0; i < indices.size(); i++)
+                    {
+                        bricks.push_back(brick());
+                        bricks.back().index = indices[i];
+                        read_brick(indices[i], bricks.back().data);
+                    }
+                    return bricks;
+                });
+    }
+}
+
+void brick_cache_t::read_block(const uintmax_t *lower, const uintmax_t *higher, void *block)
+{
+    const size_t n = _bricks.size();
+    const size_t es = checked_cast<size_t>(_header.element_size());
+    for (size_t d = 0; d < n; d++)
+    {
+        if (lower[d] > higher[d] || higher[d] >= _header.dimension_size(d))
+        {
+            throw exc((_filename.empty() ? std::string() : _filename + ": ") + "invalid block coordinates");
+        }
+    }
+    if (_header.data_size() == 0)
+    {
+        return;
+    }
+    finish_prefetch();
+
+    std::vector<size_t> dst_stride(n);
+    std::vector<uintmax_t> j_lo(n), j_hi(n), j(n);
+    for (size_t d = 0; d < n; d++)
+    {
+        dst_stride[d] = (d == 0 ? es : dst_stride[d - 1] * checked_cast<size_t>(higher[d - 1] - lower[d - 1] + 1));
+        j_lo[d] = (lower[d] + _brick_shift[d]) / _brick_size[d];
+        j_hi[d] = (higher[d] + _brick_shift[d]) / _brick_size[d];
+    }
+    std::vector<uintmax_t> blo(n), bhi(n), ilo(n), ihi(n), x(n);
+    std::vector<size_t> src_stride(n);
+    j = j_lo;
+    for (;;)
+    {
+        // Get the brick, from the cache or from the file
+        uintmax_t index = 0;
+        for (size_t d = n; d > 0; d--)
+        {
+            index = index * _bricks[d - 1] + j[d - 1];
+        }
+        auto it = _index.find(index);
+        if (it != _index.end())
+        {
+            _lru.splice(_lru.begin(), _lru, it->second);
+        }
+        else
+        {
+            std::list<brick> bricks(1);
+            bricks.front().index = index;
+            read_brick(index, bricks.front().data);
+            insert(bricks);
+        }
+        const char *src = _lru.front().data.ptr<char>();
+        // Copy its intersection with the block in runs along dimension 0
+        brick_range(index, &(blo[0]), &(bhi[0]));
+        for (size_t d = 0; d < n; d++)
+        {
+            src_stride[d] = (d == 0 ? es : src_stride[d - 1] * (bhi[d - 1] - blo[d - 1] + 1));
+            ilo[d] = std::max(lower[d], blo[d]);
+            ihi[d] = std::min(higher[d], bhi[d]);
+        }
+        size_t run = (ihi[0] - ilo[0] + 1) * es;
+        x = ilo;
+        for (;;)
+        {
+            size_t src_offset = 0;
+            size_t dst_offset = 0;
+            for (size_t d = 0; d < n; d++)
+            {
+                src_offset += (x[d] - blo[d]) * src_stride[d];
+                dst_offset += (x[d] - lower[d]) * dst_stride[d];
+            }
+            std::memcpy(static_cast<char *>(block) + dst_offset, src + src_offset, run);
+            size_t d;
+            for (d = 1; d < n; d++)
+            {
+                if (x[d] < ihi[d])
+                {
+                    x[d]++;
+                    break;
+                }
+                x[d] = ilo[d];
+            }
+            if (d >= n)
+            {
+                break;
+            }
+        }
+        // Next brick
+        size_t d;
+        for (d = 0; d < n; d++)
+        {
+            if (j[d] < j_hi[d])
+            {
+                j[d]++;
+                break;
+            }
+            j[d] = j_lo[d];
+        }
+        if (d == n)
+        {
+            break;
+        }
+    }
+
+    start_prefetch(lower, higher);
+    _prev_lower.assign(lower, lower + n);
+    _prev_higher.assign(higher, higher + n);
+}
+
+/* Copy n elements of size S (or es if S is 0) with the given strides. */
+template<size_t S>
+static void copy_strided(char *dst, ptrdiff_t dst_step, const char *src, ptrdiff_t src_step,
+        uintmax_t n, size_t es)
+{
+    for (uintmax_t i = 0; i < n; i++)
+    {
+        std::memcpy(dst, src, S == 0 ? es : S);
+        dst += dst_step;
+        src += src_step;
+    }
+}
+
+static void copy_strided(char *dst, ptrdiff_t dst_step, const char *src, ptrdiff_t src_step,
+        uintmax_t n, size_t es)
+{
+    switch (es)
+    {
+    case 1:
+        copy_strided<1>(dst, dst_step, src, src_step, n, es);
+        break;
+    case 2:
+        copy_strided<2>(dst, dst_step, src, src_step, n, es);
+        break;
+    case 4:
+        copy_strided<4>(dst, dst_step, src, src_step, n, es);
+        break;
+    case 8:
+        copy_strided<8>(dst, dst_step, src, src_step, n, es);
+        break;
+    case 16:
+        copy_strided<16>(dst, dst_step, src, src_step, n, es);
+        break;
+    default:
+        copy_strided<0>(dst, dst_step, src, src_step, n, es);
+        break;
+    }
+}
+
+/* Rearrange a tile in memory. The tile has the extents x (in output dimension
+ * order); src_step and dst_step are the byte offsets between neighboring
+ * elements in each output dimension. Output dimension 0 is contiguous in dst,
+ * and output dimension b is the one that is contiguous in src. If these
+ * differ, both are traversed in small blocks to stay in the cache. */
+static void permute_tile(char *dst, const std::vector<ptrdiff_t> &dst_step,
+        const char *src, const std::vector<ptrdiff_t> &src_step,
+        const std::vector<uintmax_t> &x, size_t b, size_t es)
+{
+    const uintmax_t block = 32;
+    const size_t n = x.size();
+    std::vector<uintmax_t> idx(n, 0);
+    for (;;)
+    {
+        char *d = dst;
+        const char *s = src;
+        for (size_t i = 1; i < n; i++)
+        {
+            if (i != b)
+            {
+                d += static_cast<ptrdiff_t>(idx[i]) * dst_step[i];
+                s += static_cast<ptrdiff_t>(idx[i]) * src_step[i];
+            }
+        }
+        if (b == 0)
+        {
+            copy_strided(d, dst_step[0], s, src_step[0], x[0], es);
+        }
+        else
+        {
+            for (uintmax_t jb = 0; jb < x[b]; jb += block)
+            {
+                uintmax_t jn = std::min(block, x[b] - jb);
+                for (uintmax_t ib = 0; ib < x[0]; ib += block)
+                {
+                    uintmax_t in = std::min(block, x[0] - ib);
+                    for (uintmax_t j = jb; j < jb + jn; j++)
+                    {
+                        ptrdiff_t jj = j;
+                        ptrdiff_t ii = ib;
+                        copy_strided(d + jj * dst_step[b] + ii * dst_step[0], dst_step[0],
+                                s + jj * src_step[b] + ii * src_step[0], src_step[0], in, es);
+                    }
+                }
+            }
+        }
+        size_t i;
+        for (i = 1; i < n; i++)
+        {
+            if (i == b)
+            {
+                continue;
+            }
+            if (idx[i] + 1 < x[i])
+            {
+                idx[i]++;
+                break;
+            }
+            idx[i] = 0;
+        }
+        if (i >= n)
+        {
+            break;
+        }
+    }
+}
+
+void permute_dimensions(const gta::header &header_in, FILE *f, uintmax_t data_offset,
+        element_loop_t &element_loop, const gta::header &header_out,
+        const std::vector<uintmax_t> &dim_map, const std::vector<bool> &reverse,
+        uintmax_t memory)
+{
+    const size_t n = header_in.dimensions();
+    if (header_in.data_size() == 0)
+    {
+        return;
+    }
+    const size_t es = checked_cast<size_t>(header_in.element_size());
+    std::vector<size_t> in_to_out(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        in_to_out[dim_map[i]] = i;
+    }
+
+    /* Choose the tile extents (in input dimension order). Grow the dimensions
+     * in input order and in output order alternately, always extending the
+     * shorter of the contiguous runs, so that both reading the input and
+     * writing the output happen in long runs. The memory holds four tiles:
+     * the input and output tiles, and the current and the next input tile in
+     * the brick cache. */
+    const uintmax_t max_tile_elements = std::max(memory / (4 * es), static_cast<uintmax_t>(1));
+    std::vector<uintmax_t> e(n, 1);
+    uintmax_t tile_elements = 1;
+    for (;;)
+    {
+        size_t in_next = 0;
+        uintmax_t in_run = 1;
+        while (in_next < n && e[in_next] == header_in.dimension_size(in_next))
+        {
+            in_run *= e[in_next];
+            in_next++;
+        }
+        size_t out_next = 0;
+        uintmax_t out_run = 1;
+        while (out_next < n && e[dim_map[out_next]] == header_in.dimension_size(dim_map[out_next]))
+        {
+            out_run *= e[dim_map[out_next]];
+            out_next++;
+        }
+        if (in_next == n && out_next == n)
+        {
+            break;
+        }
+        size_t d = ((in_next < n && in_run <= out_run) || out_next == n) ? in_next : dim_map[out_next];
+        uintmax_t room = max_tile_elements / (tile_elements / e[d]);
+        uintmax_t new_e = std::min(room, header_in.dimension_size(d));
+        if (new_e <= e[d])
+        {
+            break;
+        }
+        tile_elements = tile_elements / e[d] * new_e;
+        e[d] = new_e;
+        if (new_e < header_in.dimension_size(d))
+        {
+            break;
+        }
+    }
+
+    /* If the tiles are slabs of the output, i.e. they cover the lower output
+     * dimensions completely, they can be written directly in output order.
+     * Otherwise, they are first collected in a temporary file. */
+    bool direct = true;
+    {
+        size_t i = 0;
+        while (i < n && e[dim_map[i]] == header_in.dimension_size(dim_map[i]))
+        {
+            i++;
+        }
+        for (i++; i < n; i++)
+        {
+            if (e[dim_map[i]] != 1)
+            {
+                direct = false;
+            }
+        }
+    }
+    FILE *ftmp = NULL;
+    gta::header header_tmp;
+    if (!direct)
+    {
+        ftmp = fio::tempfile();
+        header_tmp = header_out;
+        header_tmp.set_compression(gta::none);
+    }
+
+    /* The input tiles are the bricks of the cache. In reversed dimensions,
+     * the tiles are aligned to the end of the dimension. */
+    std::vector<uintmax_t> brick_start(n);
+    for (size_t d = 0; d < n; d++)
+    {
+        brick_start[d] = (reverse[in_to_out[d]] ? header_in.dimension_size(d) % e[d] : 0);
+    }
+    brick_cache_t cache(header_in, f, data_offset, 2 * tile_elements * es, e, brick_start);
+
+    blob in_tile(es, checked_cast<size_t>(tile_elements));
+    blob out_tile(es, checked_cast<size_t>(tile_elements));
+    std::vector<uintmax_t> tile_index(n, 0);
+    std::vector<uintmax_t> x(n), in_lo(n), in_hi(n), out_lo(n), out_hi(n);
+    std::vector<ptrdiff_t> src_step(n), dst_step(n), in_stride(n);
+    for (;;)
+    {
+        // Determine the tile in output and input coordinates
+        for (size_t i = 0; i < n; i++)
+        {
+            uintmax_t size = header_out.dimension_size(i);
+            out_lo[i] = tile_index[i] * e[dim_map[i]];
+            x[i] = std::min(e[dim_map[i]], size - out_lo[i]);
+            out_hi[i] = out_lo[i] + x[i] - 1;
+            uintmax_t d = dim_map[i];
+            in_lo[d] = (reverse[i] ? size - 1 - out_hi[i] : out_lo[i]);
+            in_hi[d] = (reverse[i] ? size - 1 - out_lo[i] : out_hi[i]);
+        }
+        // Read it and rearrange it
+        cache.read_block(&(in_lo[0]), &(in_hi[0]), in_tile.ptr());
+        ptrdiff_t src_offset = 0;
+        for (size_t d = 0; d < n; d++)
+        {
+            in_stride[d] = (d == 0 ? es : in_stride[d - 1] * static_cast<ptrdiff_t>(in_hi[d - 1] - in_lo[d - 1] + 1));
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            dst_step[i] = (i == 0 ? es : dst_step[i - 1] * static_cast<ptrdiff_t>(x[i - 1]));
+            src_step[i] = in_stride[dim_map[i]];
+            if (reverse[i])
+            {
+                src_offset += static_cast<ptrdiff_t>(x[i] - 1) * src_step[i];
+                src_step[i] = -src_step[i];
+            }
+        }
+        permute_tile(out_tile.ptr<char>(), dst_step, in_tile.ptr<char>() + src_offset, src_step,
+                x, in_to_out[0], es);
+        // Write it
+        uintmax_t out_tile_elements = 1;
+        for (size_t i = 0; i < n; i++)
+        {
+            out_tile_elements *= x[i];
+        }
+        if (direct)
+        {
+            element_loop.write(out_tile.ptr(), out_tile_elements);
+        }
+        else
+        {
+            header_tmp.write_block(ftmp, 0, &(out_lo[0]), &(out_hi[0]), out_tile.ptr());
+        }
+        // Next tile in output order
+        size_t i;
+        for (i = 0; i < n; i++)
+        {
+            if (out_hi[i] + 1 < header_out.dimension_size(i))
+            {
+                tile_index[i]++;
+                break;
+            }
+            tile_index[i] = 0;
+        }
+        if (i == n)
+        {
+            break;
+        }
+    }
+
+    if (!direct)
+    {
+        fio::rewind(ftmp);
+        uintmax_t remaining = header_out.elements();
+        while (remaining > 0)
+        {
+            size_t k = element_loop.batch_size(remaining);
+            void *p = element_loop.write_buffer(k);
+            fio::read(p, es, k, ftmp);
+            element_loop.write(p, k);
+            remaining -= k;
+        }
+        fio::close(ftmp);
+    }
+}
+
+/* Planned output */
+
+planned_output_t::planned_output_t() throw () : _f(NULL), _end(0)
+{
+}
+
+bool planned_output_t::possible(array_loop_t &array_loop)
+{
+    if (!fio::seekable(array_loop.file_out()))
+    {
+        return false;
+    }
+#ifdef F_GETFL
+    // positioned writes ignore the offset in append mode
+    int flags = ::fcntl(fileno(array_loop.file_out()), F_GETFL);
+    if (flags == -1 || (flags & O_APPEND))
+    {
+        return false;
+    }
+#endif
+    return true;
+}
+
+void planned_output_t::start(array_loop_t &array_loop, const std::vector<gta::header> &headers,
+        std::vector<std::string> &names, uintmax_t memory)
+{
+    _f = array_loop.file_out();
+    _filename = array_loop.filename_out();
+    _offsets.resize(headers.size());
+    _ends.resize(headers.size());
+    _buffers.resize(headers.size());
+    _buffer_fill.assign(headers.size(), 0);
+    names.resize(headers.size());
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        array_loop.write(headers[i], names[i]);
+        _offsets[i] = fio::tell(_f, _filename);
+        _ends[i] = checked_add(_offsets[i], headers[i].data_size());
+        if (i + 1 < headers.size())
+        {
+            fio::seek(_f, _ends[i], SEEK_SET, _filename);
+        }
+    }
+    fio::flush(_f, _filename);
+    _end = (headers.size() > 0 ? _ends.back() : fio::tell(_f, _filename));
+    size_t buffer_size = checked_cast<size_t>(std::max(memory / std::max(headers.size(), static_cast<size_t>(1)),
+                static_cast<uintmax_t>(1)));
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        _buffers[i].resize(checked_cast<size_t>(std::min(static_cast<uintmax_t>(buffer_size),
+                        headers[i].data_size())));
+    }
+}
+
+void planned_output_t::flush(size_t i)
+{
+    fio::pwrite(_buffers[i].ptr(), _buffer_fill[i], _offsets[i], _f, _filename);
+    _offsets[i] += _buffer_fill[i];
+    _buffer_fill[i] = 0;
+}
+
+void planned_output_t::write(size_t i, const void *data, size_t size)
+{
+    if (size > _ends[i] - _offsets[i] - _buffer_fill[i])
+    {
+        throw exc(_filename + ": too much data for planned array");
+    }
+    const char *p = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        size_t k = std::min(size, _buffers[i].size() - _buffer_fill[i]);
+        std::memcpy(_buffers[i].ptr(_buffer_fill[i]), p, k);
+        _buffer_fill[i] += k;
+        p += k;
+        size -= k;
+        if (_buffer_fill[i] == _buffers[i].size())
+        {
+            flush(i);
+        }
+    }
+}
+
+void planned_output_t::finish()
+{
+    for (size_t i = 0; i < _buffers.size(); i++)
+    {
+        flush(i);
+        if (_offsets[i] != _ends[i])
+        {
+            throw exc(_filename + ": not enough data for planned array");
+        }
+    }
+    fio::seek(_f, _end, SEEK_SET, _filename);
+    _buffers.clear();
+}
+
+/* Statistics */
+
+// The number of values of a component that are processed together
+static const size_t statistics_block_size = 1024;
+// The number of buckets for inexact bucket counting (indexed by the upper 16
+// bits of the order-preserving representation of a float)
+static const size_t statistics_float_buckets = 65536;
+
+struct statistics_t::accumulator
+{
+    std::vector<statistics_t::component_statistics> stats;
+    std::vector<std::vector<uintmax_t> > buckets;
+    std::vector<double> values;
+};
+
+/* Copy the values of a component to dst, skipping values that are not finite
+ * or that match the nodata value (if any). Return the number of copied values. */
+template<typename T>
+static size_t gather_values(const unsigned char *src, size_t stride, size_t n,
+        const unsigned char *nodata, double *dst)
+{
+    size_t m = 0;
+    for (size_t k = 0; k < n; k++, src += stride)
+    {
+        T v;
+        std::memcpy(&v, src, sizeof(T));
+        dst[m] = v;
+        m += (std::isfinite(dst[m]) && !(nodata && std::memcmp(src, nodata, sizeof(T)) == 0));
+    }
+    return m;
+}
+
+static size_t gather_component_values(gta::type t, const unsigned char *src, size_t stride, size_t n,
+        const unsigned char *nodata, double *dst)
+{
+    switch (t)
+    {
+    case gta::int8:
+        return gather_values<int8_t>(src, stride, n, nodata, dst);
+    case gta::uint8:
+        return gather_values<uint8_t>(src, stride, n, nodata, dst);
+    case gta::int16:
+        return gather_values<int16_t>(src, stride, n, nodata, dst);
+    case gta::uint16:
+        return gather_values<uint16_t>(src, stride, n, nodata, dst);
+    case gta::int32:
+        return gather_values<int32_t>(src, stride, n, nodata, dst);
+    case gta::uint32:
+        return gather_values<uint32_t>(src, stride, n, nodata, dst);
+    case gta::int64:
+        return gather_values<int64_t>(src, stride, n, nodata, dst);
+    case gta::uint64:
+        return gather_values<uint64_t>(src, stride, n, nodata, dst);
+#ifdef HAVE_INT128_T
+    case gta::int128:
+        return gather_values<int128_t>(src, stride, n, nodata, dst);
+#endif
+#ifdef HAVE_UINT128_T
+    case gta::uint128:
+        return gather_values<uint128_t>(src, stride, n, nodata, dst);
+#endif
+    case gta::float32:
+    case gta::cfloat32:
+        return gather_values<float>(src, stride, n, nodata, dst);
+    case gta::float64:
+    case gta::cfloat64:
+        return gather_values<double>(src, stride, n, nodata, dst);
+#ifdef HAVE_FLOAT128_T
+    case gta::float128:
+    case gta::cfloat128:
+        return gather_values<float128_t>(src, stride, n, nodata, dst);
+#endif
+    default:
+        // cannot happen
+        assert(false);
+        return 0;
+    }
+}
+
+template<typename T>
+static bool parse_nodata(const char *tagval, unsigned char *nodata)
+{
+    T v;
+    if (!tagval || !str::to(tagval, &v))
+        return false;
+    std::memcpy(nodata, &v, sizeof(T));
+    return true;
+}
+
+static size_t float_bucket(double x)
+{
+    float f = x;
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(uint32_t));
+    u = (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+    return u >> 16;
+}
+
+static double float_from_bucket_key(uint32_t u, double if_nan)
+{
+    u = (u & 0x80000000u) ? (u & 0x7fffffffu) : ~u;
+    float f;
+    std::memcpy(&f, &u, sizeof(uint32_t));
+    return (std::isnan(f) ? if_nan : f);
+}
+
+/* Get the value range of an inexact bucket, clamped to [minimum, maximum] */
+static void float_bucket_range(size_t b, double minimum, double maximum, double *lo, double *hi)
+{
+    double nan_value = (b < statistics_float_buckets / 2
+            ? -std::numeric_limits<double>::infinity()
+            : +std::numeric_limits<double>::infinity());
+    *lo = float_from_bucket_key(static_cast<uint32_t>(b) << 16, nan_value);
+    *hi = float_from_bucket_key((static_cast<uint32_t>(b) << 16) | 0xffffu, nan_value);
+    *lo = std::max(minimum, std::min(maximum, *lo));
+    *hi = std::max(minimum, std::min(maximum, *hi));
+}
+
+/* Merge statistics b into a (Chan, Golub, LeVeque: Updating Formulae and a
+ * Pairwise Algorithm for Computing Sample Variances, 1979) */
+static void merge_statistics(statistics_t::component_statistics &a, const statistics_t::component_statistics &b)
+{
+    if (b.values == 0)
+        return;
+    if (a.values == 0)
+    {
+        a = b;
+        return;
+    }
+    double na = a.values;
+    double nb = b.values;
+    double n = na + nb;
+    double delta = b.mean - a.mean;
+    a.mean = a.mean * (na / n) + b.mean * (nb / n);     // cannot overflow
+    a.m2 += b.m2 + delta * delta * (na / n) * nb;
+    a.minimum = std::min(a.minimum, b.minimum);
+    a.maximum = std::max(a.maximum, b.maximum);
+    a.values += b.values;
+}
+
+statistics_t::statistics_t(const gta::header &header, bool buckets) :
+    _header(header), _buckets(buckets), _components(checked_cast<size_t>(header.components())),
+    _result_valid(false)
+{
+    for (uintmax_t i = 0; i < header.components(); i++)
+    {
+        component_info &ci = _components[i];
+        ci.type = header.component_type(i);
+        ci.offset = (i == 0 ? 0 : _components[i - 1].offset + header.component_size(i - 1));
+        ci.have_nodata = false;
+        ci.exact_buckets = false;
+        ci.bucket_bias = 0.0;
+        const char *tagval = header.component_taglist(i).get("NO_DATA_VALUE");
+        switch (ci.type)
+        {
+        case gta::int8:
+            ci.have_nodata = parse_nodata<int8_t>(tagval, ci.nodata);
+            ci.exact_buckets = true;
+            ci.bucket_bias = std::numeric_limits<int8_t>::min();
+            break;
+        case gta::uint8:
+            ci.have_nodata = parse_nodata<uint8_t>(tagval, ci.nodata);
+            ci.exact_buckets = true;
+            break;
+        case gta::int16:
+            ci.have_nodata = parse_nodata<int16_t>(tagval, ci.nodata);
+            ci.exact_buckets = true;
+            ci.bucket_bias = std::numeric_limits<int16_t>::min();
+            break;
+        case gta::uint16:
+            ci.have_nodata = parse_nodata<uint16_t>(tagval, ci.nodata);
+            ci.exact_buckets = true;
+            break;
+        case gta::int32:
+            ci.have_nodata = parse_nodata<int32_t>(tagval, ci.nodata);
+            break;
+        case gta::uint32:
+            ci.have_nodata = parse_nodata<uint32_t>(tagval, ci.nodata);
+            break;
+        case gta::int64:
+            ci.have_nodata = parse_nodata<int64_t>(tagval, ci.nodata);
+            break;
+        case gta::uint64:
+            ci.have_nodata = parse_nodata<uint64_t>(tagval, ci.nodata);
+            break;
+#ifdef HAVE_INT128_T
+        case gta::int128:
+            ci.have_nodata = parse_nodata<int128_t>(tagval, ci.nodata);
+            break;
+#endif
+#ifdef HAVE_UINT128_T
+        case gta::uint128:
+            ci.have_nodata = parse_nodata<uint128_t>(tagval, ci.nodata);
+            break;
+#endif
+        case gta::float32:
+        case gta::cfloat32:
+            ci.have_nodata = parse_nodata<float>(tagval, ci.nodata);
+            break;
+        case gta::float64:
+        case gta::cfloat64:
+            ci.have_nodata = parse_nodata<double>(tagval, ci.nodata);
+            break;
+#ifdef HAVE_FLOAT128_T
+        case gta::float128:
+        case gta::cfloat128:
+            ci.have_nodata = parse_nodata<float128_t>(tagval, ci.nodata);
+            break;
+#endif
+        default:
+            throw exc(std::string("cannot compute statistics for component type ")
+                    + type_to_string(ci.type, header.component_size(i)));
+            break;
+        }
+    }
+}
+
+statistics_t::~statistics_t()
+{
+    for (size_t i = 0; i < _accumulators.size(); i++)
+        delete _accumulators[i];
+}
+
+void statistics_t::add(const void *elements, size_t n)
+{
+    _result_valid = false;
+    const unsigned char *data = static_cast<const unsigned char *>(elements);
+    size_t element_size = _header.element_size();
+    parallel_for(n, 16 * statistics_block_size, [&](uintmax_t begin, uintmax_t end)
+            {
+                accumulator *acc;
+                {
+                    std::lock_guard<std::mutex> lock(_accumulators_mutex);
+                    if (_idle_accumulators.empty())
+                    {
+                        std::unique_ptr<accumulator> a(new accumulator);
+                        component_statistics empty = { 0, 0.0, 0.0, 0.0, 0.0 };
+                        a->stats.resize(_components.size(), empty);
+                        a->buckets.resize(_components.size());
+                        for (size_t i = 0; i < _components.size() && _buckets; i++)
+                        {
+                            a->buckets[i].resize(!_components[i].exact_buckets ? statistics_float_buckets
+                                    : _header.component_size(i) == 1 ? 256 : 65536, 0);
+                        }
+                        a->values.resize(statistics_block_size);
+                        _accumulators.push_back(a.get());
+                        _idle_accumulators.push_back(a.release());
+                    }
+                    acc = _idle_accumulators.back();
+                    _idle_accumulators.pop_back();
+                }
+                double *v = &(acc->values[0]);
+                for (size_t i = 0; i < _components.size(); i++)
+                {
+                    const component_info &ci = _components[i];
+                    for (uintmax_t b = begin; b < end; b += statistics_block_size)
+                    {
+                        size_t m = std::min(statistics_block_size, static_cast<size_t>(end - b));
+                        size_t k = gather_component_values(ci.type, data + b * element_size + ci.offset,
+                                element_size, m, ci.have_nodata ? ci.nodata : NULL, v);
+                        if (k == 0)
+                            continue;
+                        component_statistics s;
+                        double minimum = v[0];
+                        double maximum = v[0];
+                        double sum = 0.0;
+                        for (size_t j = 0; j < k; j++)
+                        {
+                            minimum = (v[j] < minimum ? v[j] : minimum);
+                            maximum = (v[j] > maximum ? v[j] : maximum);
+                            sum += v[j];
+                        }
+                        double mean = sum / k;
+                        if (!std::isfinite(mean))
+                        {
+                            // the sum overflowed; the mean itself cannot
+                            mean = 0.0;
+                            for (size_t j = 0; j < k; j++)
+                                mean += v[j] / k;
+                        }
+                        double m2 = 0.0;
+                        for (size_t j = 0; j < k; j++)
+                        {
+                            double d = v[j] - mean;
+                            m2 += d * d;
+                        }
+                        s.values = k;
+                        s.minimum = minimum;
+                        s.maximum = maximum;
+                        s.mean = mean;
+                        s.m2 = m2;
+                        merge_statistics(acc->stats[i], s);
+                        if (_buckets)
+                        {
+                            uintmax_t *buckets = &(acc->buckets[i][0]);
+                            if (ci.exact_buckets)
+                            {
+                                for (size_t j = 0; j < k; j++)
+                                    buckets[static_cast<size_t>(v[j] - ci.bucket_bias)]++;
+                            }
+                            else
+                            {
+                                for (size_t j = 0; j < k; j++)
+                                    buckets[float_bucket(v[j])]++;
+                            }
+                        }
+                    }
+                }
+                std::lock_guard<std::mutex> lock(_accumulators_mutex);
+                _idle_accumulators.push_back(acc);
+            });
+}
+
+void statistics_t::merge()
+{
+    if (_result_valid)
+        return;
+    component_statistics empty = { 0, 0.0, 0.0, 0.0, 0.0 };
+    _result.assign(_components.size(), empty);
+    _result_buckets.assign(_components.size(), std::vector<uintmax_t>());
+    for (size_t a = 0; a < _accumulators.size(); a++)
+    {
+        for (size_t i = 0; i < _components.size(); i++)
+        {
+            merge_statistics(_result[i], _accumulators[a]->stats[i]);
+            if (_buckets)
+            {
+                const std::vector<uintmax_t> &buckets = _accumulators[a]->buckets[i];
+                _result_buckets[i].resize(buckets.size(), 0);
+                for (size_t b = 0; b < buckets.size(); b++)
+                    _result_buckets[i][b] += buckets[b];
+            }
+        }
+    }
+    _result_valid = true;
+}
+
+const statistics_t::component_statistics &statistics_t::get(uintmax_t i)
+{
+    merge();
+    return _result[i];
+}
+
+double statistics_t::variance(uintmax_t i)
+{
+    const component_statistics &s = get(i);
+    return (s.values > 1 ? s.m2 / (s.values - 1) : std::numeric_limits<double>::quiet_NaN());
+}
+
+double statistics_t::percentile(uintmax_t i, double p)
+{
+    assert(_buckets);
+    const component_statistics &s = get(i);
+    const std::vector<uintmax_t> &buckets = _result_buckets[i];
+    const component_info &ci = _components[i];
+    if (s.values == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+    // Interpolate linearly between the two values closest to the rank
+    double rank = std::max(0.0, std::min(100.0, p)) / 100.0 * (s.values - 1);
+    uintmax_t ranks[2] = { static_cast<uintmax_t>(rank), 0 };
+    ranks[1] = std::min(ranks[0] + 1, s.values - 1);
+    double values[2];
+    for (int r = 0; r < 2; r++)
+    {
+        if (ranks[r] == 0)
+        {
+            values[r] = s.minimum;
+            continue;
+        }
+        if (ranks[r] == s.values - 1)
+        {
+            values[r] = s.maximum;
+            continue;
+        }
+        uintmax_t before = 0;
+        size_t b = 0;
+        while (before + buckets[b] <= ranks[r])
+            before += buckets[b++];
+        if (ci.exact_buckets)
+        {
+            values[r] = b + ci.bucket_bias;
+        }
+        else
+        {
+            double lo, hi;
+            float_bucket_range(b, s.minimum, s.maximum, &lo, &hi);
+            values[r] = lo + (ranks[r] - before + 0.5) / buckets[b] * (hi - lo);
+        }
+    }
+    return values[0] + (rank - ranks[0]) * (values[1] - values[0]);
+}
+
+std::vector<uintmax_t> statistics_t::histogram(uintmax_t i, size_t bins)
+{
+    assert(_buckets);
+    const component_statistics &s = get(i);
+    const std::vector<uintmax_t> &buckets = _result_buckets[i];
+    const component_info &ci = _components[i];
+    std::vector<uintmax_t> histogram(bins, 0);
+    if (s.values == 0 || bins == 0)
+        return histogram;
+    double width = s.maximum / bins - s.minimum / bins;   // cannot overflow
+    for (size_t b = 0; b < buckets.size(); b++)
+    {
+        if (buckets[b] == 0)
+            continue;
+        double x;
+        if (ci.exact_buckets)
+        {
+            x = b + ci.bucket_bias;
+        }
+        else
+        {
+            double lo, hi;
+            float_bucket_range(b, s.minimum, s.maximum, &lo, &hi);
+            x = lo / 2.0 + hi / 2.0;
+        }
+        size_t bin = (width > 0.0 ? std::min(static_cast<double>(bins - 1), x / width - s.minimum / width) : 0);
+        histogram[bin] += buckets[b];
+    }
+    return histogram;
+}
+
+/* MIN_VALUE and MAX_VALUE tags */
+
+static bool is_complex_type(gta::type t)
+{
+    return (t == gta::cfloat32 || t == gta::cfloat64 || t == gta::cfloat128);
+}
+
+/* Check if a range of values of type t is exactly represented by doubles.
+ * Values of 64 and 128 bit integer types are rounded when they are converted
+ * to double unless their magnitude is below 2^53 (and a rounded value below
+ * 2^53 means that the original value was below 2^53, too). Values of float128
+ * may always have been rounded. */
+static bool is_exact_range(gta::type t, double min_value, double max_value)
+{
+    const double limit = 9007199254740992.0;    // 2^53
+    switch (t)
+    {
+    case gta::int64:
+    case gta::uint64:
+    case gta::int128:
+    case gta::uint128:
+        return (std::fabs(min_value) < limit && std::fabs(max_value) < limit);
+    case gta::float128:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool min_max_tags_get(const gta::header &header, uintmax_t i, double *min_value, double *max_value)
+{
+    const char *min_tag = header.component_taglist(i).get("MIN_VALUE");
+    const char *max_tag = header.component_taglist(i).get("MAX_VALUE");
+    return (min_tag && max_tag
+            && str::to(min_tag, min_value) && str::to(max_tag, max_value)
+            && std::isfinite(*min_value) && std::isfinite(*max_value)
+            && *min_value <= *max_value
+            && is_exact_range(header.component_type(i), *min_value, *max_value));
+}
+
+void min_max_tags_set(gta::header &header, uintmax_t i, double min_value, double max_value)
+{
+    if (is_complex_type(header.component_type(i))
+            || !std::isfinite(min_value) || !std::isfinite(max_value) || min_value > max_value
+            || !is_exact_range(header.component_type(i), min_value, max_value))
+    {
+        min_max_tags_unset(header, i);
+    }
+    else
+    {
+        header.component_taglist(i).set("MIN_VALUE", str::from(min_value).c_str());
+        header.component_taglist(i).set("MAX_VALUE", str::from(max_value).c_str());
+    }
+}
+
+void min_max_tags_set(gta::header &header, uintmax_t i, statistics_t &stats)
+{
+    const statistics_t::component_statistics &s = stats.get(i);
+    if (s.values > 0)
+        min_max_tags_set(header, i, s.minimum, s.maximum);
+    else
+        min_max_tags_unset(header, i);
+}
+
+void min_max_tags_unset(gta::header &header, uintmax_t i)
+{
+    header.component_taglist(i).unset("MIN_VALUE");
+    header.component_taglist(i).unset("MAX_VALUE");
+}
+
+void min_max_tags_unset(gta::header &header)
+{
+    for (uintmax_t i = 0; i < header.components(); i++)
+        min_max_tags_unset(header, i);
+}
+
+// Statistics for a single element, or NULL if they are unavailable for the
+// component types of the header
+static statistics_t *element_statistics(const gta::header &header, const void *element)
+{
+    std::unique_ptr<statistics_t> stats;
+    try
+    {
+        stats.reset(new statistics_t(header));
+    }
+    catch (exc &)
+    {
+        return NULL;
+    }
+    stats->add(element, 1);
+    return stats.release();
+}
+
+void min_max_tags_set_constant(gta::header &header, const void *element)
+{
+    std::unique_ptr<statistics_t> stats(element_statistics(header, element));
+    for (uintmax_t i = 0; i < header.components(); i++)
+    {
+        if (!header.component_taglist(i).get("MIN_VALUE") && !header.component_taglist(i).get("MAX_VALUE"))
+            continue;
+        if (stats)
+            min_max_tags_set(header, i, *stats);
+        else
+            min_max_tags_unset(header, i);
+    }
+}
+
+void min_max_tags_extend(gta::header &header, const void *element)
+{
+    std::unique_ptr<statistics_t> stats(element_statistics(header, element));
+    if (!stats)
+    {
+        min_max_tags_unset(header);
+        return;
+    }
+    for (uintmax_t i = 0; i < header.components(); i++)
+    {
+        double min_value, max_value;
+        const statistics_t::component_statistics &s = stats->get(i);
+        if (s.values > 0 && min_max_tags_get(header, i, &min_value, &max_value))
+        {
+            min_max_tags_set(header, i, std::min(min_value, s.minimum), std::max(max_value, s.maximum));
+        }
+    }
+}
+
+void min_max_tags_merge(gta::header &header, const gta::header &other)
+{
+    for (uintmax_t i = 0; i < header.components(); i++)
+    {
+        double min0, max0, min1, max1;
+        if (min_max_tags_get(header, i, &min0, &max0) && min_max_tags_get(other, i, &min1, &max1))
+            min_max_tags_set(header, i, std::min(min0, min1), std::max(max0, max1));
+        else
+            min_max_tags_unset(header, i);
+    }
+}
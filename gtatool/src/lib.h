@@ -51,8 +51,14 @@ typedef __float128 float128_t;
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <future>
+#include <mutex>
 #include <cerrno>
 #include <cstdio>
+#include <sys/types.h>
 
 #include <gta/gta.hpp>
 
@@ -87,17 +93,58 @@ void value_from_string(const std::string &s, const gta::type t, const uintmax_t
 void valuelist_from_string(const std::string &s, const std::vector<gta::type> &types,
         const std::vector<uintmax_t> &sizes, void *valuelist);
 
-/* Swap the endianness of a GTA element/component */
+/* Swap the endianness of a GTA component/element/array of n elements */
 void swap_component_endianness(const gta::header &header, uintmax_t i, void *component);
 void swap_element_endianness(const gta::header &header, void *element);
+void swap_elements_endianness(const gta::header &header, void *elements, size_t n);
 
 /* Convert strings between the local character set and UTF-8, in a fail-safe way */
 std::string from_utf8(const std::string &s);
 std::string to_utf8(const std::string &s);
 
+/* Process the range [0,n) in parallel. The range is split into parts of at
+ * least min_part elements, and f(begin, end) is called for each part by a pool
+ * of worker threads and by the calling thread. This function returns when all
+ * parts are done. The first exception thrown by f is rethrown. Calls from
+ * within f are processed serially. */
+void parallel_for(uintmax_t n, uintmax_t min_part, const std::function<void (uintmax_t, uintmax_t)> &f);
+
+#ifdef HAVE_SYS_WAIT_H
+/* Start the shell command cmd in a child process, for commands that run
+ * several child processes at the same time. The standard input of the child
+ * is a pipe that is returned in *in; closing it ends the input. Its standard
+ * output is the file out. Both are close-on-exec in this process, so that other
+ * child processes do not inherit them. The caller must wait for the returned
+ * process with waitpid(). */
+pid_t start_command(const std::string &cmd, FILE *out, FILE **in);
+#endif
+
+/* Stream indices. The index of the GTA file <filename> is stored in the
+ * sidecar file <filename>.idx (see the stream-index command).
+ * stream_index_load() returns false if the file has no index, or if the
+ * index is outdated because the file was modified after the index was built. */
+std::string stream_index_name(const std::string &filename);
+bool stream_index_load(const std::string &filename, gta::stream_index &index);
+
+class array_loop_t;
+
 /* Loop over all input and output array elements.
  * This loop provides input/output buffering for filtering commands that
- * work on array element level. */
+ * work on array element level.
+ * Commands should process elements in batches: batch_size() returns the number
+ * of elements to pass to read() and write() next, so that the per-call overhead
+ * is paid once per batch instead of once per element.
+ * The pointer returned by read() is valid until the next call of read(); it
+ * usually points directly into the libgta input buffer.
+ * A command that produces output elements from scratch can fill the buffer
+ * returned by write_buffer(n) and then pass it to write(); this buffer usually
+ * is the libgta output buffer, so that no copy is needed.
+ * If the input data can be mapped into memory by the array loop (see
+ * array_loop_t::read_data()), read() returns pointers into the mapping.
+ * Otherwise, libgta reads the next chunk of input ahead and writes full chunks
+ * of output behind in the background while the command processes elements.
+ * A loop must therefore read and write all elements of its arrays before the
+ * files are used for anything else. */
 class element_loop_t
 {
 private:
@@ -112,16 +159,27 @@ private:
     FILE *_file_out;
     gta::io_state _state_out;
 
+    array_loop_t *_array_loop;  // the array loop that started this loop, or NULL
+    const char *_data_in;       // the complete input data if it is mapped, or NULL
     blob _buf;
+    uintmax_t _read_counter;    // number of elements read so far
+    bool _in_lent;              // whether elements lent by libgta need to be committed
+    void *_out_view;            // output elements lent by libgta, or NULL
+    uintmax_t _out_lent;        // number of output elements lent by libgta
+    blob _out_buf;
 
 public:
     element_loop_t() throw ();
     ~element_loop_t();
 
     void start(const gta::header &header_in, const std::string &name_in, FILE *file_in,
-            const gta::header &header_out, const std::string &name_out, FILE *file_out);
+            const gta::header &header_out, const std::string &name_out, FILE *file_out,
+            array_loop_t *array_loop = NULL);
+
+    size_t batch_size(uintmax_t remaining) const;
 
     const void *read(size_t n = 1);
+    void *write_buffer(size_t n);
     void write(const void *element, size_t n = 1);
 };
 
@@ -147,6 +205,18 @@ private:
     uintmax_t _index_out;
     std::string _array_name_in;
     std::string _array_name_out;
+    void *_map;                 // mapped data of the current input array, or NULL
+    size_t _map_size;
+    blob _data_buf;
+    gta::stream_index *_stream_index;   // index of the current input file, or NULL
+    size_t _stream_index_file;          // input file that _stream_index was loaded for
+    bool _stream_index_loaded;
+
+    const void *map_data(const gta::header &header_in);
+    void unmap_data();
+    bool next_input();
+
+    friend class element_loop_t;
 
 public:
     array_loop_t() throw ();
@@ -165,6 +235,12 @@ public:
     }
 
     bool read(gta::header &header_in, std::string &name_in);
+    /* Skip the next n input arrays and return the number of arrays that were
+     * skipped; this is less than n if the input ends. If an input file has an
+     * up to date stream index, this seeks directly to the target array. */
+    uintmax_t skip_arrays(uintmax_t n);
+    /* Get the stream index of the current input file, or NULL if it has none. */
+    const gta::stream_index *stream_index_in();
 
     void write(const gta::header &header_out, std::string &name_out);
 
@@ -172,6 +248,11 @@ public:
     void copy_data(const gta::header &header_in, const gta::header &header_out);
     void copy_data(const gta::header &header_in, const array_loop_t &array_loop_out, gta::header &header_out);
     void read_data(const gta::header &header_in, void *data);
+    /* Get the complete data of the current input array. If the input is a
+     * seekable regular file and the data is stored in native form, the data is
+     * mapped into memory instead of being read. The returned pointer is valid
+     * until the next input array is read. */
+    const void *read_data(const gta::header &header_in);
     void write_data(const gta::header &header_out, const void *data);
     void start_element_loop(element_loop_t &element_loop, const gta::header &header_in, const gta::header &header_out);
 
@@ -214,4 +295,214 @@ public:
  */
 void buffer_data(const gta::header &header, FILE *f, gta::header &buf_header, FILE **buf_f);
 
+/* Write the input array data with rearranged dimensions to an element loop.
+ *
+ * Output dimension i is input dimension dim_map[i], and it is traversed in
+ * reverse direction if reverse[i] is set. The input data must be uncompressed
+ * and start at data_offset in the seekable file f (see buffer_data()).
+ *
+ * The data is processed in tiles that are read with block-based i/o and
+ * rearranged in memory; the tiles use at most the given memory size in bytes.
+ * If the tiles cannot be written in output order, they are collected in a
+ * temporary file first. The file pointer of f is undefined afterwards.
+ */
+void permute_dimensions(const gta::header &header_in, FILE *f, uintmax_t data_offset,
+        element_loop_t &element_loop, const gta::header &header_out,
+        const std::vector<uintmax_t> &dim_map, const std::vector<bool> &reverse,
+        uintmax_t memory);
+
+/* A cache for repeated block reads from the same array.
+ *
+ * The array data must be uncompressed and start at data_offset in the file f.
+ * It is divided into bricks on a regular grid. By default, the bricks are
+ * roughly cubic with about 1 MiB of data each; alternatively, the caller can
+ * give the brick size and the coordinate at which one brick starts in each
+ * dimension, so that the bricks match its own access pattern. Bricks are read
+ * with positioned input and kept in host endianness in a least recently used
+ * list that uses at most the given memory size in bytes.
+ *
+ * read_block() assembles a block from the bricks. If the block moved along a
+ * single dimension since the previous call, the bricks of the next block in
+ * the same direction are read in the background until the next call. The file
+ * position of f is not used and not changed, so f can be used for other
+ * purposes at the same time. */
+class brick_cache_t
+{
+private:
+    struct brick
+    {
+        uintmax_t index;        // linear index in the brick grid
+        blob data;
+    };
+
+    const gta::header _header;
+    const int _fd;
+    const uintmax_t _data_offset;
+    const uintmax_t _memory;
+    const std::string _filename;
+    std::vector<uintmax_t> _brick_size;
+    std::vector<uintmax_t> _brick_shift;      // so that brick j starts at j * size - shift
+    std::vector<uintmax_t> _bricks;           // number of bricks in each dimension
+    std::list<brick> _lru;                    // most recently used first
+    std::unordered_map<uintmax_t, std::list<brick>::iterator> _index;
+    uintmax_t _size;                          // data size of the cached bricks
+    std::future<std::list<brick> > _prefetch;
+    std::vector<uintmax_t> _prev_lower;
+    std::vector<uintmax_t> _prev_higher;
+
+    void init_grid(const std::vector<uintmax_t> &brick_size, const std::vector<uintmax_t> &brick_start);
+    void brick_range(uintmax_t index, uintmax_t *lower, uintmax_t *higher) const;
+    void read_brick(uintmax_t index, blob &data) const;
+    void insert(std::list<brick> &bricks);
+    void finish_prefetch();
+    void start_prefetch(const uintmax_t *lower, const uintmax_t *higher);
+
+public:
+    brick_cache_t(const gta::header &header, FILE *f, uintmax_t data_offset, uintmax_t memory,
+            const std::string &filename = std::string());
+    brick_cache_t(const gta::header &header, FILE *f, uintmax_t data_offset, uintmax_t memory,
+            const std::vector<uintmax_t> &brick_size, const std::vector<uintmax_t> &brick_start,
+            const std::string &filename = std::string());
+    ~brick_cache_t();
+
+    /* Read the block with the given lower and higher coordinates (inclusive)
+     * into the given buffer, like gta::header::read_block(). */
+    void read_block(const uintmax_t *lower, const uintmax_t *higher, void *block);
+};
+
+/* Write several arrays to the output stream of an array loop with a planned
+ * layout, for commands that produce the data of these arrays interleaved.
+ *
+ * If the output stream is seekable (see possible()), start() writes all
+ * headers and leaves room for the data of each array. The data of array i is
+ * then appended with write(i, ...), which collects it in a buffer and writes it
+ * directly to its final position with positioned writes. All buffers together
+ * use at most the given memory size in bytes. After finish(), the file
+ * position of the output stream is after the last array. */
+class planned_output_t
+{
+private:
+    FILE *_f;
+    std::string _filename;
+    std::vector<uintmax_t> _offsets;    // position of the next data byte of each array
+    std::vector<uintmax_t> _ends;       // end of the data of each array
+    std::vector<blob> _buffers;
+    std::vector<size_t> _buffer_fill;
+    uintmax_t _end;
+
+    void flush(size_t i);
+
+public:
+    planned_output_t() throw ();
+
+    static bool possible(array_loop_t &array_loop);
+
+    void start(array_loop_t &array_loop, const std::vector<gta::header> &headers,
+            std::vector<std::string> &names, uintmax_t memory = 64 * 1024 * 1024);
+    void write(size_t i, const void *data, size_t size);
+    void finish();
+};
+
+/* Statistics about the values of each element component of an array,
+ * computed in a single pass over the array data.
+ *
+ * The NO_DATA_VALUE tags of the components are parsed once by the constructor.
+ * Values that match them and values that are not finite are ignored. For
+ * complex components, only the real part is used. Values are converted to
+ * double precision.
+ *
+ * The elements passed to add() are processed by parallel_for(). Means and
+ * variances are computed per block of values and merged with the update
+ * formula of Chan et al., which is numerically stable.
+ *
+ * If buckets are requested, values are also counted per bucket: one bucket per
+ * value for 8 and 16 bit integer components, which makes percentiles and
+ * histograms exact, and otherwise buckets with a relative width of 2^-7, from
+ * which percentiles and histograms are estimated.
+ */
+class statistics_t
+{
+public:
+    struct component_statistics
+    {
+        uintmax_t values;       // number of values that were not ignored
+        double minimum;
+        double maximum;
+        double mean;
+        double m2;              // sum of squared differences from the mean
+    };
+
+private:
+    struct component_info
+    {
+        gta::type type;
+        size_t offset;
+        bool have_nodata;
+        unsigned char nodata[16];       // NO_DATA_VALUE in the component type
+        bool exact_buckets;             // one bucket per value?
+        double bucket_bias;             // the value of bucket 0 if exact
+    };
+    struct accumulator;
+
+    const gta::header &_header;
+    const bool _buckets;
+    std::vector<component_info> _components;
+    std::mutex _accumulators_mutex;
+    std::vector<accumulator *> _accumulators;
+    std::vector<accumulator *> _idle_accumulators;
+    std::vector<component_statistics> _result;
+    std::vector<std::vector<uintmax_t> > _result_buckets;
+    bool _result_valid;
+
+    void merge();
+
+public:
+    statistics_t(const gta::header &header, bool buckets = false);
+    ~statistics_t();
+
+    /* Add n elements */
+    void add(const void *elements, size_t n);
+
+    /* Get the statistics of component i */
+    const component_statistics &get(uintmax_t i);
+
+    /* Get the sample variance of component i (NaN if unavailable) */
+    double variance(uintmax_t i);
+
+    /* Get the percentile p in [0,100] of component i. Requires buckets. */
+    double percentile(uintmax_t i, double p);
+
+    /* Get a histogram with the given number of bins between the minimum and
+     * the maximum value of component i. Requires buckets. */
+    std::vector<uintmax_t> histogram(uintmax_t i, size_t bins);
+};
+
+/* The MIN_VALUE and MAX_VALUE component tags store the range of the values of
+ * a component (as computed by statistics_t), so that readers do not need to
+ * scan the data. They are not set for complex components, and not for ranges
+ * that cannot be represented exactly as double (large 64 and 128 bit integers,
+ * float128).
+ * Commands keep these tags current: they copy them when values do not change,
+ * update them when they know how values change, and remove them otherwise. */
+
+/* Get the range of component i from its tags. Returns false if the tags are
+ * not set or invalid. */
+bool min_max_tags_get(const gta::header &header, uintmax_t i, double *min_value, double *max_value);
+/* Set the tags of component i to the given range */
+void min_max_tags_set(gta::header &header, uintmax_t i, double min_value, double max_value);
+/* Set or remove the tags of component i according to the given statistics */
+void min_max_tags_set(gta::header &header, uintmax_t i, statistics_t &stats);
+/* Remove the tags of component i, or of all components */
+void min_max_tags_unset(gta::header &header, uintmax_t i);
+void min_max_tags_unset(gta::header &header);
+/* Update the tags of all components that have them for arrays in which every
+ * element is the given element */
+void min_max_tags_set_constant(gta::header &header, const void *element);
+/* Extend existing tags by the values of the given element, for example after
+ * adding elements with a fill value. Tags that are not set stay unset. */
+void min_max_tags_extend(gta::header &header, const void *element);
+/* Merge the tags of another array with the same components into the tags of
+ * header, for arrays that combine the elements of both. */
+void min_max_tags_merge(gta::header &header, const gta::header &other);
+
 #endif
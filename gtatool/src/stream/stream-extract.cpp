@@ -24,6 +24,7 @@
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <cstdio>
 #include <cctype>
 
@@ -32,6 +33,7 @@
 #include "base/msg.h"
 #include "base/opt.h"
 #include "base/str.h"
+#include "base/fio.h"
 
 #include "lib.h"
 
@@ -48,6 +50,8 @@ extern "C" void gtatool_stream_extract_help(void)
             "all arrays up to and including b), or b (to select the single array b).\n"
             "If --drop is used, the selection is inverted: the selected arrays are discarded and all others "
             "written to standard output.\n"
+            "If an input file has a stream index (see stream-index), the selected arrays are accessed "
+            "directly instead of reading through all preceding arrays.\n"
             "Example:\n"
             "stream-extract 1-3,9-15 many-arrays.gta > subset.gta");
 }
@@ -132,33 +136,34 @@ static void normalize(std::vector<range_t> &rangelist)
     }
 }
 
-/* Checks whether the given index is in one of the ranges in the range list.
- * The range list must be normalized. 'ranges_index' must be zero on the first call.
- * Subsequent calls must have increasing values of 'index'. */
-static bool in_range(const std::vector<range_t> &rangelist, size_t *ranges_index, uintmax_t index)
+/* Returns the number of arrays starting with the given index that are not
+ * kept, or the maximum uintmax_t value if no arrays after the given index are
+ * kept. Arrays are kept if they are in one of the ranges in the range list,
+ * or, if 'drop' is set, if they are not. The range list must be normalized.
+ * 'ranges_index' must be zero on the first call. Subsequent calls must have
+ * increasing values of 'index'. */
+static uintmax_t not_kept(const std::vector<range_t> &rangelist, size_t *ranges_index, bool drop, uintmax_t index)
 {
-    /* test all frame ranges beginning at ranges_index */
-    for (size_t i = *ranges_index; i < rangelist.size(); i++)
+    /* skip all frame ranges that cannot be reached anymore */
+    while (*ranges_index < rangelist.size() && index > rangelist[*ranges_index].b)
     {
-        if (index > rangelist[i].b)
-        {
-            /* this frame range cannot be reached anymore */
-            *ranges_index = i + 1;
-            continue;
-        }
-        else if (index >= rangelist[i].a)
-        {
-            /* index is in the frame range i */
-            return true;
-        }
-        else
-        {
-            /* index < ranges[i].a. Since the following frame ranges have start
-             * values >= ranges[i].a, we don't need to test them */
-            break;
-        }
+        (*ranges_index)++;
+    }
+    if (*ranges_index == rangelist.size())
+    {
+        return (drop ? 0 : std::numeric_limits<uintmax_t>::max());
+    }
+    const range_t &r = rangelist[*ranges_index];
+    if (index < r.a)
+    {
+        return (drop ? 0 : r.a - index);
+    }
+    else
+    {
+        /* index is in the frame range */
+        return (!drop ? 0 : r.b == std::numeric_limits<uintmax_t>::max()
+                ? r.b : r.b - index + 1);
     }
-    return false;
 }
 
 
@@ -202,25 +207,41 @@ extern "C" int gtatool_stream_extract(int argc, char *argv[])
         size_t rangelist_index = 0;
         uintmax_t dropcounter = 0;
         array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        for (;;)
         {
-            bool keep = in_range(rangelist, &rangelist_index, array_index);
-            if (drop.value())
+            /* Skip arrays that are not kept; this is fast if the input has a
+             * stream index. Stop if no further arrays are kept, but read the
+             * rest of an input stream that cannot seek (such as a pipe), so
+             * that its writer does not fail. */
+            uintmax_t skip = not_kept(rangelist, &rangelist_index, drop.value(), array_index);
+            if (skip == std::numeric_limits<uintmax_t>::max())
             {
-                keep = !keep;
+                if (!fio::seekable(array_loop.file_in()))
+                {
+                    uintmax_t skipped = array_loop.skip_arrays(skip);
+                    array_index += skipped;
+                    dropcounter += skipped;
+                }
+                break;
             }
-            if (keep)
+            if (skip > 0)
             {
-                hdro = hdri;
-                hdro.set_compression(gta::none);
-                array_loop.write(hdro, nameo);
-                array_loop.copy_data(hdri, hdro);
+                uintmax_t skipped = array_loop.skip_arrays(skip);
+                array_index += skipped;
+                dropcounter += skipped;
+                if (skipped < skip)
+                {
+                    break;
+                }
             }
-            else
+            if (!array_loop.read(hdri, namei))
             {
-                array_loop.skip_data(hdri);
-                dropcounter++;
+                break;
             }
+            hdro = hdri;
+            hdro.set_compression(gta::none);
+            array_loop.write(hdro, nameo);
+            array_loop.copy_data(hdri, hdro);
             array_index++;
         }
         array_loop.finish();
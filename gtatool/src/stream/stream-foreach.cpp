@@ -23,7 +23,9 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
 #include <limits>
+#include <list>
 #include <unistd.h>
 #ifdef HAVE_SIGACTION
 # include <signal.h>
@@ -48,7 +50,7 @@
 extern "C" void gtatool_stream_foreach_help(void)
 {
     msg::req_txt(
-            "stream-foreach [-n|--n=<N>] command [<files...>]\n"
+            "stream-foreach [-n|--n=<N>] [-j|--jobs=<J>] [-k|--keep-order] command [<files...>]\n"
             "\n"
             "Executes the given command for each block of N input GTAs.\n"
             "The command must read N GTAs from its standard input, and must "
@@ -56,7 +58,10 @@ extern "C" void gtatool_stream_foreach_help(void)
             "The N orginal GTAs are replaced by these new GTAs in the stream.\n"
             "The default is N=1.\n"
             "The special string %%I in the command is replaced by the index of the "
-            "current block of GTAs."
+            "current block of GTAs.\n"
+            "With -j, up to J commands run at the same time. The output of each command is collected "
+            "in a temporary file and written to the output stream when the command has finished, "
+            "in the order in which the commands finish. With -k, the output is written in input order instead.\n"
             "Example:\n"
             "stream-foreach 'gta tag --set-global=\"X-INDEX=%%I\"' in.gta > numbered.gta");
 }
@@ -71,6 +76,204 @@ static void sigpipe_handler(int /* signum */)
 static const int sigpipe_flag = 0;
 #endif
 
+/* Write a block of up to n GTAs, starting with hdri, to the command input p.
+ * Returns false if the command did not read all of its input. */
+static bool write_block(array_loop_t &array_loop, gta::header &hdri, std::string &namei, uintmax_t n, FILE *p)
+{
+    try
+    {
+        gta::header hdro;
+        uintmax_t i = 0;
+        for (;;)
+        {
+            hdro = hdri;
+            hdro.set_compression(gta::none);
+            hdro.write_to(p);
+            hdri.copy_data(array_loop.file_in(), hdro, p);
+            i++;
+            if (i >= n || !array_loop.read(hdri, namei))
+                break;
+        }
+        if (i < n)
+        {
+            fflush(msg::file());
+            msg::wrn(std::string("last input block only has ") + str::from(i) + " GTAs");
+            fflush(msg::file());
+        }
+    }
+    catch (gta::exception& e)
+    {
+        if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
+        {
+            // the command did not read its stdin
+            return false;
+        }
+        throw;
+    }
+    return true;
+}
+
+/* Check the status of a finished command */
+static void check_status(const std::string &cmd, int r, bool read_input)
+{
+    if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
+    {
+        throw exc(std::string("command '") + cmd + "' failed to execute");
+    }
+    else if (!read_input)
+    {
+        throw exc(std::string("command '") + cmd + "' did not read its stdin");
+    }
+    else if (WEXITSTATUS(r) != 0)
+    {
+        throw exc(std::string("command '") + cmd + "' returned exit status "
+                + str::from(WEXITSTATUS(r)));
+    }
+}
+
+#ifdef HAVE_SYS_WAIT_H
+/* Parallel execution: each command reads its block of GTAs from its own pipe
+ * and writes its output to its own temporary file. */
+
+struct foreach_job
+{
+    pid_t pid;
+    std::string cmd;
+    FILE *out;
+    bool read_input;
+    bool done;
+    int status;
+
+    foreach_job() : pid(-1), cmd(), out(NULL), read_input(false), done(true), status(0)
+    {
+    }
+};
+
+static void start_job(foreach_job &job, array_loop_t &array_loop, gta::header &hdri, std::string &namei, uintmax_t n)
+{
+    job.out = fio::tempfile();
+    FILE *p;
+    job.pid = start_command(job.cmd, job.out, &p);
+    job.done = false;
+    try
+    {
+        job.read_input = write_block(array_loop, hdri, namei, n, p);
+    }
+    catch (...)
+    {
+        fclose(p);
+        throw;
+    }
+    if (fclose(p) != 0 && !(sigpipe_flag && errno == EPIPE))
+    {
+        throw exc(std::string("cannot write to command '") + job.cmd + "': " + std::strerror(errno), errno);
+    }
+    // Same rule as for serial execution
+    job.read_input = job.read_input && !sigpipe_flag;
+}
+
+static void write_job_output(foreach_job &job)
+{
+    static const size_t bufsize = 1024 * 1024;
+    std::vector<char> buf(bufsize);
+    fio::rewind(job.out);
+    size_t r;
+    while ((r = fread(&(buf[0]), 1, bufsize, job.out)) > 0)
+    {
+        fio::write(&(buf[0]), 1, r, gtatool_stdout, "standard output");
+    }
+    if (ferror(job.out))
+    {
+        throw exc(std::string("cannot read output of command '") + job.cmd + "'");
+    }
+    fclose(job.out);
+    job.out = NULL;
+}
+
+/* Wait for a command to finish and write the output of all commands that can
+ * be written. With keep_order, this is the oldest command; otherwise it is
+ * any command. */
+static void finish_job(std::list<foreach_job> &jobs, bool keep_order)
+{
+    pid_t pid;
+    int status;
+    std::list<foreach_job>::iterator it;
+    for (;;)
+    {
+        pid = waitpid(keep_order ? jobs.front().pid : -1, &status, 0);
+        if (pid < 0 && errno == EINTR)
+            continue;
+        if (pid < 0)
+            throw exc(std::string("cannot wait for command: ") + std::strerror(errno), errno);
+        for (it = jobs.begin(); it != jobs.end() && it->pid != pid; it++);
+        if (it != jobs.end())
+            break;
+    }
+    it->done = true;
+    it->status = status;
+    fflush(msg::file());
+    check_status(it->cmd, it->status, it->read_input);
+    if (!keep_order)
+    {
+        write_job_output(*it);
+        jobs.erase(it);
+    }
+    else
+    {
+        while (!jobs.empty() && jobs.front().done)
+        {
+            write_job_output(jobs.front());
+            jobs.pop_front();
+        }
+    }
+}
+
+static void foreach_parallel(array_loop_t &array_loop, const std::string &command,
+        uintmax_t n, uintmax_t max_jobs, bool keep_order)
+{
+    std::list<foreach_job> jobs;
+    try
+    {
+        gta::header hdri;
+        std::string namei;
+        uintmax_t block_index = 0;
+        while (array_loop.read(hdri, namei))
+        {
+            while (jobs.size() >= max_jobs)
+            {
+                finish_job(jobs, keep_order);
+            }
+            foreach_job job;
+            job.cmd = str::replace(command, "%I", str::from(block_index));
+            jobs.push_back(job);
+            start_job(jobs.back(), array_loop, hdri, namei, n);
+            block_index++;
+        }
+        while (!jobs.empty())
+        {
+            finish_job(jobs, keep_order);
+        }
+    }
+    catch (...)
+    {
+        // Let the remaining commands finish; their input is already closed.
+        for (std::list<foreach_job>::iterator it = jobs.begin(); it != jobs.end(); it++)
+        {
+            if (!it->done)
+            {
+                int status;
+                while (waitpid(it->pid, &status, 0) < 0 && errno == EINTR);
+            }
+            if (it->out)
+            {
+                fclose(it->out);
+            }
+        }
+        throw;
+    }
+}
+#endif
+
 extern "C" int gtatool_stream_foreach(int argc, char *argv[])
 {
     std::vector<opt::option *> options;
@@ -78,6 +281,10 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
     options.push_back(&help);
     opt::val<uintmax_t> n("n", 'n', opt::optional, 1, std::numeric_limits<uintmax_t>::max(), 1);
     options.push_back(&n);
+    opt::val<uintmax_t> jobs("jobs", 'j', opt::optional, 1, std::numeric_limits<int>::max(), 1);
+    options.push_back(&jobs);
+    opt::flag keep_order("keep-order", 'k', opt::optional);
+    options.push_back(&keep_order);
     std::vector<std::string> arguments;
     if (!opt::parse(argc, argv, options, 1, -1, arguments))
     {
@@ -121,11 +328,19 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
         std::string command = arguments[0];
         arguments.erase(arguments.begin());
         array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
+        gta::header hdri;
+        std::string namei;
         uintmax_t block_index = 0;
         array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        if (jobs.value() > 1)
+        {
+#ifdef HAVE_SYS_WAIT_H
+            foreach_parallel(array_loop, command, n.value(), jobs.value(), keep_order.value());
+#else
+            throw exc("parallel execution is not supported on this platform");
+#endif
+        }
+        while (jobs.value() == 1 && array_loop.read(hdri, namei))
         {
             // Open command
             std::string cmd = str::replace(command, "%I", str::from(block_index));
@@ -139,37 +354,10 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
                 throw exc(std::string("cannot run command '") + cmd + "': " + std::strerror(errno));
             }
             // Write N GTAs to command
+            bool read_input;
             try
             {
-                uintmax_t i = 0;
-                for (;;)
-                {
-                    hdro = hdri;
-                    hdro.set_compression(gta::none);
-                    hdro.write_to(p);
-                    hdri.copy_data(array_loop.file_in(), hdro, p);
-                    i++;
-                    if (i >= n.value() || !array_loop.read(hdri, namei))
-                        break;
-                }
-                if (i < n.value())
-                {
-                    fflush(msg::file());
-                    msg::wrn(std::string("last input block only has ") + str::from(i) + " GTAs");
-                    fflush(msg::file());
-                }
-            }
-            catch (gta::exception& e)
-            {
-                if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
-                {
-                    // ignore: we got sigpipe and handle that below
-                }
-                else
-                {
-                    (void)pclose(p);
-                    throw e;
-                }
+                read_input = write_block(array_loop, hdri, namei, n.value(), p);
             }
             catch (...)
             {
@@ -180,19 +368,7 @@ extern "C" int gtatool_stream_foreach(int argc, char *argv[])
             // Close command
             int r = pclose(p);
             fflush(msg::file());
-            if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
-            {
-                throw exc(std::string("command '") + cmd + "' failed to execute");
-            }
-            else if (sigpipe_flag)
-            {
-                throw exc(std::string("command '") + cmd + "' did not read its stdin");
-            }
-            else if (WEXITSTATUS(r) != 0)
-            {
-                throw exc(std::string("command '") + cmd + "' returned exit status "
-                        + str::from(WEXITSTATUS(r)));
-            }
+            check_status(cmd, r, read_input && !sigpipe_flag);
             block_index++;
         }
     }
@@ -23,7 +23,14 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 #include <limits>
+#include <list>
+#include <memory>
+#include <future>
+#include <functional>
 #include <unistd.h>
 #ifdef HAVE_SIGACTION
 # include <signal.h>
@@ -41,6 +48,7 @@
 #include "base/opt.h"
 #include "base/str.h"
 #include "base/fio.h"
+#include "base/blb.h"
 
 #include "lib.h"
 
@@ -48,18 +56,34 @@
 extern "C" void gtatool_stream_grep_help(void)
 {
     msg::req_txt(
-            "stream-grep command [<files...>]\n"
+            "stream-grep [-j|--jobs=<J>] [-m|--memory=<M>] command [<files...>]\n"
+            "stream-grep -e|--expression=<expr> [<files...>]\n"
             "\n"
-            "Executes the given command for each input GTAs, and outputs only those GTAs "
-            "for which the command exits successfully.\n"
+            "Outputs only those input GTAs that match a condition. "
             "This can be used to extract GTAs that match certain characteristics from an "
             "input stream.\n"
-            "The command must read one GTA from standard input and then exit with zero "
-            "(success; the GTA passes) or non-zero (failure; the GTA is removed). Any "
-            "output of the command is ignored.\n"
+            "The condition can be a command. It is executed for each input GTA, and must read one GTA "
+            "from standard input and then exit with zero (success; the GTA passes) or non-zero "
+            "(failure; the GTA is removed). Any output of the command is ignored.\n"
+            "With -j, up to J commands run at the same time. The order of the GTAs is preserved. "
+            "GTAs are kept in memory while their command runs, except for GTAs with more than M/J MiB "
+            "of data (default M=64), which are kept in temporary files.\n"
+            "Alternatively, the condition can be an expression. It only uses the GTA header, so that "
+            "no commands need to be run and the data does not need to be buffered. "
+            "Expressions compare values with ==, !=, <, <=, >, >= and combine comparisons with "
+            "&& (and), || (or), ! (not), and parentheses. Values are numbers, strings in single or "
+            "double quotes, and the following properties of the current GTA: index (in the input), "
+            "dimensions, components, elements, element_size, data_size, dimension_size(d), "
+            "component_type(c), component_size(c), global_tag(name), dimension_tag(d, name), "
+            "component_tag(c, name).\n"
+            "Values are compared as numbers if both are numbers, and as strings otherwise. "
+            "Tags that are not set and dimension or component indices that do not exist give undefined "
+            "values, which are only unequal to other values. "
+            "A value on its own is true if it is defined and is not the number zero.\n"
             "Examples:\n"
-            "stream-grep 'gta tag --get-global=X-INDEX 2>&1 > /dev/null | grep X-INDEX=8' all.gta > only-8.gta\n"
-            "stream-grep 'gta info 2>&1 > /dev/null | grep \"dimension 0: 42\"' all.gta > only-width42.gta");
+            "stream-grep -e 'global_tag(\"X-INDEX\") == 8' all.gta > only-8.gta\n"
+            "stream-grep -e 'dimension_size(0) == 42 && component_type(0) == \"uint8\"' all.gta > only-width42.gta\n"
+            "stream-grep -j 4 'gta tag --get-global=X-INDEX 2>&1 > /dev/null | grep X-INDEX=8' all.gta > only-8.gta");
 }
 
 #ifdef HAVE_SIGACTION
@@ -72,125 +96,637 @@ static void sigpipe_handler(int /* signum */)
 static const int sigpipe_flag = 0;
 #endif
 
-extern "C" int gtatool_stream_grep(int argc, char *argv[])
+/*
+ * Expressions
+ */
+
+class grep_expression
 {
-    std::vector<opt::option *> options;
-    opt::info help("help", '\0', opt::optional);
-    options.push_back(&help);
-    std::vector<std::string> arguments;
-    if (!opt::parse(argc, argv, options, 1, -1, arguments))
+private:
+    struct value
     {
-        return 1;
+        bool defined;
+        bool is_number;
+        double number;
+        std::string string;
+
+        value() : defined(false), is_number(false), number(0.0) {}
+        value(double x) : defined(true), is_number(true), number(x) {}
+        value(const std::string &s) : defined(true), is_number(false), number(0.0), string(s) {}
+
+        bool to_number(double *x) const
+        {
+            if (is_number)
+                *x = number;
+            return defined && (is_number || str::to(string, x));
+        }
+        bool to_index(uintmax_t n, uintmax_t *i) const
+        {
+            double x;
+            if (!to_number(&x) || x < 0.0 || x >= static_cast<double>(n) || x != static_cast<uintmax_t>(x))
+                return false;
+            *i = x;
+            return true;
+        }
+        bool truth() const
+        {
+            return defined && !(is_number && number == 0.0);
+        }
+    };
+
+    enum node_type { literal, variable, function, not_op, and_op, or_op, comparison };
+
+    struct node
+    {
+        node_type type;
+        value literal_value;
+        std::string name;       // variable, function, or comparison operator
+        std::vector<std::unique_ptr<node> > args;
+    };
+
+    std::string _expr;
+    size_t _pos;
+    std::unique_ptr<node> _root;
+
+    void error(const std::string &what) const
+    {
+        throw exc("invalid expression '" + _expr + "' at position " + str::from(_pos + 1) + ": " + what);
     }
-    if (help.value())
+
+    void skip_space()
     {
-        gtatool_stream_grep_help();
-        return 0;
+        while (_pos < _expr.length() && std::isspace(static_cast<unsigned char>(_expr[_pos])))
+            _pos++;
     }
 
-#ifdef HAVE_SIGACTION
-    struct sigaction new_sigpipe_handler, old_sigpipe_handler;
-    new_sigpipe_handler.sa_handler = sigpipe_handler;
-    sigemptyset(&new_sigpipe_handler.sa_mask);
-    new_sigpipe_handler.sa_flags = 0;
-    (void)sigaction(SIGPIPE, &new_sigpipe_handler, &old_sigpipe_handler);
-#endif
+    bool accept(const char *token)
+    {
+        skip_space();
+        size_t l = std::strlen(token);
+        if (_expr.compare(_pos, l, token) == 0)
+        {
+            _pos += l;
+            return true;
+        }
+        return false;
+    }
 
-#if W32
-    FILE *fdevnull = fio::open("NUL", "w");
-#else
-    FILE *fdevnull = fio::open("/dev/null", "w");
-#endif
+    std::unique_ptr<node> new_node(node_type type)
+    {
+        std::unique_ptr<node> n(new node);
+        n->type = type;
+        return n;
+    }
 
-    FILE *tmpf = NULL;
-    int retval = 0;
-    try
+    std::unique_ptr<node> parse_operand()
     {
-        std::string command = arguments[0];
-        arguments.erase(arguments.begin());
-        array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
-        array_loop.start(arguments, "");
-        while (array_loop.read(hdri, namei))
+        skip_space();
+        if (_pos >= _expr.length())
+            error("value expected");
+        char c = _expr[_pos];
+        if (c == '(')
+        {
+            _pos++;
+            std::unique_ptr<node> n = parse_or();
+            if (!accept(")"))
+                error("')' expected");
+            return n;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            size_t end = _expr.find(c, _pos + 1);
+            if (end == std::string::npos)
+                error("unterminated string");
+            std::unique_ptr<node> n = new_node(literal);
+            n->literal_value = value(_expr.substr(_pos + 1, end - _pos - 1));
+            _pos = end + 1;
+            return n;
+        }
+        else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '+')
         {
-            // Make sure the output of the child process is ignored.
-            int stdout_bak = -1;
-            if ((stdout_bak = dup(1)) < 0 || dup2(fileno(fdevnull), 1) < 0)
+            const char *start = _expr.c_str() + _pos;
+            char *end;
+            double x = std::strtod(start, &end);
+            if (end == start)
+                error("number expected");
+            std::unique_ptr<node> n = new_node(literal);
+            n->literal_value = value(x);
+            _pos += end - start;
+            return n;
+        }
+        else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+        {
+            size_t start = _pos;
+            while (_pos < _expr.length() && (std::isalnum(static_cast<unsigned char>(_expr[_pos])) || _expr[_pos] == '_'))
+                _pos++;
+            std::string name = _expr.substr(start, _pos - start);
+            if (name == "index" || name == "dimensions" || name == "components"
+                    || name == "elements" || name == "element_size" || name == "data_size")
             {
-                throw exc(std::string("cannot set stdout for child process: ") + std::strerror(errno));
+                std::unique_ptr<node> n = new_node(variable);
+                n->name = name;
+                return n;
             }
-            // Open command
-            std::string cmd = command;
-            fflush(msg::file());
-            errno = 0;
-            FILE* p = popen(cmd.c_str(), "w");
-            if (!p)
+            size_t arity = (name == "dimension_size" || name == "component_type"
+                    || name == "component_size" || name == "global_tag" ? 1
+                    : name == "dimension_tag" || name == "component_tag" ? 2 : 0);
+            if (arity == 0)
             {
-                if (errno == 0)
-                    errno = ENOMEM;
-                throw exc(std::string("cannot run command '") + cmd + "': " + std::strerror(errno));
+                _pos = start;
+                error("unknown name '" + name + "'");
             }
-            // Buffer GTA data to temp file
-            hdro = hdri;
-            hdro.set_compression(gta::none);
-            tmpf = fio::tempfile();
-            hdri.copy_data(array_loop.file_in(), hdro, tmpf);
-            fio::rewind(tmpf);
-            // Write 1 GTA to command
-            try
+            std::unique_ptr<node> n = new_node(function);
+            n->name = name;
+            if (!accept("("))
+                error("'(' expected");
+            for (size_t i = 0; i < arity; i++)
+            {
+                if (i > 0 && !accept(","))
+                    error("',' expected");
+                n->args.push_back(parse_or());
+            }
+            if (!accept(")"))
+                error("')' expected");
+            return n;
+        }
+        error("value expected");
+        return std::unique_ptr<node>();
+    }
+
+    std::unique_ptr<node> parse_comparison()
+    {
+        static const char *ops[] = { "==", "!=", "<=", ">=", "<", ">" };
+        std::unique_ptr<node> left = parse_operand();
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        {
+            if (accept(ops[i]))
             {
-                hdro.write_to(p);
-                hdro.copy_data(tmpf, hdro, p);
+                std::unique_ptr<node> n = new_node(comparison);
+                n->name = ops[i];
+                n->args.push_back(std::move(left));
+                n->args.push_back(parse_operand());
+                return n;
             }
-            catch (gta::exception& e)
+        }
+        return left;
+    }
+
+    std::unique_ptr<node> parse_not()
+    {
+        skip_space();
+        if (_pos < _expr.length() && _expr[_pos] == '!' && _expr.compare(_pos, 2, "!=") != 0)
+        {
+            _pos++;
+            std::unique_ptr<node> n = new_node(not_op);
+            n->args.push_back(parse_not());
+            return n;
+        }
+        return parse_comparison();
+    }
+
+    std::unique_ptr<node> parse_and()
+    {
+        std::unique_ptr<node> left = parse_not();
+        while (accept("&&"))
+        {
+            std::unique_ptr<node> n = new_node(and_op);
+            n->args.push_back(std::move(left));
+            n->args.push_back(parse_not());
+            left = std::move(n);
+        }
+        return left;
+    }
+
+    std::unique_ptr<node> parse_or()
+    {
+        std::unique_ptr<node> left = parse_and();
+        while (accept("||"))
+        {
+            std::unique_ptr<node> n = new_node(or_op);
+            n->args.push_back(std::move(left));
+            n->args.push_back(parse_and());
+            left = std::move(n);
+        }
+        return left;
+    }
+
+    static value tag_value(const gta::taglist &tl, const value &name)
+    {
+        const char *v = (name.defined ? tl.get(to_utf8(name.is_number ? str::from(name.number) : name.string).c_str()) : NULL);
+        return v ? value(from_utf8(v)) : value();
+    }
+
+    static bool compare(const std::string &op, const value &a, const value &b)
+    {
+        if (!a.defined || !b.defined)
+            return (op == "!=" && (a.defined || b.defined));
+        double x, y;
+        int c;
+        if (a.to_number(&x) && b.to_number(&y))
+            c = (x < y ? -1 : x > y ? +1 : 0);
+        else
+            c = (a.is_number ? str::from(a.number) : a.string).compare(b.is_number ? str::from(b.number) : b.string);
+        return (op == "==" ? c == 0 : op == "!=" ? c != 0 : op == "<" ? c < 0
+                : op == "<=" ? c <= 0 : op == ">" ? c > 0 : c >= 0);
+    }
+
+    static value evaluate(const node *n, const gta::header &hdr, uintmax_t index)
+    {
+        switch (n->type)
+        {
+        case literal:
+            return n->literal_value;
+        case variable:
+            return value(static_cast<double>(
+                        n->name == "index" ? index
+                        : n->name == "dimensions" ? hdr.dimensions()
+                        : n->name == "components" ? hdr.components()
+                        : n->name == "elements" ? hdr.elements()
+                        : n->name == "element_size" ? hdr.element_size()
+                        : hdr.data_size()));
+        case function:
             {
-                if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
+                value a = evaluate(n->args[0].get(), hdr, index);
+                uintmax_t i;
+                if (n->name == "global_tag")
+                    return tag_value(hdr.global_taglist(), a);
+                else if (n->name == "dimension_size" || n->name == "dimension_tag")
                 {
-                    // ignore: we got sigpipe and handle that below
+                    if (!a.to_index(hdr.dimensions(), &i))
+                        return value();
+                    if (n->name == "dimension_size")
+                        return value(static_cast<double>(hdr.dimension_size(i)));
+                    return tag_value(hdr.dimension_taglist(i), evaluate(n->args[1].get(), hdr, index));
                 }
                 else
                 {
-                    (void)pclose(p);
-                    throw e;
+                    if (!a.to_index(hdr.components(), &i))
+                        return value();
+                    if (n->name == "component_type")
+                        return value(type_to_string(hdr.component_type(i), hdr.component_size(i)));
+                    else if (n->name == "component_size")
+                        return value(static_cast<double>(hdr.component_size(i)));
+                    return tag_value(hdr.component_taglist(i), evaluate(n->args[1].get(), hdr, index));
                 }
             }
-            catch (...)
+        case not_op:
+            return value(evaluate(n->args[0].get(), hdr, index).truth() ? 0.0 : 1.0);
+        case and_op:
+            return value(evaluate(n->args[0].get(), hdr, index).truth()
+                    && evaluate(n->args[1].get(), hdr, index).truth() ? 1.0 : 0.0);
+        case or_op:
+            return value(evaluate(n->args[0].get(), hdr, index).truth()
+                    || evaluate(n->args[1].get(), hdr, index).truth() ? 1.0 : 0.0);
+        case comparison:
+        default:
+            return value(compare(n->name,
+                        evaluate(n->args[0].get(), hdr, index),
+                        evaluate(n->args[1].get(), hdr, index)) ? 1.0 : 0.0);
+        }
+    }
+
+public:
+    grep_expression(const std::string &expr) : _expr(expr), _pos(0)
+    {
+        _root = parse_or();
+        skip_space();
+        if (_pos < _expr.length())
+            error("unexpected characters");
+    }
+
+    bool matches(const gta::header &hdr, uintmax_t index) const
+    {
+        return evaluate(_root.get(), hdr, index).truth();
+    }
+};
+
+/*
+ * Commands
+ */
+
+/* An input GTA that is checked by a command */
+struct grep_array
+{
+    gta::header hdr;    // header without compression
+    blob data;          // the data if it is kept in memory
+    FILE *tmpf;         // the data if it is kept in a temporary file
+    bool read_input;    // whether the command read the GTA
+#ifdef HAVE_SYS_WAIT_H
+    pid_t pid;          // the command process
+    std::future<bool> feeder;   // the thread that writes the GTA to the command
+#endif
+};
+
+static void buffer_array(array_loop_t &array_loop, const gta::header &hdri, uintmax_t max_memory, grep_array &a)
+{
+    a.hdr = hdri;
+    a.hdr.set_compression(gta::none);
+    if (hdri.data_size() <= max_memory)
+    {
+        a.data.resize(checked_cast<size_t>(hdri.data_size()));
+        array_loop.read_data(hdri, a.data.ptr());
+    }
+    else
+    {
+        a.tmpf = fio::tempfile();
+        hdri.copy_data(array_loop.file_in(), a.hdr, a.tmpf);
+    }
+}
+
+static void write_data(const grep_array &a, FILE *f)
+{
+    if (a.tmpf)
+    {
+        fio::rewind(a.tmpf);
+        a.hdr.copy_data(a.tmpf, a.hdr, f);
+    }
+    else
+    {
+        a.hdr.write_data(f, a.data.ptr());
+    }
+}
+
+/* Write the GTA to the command input p and close it. Returns false if the
+ * command did not read all of it. */
+static bool feed_command(const grep_array &a, FILE *p)
+{
+    try
+    {
+        a.hdr.write_to(p);
+        write_data(a, p);
+    }
+    catch (gta::exception& e)
+    {
+        if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
+        {
+            (void)fclose(p);
+            return false;
+        }
+        (void)fclose(p);
+        throw;
+    }
+    catch (...)
+    {
+        (void)fclose(p);
+        throw;
+    }
+    if (fclose(p) != 0)
+    {
+        if (errno == EPIPE)
+            return false;
+        throw exc(std::string("cannot write to command: ") + std::strerror(errno), errno);
+    }
+    return true;
+}
+
+/* Check the exit status r of the command for GTA a, and write a to the output
+ * if it passes. */
+static void finish_array(array_loop_t &array_loop, const std::string &cmd, int r, grep_array &a)
+{
+    fflush(msg::file());
+    if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
+    {
+        throw exc(std::string("command '") + cmd + "' failed to execute");
+    }
+    else if (!a.read_input)
+    {
+        throw exc(std::string("command '") + cmd + "' did not read its stdin");
+    }
+    else if (WEXITSTATUS(r) == 0)
+    {
+        std::string nameo;
+        array_loop.write(a.hdr, nameo);
+        write_data(a, array_loop.file_out());
+    }
+    if (a.tmpf)
+    {
+        fio::close(a.tmpf);
+        a.tmpf = NULL;
+    }
+}
+
+#ifdef HAVE_SYS_WAIT_H
+static void finish_command(array_loop_t &array_loop, const std::string &cmd, std::list<grep_array> &pending)
+{
+    grep_array &a = pending.front();
+    a.read_input = a.feeder.get();
+    int r;
+    while (waitpid(a.pid, &r, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            r = -1;
+            break;
+        }
+    }
+    a.pid = -1;
+    finish_array(array_loop, cmd, r, a);
+    pending.pop_front();
+}
+#endif
+
+static void grep_commands(array_loop_t &array_loop, const std::string &cmd,
+        uintmax_t max_jobs, uintmax_t max_memory, FILE *fdevnull)
+{
+    gta::header hdri;
+    std::string namei;
+#ifdef HAVE_SYS_WAIT_H
+    std::list<grep_array> pending;
+    try
+    {
+        while (array_loop.read(hdri, namei))
+        {
+            while (pending.size() >= max_jobs)
             {
-                (void)pclose(p);
-                throw;
+                finish_command(array_loop, cmd, pending);
             }
-            // Close command
-            bool keep_gta = true;
-            int r = pclose(p);
-            fflush(msg::file());
-            if (r == -1 || !WIFEXITED(r) || WEXITSTATUS(r) == 127)
+            pending.push_back(grep_array());
+            grep_array &a = pending.back();
+            a.tmpf = NULL;
+            a.pid = -1;
+            buffer_array(array_loop, hdri, max_memory / max_jobs, a);
+            FILE *p;
+            a.pid = start_command(cmd, fdevnull, &p);
+            // Feed the command in its own thread, so that all pending
+            // commands can read their input at the same time.
+            try
             {
-                throw exc(std::string("command '") + cmd + "' failed to execute");
+                a.feeder = std::async(std::launch::async, feed_command, std::cref(a), p);
             }
-            else if (sigpipe_flag)
+            catch (...)
             {
-                throw exc(std::string("command '") + cmd + "' did not read its stdin");
+                (void)fclose(p);
+                throw;
             }
-            else if (WEXITSTATUS(r) != 0)
+        }
+        while (!pending.empty())
+        {
+            finish_command(array_loop, cmd, pending);
+        }
+    }
+    catch (...)
+    {
+        // Let the remaining commands finish reading their input.
+        for (std::list<grep_array>::iterator it = pending.begin(); it != pending.end(); it++)
+        {
+            int status;
+            if (it->feeder.valid())
+                it->feeder.wait();
+            if (it->pid > 0)
+                while (waitpid(it->pid, &status, 0) < 0 && errno == EINTR);
+            if (it->tmpf)
+            {
+                try { fio::close(it->tmpf); } catch (...) { }
+            }
+        }
+        throw;
+    }
+#else
+    if (max_jobs > 1)
+    {
+        throw exc("parallel execution is not supported on this platform");
+    }
+    while (array_loop.read(hdri, namei))
+    {
+        grep_array a;
+        a.tmpf = NULL;
+        buffer_array(array_loop, hdri, max_memory, a);
+        // Make sure the output of the child process is ignored.
+        int stdout_bak = -1;
+        if ((stdout_bak = dup(1)) < 0 || dup2(fileno(fdevnull), 1) < 0)
+        {
+            throw exc(std::string("cannot set stdout for child process: ") + std::strerror(errno));
+        }
+        // Open command
+        fflush(msg::file());
+        errno = 0;
+        FILE* p = popen(cmd.c_str(), "w");
+        if (!p)
+        {
+            if (errno == 0)
+                errno = ENOMEM;
+            throw exc(std::string("cannot run command '") + cmd + "': " + std::strerror(errno));
+        }
+        // Write 1 GTA to command
+        try
+        {
+            a.hdr.write_to(p);
+            write_data(a, p);
+            a.read_input = true;
+        }
+        catch (gta::exception& e)
+        {
+            if (sigpipe_flag && e.result() == gta::system_error && e.sys_errno() == EPIPE)
             {
-                keep_gta = false;
+                a.read_input = false;
             }
-            // Restore stdout
-            if (close(1) < 0 || dup2(stdout_bak, 1) < 0 || close(stdout_bak) < 0)
+            else
             {
-                throw exc(std::string("cannot restore stdout: ") + strerror(errno));
+                (void)pclose(p);
+                throw;
             }
-            // Write array
-            if (keep_gta)
+        }
+        catch (...)
+        {
+            (void)pclose(p);
+            throw;
+        }
+        int r = pclose(p);
+        // Restore stdout
+        if (close(1) < 0 || dup2(stdout_bak, 1) < 0 || close(stdout_bak) < 0)
+        {
+            throw exc(std::string("cannot restore stdout: ") + strerror(errno));
+        }
+        finish_array(array_loop, cmd, r, a);
+    }
+#endif
+}
+
+extern "C" int gtatool_stream_grep(int argc, char *argv[])
+{
+    std::vector<opt::option *> options;
+    opt::info help("help", '\0', opt::optional);
+    options.push_back(&help);
+    opt::string expression("expression", 'e', opt::optional);
+    options.push_back(&expression);
+    opt::val<uintmax_t> jobs("jobs", 'j', opt::optional, 1, std::numeric_limits<int>::max(), 1);
+    options.push_back(&jobs);
+    opt::val<uintmax_t> memory("memory", 'm', opt::optional, 0, std::numeric_limits<uintmax_t>::max() / (1024 * 1024), 64);
+    options.push_back(&memory);
+    std::vector<std::string> arguments;
+    if (!opt::parse(argc, argv, options, 0, -1, arguments))
+    {
+        return 1;
+    }
+    if (help.value())
+    {
+        gtatool_stream_grep_help();
+        return 0;
+    }
+    if (expression.values().empty() && arguments.empty())
+    {
+        msg::err_txt("no command or expression given");
+        return 1;
+    }
+
+    int retval = 0;
+    if (!expression.values().empty())
+    {
+        try
+        {
+            grep_expression expr(expression.value());
+            array_loop_t array_loop;
+            gta::header hdri, hdro;
+            std::string namei, nameo;
+            uintmax_t index = 0;
+            array_loop.start(arguments, "");
+            while (array_loop.read(hdri, namei))
             {
-                array_loop.write(hdro, nameo);
-                fio::rewind(tmpf);
-                hdro.copy_data(tmpf, hdro, array_loop.file_out());
+                if (expr.matches(hdri, index))
+                {
+                    hdro = hdri;
+                    hdro.set_compression(gta::none);
+                    array_loop.write(hdro, nameo);
+                    array_loop.copy_data(hdri, hdro);
+                }
+                else
+                {
+                    array_loop.skip_data(hdri);
+                }
+                index++;
             }
-            fio::close(tmpf);
-            tmpf = NULL;
+            array_loop.finish();
+        }
+        catch (std::exception &e)
+        {
+            msg::err_txt("%s", e.what());
+            retval = 1;
         }
+        return retval;
+    }
+
+#ifdef HAVE_SIGACTION
+    struct sigaction new_sigpipe_handler, old_sigpipe_handler;
+    new_sigpipe_handler.sa_handler = sigpipe_handler;
+    sigemptyset(&new_sigpipe_handler.sa_mask);
+    new_sigpipe_handler.sa_flags = 0;
+    (void)sigaction(SIGPIPE, &new_sigpipe_handler, &old_sigpipe_handler);
+#endif
+
+#if W32
+    FILE *fdevnull = fio::open("NUL", "w");
+#else
+    FILE *fdevnull = fio::open("/dev/null", "w");
+#endif
+
+    try
+    {
+        std::string command = arguments[0];
+        arguments.erase(arguments.begin());
+        array_loop_t array_loop;
+        array_loop.start(arguments, "");
+        grep_commands(array_loop, command, jobs.value(), memory.value() * 1024 * 1024, fdevnull);
+        array_loop.finish();
     }
     catch (std::exception &e)
     {
@@ -198,10 +734,6 @@ extern "C" int gtatool_stream_grep(int argc, char *argv[])
         retval = 1;
     }
     fclose(fdevnull);
-    if (tmpf)
-    {
-        fclose(tmpf);
-    }
 
 #ifdef HAVE_SIGACTION
     (void)sigaction(SIGPIPE, &old_sigpipe_handler, NULL);
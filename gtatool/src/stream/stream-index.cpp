@@ -0,0 +1,115 @@
+/*
+ * This file is part of gtatool, a tool to manipulate Generic Tagged Arrays
+ * (GTAs).
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include <gta/gta.hpp>
+
+#include "base/msg.h"
+#include "base/opt.h"
+#include "base/fio.h"
+#include "base/str.h"
+
+#include "lib.h"
+
+
+extern "C" void gtatool_stream_index_help(void)
+{
+    msg::req_txt(
+            "stream-index [-f|--force] <files...>\n"
+            "\n"
+            "Builds a stream index for each of the given GTA files. The index of a file is stored "
+            "in a separate file with the additional extension .idx. It records the position of each "
+            "array in the file, so that commands like stream-extract and stream-split can access "
+            "arrays directly instead of reading through all preceding arrays.\n"
+            "An index is only built if it is missing or outdated, i.e. if the GTA file was modified "
+            "after the index was built. Use --force to rebuild it anyway.\n"
+            "Example:\n"
+            "stream-index video.gta");
+}
+
+extern "C" int gtatool_stream_index(int argc, char *argv[])
+{
+    std::vector<opt::option *> options;
+    opt::info help("help", '\0', opt::optional);
+    options.push_back(&help);
+    opt::flag force("force", 'f', opt::optional);
+    options.push_back(&force);
+    std::vector<std::string> arguments;
+    if (!opt::parse(argc, argv, options, 1, -1, arguments))
+    {
+        return 1;
+    }
+    if (help.value())
+    {
+        gtatool_stream_index_help();
+        return 0;
+    }
+
+    try
+    {
+        for (size_t i = 0; i < arguments.size(); i++)
+        {
+            const std::string &name = arguments[i];
+            const std::string index_name = stream_index_name(name);
+            gta::stream_index index;
+            if (!force.value() && stream_index_load(name, index))
+            {
+                msg::dbg_txt("%s: index is up to date", name.c_str());
+                continue;
+            }
+            FILE *f = fio::open(name, "r");
+            try
+            {
+                index.build(f);
+            }
+            catch (std::exception &e)
+            {
+                fio::close(f, name);
+                throw exc(name + ": " + e.what());
+            }
+            fio::close(f, name);
+            FILE *fi = fio::open(index_name, "w");
+            try
+            {
+                index.write_to(fi);
+            }
+            catch (std::exception &e)
+            {
+                fio::close(fi, index_name);
+                throw exc(index_name + ": " + e.what());
+            }
+            fio::close(fi, index_name);
+            msg::dbg_txt("%s: %s arrays indexed", name.c_str(), str::from(index.arrays()).c_str());
+        }
+    }
+    catch (std::exception &e)
+    {
+        msg::err_txt("%s", e.what());
+        return 1;
+    }
+
+    return 0;
+}
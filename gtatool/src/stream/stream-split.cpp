@@ -22,6 +22,9 @@
 #include "config.h"
 
 #include <sstream>
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include <cstdio>
 #include <cctype>
 
@@ -29,6 +32,7 @@
 
 #include "base/msg.h"
 #include "base/opt.h"
+#include "base/fio.h"
 #include "base/str.h"
 
 #include "lib.h"
@@ -44,6 +48,8 @@ extern "C" void gtatool_stream_split_help(void)
             "index of the array in the input stream. The optional parameter n gives the minimum "
             "number of digits in the index number; small indices will be padded with zeroes. "
             "The default template is %%9N.gta.\n"
+            "If all input files have a stream index (see stream-index), the arrays are "
+            "written in parallel.\n"
             "Example:\n"
             "stream-split array-%%3N.gta 129-arrays.gta");
 }
@@ -104,12 +110,7 @@ extern "C" int gtatool_stream_split(int argc, char *argv[])
             }
         }
 
-        array_loop_t array_loop;
-        gta::header hdri, hdro;
-        std::string namei, nameo;
-        array_loop.start(arguments, "");
-        uintmax_t array_index = 0;
-        while (array_loop.read(hdri, namei))
+        auto output_name = [&](uintmax_t array_index) -> std::string
         {
             std::string array_index_str = str::from(array_index);
             if (array_index_str.length() < min_width)
@@ -118,6 +119,99 @@ extern "C" int gtatool_stream_split(int argc, char *argv[])
             }
             std::string foname = tmpl;
             foname.replace(seq_start, seq_length, array_index_str);
+            return foname;
+        };
+
+        /* If all input files have a stream index, each array can be read
+         * independently, so the arrays are split in parallel. */
+        std::vector<std::unique_ptr<gta::stream_index>> indices;
+        std::vector<uintmax_t> first_array(1, 0);
+        for (size_t i = 0; i < arguments.size(); i++)
+        {
+            indices.push_back(std::unique_ptr<gta::stream_index>(new gta::stream_index));
+            if (!stream_index_load(arguments[i], *indices.back()))
+            {
+                indices.clear();
+                break;
+            }
+            first_array.push_back(first_array.back() + indices.back()->arrays());
+        }
+        if (indices.size() > 0)
+        {
+            parallel_for(first_array.back(), 1, [&](uintmax_t begin, uintmax_t end)
+            {
+                size_t file = std::upper_bound(first_array.begin(), first_array.end(), begin)
+                    - first_array.begin() - 1;
+                FILE *fi = NULL;
+                try
+                {
+                    for (uintmax_t a = begin; a < end; a++)
+                    {
+                        while (a >= first_array[file + 1])
+                        {
+                            file++;
+                            if (fi)
+                            {
+                                FILE *f = fi;
+                                fi = NULL;
+                                fio::close(f, arguments[file - 1]);
+                            }
+                        }
+                        if (!fi)
+                        {
+                            fi = fio::open(arguments[file], "r");
+                        }
+                        std::string namei = arguments[file] + " array " + str::from(a - first_array[file]);
+                        std::string foname = output_name(a);
+                        gta::header hdri, hdro;
+                        try
+                        {
+                            hdri.read_from(*indices[file], a - first_array[file], fi);
+                        }
+                        catch (std::exception &e)
+                        {
+                            throw exc(namei + ": " + e.what());
+                        }
+                        hdro = hdri;
+                        hdro.set_compression(gta::none);
+                        FILE *fo = fio::open(foname, "w");
+                        try
+                        {
+                            hdro.write_to(fo);
+                            hdri.copy_data(fi, hdro, fo);
+                        }
+                        catch (std::exception &e)
+                        {
+                            fio::close(fo, foname);
+                            throw exc(namei + ": " + e.what());
+                        }
+                        fio::close(fo, foname);
+                    }
+                }
+                catch (...)
+                {
+                    if (fi)
+                    {
+                        try { fio::close(fi, arguments[file]); } catch (...) { }
+                    }
+                    throw;
+                }
+                if (fi)
+                {
+                    fio::close(fi, arguments[file]);
+                }
+            });
+            return 0;
+        }
+
+        array_loop_t array_loop;
+        gta::header hdri, hdro;
+        std::string namei, nameo;
+        array_loop.start(arguments, "");
+        uintmax_t array_index = 0;
+        while (array_loop.read(hdri, namei))
+        {
+            std::string foname = output_name(array_index);
             array_loop_t array_loop_out;
             array_loop_out.start("", foname);
             hdro = hdri;
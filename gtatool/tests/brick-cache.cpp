@@ -0,0 +1,197 @@
+/*
+ * This file is part of gtatool, a tool to manipulate Generic Tagged Arrays
+ * (GTAs).
+ *
+ * Copyright (C) 2010, 2011, 2012, 2013, 2014
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <gta/gta.hpp>
+
+#include "base/blb.h"
+#include "base/exc.h"
+
+#include "lib.h"
+
+#define check(condition) \
+    if (!(condition)) \
+    { \
+        std::fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        std::exit(1); \
+    }
+
+/* Read a block through the cache and directly from the file, and compare. */
+static void check_block(brick_cache_t &cache, const gta::header &header, FILE *f, uintmax_t data_offset,
+        const std::vector<uintmax_t> &lower, const std::vector<uintmax_t> &higher)
+{
+    size_t elements = 1;
+    for (size_t d = 0; d < lower.size(); d++)
+    {
+        elements *= higher[d] - lower[d] + 1;
+    }
+    blob cached(static_cast<size_t>(header.element_size()), elements);
+    blob direct(static_cast<size_t>(header.element_size()), elements);
+    off_t pos = ftello(f);
+    cache.read_block(&(lower[0]), &(higher[0]), cached.ptr());
+    check(ftello(f) == pos);
+    header.read_block(f, data_offset, &(lower[0]), &(higher[0]), direct.ptr());
+    check(std::memcmp(cached.ptr(), direct.ptr(), cached.size()) == 0);
+}
+
+/* Read a sequence of blocks that overlap each other, straddle brick
+ * boundaries, repeat, and move along each dimension in both directions. */
+static void check_blocks(brick_cache_t &cache, const gta::header &header, FILE *f, uintmax_t data_offset)
+{
+    const size_t n = header.dimensions();
+    std::vector<uintmax_t> lower(n), higher(n);
+
+    // The complete array, twice
+    for (int i = 0; i < 2; i++)
+    {
+        for (size_t d = 0; d < n; d++)
+        {
+            lower[d] = 0;
+            higher[d] = header.dimension_size(d) - 1;
+        }
+        check_block(cache, header, f, data_offset, lower, higher);
+    }
+    // Single elements at the corners
+    for (size_t d = 0; d < n; d++)
+    {
+        lower[d] = higher[d] = header.dimension_size(d) - 1;
+    }
+    check_block(cache, header, f, data_offset, lower, higher);
+    for (size_t d = 0; d < n; d++)
+    {
+        lower[d] = higher[d] = 0;
+    }
+    check_block(cache, header, f, data_offset, lower, higher);
+    // Windows that slide forward and backward along each dimension
+    for (size_t dim = 0; dim < n; dim++)
+    {
+        for (size_t d = 0; d < n; d++)
+        {
+            lower[d] = header.dimension_size(d) / 4;
+            higher[d] = std::min(lower[d] + 5, header.dimension_size(d) - 1);
+        }
+        lower[dim] = 0;
+        higher[dim] = 2;
+        while (higher[dim] < header.dimension_size(dim) - 1)
+        {
+            check_block(cache, header, f, data_offset, lower, higher);
+            lower[dim]++;
+            higher[dim]++;
+        }
+        while (lower[dim] > 0)
+        {
+            check_block(cache, header, f, data_offset, lower, higher);
+            lower[dim] -= std::min(lower[dim], static_cast<uintmax_t>(2));
+            higher[dim] -= 2;
+        }
+        check_block(cache, header, f, data_offset, lower, higher);
+    }
+    // Random blocks, each read again with an overlapping neighbor
+    std::srand(42);
+    for (int i = 0; i < 500; i++)
+    {
+        for (size_t d = 0; d < n; d++)
+        {
+            uintmax_t size = header.dimension_size(d);
+            lower[d] = std::rand() % size;
+            higher[d] = lower[d] + std::rand() % (size - lower[d]);
+        }
+        check_block(cache, header, f, data_offset, lower, higher);
+        check_block(cache, header, f, data_offset, lower, higher);
+        size_t d = std::rand() % n;
+        if (higher[d] + 1 < header.dimension_size(d))
+        {
+            lower[d]++;
+            higher[d]++;
+            check_block(cache, header, f, data_offset, lower, higher);
+        }
+    }
+}
+
+int main(void)
+{
+    // An array with odd sizes, both in its dimensions and in its element size
+    gta::header header;
+    header.set_dimensions(37, 23, 11);
+    gta::type types[] = { gta::uint16, gta::uint8 };
+    header.set_components(2, types);
+    FILE *f = std::tmpfile();
+    check(f);
+    header.write_to(f);
+    uintmax_t data_offset = ftello(f);
+    blob data(static_cast<size_t>(header.element_size()), static_cast<size_t>(header.elements()));
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data.ptr<unsigned char>()[i] = (i * 7 + i / 251) & 0xff;
+    }
+    header.write_data(f, data.ptr());
+    check(std::fflush(f) == 0);
+
+    // Default bricks, with a memory size that forces eviction
+    {
+        brick_cache_t cache(header, f, data_offset, 2000);
+        check_blocks(cache, header, f, data_offset);
+    }
+    // Default bricks, with enough memory for the complete array
+    {
+        brick_cache_t cache(header, f, data_offset, 16 * header.data_size());
+        check_blocks(cache, header, f, data_offset);
+    }
+    // Given bricks that do not start at zero, with a memory size that forces eviction
+    {
+        std::vector<uintmax_t> brick_size(3), brick_start(3);
+        brick_size[0] = 5;
+        brick_size[1] = 4;
+        brick_size[2] = 3;
+        brick_start[0] = 2;
+        brick_start[1] = 1;
+        brick_start[2] = 0;
+        brick_cache_t cache(header, f, data_offset, 3000, brick_size, brick_start);
+        check_blocks(cache, header, f, data_offset);
+    }
+    // Invalid blocks are rejected
+    {
+        brick_cache_t cache(header, f, data_offset, 2000);
+        uintmax_t lower[] = { 0, 0, 0 };
+        uintmax_t higher[] = { 37, 0, 0 };
+        blob block(static_cast<size_t>(header.element_size()), 38);
+        bool failed = false;
+        try
+        {
+            cache.read_block(lower, higher, block.ptr());
+        }
+        catch (exc &)
+        {
+            failed = true;
+        }
+        check(failed);
+    }
+
+    std::fclose(f);
+    return 0;
+}
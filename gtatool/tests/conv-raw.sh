@@ -26,4 +26,17 @@ $GTA tag --unset-all < "$TMPD"/c.gta > "$TMPD"/e.gta
 cmp "$TMPD"/d.gta "$TMPD"/a.gta
 cmp "$TMPD"/e.gta "$TMPD"/a.gta
 
+$GTA create -d 5,7 -c uint16 -v 258 "$TMPD"/f.gta
+$GTA to-raw -e big "$TMPD"/f.gta "$TMPD"/f.raw
+test "`od -An -tx1 -N4 "$TMPD"/f.raw | tr -d ' \n'`" = "01020102"
+
+for cv in "uint16:258" "float32,float32,float32:1,2,3" "uint8,int32,uint8:1,2,3" \
+        "uint8,int16,float64,cfloat32,int16,int16:1,2,3,4,5,6,7"; do
+    $GTA create -d 5,7 -c "${cv%%:*}" -v "${cv#*:}" "$TMPD"/g.gta
+    $GTA to-raw -e big "$TMPD"/g.gta "$TMPD"/g.raw
+    $GTA from-raw -e big -d 5,7 -c "${cv%%:*}" "$TMPD"/g.raw "$TMPD"/h.gta
+    $GTA tag --unset-all < "$TMPD"/h.gta > "$TMPD"/i.gta
+    cmp "$TMPD"/i.gta "$TMPD"/g.gta
+done
+
 rm -r "$TMPD"
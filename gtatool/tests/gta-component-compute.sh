@@ -19,6 +19,24 @@ $GTA create -d 10,10 -c uint8 -v 117 "$TMPD"/b.gta
 $GTA component-compute -e 'c0=42' "$TMPD"/b.gta > "$TMPD"/c.gta
 cmp "$TMPD"/a.gta "$TMPD"/c.gta
 
+$GTA create -d 300,200 -c uint8,float32 -v 42,0 "$TMPD"/d.gta
+$GTA create -d 300,200 -c uint8,float32 -v 42,84 "$TMPD"/e.gta
+$GTA component-compute -e 'c1 = comp(0, i0 - 1, i1) + comp(0, i0, i1 + 1)' "$TMPD"/d.gta "$TMPD"/d.gta > "$TMPD"/f.gta
+$GTA stream-merge "$TMPD"/e.gta "$TMPD"/e.gta > "$TMPD"/ee.gta
+cmp "$TMPD"/ee.gta "$TMPD"/f.gta
+
+# Stencil access on varying data, with indices clamped at the borders
+$GTA create -d 10,12 -c uint8,float32 -v 0,0 | $GTA component-compute -e 'c0 = i0 + 10 * i1' > "$TMPD"/g.gta
+$GTA component-compute -e 'c1 = comp(0, i0 - 1, i1) + comp(0, i0, i1 + 1)' "$TMPD"/g.gta > "$TMPD"/h.gta
+$GTA component-compute -e 'c1 = clamp(i0 - 1, 0, d0 - 1) + 10 * i1 + i0 + 10 * clamp(i1 + 1, 0, d1 - 1)' "$TMPD"/g.gta > "$TMPD"/xh.gta
+cmp "$TMPD"/h.gta "$TMPD"/xh.gta
+for e in 4,5,54,117 0,0,0,10 9,11,119,237 0,11,110,220 9,0,9,27; do
+    set -- `echo $e | tr , ' '`
+    $GTA create -d 1,1 -c uint8,float32 -v $3,$4 > "$TMPD"/e1.gta
+    $GTA extract -l $1,$2 -h $1,$2 "$TMPD"/h.gta > "$TMPD"/xe1.gta
+    cmp "$TMPD"/e1.gta "$TMPD"/xe1.gta
+done
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 $GTA component-compute -e '5' "$TMPD"/empty0.gta > "$TMPD"/xempty0.gta
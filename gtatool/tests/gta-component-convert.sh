@@ -22,4 +22,15 @@ $GTA component-convert -c int16 "$TMPD"/empty0.gta > "$TMPD"/t.gta
 $GTA component-convert -c uint8 "$TMPD"/t.gta > "$TMPD"/xempty0.gta
 cmp "$TMPD"/empty0.gta "$TMPD"/xempty0.gta
 
+$GTA create -d 300,200 -c uint16,int8,uint8 -v 40000,-100,200 "$TMPD"/c.gta
+$GTA component-convert -n -c float32,float64,float32 "$TMPD"/c.gta > "$TMPD"/t.gta
+$GTA component-convert -n -c uint16,int8,uint8 "$TMPD"/t.gta > "$TMPD"/xc.gta
+cmp "$TMPD"/c.gta "$TMPD"/xc.gta
+
+# Normalized values that are sensitive to the precision of the division
+$GTA create -d 2 -c uint32,uint32,int32 -v 4294966655,4294967167,2147483583 "$TMPD"/n.gta
+$GTA create -d 2 -c float32,float32,float32 -v 0.999999821,0.99999994,0.99999994 "$TMPD"/fn.gta
+$GTA component-convert -n -c float32,float32,float32 "$TMPD"/n.gta > "$TMPD"/xfn.gta
+cmp "$TMPD"/fn.gta "$TMPD"/xfn.gta
+
 rm -r "$TMPD"
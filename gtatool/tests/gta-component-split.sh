@@ -26,6 +26,11 @@ $GTA component-split -d 0,3 "$TMPD"/all.gta > "$TMPD"/x12.gta
 cmp "$TMPD"/alls.gta "$TMPD"/xalls.gta
 cmp "$TMPD"/12.gta "$TMPD"/x12.gta
 
+$GTA fill -l 2,3 -h 5,8 -v 4,5,6,7 "$TMPD"/all.gta > "$TMPD"/e.gta
+$GTA component-split -d 1 "$TMPD"/e.gta "$TMPD"/all.gta > "$TMPD"/xe.gta
+cat "$TMPD"/e.gta "$TMPD"/all.gta | $GTA component-split -d 1 | cat > "$TMPD"/ye.gta
+cmp "$TMPD"/xe.gta "$TMPD"/ye.gta
+
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8,uint8 -n5 > "$TMPD"/empty1.gta
 $GTA create -c uint8 -n10 > "$TMPD"/empty2.gta
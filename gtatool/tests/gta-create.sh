@@ -25,4 +25,9 @@ LC_NUMERIC=C $GTA create -d 10 \
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
 
+# Output files are filled in parallel; compare to sequential output to a pipe
+$GTA create -d 1000,700 -c uint16,float32,uint8 -v 1,2.5,3 -n 3 "$TMPD"/c.gta
+$GTA create -d 1000,700 -c uint16,float32,uint8 -v 1,2.5,3 -n 3 | cat > "$TMPD"/d.gta
+cmp "$TMPD"/c.gta "$TMPD"/d.gta
+
 rm -r "$TMPD"
@@ -35,6 +35,17 @@ cmp "$TMPD"/g.gta "$TMPD"/a.gta
 cat "$TMPD"/b.gta | $GTA dimension-reorder -i 2,1,0 > "$TMPD"/h.gta
 cmp "$TMPD"/h.gta "$TMPD"/a.gta
 
+# Arrays that need more than one tile
+$GTA create -d 300,300,1 -c uint32 -v 1 "$TMPD"/t1.gta
+$GTA create -d 300,300,1 -c uint32 -v 2 "$TMPD"/t2.gta
+$GTA create -d 300,300,1 -c uint32 -v 3 "$TMPD"/t3.gta
+$GTA merge -d 2 "$TMPD"/t1.gta "$TMPD"/t2.gta "$TMPD"/t3.gta > "$TMPD"/t.gta
+$GTA dimension-reorder -i 2,0,1 "$TMPD"/t.gta > "$TMPD"/i.gta
+$GTA dimension-reorder -m 1 -i 2,0,1 "$TMPD"/t.gta > "$TMPD"/j.gta
+cmp "$TMPD"/i.gta "$TMPD"/j.gta
+$GTA dimension-reorder -m 1 -i 1,2,0 "$TMPD"/j.gta > "$TMPD"/k.gta
+cmp "$TMPD"/k.gta "$TMPD"/t.gta
+
 $GTA create -n5 > "$TMPD"/empty0.gta
 $GTA create -n5 -c uint8 > "$TMPD"/empty1.gta
 $GTA create -d 5,7,3 "$TMPD"/empty2.gta
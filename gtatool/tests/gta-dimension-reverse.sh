@@ -35,6 +35,15 @@ cmp "$TMPD"/e.gta "$TMPD"/a321.gta
 cat "$TMPD"/a123.gta | $GTA dimension-reverse -i 1 > "$TMPD"/f.gta
 cmp "$TMPD"/f.gta "$TMPD"/a321.gta
 
+# Arrays that need more than one tile
+$GTA create -d 300,1,300 -c uint32 -v 1 "$TMPD"/t1.gta
+$GTA create -d 300,2,300 -c uint32 -v 2 "$TMPD"/t2.gta
+$GTA create -d 300,3,300 -c uint32 -v 3 "$TMPD"/t3.gta
+$GTA merge -d 1 "$TMPD"/t1.gta "$TMPD"/t2.gta "$TMPD"/t3.gta > "$TMPD"/t123.gta
+$GTA merge -d 1 "$TMPD"/t3.gta "$TMPD"/t2.gta "$TMPD"/t1.gta > "$TMPD"/t321.gta
+$GTA dimension-reverse -m 1 -i 1 "$TMPD"/t123.gta > "$TMPD"/g.gta
+cmp "$TMPD"/g.gta "$TMPD"/t321.gta
+
 $GTA create -n5 > "$TMPD"/empty0.gta
 $GTA create -n5 -c uint8 > "$TMPD"/empty1.gta
 $GTA create -d 5,7,3 "$TMPD"/empty2.gta
@@ -25,6 +25,14 @@ $GTA create -n 7 -d 1 -c uint8 -v 42 "$TMPD"/d.gta
 $GTA dimension-split "$TMPD"/c.gta > "$TMPD"/xd.gta
 cmp "$TMPD"/xd.gta "$TMPD"/d.gta
 
+$GTA create -d 5,4,3 -c uint8,uint16 -v 1,2 "$TMPD"/e.gta
+$GTA fill -l 1,0,0 -h 2,3,1 -v 7,8 "$TMPD"/e.gta | $GTA fill -l 0,2,1 -h 4,3,2 -v 9,10 > "$TMPD"/f.gta
+for d in 0 1 2; do
+    $GTA dimension-split -d $d "$TMPD"/f.gta "$TMPD"/e.gta > "$TMPD"/xf.gta
+    cat "$TMPD"/f.gta "$TMPD"/e.gta | $GTA dimension-split -d $d | cat > "$TMPD"/yf.gta
+    cmp "$TMPD"/xf.gta "$TMPD"/yf.gta
+done
+
 $GTA create -d 5,3 "$TMPD"/empty1.gta
 $GTA create -n 3 -d 5 "$TMPD"/empty2.gta
 $GTA dimension-split "$TMPD"/empty1.gta > "$TMPD"/xempty2.gta
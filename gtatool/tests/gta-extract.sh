@@ -18,4 +18,18 @@ $GTA fill -l 3,3 -h 7,7 -v 117 < "$TMPD"/a.gta > "$TMPD"/c.gta
 $GTA extract -l 3,3 -h 7,7 < "$TMPD"/c.gta > "$TMPD"/d.gta
 cmp "$TMPD"/b.gta "$TMPD"/d.gta
 
+$GTA create -d 10,10,10 -c uint8 -v 42 "$TMPD"/a3.gta
+$GTA create -d 5,5,5 -c uint8 -v 117 "$TMPD"/b3.gta
+$GTA fill -l 3,3,3 -h 7,7,7 -v 117 < "$TMPD"/a3.gta > "$TMPD"/c3.gta
+
+$GTA extract -l 3,3,3 -h 7,7,7 "$TMPD"/c3.gta "$TMPD"/c3.gta > "$TMPD"/d3.gta
+$GTA stream-extract 1 < "$TMPD"/d3.gta > "$TMPD"/e3.gta
+cmp "$TMPD"/b3.gta "$TMPD"/e3.gta
+cat "$TMPD"/c3.gta | $GTA extract -l 3,3,3 -h 7,7,7 > "$TMPD"/f3.gta
+cmp "$TMPD"/b3.gta "$TMPD"/f3.gta
+
+$GTA extract -l 0,0,2 -h 9,9,8 "$TMPD"/c3.gta > "$TMPD"/g3.gta
+cat "$TMPD"/c3.gta | $GTA extract -l 0,0,2 -h 9,9,8 > "$TMPD"/h3.gta
+cmp "$TMPD"/g3.gta "$TMPD"/h3.gta
+
 rm -r "$TMPD"
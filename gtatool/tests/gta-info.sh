@@ -17,6 +17,12 @@ $GTA info --help 2> "$TMPD"/help.txt
 
 $GTA info "$TMPD"/a.gta "$TMPD"/a.gta "$TMPD"/a.gta 2> /dev/null
 $GTA info -s "$TMPD"/a.gta 2> /dev/null
+$GTA info -p 0,50,100 --histogram 4 "$TMPD"/a.gta 2> /dev/null
+
+$GTA create -d 100,100 -c uint16,float32 -v 1000,2.5 "$TMPD"/b.gta
+$GTA info -p 50 "$TMPD"/b.gta 2> "$TMPD"/b.txt
+grep -q "percentile 50 = 1000$" "$TMPD"/b.txt
+grep -q "percentile 50 = 2.5$" "$TMPD"/b.txt
 
 $GTA create -d 10 -n5 > "$TMPD"/empty0.gta
 $GTA create -c uint8 -n5 > "$TMPD"/empty1.gta
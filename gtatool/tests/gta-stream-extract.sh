@@ -39,4 +39,10 @@ cmp "$TMPD"/empty1.gta "$TMPD"/xempty1.gta
 $GTA stream-extract 0,4 "$TMPD"/empty2.gta > "$TMPD"/xempty3.gta
 cmp "$TMPD"/empty3.gta "$TMPD"/xempty3.gta
 
+# When reading from a pipe, the rest of the input is read even if no more arrays are selected
+$GTA create -d 100,100 -c float64 -n 1 > "$TMPD"/big1.gta
+$GTA create -d 100,100 -c float64 -n 20 | $GTA stream-extract 0 > "$TMPD"/xbig1.gta
+test "${PIPESTATUS[0]}" = 0
+cmp "$TMPD"/big1.gta "$TMPD"/xbig1.gta
+
 rm -r "$TMPD"
@@ -23,6 +23,16 @@ for i in 0 1 5 9; do
     cmp "$TMPD"/$i.gta "$TMPD"/x$i.gta
     $GTA stream-foreach "$GTA uncompress" < "$TMPD"/$i.gta > "$TMPD"/y$i.gta
     cmp "$TMPD"/$i.gta "$TMPD"/y$i.gta
+    $GTA stream-foreach -j 3 -k "$GTA uncompress" "$TMPD"/$i.gta > "$TMPD"/z$i.gta
+    cmp "$TMPD"/$i.gta "$TMPD"/z$i.gta
 done
 
+$GTA create -d 100,100 -c uint8 -n 20 "$TMPD"/20.gta
+$GTA stream-foreach -n 3 "$GTA tag --set-global=X=%I" "$TMPD"/20.gta > "$TMPD"/x20.gta
+$GTA stream-foreach -n 3 -j 4 -k "$GTA tag --set-global=X=%I" "$TMPD"/20.gta > "$TMPD"/y20.gta
+cmp "$TMPD"/x20.gta "$TMPD"/y20.gta
+$GTA stream-foreach -n 3 -j 4 "$GTA tag --set-global=X=%I" "$TMPD"/20.gta > "$TMPD"/z20.gta
+test `wc -c < "$TMPD"/x20.gta` = `wc -c < "$TMPD"/z20.gta`
+if $GTA stream-foreach -j 4 false "$TMPD"/20.gta > "$TMPD"/f20.gta 2> /dev/null; then false; fi
+
 rm -r "$TMPD"
@@ -23,6 +23,29 @@ for i in 0 1 5 9; do
     cmp "$TMPD"/$i.gta "$TMPD"/x$i.gta
     $GTA stream-grep "$GTA uncompress" < "$TMPD"/$i.gta > "$TMPD"/y$i.gta
     cmp "$TMPD"/$i.gta "$TMPD"/y$i.gta
+    $GTA stream-grep -j 3 -m 0 "$GTA uncompress" "$TMPD"/$i.gta > "$TMPD"/z$i.gta
+    cmp "$TMPD"/$i.gta "$TMPD"/z$i.gta
+    $GTA stream-grep -e 'index >= 0' "$TMPD"/$i.gta > "$TMPD"/e$i.gta
+    cmp "$TMPD"/$i.gta "$TMPD"/e$i.gta
 done
 
+$GTA create -d 10,10 -c uint8 -n 3 | $GTA stream-foreach "$GTA tag --set-global=X-INDEX=%I" > "$TMPD"/t.gta
+$GTA create -d 10,10 -c uint8 -n 1 | $GTA tag --set-global=X-INDEX=1 > "$TMPD"/t1.gta
+$GTA stream-grep -e 'global_tag("X-INDEX") == 1' "$TMPD"/t.gta > "$TMPD"/xt1.gta
+cmp "$TMPD"/t1.gta "$TMPD"/xt1.gta
+$GTA stream-grep -j 2 "$GTA tag --get-global=X-INDEX 2>&1 > /dev/null | grep -q X-INDEX=1" "$TMPD"/t.gta > "$TMPD"/yt1.gta
+cmp "$TMPD"/t1.gta "$TMPD"/yt1.gta
+$GTA stream-grep -e 'dimension_size(1) == 10 && component_type(0) == "uint8" && !(index == 0 || index > 1)' "$TMPD"/t.gta > "$TMPD"/zt1.gta
+cmp "$TMPD"/t1.gta "$TMPD"/zt1.gta
+$GTA stream-grep -e 'component_tag(0, "X") || dimension_size(2) == 10' "$TMPD"/t.gta > "$TMPD"/none.gta
+cmp /dev/null "$TMPD"/none.gta
+
+# Commands that only read their input after all commands were started must not
+# block each other, even if the arrays do not fit into a pipe buffer.
+$GTA create -d 300,300 -c uint8 -n 3 "$TMPD"/big.gta
+mkdir "$TMPD"/started
+export STARTED="$TMPD"/started
+$GTA stream-grep -j 3 'touch "$STARTED"/$$; n=0; while test `ls "$STARTED" | wc -l` -lt 3 -a $n -lt 10; do sleep 1; n=`expr $n + 1`; done; cat > /dev/null; test $n -lt 10' "$TMPD"/big.gta > "$TMPD"/xbig.gta
+cmp "$TMPD"/big.gta "$TMPD"/xbig.gta
+
 rm -r "$TMPD"
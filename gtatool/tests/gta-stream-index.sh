@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2013
+# Martin Lambers <marlam@marlam.de>
+#
+# Copying and distribution of this file, with or without modification, are
+# permitted in any medium without royalty provided the copyright notice and this
+# notice are preserved. This file is offered as-is, without any warranty.
+
+set -e
+
+TMPD="`mktemp -d tmp-\`basename $0 .sh\`.XXXXXX`"
+
+for i in 0 1 2 3 4 5 6 7 8 9; do
+	$GTA create -d 3,$((i + 1)) -c uint8 -v $i "$TMPD"/a$i.gta
+done
+$GTA stream-merge "$TMPD"/a[0-4].gta > "$TMPD"/s0.gta
+$GTA stream-merge "$TMPD"/a[5-9].gta > "$TMPD"/s1.gta
+cp "$TMPD"/s0.gta "$TMPD"/t0.gta
+cp "$TMPD"/s1.gta "$TMPD"/t1.gta
+
+$GTA stream-index --help 2> "$TMPD"/help.txt
+
+# Results must be the same with and without index
+$GTA stream-index "$TMPD"/t0.gta "$TMPD"/t1.gta
+test -f "$TMPD"/t0.gta.idx
+test -f "$TMPD"/t1.gta.idx
+for r in 0 7 9 3-6 -2 8- 1,4,8 0-9; do
+	$GTA stream-extract -- $r "$TMPD"/s0.gta "$TMPD"/s1.gta > "$TMPD"/x.gta
+	$GTA stream-extract -- $r "$TMPD"/t0.gta "$TMPD"/t1.gta > "$TMPD"/y.gta
+	cmp "$TMPD"/x.gta "$TMPD"/y.gta
+	$GTA stream-extract -d -- $r "$TMPD"/s0.gta "$TMPD"/s1.gta > "$TMPD"/x.gta
+	$GTA stream-extract -d -- $r "$TMPD"/t0.gta "$TMPD"/t1.gta > "$TMPD"/y.gta
+	cmp "$TMPD"/x.gta "$TMPD"/y.gta
+done
+$GTA stream-extract 7 "$TMPD"/t0.gta "$TMPD"/t1.gta > "$TMPD"/x7.gta
+cmp "$TMPD"/x7.gta "$TMPD"/a7.gta
+
+mkdir "$TMPD"/x "$TMPD"/y
+$GTA stream-split "$TMPD"/x/%2N.gta "$TMPD"/s0.gta "$TMPD"/s1.gta
+$GTA stream-split "$TMPD"/y/%2N.gta "$TMPD"/t0.gta "$TMPD"/t1.gta
+for i in 0 1 2 3 4 5 6 7 8 9; do
+	cmp "$TMPD"/x/0$i.gta "$TMPD"/y/0$i.gta
+done
+
+# An outdated index must be ignored, and refreshed by stream-index
+touch -d '2000-01-01' "$TMPD"/t0.gta.idx
+$GTA stream-merge "$TMPD"/a[4-8].gta > "$TMPD"/t0.gta
+$GTA stream-extract 3 "$TMPD"/t0.gta > "$TMPD"/x.gta
+cmp "$TMPD"/x.gta "$TMPD"/a7.gta
+$GTA stream-index "$TMPD"/t0.gta
+$GTA stream-extract 3 "$TMPD"/t0.gta > "$TMPD"/x.gta
+cmp "$TMPD"/x.gta "$TMPD"/a7.gta
+
+rm -r "$TMPD"
@@ -55,4 +55,144 @@ $GTA tag --unset-global=baz \
 	--unset-all "$PING" > "$PONG"
 cmp "$TMPD"/a.gta "$PONG"
 
+# MIN_VALUE and MAX_VALUE component tags, as set by tag and kept current by other commands.
+# check_tag <file> <cmp>,<name> <expected>, where <expected> is "=<value>" or " not set".
+check_tag()
+{
+    $GTA tag --get-component="$2" "$1" > /dev/null 2> "$TMPD"/tag.txt
+    grep -q "component ${2%%,*}: ${2#*,}$3\$" "$TMPD"/tag.txt
+}
+
+$GTA create -d 10,10 -c uint8,float32 -v 42,-1.5 "$TMPD"/b.gta
+$GTA tag --set-min-max=all "$TMPD"/b.gta > "$TMPD"/c.gta
+cat "$TMPD"/b.gta | $GTA tag --set-min-max=all > "$TMPD"/d.gta
+cmp "$TMPD"/c.gta "$TMPD"/d.gta
+check_tag "$TMPD"/c.gta 0,MIN_VALUE =42
+check_tag "$TMPD"/c.gta 1,MAX_VALUE =-1.5
+$GTA create -c uint8 > "$TMPD"/empty.gta
+$GTA tag --set-min-max=all "$TMPD"/empty.gta > "$TMPD"/e.gta
+cmp "$TMPD"/empty.gta "$TMPD"/e.gta
+# Ranges of 64 bit integers are only stored if double represents them exactly
+$GTA create -d 4 -c int64,uint64 -v 9007199254740993,18446744073709551615 | $GTA tag --set-min-max=all > "$TMPD"/mm0.gta
+check_tag "$TMPD"/mm0.gta 0,MAX_VALUE " not set"
+check_tag "$TMPD"/mm0.gta 1,MAX_VALUE " not set"
+$GTA create -d 4 -c int64,uint64 -v -9007199254740991,9007199254740991 | $GTA tag --set-min-max=all > "$TMPD"/mm1.gta
+check_tag "$TMPD"/mm1.gta 0,MIN_VALUE =-9007199254740991
+check_tag "$TMPD"/mm1.gta 1,MAX_VALUE =9007199254740991
+# resize: tags are kept, extended by the fill value, or removed
+$GTA create -d 10,10 -c uint8,int16 -v 42,-7 | $GTA tag --set-min-max=all > "$TMPD"/mm2.gta
+$GTA resize -d 10,10 "$TMPD"/mm2.gta > "$TMPD"/mm3.gta
+check_tag "$TMPD"/mm3.gta 0,MIN_VALUE =42
+check_tag "$TMPD"/mm3.gta 1,MAX_VALUE =-7
+$GTA resize -d 12,10 -v 200,5 "$TMPD"/mm2.gta > "$TMPD"/mm4.gta
+check_tag "$TMPD"/mm4.gta 0,MIN_VALUE =42
+check_tag "$TMPD"/mm4.gta 0,MAX_VALUE =200
+check_tag "$TMPD"/mm4.gta 1,MIN_VALUE =-7
+check_tag "$TMPD"/mm4.gta 1,MAX_VALUE =5
+$GTA resize -d 5,5 "$TMPD"/mm2.gta > "$TMPD"/mm5.gta
+check_tag "$TMPD"/mm5.gta 0,MIN_VALUE " not set"
+check_tag "$TMPD"/mm5.gta 1,MAX_VALUE " not set"
+$GTA resize -d 12,12 -i -1,0 "$TMPD"/mm2.gta > "$TMPD"/mm6.gta
+check_tag "$TMPD"/mm6.gta 0,MIN_VALUE " not set"
+# fill: constant tags if all elements are filled, otherwise removed
+$GTA fill -v 9,-3 "$TMPD"/mm2.gta > "$TMPD"/mm7.gta
+check_tag "$TMPD"/mm7.gta 0,MAX_VALUE =9
+check_tag "$TMPD"/mm7.gta 1,MIN_VALUE =-3
+$GTA fill -l 0,0 -h 1,1 -v 9,-3 "$TMPD"/mm2.gta > "$TMPD"/mm8.gta
+check_tag "$TMPD"/mm8.gta 0,MAX_VALUE " not set"
+check_tag "$TMPD"/mm8.gta 1,MIN_VALUE " not set"
+# component-set: constant tags for the components that are set
+$GTA component-set -i 1 -v 5 "$TMPD"/mm2.gta > "$TMPD"/mm9.gta
+check_tag "$TMPD"/mm9.gta 0,MAX_VALUE =42
+check_tag "$TMPD"/mm9.gta 1,MIN_VALUE =5
+check_tag "$TMPD"/mm9.gta 1,MAX_VALUE =5
+# merge and dimension-merge: union of the ranges, removed if an input has no tags
+$GTA create -d 10,10 -c uint8,int16 -v 7,100 | $GTA tag --set-min-max=all > "$TMPD"/mm10.gta
+$GTA create -d 10,10 -c uint8,int16 -v 7,100 > "$TMPD"/mm11.gta
+$GTA merge -d 1 "$TMPD"/mm2.gta "$TMPD"/mm10.gta > "$TMPD"/mm12.gta
+check_tag "$TMPD"/mm12.gta 0,MIN_VALUE =7
+check_tag "$TMPD"/mm12.gta 0,MAX_VALUE =42
+check_tag "$TMPD"/mm12.gta 1,MIN_VALUE =-7
+check_tag "$TMPD"/mm12.gta 1,MAX_VALUE =100
+$GTA merge -d 1 "$TMPD"/mm2.gta "$TMPD"/mm11.gta > "$TMPD"/mm13.gta
+check_tag "$TMPD"/mm13.gta 0,MIN_VALUE " not set"
+check_tag "$TMPD"/mm13.gta 1,MAX_VALUE " not set"
+$GTA dimension-merge "$TMPD"/mm2.gta "$TMPD"/mm10.gta > "$TMPD"/mm14.gta
+check_tag "$TMPD"/mm14.gta 0,MIN_VALUE =7
+check_tag "$TMPD"/mm14.gta 1,MAX_VALUE =100
+$GTA dimension-merge "$TMPD"/mm2.gta "$TMPD"/mm11.gta > "$TMPD"/mm15.gta
+check_tag "$TMPD"/mm15.gta 0,MIN_VALUE " not set"
+check_tag "$TMPD"/mm15.gta 1,MAX_VALUE " not set"
+# component-convert: tags are converted, or removed for complex types, float to
+# integer conversion, overflow, and values that the source type cannot represent
+$GTA create -d 4 -c int16,uint16,float32,float64,cfloat32 -v -7,40000,1.5,2.5,1,2 | $GTA tag --set-min-max=all > "$TMPD"/mm16.gta
+$GTA tag --set-component=2,MIN_VALUE=0.1 --set-component=3,MIN_VALUE=0.1 --set-component=3,MAX_VALUE=0.1 "$TMPD"/mm16.gta > "$TMPD"/mm17.gta
+$GTA component-convert -c int32,uint16,float64,float64,cfloat64 "$TMPD"/mm16.gta > "$TMPD"/mm18.gta
+check_tag "$TMPD"/mm18.gta 0,MIN_VALUE =-7
+check_tag "$TMPD"/mm18.gta 2,MAX_VALUE =1.5
+$GTA component-convert -c float32,int16,int32,float32,cfloat64 "$TMPD"/mm16.gta > "$TMPD"/mm19.gta
+check_tag "$TMPD"/mm19.gta 0,MIN_VALUE =-7
+check_tag "$TMPD"/mm19.gta 1,MAX_VALUE " not set"
+check_tag "$TMPD"/mm19.gta 2,MIN_VALUE " not set"
+check_tag "$TMPD"/mm19.gta 3,MAX_VALUE =2.5
+$GTA component-convert -c int16,uint16,float64,float32,cfloat64 "$TMPD"/mm17.gta > "$TMPD"/mm20.gta
+check_tag "$TMPD"/mm20.gta 2,MIN_VALUE " not set"
+check_tag "$TMPD"/mm20.gta 3,MAX_VALUE =0.10000000149011612
+$GTA component-convert -n -c float32,float32,float32,float64,cfloat32 "$TMPD"/mm16.gta > "$TMPD"/mm21.gta
+check_tag "$TMPD"/mm21.gta 1,MIN_VALUE =0.61036086082458496
+check_tag "$TMPD"/mm21.gta 1,MAX_VALUE =0.61036086082458496
+$GTA component-convert -c cfloat32,uint16,float32,float64,cfloat32 "$TMPD"/mm16.gta > "$TMPD"/mm22.gta
+check_tag "$TMPD"/mm22.gta 0,MIN_VALUE " not set"
+check_tag "$TMPD"/mm22.gta 4,MAX_VALUE " not set"
+
+# In-place mode: headers with enough padding are rewritten without changing the file size
+$GTA create -d 100,100 -c uint16,int8 -v 7,-3 -n 2 "$TMPD"/f.gta
+$GTA tag --padding=1000 "$TMPD"/f.gta > "$TMPD"/g.gta
+$GTA tag --padding=0 "$TMPD"/g.gta > "$TMPD"/h.gta
+cmp "$TMPD"/f.gta "$TMPD"/h.gta
+SIZE="`wc -c < "$TMPD"/g.gta`"
+$GTA tag -i --set-global=foo=bar --set-component=1,X-CMP=baz --set-min-max=0 "$TMPD"/g.gta
+test "`wc -c < "$TMPD"/g.gta`" = "$SIZE"
+$GTA tag --set-global=foo=bar --set-component=1,X-CMP=baz --set-min-max=0 "$TMPD"/f.gta > "$TMPD"/i.gta
+$GTA tag --padding=0 "$TMPD"/g.gta > "$TMPD"/j.gta
+cmp "$TMPD"/i.gta "$TMPD"/j.gta
+$GTA tag -i --unset-all "$TMPD"/g.gta
+test "`wc -c < "$TMPD"/g.gta`" = "$SIZE"
+$GTA tag --padding=0 "$TMPD"/g.gta > "$TMPD"/j.gta
+cmp "$TMPD"/f.gta "$TMPD"/j.gta
+
+# In-place mode: headers that do not fit cause the file to be rewritten with padding
+cp "$TMPD"/f.gta "$TMPD"/k.gta
+$GTA tag --in-place --set-global=foo=bar --set-component=1,X-CMP=baz --set-min-max=0 "$TMPD"/k.gta
+test "`wc -c < "$TMPD"/k.gta`" -gt "`wc -c < "$TMPD"/f.gta`"
+$GTA tag --padding=0 "$TMPD"/k.gta > "$TMPD"/j.gta
+cmp "$TMPD"/i.gta "$TMPD"/j.gta
+SIZE="`wc -c < "$TMPD"/k.gta`"
+test $(( (SIZE - 30000) % 4096 )) = 0
+$GTA tag -i --set-global=DESCRIPTION="a longer tag that now fits into the padding" "$TMPD"/k.gta
+test "`wc -c < "$TMPD"/k.gta`" = "$SIZE"
+$GTA tag --get-global=DESCRIPTION --get-global=GTA/PADDING "$TMPD"/k.gta > "$TMPD"/devnull.gta 2> "$TMPD"/out5.txt
+grep -q "DESCRIPTION=a longer tag that now fits into the padding$" "$TMPD"/out5.txt
+grep -q "GTA/PADDING not set$" "$TMPD"/out5.txt
+# The padding tag cannot be set, and failures leave the file unchanged
+cp "$TMPD"/k.gta "$TMPD"/n.gta
+if $GTA tag -i --set-global=GTA/PADDING=x "$TMPD"/n.gta 2> /dev/null; then false; fi
+if $GTA tag --set-global=GTA/PADDING=x "$TMPD"/n.gta > "$TMPD"/o.gta 2> /dev/null; then false; fi
+cmp "$TMPD"/k.gta "$TMPD"/n.gta
+
+# In-place mode: rewriting a file keeps symbolic links, permissions, and other files
+cp "$TMPD"/f.gta "$TMPD"/l.gta
+chmod 640 "$TMPD"/l.gta
+ln -s l.gta "$TMPD"/m.gta
+echo "other" > "$TMPD"/l.gta.tmp
+echo "other" > "$TMPD"/m.gta.tmp
+$GTA tag -i --set-global=foo=bar --set-component=1,X-CMP=baz --set-min-max=0 "$TMPD"/m.gta
+test -L "$TMPD"/m.gta
+test "`ls -l "$TMPD"/l.gta | cut -c 1-10`" = "-rw-r-----"
+echo "other" | cmp - "$TMPD"/l.gta.tmp
+echo "other" | cmp - "$TMPD"/m.gta.tmp
+test -z "`ls "$TMPD" | grep tmp-`"
+$GTA tag --padding=0 "$TMPD"/l.gta > "$TMPD"/j.gta
+cmp "$TMPD"/i.gta "$TMPD"/j.gta
+
 rm -r "$TMPD"
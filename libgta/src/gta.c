@@ -33,6 +33,9 @@
 #ifndef _MSC_VER
 #   include <unistd.h>
 #endif
+#ifdef HAVE_PREADV
+#   include <sys/uio.h>
+#endif
 
 #if WITH_COMPRESSION
 #   include <zlib.h>
@@ -45,6 +48,9 @@
 #   endif
 #   include <lzma.h>
 #endif
+#ifdef HAVE_PTHREAD
+#   include <pthread.h>
+#endif
 
 #define GTA_BUILD
 #include "gta/gta.h"
@@ -92,7 +98,16 @@
 
 /* The maximum size of a chunk. Changing this will break compatibility! */
 static const size_t gta_max_chunk_size = 16 * 1024 * 1024;
-/* The buffer size increment when filling buffers with an unknown number of elements. */
+/* The name of the global tag that reserves header space for later modifications.
+ * Changing this will break compatibility! */
+static const char gta_padding_tag_name[] = "GTA/PADDING";
+/* Tag list storage is shared between copies of a tag list if the compiler provides
+ * atomic operations for the reference count. Otherwise, copies are deep copies. */
+#if defined(__ATOMIC_ACQ_REL)
+#   define GTA_SHARED_TAGLISTS 1
+#endif
+/* The initial buffer size when filling buffers with an unknown number of elements.
+ * Such buffers grow geometrically from there. */
 static const size_t gta_bufsize_inc = 256;
 
 
@@ -138,13 +153,31 @@ struct gta_internal_taglist_struct
      * were set (which is not strictly necessary, but nice), and that a tag list
      * can be searched for specific entries via fast binary search nevertheless.
      * We keep track of the total size that the tag list requires when written
-     * to a GTA file in the encoded_size value. */
+     * to a GTA file in the encoded_size value.
+     * The arrays and the strings they point to may be shared by copies of the
+     * tag list, e.g. after a header was cloned. The number of tag lists that
+     * share them is stored in refcount. Shared storage is copied before it is
+     * modified. */
     ssize_t entries;
     size_t size;
     char **names;
     char **values;
     ssize_t *sorted;
     size_t encoded_size;
+    size_t *refcount;
+};
+
+struct gta_tag_ref
+{
+    const char *name;           // Name of a tag list entry
+    ssize_t index;              // Index of the entry in the tag list
+};
+
+struct gta_swap_run
+{
+    uintmax_t offset;           // Offset of the run inside the element
+    size_t count;               // Number of consecutive values in the run
+    uint8_t size;               // Size of each value: 2, 4, 8, or 16
 };
 
 struct gta_internal_header_struct
@@ -159,21 +192,47 @@ struct gta_internal_header_struct
     uintmax_t *component_blob_sizes;
     gta_taglist_t **component_taglists;
     uintmax_t element_size;
+    size_t swap_runs;           // Number of runs of values whose endianness must be swapped
+    struct gta_swap_run *swap_plan; // These runs, in element order
+
+    uintmax_t padding;          // Encoded size of the padding tag, or 0 if there is none
 
     size_t dimensions;
     uintmax_t *dimension_sizes;
     gta_taglist_t **dimension_taglists;
 };
 
+struct gta_chunk_buffers
+{
+    void *chunk;                // Buffer for an uncompressed chunk
+    size_t chunk_alloc;         // Allocated size of chunk
+    void *stored;               // Buffer for a compressed chunk as stored in the input
+    size_t stored_alloc;        // Allocated size of stored
+};
+
 struct gta_internal_io_state_struct
 {
     int io_type;                // 0 = undecided, 1 = input, 2 = output
     bool failure;               // Failure flag. When set, no further actions are performed.
     uintmax_t counter;          // Number of elements that were already read or written.
-    void *chunk;                // The current chunk (if GTA is compressed) of buffer (if uncompressed)
+    struct gta_chunk_buffers buffers; // Reusable buffers for the current chunk (if GTA is compressed) or buffer (if uncompressed)
     size_t chunk_size;          // Size of the chunk
     size_t chunk_index;         // Current index inside the chunk
-    uintmax_t already_read;     // Only for input of uncompressed GTA: number of bytes that were already read
+    uintmax_t already_read;     // Only for input: number of (uncompressed) data bytes that were already read
+    uintmax_t lent;             // Number of elements lent to the caller and not yet committed
+    bool lent_from_buf;         // Whether the lent element is in lend_buf instead of the chunk
+    void *lend_buf;             // Buffer for a lent element that crosses a chunk boundary
+    size_t lend_buf_size;       // Size of lend_buf
+    struct gta_io_job *job;     // Background input/output, or NULL if input/output is synchronous
+};
+
+struct gta_internal_stream_index_struct
+{
+    uintmax_t arrays;           // Number of indexed arrays
+    size_t size;                // Allocated number of entries
+    uintmax_t *header_offsets;  // Offset of the header of each array
+    uintmax_t *data_offsets;    // Offset of the data of each array
+    uintmax_t end;              // Offset of the end of the last array
 };
 
 
@@ -378,6 +437,52 @@ exit:
 }
 
 
+/*
+ *
+ * Reusable Buffers
+ *
+ */
+
+
+/* Make sure that the buffer holds at least size bytes. Its contents are not preserved. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_buffer(void **buf, size_t *buf_alloc, size_t size)
+{
+    if (*buf_alloc < size)
+    {
+        free(*buf);
+        *buf_alloc = 0;
+        *buf = malloc(size);
+        if (!*buf)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        *buf_alloc = size;
+    }
+    return GTA_OK;
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_init_chunk_buffers(struct gta_chunk_buffers *buffers)
+{
+    buffers->chunk = NULL;
+    buffers->chunk_alloc = 0;
+    buffers->stored = NULL;
+    buffers->stored_alloc = 0;
+}
+
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_free_chunk_buffers(struct gta_chunk_buffers *buffers)
+{
+    free(buffers->chunk);
+    free(buffers->stored);
+    gta_init_chunk_buffers(buffers);
+}
+
+
 /*
  *
  * Compression and Decompression
@@ -385,21 +490,20 @@ exit:
  */
 
 
+/* Compress into the reusable buffer dst, which has the allocated size dst_alloc. */
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
 gta_result_t
-gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta_compression_t compression)
+gta_compress(void **dst, size_t *dst_alloc, size_t *dst_size, const void *src, size_t src_size, gta_compression_t compression)
 {
-    void* tmp_ptr;
     gta_result_t retval = GTA_OK;
 
     switch (compression)
     {
     case GTA_NONE:
         {
-            *dst = malloc(src_size);
-            if (!*dst)
+            retval = gta_reserve_buffer(dst, dst_alloc, src_size);
+            if (retval != GTA_OK)
             {
-                retval = GTA_SYSTEM_ERROR;
                 break;
             }
             memcpy(*dst, src, src_size);
@@ -447,16 +551,14 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 retval = GTA_OVERFLOW;
                 break;
             }
-            *dst = malloc(zlib_compressed_size);
-            if (!*dst)
+            retval = gta_reserve_buffer(dst, dst_alloc, zlib_compressed_size);
+            if (retval != GTA_OK)
             {
-                retval = GTA_SYSTEM_ERROR;
                 break;
             }
             zlib_r = compress2(*dst, &zlib_compressed_size, src, zlib_uncompressed_size, zlib_level);
             if (zlib_r != Z_OK)
             {
-                free(*dst);
                 // of the possible errors Z_MEM_ERROR, Z_BUF_ERROR, Z_STREAM_ERROR,
                 // only Z_MEM_ERROR can happen here
                 errno = ENOMEM;
@@ -464,14 +566,6 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 break;
             }
             *dst_size = zlib_compressed_size;
-            tmp_ptr = realloc(*dst, *dst_size);
-            if (!tmp_ptr)
-            {
-                free(*dst);
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
-            *dst = tmp_ptr;
         }
         break;
 
@@ -491,10 +585,9 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 retval = GTA_OVERFLOW;
                 break;
             }
-            *dst = malloc(bz2_compressed_size);
-            if (!*dst)
+            retval = gta_reserve_buffer(dst, dst_alloc, bz2_compressed_size);
+            if (retval != GTA_OK)
             {
-                retval = GTA_SYSTEM_ERROR;
                 break;
             }
             int r = BZ2_bzBuffToBuffCompress(
@@ -510,21 +603,12 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 break;
             }
             *dst_size = bz2_compressed_size;
-            tmp_ptr = realloc(*dst, *dst_size);
-            if (!tmp_ptr)
-            {
-                free(*dst);
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
-            *dst = tmp_ptr;
         }
         break;
 
     case GTA_XZ:
         {
             lzma_stream strm = LZMA_STREAM_INIT;
-            void *buf;
             size_t buf_size;
             lzma_ret r;
 
@@ -534,15 +618,14 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 retval = GTA_OVERFLOW;
                 break;
             }
-            buf = malloc(buf_size);
-            if (!buf)
+            retval = gta_reserve_buffer(dst, dst_alloc, buf_size);
+            if (retval != GTA_OK)
             {
-                retval = GTA_SYSTEM_ERROR;
                 break;
             }
             strm.next_in = src;
             strm.avail_in = src_size;
-            strm.next_out = buf;
+            strm.next_out = *dst;
             strm.avail_out = buf_size;
             r = lzma_easy_encoder(&strm, LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE);
             if (r != LZMA_OK)
@@ -568,14 +651,6 @@ gta_compress(void **dst, size_t *dst_size, const void *src, size_t src_size, gta
                 break;
             }
             *dst_size = strm.total_out;
-            *dst = realloc(buf, *dst_size);
-            if (!*dst)
-            {
-                free(buf);
-                lzma_end(&strm);
-                retval = GTA_SYSTEM_ERROR;
-                break;
-            }
             lzma_end(&strm);
         }
         break;
@@ -819,114 +894,205 @@ gta_swap_endianness_128(void *GTA_RESTRICT ptr)
 }
 
 /**
- * \brief               Swap the endianness of a component.
- * \param header        The header.
- * \param i             The component index.
- * \param component     The component.
+ * \brief               Swap the endianness of consecutive values.
+ * \param ptr           The first value.
+ * \param size          The size of each value: 2, 4, 8, or 16.
+ * \param stride        The distance between the start of two values.
+ * \param n             The number of values.
  *
- * Swaps the endianness of a the given component.\n
- * Components of type \a GTA_BLOB are assumed to be independent of endianness,
- * and are therefore not altered.
+ * The loops are kept free of anything but the swapping itself so that the compiler
+ * can turn them into byte swap instructions or vectorize them.
  */
-static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 void
-gta_swap_component_endianness(const gta_header_t *header, uintmax_t i, void *GTA_RESTRICT component)
+gta_swap_endianness_n(void *GTA_RESTRICT ptr, uint8_t size, size_t stride, size_t n)
 {
-    switch (header->component_types[i])
+    char *p = ptr;
+    switch (size)
     {
-    case GTA_BLOB:
-    case GTA_INT8:
-    case GTA_UINT8:
-        break;
-    case GTA_INT16:
-    case GTA_UINT16:
-        gta_swap_endianness_16(component);
-        break;
-    case GTA_INT32:
-    case GTA_UINT32:
-    case GTA_FLOAT32:
-        gta_swap_endianness_32(component);
-        break;
-    case GTA_INT64:
-    case GTA_UINT64:
-    case GTA_FLOAT64:
-        gta_swap_endianness_64(component);
-        break;
-    case GTA_INT128:
-    case GTA_UINT128:
-    case GTA_FLOAT128:
-        gta_swap_endianness_128(component);
+    case 2:
+        for (size_t i = 0; i < n; i++)
+        {
+            gta_swap_endianness_16(p + i * stride);
+        }
         break;
-    case GTA_CFLOAT32:
-        gta_swap_endianness_32(component);
-        gta_swap_endianness_32((char *)component + 4);
+    case 4:
+        for (size_t i = 0; i < n; i++)
+        {
+            gta_swap_endianness_32(p + i * stride);
+        }
         break;
-    case GTA_CFLOAT64:
-        gta_swap_endianness_64(component);
-        gta_swap_endianness_64((char *)component + 8);
+    case 8:
+        for (size_t i = 0; i < n; i++)
+        {
+            gta_swap_endianness_64(p + i * stride);
+        }
         break;
-    case GTA_CFLOAT128:
-        gta_swap_endianness_128(component);
-        gta_swap_endianness_128((char *)component + 16);
+    case 16:
+        for (size_t i = 0; i < n; i++)
+        {
+            gta_swap_endianness_128(p + i * stride);
+        }
         break;
     }
 }
 
 /**
- * \brief               Swap the endianness of an array element.
- * \param header        The header.
- * \param element       The array element.
+ * \brief               Compute the endianness swapping plan for an element.
+ * \param n             The number of components.
+ * \param types         The component types.
+ * \param runs          The number of runs in the plan.
+ * \param plan          The plan.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
  *
- * This function corrects the endianness for all components of the given array element.\n
+ * The plan describes where the values that need endianness swapping are located
+ * inside an element. Adjacent values of the same size are merged into runs, so that
+ * e.g. an element with three GTA_FLOAT32 components results in a single run.
  * Components of type \a GTA_BLOB are assumed to be independent of endianness,
- * and are therefore not altered.
+ * and are therefore not part of the plan.
  */
-static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
-void
-gta_swap_element_endianness(const gta_header_t *header, void *GTA_RESTRICT element)
+static GTA_ATTR_NONNULL2(4, 5) GTA_ATTR_NOTHROW
+gta_result_t
+gta_create_swap_plan(size_t n, const uint8_t *GTA_RESTRICT types, const uintmax_t *GTA_RESTRICT blob_sizes,
+        size_t *GTA_RESTRICT runs, struct gta_swap_run **GTA_RESTRICT plan)
 {
-    char *ptr = element;
+    struct gta_swap_run *my_plan = NULL;
+    size_t my_runs = 0;
+    uintmax_t offset = 0;
     size_t blob_size_index = 0;
-    for (uintmax_t i = 0; i < header->components; i++)
+
+    if (n > 0)
+    {
+        my_plan = malloc(n * sizeof(struct gta_swap_run));
+        if (!my_plan)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    for (size_t i = 0; i < n; i++)
     {
-        gta_swap_component_endianness(header, i, ptr);
-        switch (header->component_types[i])
+        uint8_t value_size = 0;
+        size_t values = 1;
+        uintmax_t size;
+        switch (types[i])
         {
         case GTA_BLOB:
-            ptr += header->component_blob_sizes[blob_size_index++];
+            size = blob_sizes[blob_size_index++];
             break;
         case GTA_INT8:
         case GTA_UINT8:
-            ptr += 1;
+            size = 1;
             break;
         case GTA_INT16:
         case GTA_UINT16:
-            ptr += 2;
+            value_size = 2;
+            size = 2;
             break;
         case GTA_INT32:
         case GTA_UINT32:
         case GTA_FLOAT32:
-            ptr += 4;
+            value_size = 4;
+            size = 4;
             break;
         case GTA_INT64:
         case GTA_UINT64:
         case GTA_FLOAT64:
-        case GTA_CFLOAT32:
-            ptr += 8;
+            value_size = 8;
+            size = 8;
             break;
         case GTA_INT128:
         case GTA_UINT128:
         case GTA_FLOAT128:
+            value_size = 16;
+            size = 16;
+            break;
+        case GTA_CFLOAT32:
+            value_size = 4;
+            values = 2;
+            size = 8;
+            break;
         case GTA_CFLOAT64:
-            ptr += 16;
+            value_size = 8;
+            values = 2;
+            size = 16;
             break;
         case GTA_CFLOAT128:
-            ptr += 32;
+        default:
+            value_size = 16;
+            values = 2;
+            size = 32;
             break;
         }
+        if (value_size > 0)
+        {
+            if (my_runs > 0 && my_plan[my_runs - 1].size == value_size
+                    && my_plan[my_runs - 1].offset + my_plan[my_runs - 1].count * value_size == offset)
+            {
+                my_plan[my_runs - 1].count += values;
+            }
+            else
+            {
+                my_plan[my_runs].offset = offset;
+                my_plan[my_runs].count = values;
+                my_plan[my_runs].size = value_size;
+                my_runs++;
+            }
+        }
+        offset += size;
     }
+    if (my_runs == 0)
+    {
+        free(my_plan);
+        my_plan = NULL;
+    }
+    *runs = my_runs;
+    *plan = my_plan;
+    return GTA_OK;
 }
 
+/**
+ * \brief               Swap the endianness of array elements.
+ * \param header        The header.
+ * \param elements      The array elements.
+ * \param n             The number of elements.
+ *
+ * This function corrects the endianness for all components of the given array elements,
+ * according to the swapping plan of the header.\n
+ * If all components have the same size and need swapping, the elements are treated as
+ * one long run of values. Otherwise, each run of the plan is processed for each element.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_swap_elements_endianness(const gta_header_t *header, void *GTA_RESTRICT elements, size_t n)
+{
+    const struct gta_swap_run *plan = header->swap_plan;
+    size_t element_size = header->element_size;
+    char *ptr = elements;
+
+    if (header->swap_runs == 0)
+    {
+        // Nothing to do, e.g. for elements that consist only of bytes and blobs
+    }
+    else if (header->swap_runs == 1 && plan[0].count * plan[0].size == element_size)
+    {
+        gta_swap_endianness_n(ptr, plan[0].size, plan[0].size, n * plan[0].count);
+    }
+    else if (header->swap_runs == 1 && plan[0].count == 1)
+    {
+        gta_swap_endianness_n(ptr + plan[0].offset, plan[0].size, element_size, n);
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t j = 0; j < header->swap_runs; j++)
+            {
+                gta_swap_endianness_n(ptr + plan[j].offset, plan[j].size, plan[j].size, plan[j].count);
+            }
+            ptr += element_size;
+        }
+    }
+}
 
 /*
  *
@@ -936,39 +1102,85 @@ gta_swap_element_endianness(const gta_header_t *header, void *GTA_RESTRICT eleme
 
 
 /**
- * \brief               Read a data chunk.
+ * \brief               Read exactly the given number of bytes.
+ * \param buf           The buffer.
+ * \param size          The number of bytes.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(3)
+gta_result_t
+gta_read_fully(void *GTA_RESTRICT buf, size_t size, gta_read_t read_fn, intptr_t userdata)
+{
+    int error = false;
+    size_t r = read_fn(userdata, buf, size, &error);
+    if (error)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    if (r < size)
+    {
+        return GTA_UNEXPECTED_EOF;
+    }
+    return GTA_OK;
+}
+
+/**
+ * \brief               Write exactly the given number of bytes.
+ * \param buf           The buffer.
+ * \param size          The number of bytes.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL1(3)
+gta_result_t
+gta_write_fully(const void *GTA_RESTRICT buf, size_t size, gta_write_t write_fn, intptr_t userdata)
+{
+    int error = false;
+    errno = 0;
+    size_t r = write_fn(userdata, buf, size, &error);
+    if (error || r < size)
+    {
+        if (errno == 0)
+        {
+            errno = EIO;
+        }
+        return GTA_SYSTEM_ERROR;
+    }
+    return GTA_OK;
+}
+
+/**
+ * \brief               Read the sizes and the compression of a data chunk.
  * \param header        The header.
- * \param chunk         The buffer for the chunk (will be allocated).
- * \param chunk_size    The size of the chunk.
+ * \param compression   The compression of the chunk.
+ * \param stored_size   The size of the chunk as stored.
+ * \param chunk_size    The size of the uncompressed chunk.
  * \param read_fn       The custom input function.
  * \param userdata      A parameter to the custom input function.
- * \return              \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * The stored chunk follows in the input; it has to be read by the caller.
+ * The last, empty chunk has size zero and nothing follows it.
  */
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
-gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
-        void *GTA_RESTRICT *chunk, size_t *chunk_size,
-        gta_read_t read_fn, intptr_t userdata)
+gta_read_chunk_head(const gta_header_t *GTA_RESTRICT header, gta_compression_t *compression,
+        size_t *stored_size, size_t *chunk_size, gta_read_t read_fn, intptr_t userdata)
 {
-    int error = false;
     uint64_t size_uncompressed;
-    uint8_t compression;
+    uint8_t chunk_compression;
     uint64_t size_compressed;
-    void *chunk_compressed = NULL;
     gta_result_t retval = GTA_OK;
-    size_t r;
 
-    *chunk = NULL;
+    *compression = GTA_NONE;
+    *stored_size = 0;
     *chunk_size = 0;
-    r = read_fn(userdata, &size_uncompressed, sizeof(uint64_t), &error);
-    if (error)
-    {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
-    }
-    if (r < sizeof(uint64_t))
+    retval = gta_read_fully(&size_uncompressed, sizeof(uint64_t), read_fn, userdata);
+    if (retval != GTA_OK)
     {
-        retval = GTA_UNEXPECTED_EOF;
         goto exit;
     }
     if (gta_data_needs_endianness_swapping(header))
@@ -986,67 +1198,38 @@ gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
         retval = GTA_OK;
         goto exit;
     }
-    *chunk_size = size_uncompressed;
-    *chunk = malloc(*chunk_size);
-    if (!*chunk)
-    {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
-    }
-    r = read_fn(userdata, &compression, sizeof(uint8_t), &error);
-    if (error)
-    {
-        retval = GTA_SYSTEM_ERROR;
-        goto exit;
-    }
-    if (r < sizeof(uint8_t))
+    retval = gta_read_fully(&chunk_compression, sizeof(uint8_t), read_fn, userdata);
+    if (retval != GTA_OK)
     {
-        retval = GTA_UNEXPECTED_EOF;
         goto exit;
     }
-    if (compression != GTA_NONE
-            && compression != GTA_ZLIB
-            && compression != GTA_ZLIB1
-            && compression != GTA_ZLIB2
-            && compression != GTA_ZLIB3
-            && compression != GTA_ZLIB4
-            && compression != GTA_ZLIB5
-            && compression != GTA_ZLIB6
-            && compression != GTA_ZLIB7
-            && compression != GTA_ZLIB8
-            && compression != GTA_ZLIB9
-            && compression != GTA_BZIP2
-            && compression != GTA_XZ)
+    if (chunk_compression != GTA_NONE
+            && chunk_compression != GTA_ZLIB
+            && chunk_compression != GTA_ZLIB1
+            && chunk_compression != GTA_ZLIB2
+            && chunk_compression != GTA_ZLIB3
+            && chunk_compression != GTA_ZLIB4
+            && chunk_compression != GTA_ZLIB5
+            && chunk_compression != GTA_ZLIB6
+            && chunk_compression != GTA_ZLIB7
+            && chunk_compression != GTA_ZLIB8
+            && chunk_compression != GTA_ZLIB9
+            && chunk_compression != GTA_BZIP2
+            && chunk_compression != GTA_XZ)
     {
         retval = GTA_UNSUPPORTED_DATA;
         goto exit;
     }
-    if (compression == GTA_NONE)
+    if (chunk_compression == GTA_NONE)
     {
-        r = read_fn(userdata, *chunk, *chunk_size, &error);
-        if (error)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        if (r < *chunk_size)
-        {
-            retval = GTA_UNEXPECTED_EOF;
-            goto exit;
-        }
+        size_compressed = size_uncompressed;
     }
     else
     {
 #if WITH_COMPRESSION
-        r = read_fn(userdata, &size_compressed, sizeof(uint64_t), &error);
-        if (error)
+        retval = gta_read_fully(&size_compressed, sizeof(uint64_t), read_fn, userdata);
+        if (retval != GTA_OK)
         {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        if (r < sizeof(uint64_t))
-        {
-            retval = GTA_UNEXPECTED_EOF;
             goto exit;
         }
         if (gta_data_needs_endianness_swapping(header))
@@ -1065,48 +1248,403 @@ gta_read_chunk(const gta_header_t *GTA_RESTRICT header,
             retval = GTA_INVALID_DATA;
             goto exit;
         }
-        chunk_compressed = malloc(size_compressed);
-        if (!chunk_compressed)
-        {
-            retval = GTA_SYSTEM_ERROR;
-            goto exit;
-        }
-        r = read_fn(userdata, chunk_compressed, size_compressed, &error);
-        if (error)
+#else
+        retval = GTA_UNSUPPORTED_DATA;
+        goto exit;
+#endif
+    }
+    *compression = chunk_compression;
+    *stored_size = size_compressed;
+    *chunk_size = size_uncompressed;
+
+exit:
+    return retval;
+}
+
+/**
+ * \brief               Read a data chunk.
+ * \param header        The header.
+ * \param buffers       Reusable buffers.
+ * \param dst           A destination buffer for the chunk, or NULL.
+ * \param dst_size      The size of \a dst.
+ * \param chunk         The chunk.
+ * \param chunk_size    The size of the chunk.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * If the uncompressed chunk fits into \a dst, it is read or uncompressed directly
+ * into \a dst. Otherwise, it is stored in the chunk buffer of \a buffers.
+ * In both cases, \a chunk points to the chunk afterwards. The last, empty chunk
+ * has size zero.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 5)
+gta_result_t
+gta_read_chunk(const gta_header_t *GTA_RESTRICT header, struct gta_chunk_buffers *GTA_RESTRICT buffers,
+        void *GTA_RESTRICT dst, size_t dst_size, void **chunk, size_t *chunk_size,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    gta_compression_t compression;
+    size_t stored_size;
+    gta_result_t retval;
+
+    *chunk = NULL;
+    retval = gta_read_chunk_head(header, &compression, &stored_size, chunk_size, read_fn, userdata);
+    if (retval != GTA_OK || *chunk_size == 0)
+    {
+        return retval;
+    }
+    if (dst && *chunk_size <= dst_size)
+    {
+        *chunk = dst;
+    }
+    else
+    {
+        retval = gta_reserve_buffer(&(buffers->chunk), &(buffers->chunk_alloc), *chunk_size);
+        if (retval != GTA_OK)
         {
-            retval = GTA_SYSTEM_ERROR;
             goto exit;
         }
-        if (r < size_compressed)
+        *chunk = buffers->chunk;
+    }
+    if (compression == GTA_NONE)
+    {
+        retval = gta_read_fully(*chunk, *chunk_size, read_fn, userdata);
+    }
+    else
+    {
+        retval = gta_reserve_buffer(&(buffers->stored), &(buffers->stored_alloc), stored_size);
+        if (retval != GTA_OK)
         {
-            retval = GTA_UNEXPECTED_EOF;
             goto exit;
         }
-        retval = gta_uncompress(*chunk, *chunk_size,
-                chunk_compressed, size_compressed, compression);
+        retval = gta_read_fully(buffers->stored, stored_size, read_fn, userdata);
         if (retval != GTA_OK)
         {
             goto exit;
         }
-        free(chunk_compressed);
-        chunk_compressed = NULL;
-#else
-        retval = GTA_UNSUPPORTED_DATA;
-        goto exit;
-#endif
+        retval = gta_uncompress(*chunk, *chunk_size, buffers->stored, stored_size, compression);
     }
 
 exit:
-    free(chunk_compressed);
     if (retval != GTA_OK)
     {
-        free(*chunk);
         *chunk = NULL;
         *chunk_size = 0;
     }
     return retval;
 }
 
+#if WITH_COMPRESSION && defined HAVE_PTHREAD
+
+/*
+ * Pipelined reading of compressed data.
+ *
+ * The calling thread reads the stored chunks ahead and hands them to a pool of
+ * worker threads, which uncompress them in parallel. The uncompressed chunks are
+ * then delivered in order. All input and output functions are called from the
+ * calling thread only, so custom input/output functions need not be thread-safe.
+ */
+
+/* Maximum number of worker threads */
+static const long gta_pipeline_max_workers = 16;
+
+enum
+{
+    GTA_PIPELINE_SLOT_EMPTY,    // unused
+    GTA_PIPELINE_SLOT_QUEUED,   // waiting for a worker
+    GTA_PIPELINE_SLOT_BUSY,     // being uncompressed by a worker
+    GTA_PIPELINE_SLOT_DONE      // ready for delivery
+};
+
+struct gta_pipeline_slot
+{
+    int state;
+    gta_compression_t compression;
+    struct gta_chunk_buffers buffers; // reused for all chunks that pass through this slot
+    size_t stored_size;         // size of the chunk as stored in buffers.stored
+    void *chunk;                // the uncompressed chunk: in the data or in buffers.chunk
+    size_t chunk_size;
+    gta_result_t result;
+    int errnum;                 // errno value if result is GTA_SYSTEM_ERROR
+};
+
+struct gta_pipeline
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        // broadcast on every change of a slot state and on quit
+    struct gta_pipeline_slot *slots;
+    size_t n_slots;
+    uintmax_t queued;           // number of chunks that were queued so far
+    uintmax_t delivered;        // number of chunks that were delivered so far
+    bool quit;
+};
+
+static GTA_ATTR_NOTHROW
+void *gta_pipeline_worker(void *arg)
+{
+    struct gta_pipeline *p = arg;
+
+    pthread_mutex_lock(&p->mutex);
+    for (;;)
+    {
+        struct gta_pipeline_slot *slot = NULL;
+        for (uintmax_t i = p->delivered; i < p->queued; i++)
+        {
+            if (p->slots[i % p->n_slots].state == GTA_PIPELINE_SLOT_QUEUED)
+            {
+                slot = &(p->slots[i % p->n_slots]);
+                break;
+            }
+        }
+        if (slot)
+        {
+            slot->state = GTA_PIPELINE_SLOT_BUSY;
+            pthread_mutex_unlock(&p->mutex);
+            errno = 0;
+            slot->result = gta_uncompress(slot->chunk, slot->chunk_size,
+                    slot->buffers.stored, slot->stored_size, slot->compression);
+            slot->errnum = errno;
+            pthread_mutex_lock(&p->mutex);
+            slot->state = GTA_PIPELINE_SLOT_DONE;
+            pthread_cond_broadcast(&p->cond);
+        }
+        else if (p->quit)
+        {
+            break;
+        }
+        else
+        {
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return NULL;
+}
+
+/**
+ * \brief               Read compressed data with pipelined decompression.
+ * \param header        The header.
+ * \param read_fn       The custom input function.
+ * \param read_userdata A parameter to the custom input function.
+ * \param data          The buffer for the complete data, or NULL.
+ * \param write_fn      The custom output function, used if \a data is NULL.
+ * \param write_userdata A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * If \a data is not NULL, the chunks are uncompressed directly into it. Otherwise,
+ * they are written to the output in order. The data is not converted to host endianness.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(1, 2)
+gta_result_t
+gta_read_data_pipelined(const gta_header_t *GTA_RESTRICT header,
+        gta_read_t read_fn, intptr_t read_userdata, void *GTA_RESTRICT data,
+        gta_write_t write_fn, intptr_t write_userdata)
+{
+    struct gta_pipeline p;
+    pthread_t *workers;
+    long n_workers = 0;
+    long n_cpus;
+    uintmax_t remaining_size = gta_get_data_size(header);
+    char *data_ptr = data;
+    bool eof = false;
+    gta_result_t retval = GTA_OK;
+    int errnum = 0;
+
+    n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    n_cpus = (n_cpus < 1 ? 1 : n_cpus > gta_pipeline_max_workers ? gta_pipeline_max_workers : n_cpus);
+    p.n_slots = n_cpus + 2;     // keep the workers busy while the next chunks are read
+    p.slots = malloc(p.n_slots * sizeof(struct gta_pipeline_slot));
+    workers = malloc(n_cpus * sizeof(pthread_t));
+    if (!p.slots || !workers)
+    {
+        free(p.slots);
+        free(workers);
+        return GTA_SYSTEM_ERROR;
+    }
+    for (size_t i = 0; i < p.n_slots; i++)
+    {
+        p.slots[i].state = GTA_PIPELINE_SLOT_EMPTY;
+        gta_init_chunk_buffers(&(p.slots[i].buffers));
+        p.slots[i].chunk = NULL;
+    }
+    p.queued = 0;
+    p.delivered = 0;
+    p.quit = false;
+    if (pthread_mutex_init(&p.mutex, NULL) != 0)
+    {
+        free(p.slots);
+        free(workers);
+        return GTA_SYSTEM_ERROR;
+    }
+    if (pthread_cond_init(&p.cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&p.mutex);
+        free(p.slots);
+        free(workers);
+        return GTA_SYSTEM_ERROR;
+    }
+    for (n_workers = 0; n_workers < n_cpus; n_workers++)
+    {
+        if (pthread_create(&workers[n_workers], NULL, gta_pipeline_worker, &p) != 0)
+        {
+            break;
+        }
+    }
+    if (n_workers == 0)
+    {
+        retval = GTA_SYSTEM_ERROR;
+        errnum = EAGAIN;
+        goto exit;
+    }
+
+    pthread_mutex_lock(&p.mutex);
+    for (;;)
+    {
+        struct gta_pipeline_slot *slot = &(p.slots[p.delivered % p.n_slots]);
+        if (p.delivered < p.queued && slot->state == GTA_PIPELINE_SLOT_DONE)
+        {
+            /* Deliver the next chunk */
+            pthread_mutex_unlock(&p.mutex);
+            if (slot->result != GTA_OK)
+            {
+                retval = slot->result;
+                errnum = slot->errnum;
+            }
+            else if (!data)
+            {
+                int error = false;
+                errno = 0;
+                size_t r = write_fn(write_userdata, slot->chunk, slot->chunk_size, &error);
+                if (error || r < slot->chunk_size)
+                {
+                    errnum = (errno == 0 ? EIO : errno);
+                    retval = GTA_SYSTEM_ERROR;
+                }
+            }
+            slot->chunk = NULL;
+            pthread_mutex_lock(&p.mutex);
+            slot->state = GTA_PIPELINE_SLOT_EMPTY;
+            p.delivered++;
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+        }
+        else if (eof && p.delivered == p.queued)
+        {
+            break;
+        }
+        else if (!eof && p.queued - p.delivered < p.n_slots)
+        {
+            /* Read the next chunk ahead. The slot is empty, so no worker uses its buffers. */
+            gta_compression_t compression;
+            size_t stored_size, chunk_size;
+            slot = &(p.slots[p.queued % p.n_slots]);
+            pthread_mutex_unlock(&p.mutex);
+            errno = 0;
+            retval = gta_read_chunk_head(header, &compression, &stored_size, &chunk_size,
+                    read_fn, read_userdata);
+            if (retval == GTA_OK && chunk_size > remaining_size)
+            {
+                retval = GTA_INVALID_DATA;
+            }
+            if (retval == GTA_OK && chunk_size == 0)
+            {
+                eof = true;
+                if (remaining_size > 0)
+                {
+                    retval = (data ? GTA_INVALID_DATA : GTA_UNEXPECTED_EOF);
+                }
+            }
+            if (retval == GTA_OK && chunk_size > 0)
+            {
+                if (data)
+                {
+                    slot->chunk = data_ptr;
+                }
+                else
+                {
+                    retval = gta_reserve_buffer(&(slot->buffers.chunk), &(slot->buffers.chunk_alloc), chunk_size);
+                    slot->chunk = slot->buffers.chunk;
+                }
+            }
+            if (retval == GTA_OK && chunk_size > 0)
+            {
+                if (compression == GTA_NONE)
+                {
+                    retval = gta_read_fully(slot->chunk, chunk_size, read_fn, read_userdata);
+                }
+                else
+                {
+                    retval = gta_reserve_buffer(&(slot->buffers.stored), &(slot->buffers.stored_alloc), stored_size);
+                    if (retval == GTA_OK)
+                    {
+                        retval = gta_read_fully(slot->buffers.stored, stored_size, read_fn, read_userdata);
+                    }
+                }
+            }
+            errnum = errno;
+            pthread_mutex_lock(&p.mutex);
+            if (retval != GTA_OK)
+            {
+                break;
+            }
+            if (chunk_size > 0)
+            {
+                slot->compression = compression;
+                slot->stored_size = stored_size;
+                slot->chunk_size = chunk_size;
+                if (compression == GTA_NONE)
+                {
+                    slot->result = GTA_OK;
+                    slot->state = GTA_PIPELINE_SLOT_DONE;
+                }
+                else
+                {
+                    slot->state = GTA_PIPELINE_SLOT_QUEUED;
+                    pthread_cond_broadcast(&p.cond);
+                }
+                p.queued++;
+                if (data)
+                {
+                    data_ptr += chunk_size;
+                }
+                remaining_size -= chunk_size;
+            }
+        }
+        else
+        {
+            pthread_cond_wait(&p.cond, &p.mutex);
+        }
+    }
+    p.quit = true;
+    pthread_cond_broadcast(&p.cond);
+    pthread_mutex_unlock(&p.mutex);
+
+exit:
+    for (long i = 0; i < n_workers; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    /* The workers have finished all queued chunks */
+    for (size_t i = 0; i < p.n_slots; i++)
+    {
+        gta_free_chunk_buffers(&(p.slots[i].buffers));
+    }
+    pthread_cond_destroy(&p.cond);
+    pthread_mutex_destroy(&p.mutex);
+    free(p.slots);
+    if (retval == GTA_SYSTEM_ERROR)
+    {
+        errno = errnum;
+    }
+    return retval;
+}
+
+#endif
+
 /**
  * \brief               Skip a data chunk.
  * \param header        The header.
@@ -1355,12 +1893,23 @@ gta_create_taglist(gta_taglist_t *GTA_RESTRICT taglist)
     taglist->values = NULL;
     taglist->sorted = NULL;
     taglist->encoded_size = 1;
+    taglist->refcount = NULL;
 }
 
 static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
 void
 gta_destroy_taglist(gta_taglist_t *GTA_RESTRICT taglist)
 {
+    if (taglist->refcount)
+    {
+#ifdef GTA_SHARED_TAGLISTS
+        if (__atomic_sub_fetch(taglist->refcount, 1, __ATOMIC_ACQ_REL) > 0)
+        {
+            return;
+        }
+#endif
+        free(taglist->refcount);
+    }
     for (ssize_t i = 0; i < taglist->entries; i++)
     {
         free(taglist->names[i]);
@@ -1371,38 +1920,181 @@ gta_destroy_taglist(gta_taglist_t *GTA_RESTRICT taglist)
     free(taglist->sorted);
 }
 
-
-/*
- *
- * Access Tag Lists
- *
+/**
+ * \brief               Copy a tag list with its own storage.
+ * \param dst           The destination tag list; it is initialized by this function.
+ * \param src           The source tag list.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
  */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_copy_taglist(gta_taglist_t *GTA_RESTRICT dst, const gta_taglist_t *GTA_RESTRICT src)
+{
+    size_t entries = src->entries;
+
+    gta_create_taglist(dst);
+    if (entries == 0)
+    {
+        return GTA_OK;
+    }
+    dst->refcount = malloc(sizeof(size_t));
+    if (!dst->refcount)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    *(dst->refcount) = 1;
+    dst->names = malloc(entries * sizeof(char *));
+    dst->values = malloc(entries * sizeof(char *));
+    dst->sorted = malloc(entries * sizeof(ssize_t));
+    if (!dst->names || !dst->values || !dst->sorted)
+    {
+        gta_destroy_taglist(dst);
+        return GTA_SYSTEM_ERROR;
+    }
+    dst->size = entries;
+    for (size_t i = 0; i < entries; i++)
+    {
+        size_t name_size = strlen(src->names[i]) + 1;
+        size_t value_size = strlen(src->values[i]) + 1;
+        char *name = malloc(name_size);
+        char *value = malloc(value_size);
+        if (!name || !value)
+        {
+            free(name);
+            free(value);
+            gta_destroy_taglist(dst);
+            return GTA_SYSTEM_ERROR;
+        }
+        memcpy(name, src->names[i], name_size);
+        memcpy(value, src->values[i], value_size);
+        dst->names[i] = name;
+        dst->values[i] = value;
+        dst->entries++;
+    }
+    memcpy(dst->sorted, src->sorted, entries * sizeof(ssize_t));
+    dst->encoded_size = src->encoded_size;
+    return GTA_OK;
+}
 
 /**
- * \brief                               Check if a string is valid UTF-8 and fulfills some given requirements.
- * \param s                             The string.
- * \param allow_control_characters      Whether the string is allowed to contain control characters.
- * \param allow_equal_sign              Whether the string is allowed to contain the equal sign '='.
- * \param allow_empty_string            Whether the string is allowed to be empty.
- * \return                              True if the string is valid UTF-8 and fulfills the given requirements, false otherwise.
+ * \brief               Make sure that the storage of a tag list is not shared.
+ * \param taglist       The tag list.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ *
+ * This must be called before a tag list is modified.
  */
-static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
-bool
-gta_check_utf8(const char *s, bool allow_control_characters, bool allow_equal_sign, bool allow_empty_string)
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_unshare_taglist(gta_taglist_t *GTA_RESTRICT taglist)
 {
-    const unsigned char *data = (const unsigned char *)s;
-    size_t i = 0;
-    int multibyte_case = 0;
-    int continuation_bytes = 0;
-    unsigned int multibyte_val = 0;
-    bool error = false;
-
-    for (;;)
+#ifdef GTA_SHARED_TAGLISTS
+    if (taglist->refcount && __atomic_load_n(taglist->refcount, __ATOMIC_ACQUIRE) > 1)
     {
-        unsigned char c = data[i++];
-        if (c < 0x80)
+        gta_taglist_t copy;
+        gta_result_t retval = gta_copy_taglist(&copy, taglist);
+        if (retval != GTA_OK)
         {
-            if (continuation_bytes > 0)
+            return retval;
+        }
+        gta_destroy_taglist(taglist);
+        *taglist = copy;
+    }
+#else
+    (void)taglist;
+#endif
+    return GTA_OK;
+}
+
+/**
+ * \brief               Make room for one more entry in a tag list.
+ * \param taglist       The tag list, which must not share its storage.
+ * \return              The result.
+ *
+ * The arrays of the tag list grow geometrically, so that building a tag list
+ * with n entries takes O(n) reallocation work.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_reserve_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    if ((size_t)taglist->entries < taglist->size)
+    {
+        return GTA_OK;
+    }
+    if (!taglist->refcount)
+    {
+        taglist->refcount = malloc(sizeof(size_t));
+        if (!taglist->refcount)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        *(taglist->refcount) = 1;
+    }
+    size_t max_size = SIZE_MAX / (sizeof(char *) > sizeof(ssize_t) ? sizeof(char *) : sizeof(ssize_t));
+    if (max_size > (size_t)SSIZE_MAX)
+    {
+        max_size = SSIZE_MAX;
+    }
+    if (taglist->size >= max_size)
+    {
+        return GTA_OVERFLOW;
+    }
+    size_t size = (taglist->size == 0 ? gta_bufsize_inc
+            : taglist->size > max_size / 2 ? max_size : taglist->size * 2);
+    char **names = realloc(taglist->names, size * sizeof(char *));
+    if (!names)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    taglist->names = names;
+    char **values = realloc(taglist->values, size * sizeof(char *));
+    if (!values)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    taglist->values = values;
+    ssize_t *sorted = realloc(taglist->sorted, size * sizeof(ssize_t));
+    if (!sorted)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    taglist->sorted = sorted;
+    taglist->size = size;
+    return GTA_OK;
+}
+
+
+/*
+ *
+ * Access Tag Lists
+ *
+ */
+
+/**
+ * \brief                               Check if a string is valid UTF-8 and fulfills some given requirements.
+ * \param s                             The string.
+ * \param allow_control_characters      Whether the string is allowed to contain control characters.
+ * \param allow_equal_sign              Whether the string is allowed to contain the equal sign '='.
+ * \param allow_empty_string            Whether the string is allowed to be empty.
+ * \return                              True if the string is valid UTF-8 and fulfills the given requirements, false otherwise.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+bool
+gta_check_utf8(const char *s, bool allow_control_characters, bool allow_equal_sign, bool allow_empty_string)
+{
+    const unsigned char *data = (const unsigned char *)s;
+    size_t i = 0;
+    int multibyte_case = 0;
+    int continuation_bytes = 0;
+    unsigned int multibyte_val = 0;
+    bool error = false;
+
+    for (;;)
+    {
+        unsigned char c = data[i++];
+        if (c < 0x80)
+        {
+            if (continuation_bytes > 0)
             {
                 error = true;
                 break;
@@ -1588,6 +2280,11 @@ gta_set_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name,
     }
     size_t newnam_size = strlen(name) + 1;
     size_t newval_size = strlen(value) + 1;
+    gta_result_t retval = gta_unshare_taglist(taglist);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
 
     ssize_t a = 0;
     ssize_t b = taglist->entries - 1;
@@ -1621,47 +2318,10 @@ gta_set_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name,
         }
     }
 
-    if ((size_t)taglist->entries == taglist->size)
+    retval = gta_reserve_taglist(taglist);
+    if (retval != GTA_OK)
     {
-        if (taglist->entries == SSIZE_MAX
-                || taglist->size > SIZE_MAX - gta_bufsize_inc
-                || gta_size_overflow(taglist->size + gta_bufsize_inc, sizeof(char *))
-                || gta_size_overflow(taglist->size + gta_bufsize_inc, sizeof(ssize_t)))
-        {
-            return GTA_OVERFLOW;
-        }
-        taglist->size += gta_bufsize_inc;
-        char **old_names = taglist->names;
-        char **old_values = taglist->values;
-        ssize_t *old_sorted = taglist->sorted;
-        taglist->names = malloc((size_t)taglist->size * sizeof(char *));
-        taglist->values = malloc((size_t)taglist->size * sizeof(char *));
-        taglist->sorted = malloc((size_t)taglist->size * sizeof(ssize_t));
-        if (!taglist->names || !taglist->values || !taglist->sorted)
-        {
-            free(taglist->names);
-            free(taglist->values);
-            free(taglist->sorted);
-            taglist->names = old_names;
-            taglist->values = old_values;
-            taglist->sorted = old_sorted;
-            return GTA_SYSTEM_ERROR;
-        }
-        if (old_names)
-        {
-            memcpy(taglist->names, old_names, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(char *));
-            free(old_names);
-        }
-        if (old_values)
-        {
-            memcpy(taglist->values, old_values, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(char *));
-            free(old_values);
-        }
-        if (old_sorted)
-        {
-            memcpy(taglist->sorted, old_sorted, (size_t)(taglist->size - gta_bufsize_inc) * sizeof(ssize_t));
-            free(old_sorted);
-        }
+        return retval;
     }
 
     char *newnam = malloc(newnam_size);
@@ -1679,10 +2339,7 @@ gta_set_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name,
     taglist->values[taglist->entries] = newval;
     taglist->encoded_size += newnam_size + newval_size;
     taglist->entries++;
-    for (ssize_t i = taglist->entries - 1; i > a; i--)
-    {
-        taglist->sorted[i] = taglist->sorted[i - 1];
-    }
+    memmove(taglist->sorted + a + 1, taglist->sorted + a, (size_t)(taglist->entries - 1 - a) * sizeof(ssize_t));
     taglist->sorted[a] = taglist->entries - 1;
     return GTA_OK;
 }
@@ -1708,6 +2365,11 @@ gta_unset_tag(gta_taglist_t *GTA_RESTRICT taglist, const char *GTA_RESTRICT name
         }
         else
         {
+            gta_result_t retval = gta_unshare_taglist(taglist);
+            if (retval != GTA_OK)
+            {
+                return retval;
+            }
             size_t oldnam_size = strlen(taglist->names[d]) + 1;
             size_t oldval_size = strlen(taglist->values[d]) + 1;
             free(taglist->names[d]);
@@ -1749,18 +2411,19 @@ gta_clone_taglist(gta_taglist_t *GTA_RESTRICT dst_taglist,
         const gta_taglist_t *GTA_RESTRICT src_taglist)
 {
     gta_taglist_t tmp_taglist;
-    gta_create_taglist(&tmp_taglist);
-    for (uintmax_t i = 0; i < gta_get_tags(src_taglist); i++)
+#ifdef GTA_SHARED_TAGLISTS
+    tmp_taglist = *src_taglist;
+    if (tmp_taglist.refcount)
     {
-        gta_result_t r = gta_set_tag(&tmp_taglist,
-                gta_get_tag_name(src_taglist, i),
-                gta_get_tag_value(src_taglist, i));
-        if (r != GTA_OK)
-        {
-            gta_destroy_taglist(&tmp_taglist);
-            return r;
-        }
+        __atomic_add_fetch(tmp_taglist.refcount, 1, __ATOMIC_RELAXED);
+    }
+#else
+    gta_result_t r = gta_copy_taglist(&tmp_taglist, src_taglist);
+    if (r != GTA_OK)
+    {
+        return r;
     }
+#endif
     gta_destroy_taglist(dst_taglist);
     memcpy(dst_taglist, &tmp_taglist, sizeof(gta_taglist_t));
     return GTA_OK;
@@ -1797,6 +2460,9 @@ gta_create_header(gta_header_t *GTA_RESTRICT *GTA_RESTRICT header)
     hdr->component_blob_sizes = NULL;
     hdr->component_taglists = NULL;
     hdr->element_size = 0;
+    hdr->swap_runs = 0;
+    hdr->swap_plan = NULL;
+    hdr->padding = 0;
     hdr->dimensions = 0;
     hdr->dimension_sizes = NULL;
     hdr->dimension_taglists = NULL;
@@ -1818,15 +2484,11 @@ gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
 
     temp_header->host_endianness = src_header->host_endianness;
     temp_header->compression = src_header->compression;
-    for (uintmax_t i = 0; i < gta_get_tags(src_header->global_taglist); i++)
+    temp_header->padding = src_header->padding;
+    retval = gta_clone_taglist(temp_header->global_taglist, src_header->global_taglist);
+    if (retval != GTA_OK)
     {
-        retval = gta_set_tag(temp_header->global_taglist,
-                gta_get_tag_name(src_header->global_taglist, i),
-                gta_get_tag_value(src_header->global_taglist, i));
-        if (retval != GTA_OK)
-        {
-            goto exit;
-        }
+        goto exit;
     }
     gta_type_t *types = malloc(src_header->components * sizeof(gta_type_t));
     if (!types)
@@ -1847,15 +2509,10 @@ gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
     }
     for (uintmax_t i = 0; i < src_header->components; i++)
     {
-        for (uintmax_t j = 0; j < gta_get_tags(src_header->component_taglists[i]); j++)
+        retval = gta_clone_taglist(temp_header->component_taglists[i], src_header->component_taglists[i]);
+        if (retval != GTA_OK)
         {
-            retval = gta_set_tag(temp_header->component_taglists[i],
-                    gta_get_tag_name(src_header->component_taglists[i], j),
-                    gta_get_tag_value(src_header->component_taglists[i], j));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
+            goto exit;
         }
     }
     retval = gta_set_dimensions(temp_header, src_header->dimensions, src_header->dimension_sizes);
@@ -1865,15 +2522,10 @@ gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
     }
     for (uintmax_t i = 0; i < src_header->dimensions; i++)
     {
-        for (uintmax_t j = 0; j < gta_get_tags(src_header->dimension_taglists[i]); j++)
+        retval = gta_clone_taglist(temp_header->dimension_taglists[i], src_header->dimension_taglists[i]);
+        if (retval != GTA_OK)
         {
-            retval = gta_set_tag(temp_header->dimension_taglists[i],
-                    gta_get_tag_name(src_header->dimension_taglists[i], j),
-                    gta_get_tag_value(src_header->dimension_taglists[i], j));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
+            goto exit;
         }
     }
 
@@ -1884,6 +2536,7 @@ exit:
         free(dst_header->global_taglist);
         free(dst_header->component_types);
         free(dst_header->component_blob_sizes);
+        free(dst_header->swap_plan);
         for (uintmax_t i = 0; i < dst_header->components; i++)
         {
             gta_destroy_taglist(dst_header->component_taglists[i]);
@@ -1908,6 +2561,7 @@ exit:
         }
         free(temp_header->component_types);
         free(temp_header->component_blob_sizes);
+        free(temp_header->swap_plan);
         if (temp_header->component_taglists)
         {
             for (uintmax_t i = 0; i < temp_header->components; i++)
@@ -1939,6 +2593,7 @@ gta_destroy_header(gta_header_t *GTA_RESTRICT header)
     free(header->global_taglist);
     free(header->component_types);
     free(header->component_blob_sizes);
+    free(header->swap_plan);
     for (uintmax_t i = 0; i < header->components; i++)
     {
         gta_destroy_taglist(header->component_taglists[i]);
@@ -1972,12 +2627,17 @@ gta_append_element_to_array(
     if (*array_elements == *array_size)
     {
         void *tmp_ptr;
-        if (*array_size > SIZE_MAX - gta_bufsize_inc
-                || gta_size_overflow(*array_size + gta_bufsize_inc, element_size))
+        size_t new_size = (*array_size == 0 ? gta_bufsize_inc
+                : *array_size > SIZE_MAX / 2 ? SIZE_MAX : *array_size * 2);
+        if (new_size == *array_size || gta_size_overflow(new_size, element_size))
         {
-            return GTA_OVERFLOW;
+            new_size = *array_size + 1;
+            if (new_size == 0 || gta_size_overflow(new_size, element_size))
+            {
+                return GTA_OVERFLOW;
+            }
         }
-        *array_size += gta_bufsize_inc;
+        *array_size = new_size;
         tmp_ptr = realloc(*array, *array_size * element_size);
         if (!tmp_ptr)
         {
@@ -1992,51 +2652,219 @@ gta_append_element_to_array(
     return GTA_OK;
 }
 
+/**
+ * \brief               Make sure that unread data is available in the current header chunk.
+ * \param header        The header.
+ * \param read_fn       The read function.
+ * \param userdata      The user data for the read function.
+ * \param buffers       The chunk buffers.
+ * \param chunk_size    The size of the current chunk.
+ * \param chunk_index   The read index in the current chunk.
+ * \return              The result.
+ *
+ * Reads the next chunk if the current one is used up. The header ends before
+ * the last, empty chunk, so reaching that chunk means the data is invalid.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_refill_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        struct gta_chunk_buffers *buffers, size_t *chunk_size, size_t *chunk_index)
+{
+    if (*chunk_index < *chunk_size)
+    {
+        return GTA_OK;
+    }
+    void *chunk;
+    gta_result_t retval = gta_read_chunk(header, buffers, NULL, 0, &chunk, chunk_size, read_fn, userdata);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    if (*chunk_size == 0)
+    {
+        return GTA_INVALID_DATA;
+    }
+    *chunk_index = 0;
+    return GTA_OK;
+}
+
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
 gta_read_blob_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
-        void **chunk, size_t *chunk_size, size_t *chunk_index,
+        struct gta_chunk_buffers *buffers, size_t *chunk_size, size_t *chunk_index,
         void *blob, size_t blob_size)
 {
-    gta_result_t retval = GTA_OK;
     char *cblob = blob;
-    char *cchunk = *chunk;
-    for (size_t i = 0; i < blob_size; i++)
+    while (blob_size > 0)
     {
-        if (*chunk_index == *chunk_size)
+        gta_result_t retval = gta_refill_chunk(header, read_fn, userdata, buffers, chunk_size, chunk_index);
+        if (retval != GTA_OK)
         {
-            free(*chunk);
-            *chunk = NULL;
-            retval = gta_read_chunk(header, chunk, chunk_size, read_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                return retval;
-            }
-            if (*chunk_size == 0)
-            {
-                return GTA_INVALID_DATA;
-            }
-            *chunk_index = 0;
-            cchunk = *chunk;
+            return retval;
+        }
+        size_t n = *chunk_size - *chunk_index;
+        if (n > blob_size)
+        {
+            n = blob_size;
+        }
+        memcpy(cblob, (char *)buffers->chunk + *chunk_index, n);
+        *chunk_index += n;
+        cblob += n;
+        blob_size -= n;
+    }
+    return GTA_OK;
+}
+
+/**
+ * \brief               Read a string from the header chunks.
+ * \param header        The header.
+ * \param read_fn       The read function.
+ * \param userdata      The user data for the read function.
+ * \param buffers       The chunk buffers.
+ * \param chunk_size    The size of the current chunk.
+ * \param chunk_index   The read index in the current chunk.
+ * \param string        The string.
+ * \return              The result.
+ *
+ * Reads everything up to and including the next null character into a newly
+ * allocated string. The chunk is scanned with memchr(), and the string is copied
+ * in spans, so that strings need not be assembled character by character.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_read_string_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
+        struct gta_chunk_buffers *buffers, size_t *chunk_size, size_t *chunk_index,
+        char **string)
+{
+    char *str = NULL;
+    size_t str_len = 0;
+    gta_result_t retval;
+
+    for (;;)
+    {
+        retval = gta_refill_chunk(header, read_fn, userdata, buffers, chunk_size, chunk_index);
+        if (retval != GTA_OK)
+        {
+            break;
+        }
+        const char *span = (const char *)buffers->chunk + *chunk_index;
+        size_t span_len = *chunk_size - *chunk_index;
+        const char *end = memchr(span, '\0', span_len);
+        size_t n = (end ? (size_t)(end - span) + 1 : span_len);
+        if (str_len > SIZE_MAX - n)
+        {
+            retval = GTA_OVERFLOW;
+            break;
+        }
+        /* Strings normally lie within one chunk, so only one allocation is needed */
+        char *tmp_str = realloc(str, str_len + n);
+        if (!tmp_str)
+        {
+            retval = GTA_SYSTEM_ERROR;
+            break;
+        }
+        str = tmp_str;
+        memcpy(str + str_len, span, n);
+        str_len += n;
+        *chunk_index += n;
+        if (end)
+        {
+            *string = str;
+            return GTA_OK;
         }
-        cblob[i] = cchunk[(*chunk_index)++];
     }
+    free(str);
     return retval;
 }
 
+static int
+gta_compare_tag_refs(const void *a, const void *b)
+{
+    const struct gta_tag_ref *ra = a;
+    const struct gta_tag_ref *rb = b;
+    int cmp = strcmp(ra->name, rb->name);
+    return (cmp != 0 ? cmp : ra->index < rb->index ? -1 : ra->index > rb->index ? 1 : 0);
+}
+
+/**
+ * \brief               Finish a tag list whose entries were appended in bulk.
+ * \param taglist       The tag list, with valid names, values, and entries, but no sorted index.
+ * \return              The result.
+ *
+ * Checks all entries, computes the encoded size, and builds the sorted index
+ * with a single sort. If a name occurs more than once, the tag list is rebuilt
+ * with gta_set_tag() so that the last value wins, as when setting tags one by one.
+ */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
+gta_result_t
+gta_finish_taglist(gta_taglist_t *GTA_RESTRICT taglist)
+{
+    size_t entries = taglist->entries;
+    struct gta_tag_ref *refs;
+    bool duplicates = false;
+
+    taglist->encoded_size = 1;
+    for (size_t i = 0; i < entries; i++)
+    {
+        if (!gta_check_tag_name(taglist->names[i]) || !gta_check_tag_value(taglist->values[i]))
+        {
+            return GTA_INVALID_DATA;
+        }
+        taglist->encoded_size += strlen(taglist->names[i]) + 1 + strlen(taglist->values[i]) + 1;
+    }
+    if (entries == 0)
+    {
+        return GTA_OK;
+    }
+    if (gta_size_overflow(entries, sizeof(struct gta_tag_ref))
+            || !(refs = malloc(entries * sizeof(struct gta_tag_ref))))
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    for (size_t i = 0; i < entries; i++)
+    {
+        refs[i].name = taglist->names[i];
+        refs[i].index = i;
+    }
+    qsort(refs, entries, sizeof(struct gta_tag_ref), gta_compare_tag_refs);
+    for (size_t i = 0; i < entries; i++)
+    {
+        taglist->sorted[i] = refs[i].index;
+        if (i > 0 && strcmp(refs[i - 1].name, refs[i].name) == 0)
+        {
+            duplicates = true;
+        }
+    }
+    free(refs);
+
+    if (duplicates)
+    {
+        gta_taglist_t unique;
+        gta_result_t retval = GTA_OK;
+        gta_create_taglist(&unique);
+        for (size_t i = 0; i < entries && retval == GTA_OK; i++)
+        {
+            retval = gta_set_tag(&unique, taglist->names[i], taglist->values[i]);
+        }
+        if (retval != GTA_OK)
+        {
+            gta_destroy_taglist(&unique);
+            return retval;
+        }
+        gta_destroy_taglist(taglist);
+        *taglist = unique;
+    }
+    return GTA_OK;
+}
+
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
 gta_read_taglist_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t userdata,
-        void **chunk, size_t *chunk_size, size_t *chunk_index,
+        struct gta_chunk_buffers *buffers, size_t *chunk_size, size_t *chunk_index,
         gta_taglist_t **taglist)
 {
-    void *name = NULL;
-    size_t name_len = 0;
-    size_t name_size = 0;
-    void *value = NULL;
-    size_t value_len = 0;
-    size_t value_size = 0;
-    bool in_name = true;
+    char *name = NULL;
+    char *value = NULL;
     gta_result_t retval = GTA_OK;
 
     *taglist = malloc(sizeof(gta_taglist_t));
@@ -2045,51 +2873,37 @@ gta_read_taglist_from_chunk(const gta_header_t *GTA_RESTRICT header, gta_read_t
         return GTA_SYSTEM_ERROR;
     }
     gta_create_taglist(*taglist);
+    /* Append all entries first, and sort them afterwards */
     for (;;)
     {
-        char c;
-        retval = gta_read_blob_from_chunk(header, read_fn, userdata,
-                chunk, chunk_size, chunk_index, &c, sizeof(char));
+        retval = gta_read_string_from_chunk(header, read_fn, userdata,
+                buffers, chunk_size, chunk_index, &name);
         if (retval != GTA_OK)
         {
             goto exit;
         }
-        if (in_name && name_len == 0 && c == '\0')
+        if (name[0] == '\0')
         {
             break;
         }
-        if (in_name)
+        retval = gta_read_string_from_chunk(header, read_fn, userdata,
+                buffers, chunk_size, chunk_index, &value);
+        if (retval != GTA_OK)
         {
-            retval = gta_append_element_to_array(&name, &name_size, &name_len, &c, sizeof(char));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-            if (c == '\0')
-            {
-                in_name = false;
-            }
+            goto exit;
         }
-        else
+        retval = gta_reserve_taglist(*taglist);
+        if (retval != GTA_OK)
         {
-            retval = gta_append_element_to_array(&value, &value_size, &value_len, &c, sizeof(char));
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-            if (c == '\0')
-            {
-                retval = gta_set_tag(*taglist, name, value);
-                if (retval != GTA_OK)
-                {
-                    goto exit;
-                }
-                name_len = 0;
-                value_len = 0;
-                in_name = true;
-            }
+            goto exit;
         }
+        (*taglist)->names[(*taglist)->entries] = name;
+        (*taglist)->values[(*taglist)->entries] = value;
+        (*taglist)->entries++;
+        name = NULL;
+        value = NULL;
     }
+    retval = gta_finish_taglist(*taglist);
 
 exit:
     free(name);
@@ -2108,9 +2922,12 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
 {
     uint8_t firstblock[6];
     int input_error = false;
+    struct gta_chunk_buffers buffers;
     gta_result_t retval = GTA_OK;
     size_t r;
 
+    gta_init_chunk_buffers(&buffers);
+
     /* Use a temp header to avoid changing the given header unless we read everything successfully */
     gta_header_t *temp_header = NULL;
     retval = gta_create_header(&temp_header);
@@ -2173,7 +2990,7 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
 
     /* Read rest of header from chunk list */
 
-    void *chunk = NULL;
+    void *chunk;
     size_t chunk_size = 0;
     size_t chunk_index = 0;
 
@@ -2190,7 +3007,7 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
         {
             uint8_t type;
             retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                    &chunk, &chunk_size, &chunk_index,
+                    &buffers, &chunk_size, &chunk_index,
                     &type, sizeof(uint8_t));
             if (retval != GTA_OK)
             {
@@ -2245,7 +3062,7 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
             if (type == GTA_BLOB)
             {
                 retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                        &chunk, &chunk_size, &chunk_index,
+                        &buffers, &chunk_size, &chunk_index,
                         &size, sizeof(uint64_t));
                 if (retval != GTA_OK)
                 {
@@ -2315,6 +3132,12 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
                 goto exit;
             }
         }
+        retval = gta_create_swap_plan(temp_header->components, temp_header->component_types,
+                temp_header->component_blob_sizes, &temp_header->swap_runs, &temp_header->swap_plan);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
     }
 
     // Read dimension list
@@ -2327,7 +3150,7 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
         {
             uint64_t size;
             retval = gta_read_blob_from_chunk(temp_header, read_fn, userdata,
-                    &chunk, &chunk_size, &chunk_index,
+                    &buffers, &chunk_size, &chunk_index,
                     &size, sizeof(uint64_t));
             if (retval != GTA_OK)
             {
@@ -2375,8 +3198,8 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
     // Read tag lists
     {
         gta_taglist_t *taglist;
-        retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                &chunk, &chunk_size, &chunk_index, &taglist);
+        retval = gta_read_taglist_from_chunk(temp_header, read_fn, userdata,
+                &buffers, &chunk_size, &chunk_index, &taglist);
         if (retval != GTA_OK)
         {
             goto exit;
@@ -2384,14 +3207,25 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
         gta_destroy_taglist(temp_header->global_taglist);
         free(temp_header->global_taglist);
         temp_header->global_taglist = taglist;
+        // The padding tag is not part of the tag list
+        const char *padding_value = gta_get_tag(taglist, gta_padding_tag_name);
+        if (padding_value)
+        {
+            temp_header->padding = sizeof(gta_padding_tag_name) + strlen(padding_value) + 1;
+            retval = gta_unset_tag(taglist, gta_padding_tag_name);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
+        }
         void *tl_array = NULL;
         size_t tl_array_size = 0;
         size_t tl_array_elements = 0;
         for (size_t i = 0; i < temp_header->components; i++)
         {
             taglist = NULL;
-            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
+            if ((retval = gta_read_taglist_from_chunk(temp_header, read_fn, userdata,
+                            &buffers, &chunk_size, &chunk_index, &taglist)) != GTA_OK
                     || (retval = gta_append_element_to_array(
                             &tl_array, &tl_array_size, &tl_array_elements,
                             &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
@@ -2426,8 +3260,8 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
         for (size_t i = 0; i < temp_header->dimensions; i++)
         {
             taglist = NULL;
-            if ((retval = gta_read_taglist_from_chunk(header, read_fn, userdata,
-                            &chunk, &chunk_size, &chunk_index, &taglist)) != GTA_OK
+            if ((retval = gta_read_taglist_from_chunk(temp_header, read_fn, userdata,
+                            &buffers, &chunk_size, &chunk_index, &taglist)) != GTA_OK
                     || (retval = gta_append_element_to_array(
                             &tl_array, &tl_array_size, &tl_array_elements,
                             &taglist, sizeof(gta_taglist_t *))) != GTA_OK)
@@ -2466,9 +3300,7 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
     }
 
     // Read an empty chunk that marks the end of the chunk list
-    free(chunk);
-    chunk = NULL;
-    retval = gta_read_chunk(header, &chunk, &chunk_size, read_fn, userdata);
+    retval = gta_read_chunk(temp_header, &buffers, NULL, 0, &chunk, &chunk_size, read_fn, userdata);
     if (retval != GTA_OK)
     {
         goto exit;
@@ -2480,12 +3312,14 @@ gta_read_header(gta_header_t *GTA_RESTRICT header, gta_read_t read_fn, intptr_t
     }
 
 exit:
+    gta_free_chunk_buffers(&buffers);
     if (retval == GTA_OK)
     {
         gta_destroy_taglist(header->global_taglist);
         free(header->global_taglist);
         free(header->component_types);
         free(header->component_blob_sizes);
+        free(header->swap_plan);
         for (size_t i = 0; i < header->components; i++)
         {
             gta_destroy_taglist(header->component_taglists[i]);
@@ -2507,6 +3341,7 @@ exit:
         free(temp_header->global_taglist);
         free(temp_header->component_types);
         free(temp_header->component_blob_sizes);
+        free(temp_header->swap_plan);
         if (temp_header->component_taglists)
         {
             for (size_t i = 0; i < temp_header->components; i++)
@@ -2549,15 +3384,22 @@ gta_write_blob_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t wri
         void *chunk, size_t chunk_size, size_t *chunk_index,
         const void *blob, size_t blob_size)
 {
-    gta_result_t retval = GTA_OK;
     const char *cblob = blob;
     char *cchunk = chunk;
-    for (size_t i = 0; i < blob_size; i++)
+    while (blob_size > 0)
     {
-        cchunk[(*chunk_index)++] = cblob[i];
+        size_t n = chunk_size - *chunk_index;
+        if (n > blob_size)
+        {
+            n = blob_size;
+        }
+        memcpy(cchunk + *chunk_index, cblob, n);
+        *chunk_index += n;
+        cblob += n;
+        blob_size -= n;
         if (*chunk_index == chunk_size)
         {
-            retval = gta_write_chunk(header, chunk, *chunk_index, write_fn, userdata);
+            gta_result_t retval = gta_write_chunk(header, chunk, *chunk_index, write_fn, userdata);
             if (retval != GTA_OK)
             {
                 return retval;
@@ -2565,13 +3407,39 @@ gta_write_blob_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t wri
             *chunk_index = 0;
         }
     }
-    return retval;
+    return GTA_OK;
+}
+
+/* Return the number of header bytes that are stored in the chunk list. */
+static uintmax_t
+gta_header_payload_size(const gta_header_t *GTA_RESTRICT header)
+{
+    uintmax_t size = header->components * sizeof(uint8_t);
+    size += 1 * sizeof(uint8_t);
+    for (size_t i = 0; i < header->components; i++)
+    {
+        size += header->component_taglists[i]->encoded_size;
+        if (header->component_types[i] == GTA_BLOB)
+        {
+            size += sizeof(uint64_t);
+        }
+    }
+    size += header->dimensions * sizeof(uint64_t);
+    size += 1 * sizeof(uint64_t);
+    for (size_t i = 0; i < header->dimensions; i++)
+    {
+        size += header->dimension_taglists[i]->encoded_size;
+    }
+    size += header->global_taglist->encoded_size;
+    size += header->padding;
+    return size;
 }
 
 static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL
 gta_result_t
 gta_write_taglist_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn, intptr_t userdata,
-        void *chunk, size_t chunk_size, size_t *chunk_index, const gta_taglist_t *GTA_RESTRICT taglist)
+        void *chunk, size_t chunk_size, size_t *chunk_index, const gta_taglist_t *GTA_RESTRICT taglist,
+        uintmax_t padding)
 {
     gta_result_t retval = GTA_OK;
     for (uintmax_t i = 0; i < gta_get_tags(taglist); i++)
@@ -2591,6 +3459,30 @@ gta_write_taglist_to_chunk(const gta_header_t *GTA_RESTRICT header, gta_write_t
             return retval;
         }
     }
+    if (padding > 0)
+    {
+        // The padding tag has a value of spaces
+        static const char spaces[] = "                                                                ";
+        retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                gta_padding_tag_name, sizeof(gta_padding_tag_name));
+        for (uintmax_t i = sizeof(gta_padding_tag_name) + 1; retval == GTA_OK && i < padding; )
+        {
+            size_t n = (padding - i < sizeof(spaces) - 1 ? padding - i : sizeof(spaces) - 1);
+            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                    spaces, n);
+            i += n;
+        }
+        if (retval == GTA_OK)
+        {
+            char value_end = '\0';
+            retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
+                    &value_end, sizeof(char));
+        }
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+    }
     char taglist_end = '\0';
     retval = gta_write_blob_to_chunk(header, write_fn, userdata, chunk, chunk_size, chunk_index,
             &taglist_end, sizeof(char));
@@ -2629,24 +3521,7 @@ gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn,
     /* Write rest of header in chunklist */
 
     // Compute required space for header
-    size_t required_size = 6;
-    required_size += header->components * sizeof(uint8_t);
-    required_size += 1 * sizeof(uint8_t);
-    for (size_t i = 0; i < header->components; i++)
-    {
-        required_size += header->component_taglists[i]->encoded_size;
-        if (header->component_types[i] == GTA_BLOB)
-        {
-            required_size += sizeof(uint64_t);
-        }
-    }
-    required_size += header->dimensions * sizeof(uint64_t);
-    required_size += 1 * sizeof(uint64_t);
-    for (size_t i = 0; i < header->dimensions; i++)
-    {
-        required_size += header->dimension_taglists[i]->encoded_size;
-    }
-    required_size += header->global_taglist->encoded_size;
+    uintmax_t required_size = gta_header_payload_size(header);
     // Allocate a chunk
     void *chunk = NULL;
     size_t chunk_size = 0;
@@ -2711,7 +3586,7 @@ gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn,
 
     // Write tag lists
     retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-            header->global_taglist);
+            header->global_taglist, header->padding);
     if (retval != GTA_OK)
     {
         goto exit;
@@ -2719,7 +3594,7 @@ gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn,
     for (size_t i = 0; i < header->components; i++)
     {
         retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                header->component_taglists[i]);
+                header->component_taglists[i], 0);
         if (retval != GTA_OK)
         {
             goto exit;
@@ -2728,7 +3603,7 @@ gta_write_header(const gta_header_t *GTA_RESTRICT header, gta_write_t write_fn,
     for (size_t i = 0; i < header->dimensions; i++)
     {
         retval = gta_write_taglist_to_chunk(header, write_fn, userdata, chunk, chunk_size, &chunk_index,
-                header->dimension_taglists[i]);
+                header->dimension_taglists[i], 0);
         if (retval != GTA_OK)
         {
             goto exit;
@@ -2949,6 +3824,8 @@ gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
     uint8_t *my_types = NULL;
     uintmax_t *my_blob_sizes = NULL;
     gta_taglist_t **my_taglists = NULL;
+    size_t my_swap_runs = 0;
+    struct gta_swap_run *my_swap_plan = NULL;
     if (n > 0)
     {
         my_types = malloc(n * sizeof(uint8_t));
@@ -2972,6 +3849,13 @@ gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
         {
             memcpy(my_blob_sizes, sizes, blobs * sizeof(uintmax_t));
         }
+        if (gta_create_swap_plan(n, my_types, my_blob_sizes, &my_swap_runs, &my_swap_plan) != GTA_OK)
+        {
+            free(my_types);
+            free(my_blob_sizes);
+            free(my_taglists);
+            return GTA_SYSTEM_ERROR;
+        }
         for (size_t i = 0; i < n; i++)
         {
             my_taglists[i] = malloc(sizeof(gta_taglist_t));
@@ -2985,6 +3869,7 @@ gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
                 free(my_types);
                 free(my_blob_sizes);
                 free(my_taglists);
+                free(my_swap_plan);
                 return GTA_SYSTEM_ERROR;
             }
             gta_create_taglist(my_taglists[i]);
@@ -2999,12 +3884,15 @@ gta_set_components(gta_header_t *GTA_RESTRICT header, uintmax_t n,
     free(header->component_types);
     free(header->component_blob_sizes);
     free(header->component_taglists);
+    free(header->swap_plan);
 
     header->components = n;
     header->component_types = my_types;
     header->component_blob_sizes = my_blob_sizes;
     header->component_taglists = my_taglists;
     header->element_size = element_size;
+    header->swap_runs = my_swap_runs;
+    header->swap_plan = my_swap_plan;
 
     return GTA_OK;
 }
@@ -3131,6 +4019,12 @@ gta_get_data_size(const gta_header_t *GTA_RESTRICT header)
     return gta_get_element_size(header) * gta_get_elements(header);
 }
 
+int
+gta_data_is_native(const gta_header_t *GTA_RESTRICT header)
+{
+    return (header->compression == GTA_NONE && !gta_data_needs_endianness_swapping(header));
+}
+
 gta_compression_t
 gta_get_compression(const gta_header_t *GTA_RESTRICT header)
 {
@@ -3148,6 +4042,82 @@ gta_set_compression(gta_header_t *GTA_RESTRICT header, gta_compression_t compres
     (void)compression;
 }
 
+uintmax_t
+gta_get_header_padding(const gta_header_t *GTA_RESTRICT header)
+{
+    return header->padding;
+}
+
+gta_result_t
+gta_set_header_padding(gta_header_t *GTA_RESTRICT header, uintmax_t padding)
+{
+    // The padding is stored as a tag with a name and an empty value, at least
+    if (padding > 0 && padding < sizeof(gta_padding_tag_name) + 1)
+    {
+        return GTA_INVALID_DATA;
+    }
+    if (padding > (uintmax_t)INTMAX_MAX - gta_header_payload_size(header) + header->padding)
+    {
+        return GTA_OVERFLOW;
+    }
+    header->padding = padding;
+    return GTA_OK;
+}
+
+uintmax_t
+gta_get_header_size(const gta_header_t *GTA_RESTRICT header)
+{
+    uintmax_t payload_size = gta_header_payload_size(header);
+    uintmax_t chunks = payload_size / gta_max_chunk_size + (payload_size % gta_max_chunk_size == 0 ? 0 : 1);
+    return 6 + chunks * (sizeof(uint64_t) + sizeof(uint8_t)) + payload_size + sizeof(uint64_t);
+}
+
+gta_result_t
+gta_align_header(gta_header_t *GTA_RESTRICT header, uintmax_t offset, uintmax_t min_padding, uintmax_t alignment)
+{
+    const uintmax_t min_tag_size = sizeof(gta_padding_tag_name) + 1;
+    uintmax_t old_padding = header->padding;
+    gta_result_t retval;
+
+    if (alignment == 0 || (min_padding > 0 && min_padding < min_tag_size))
+    {
+        return GTA_INVALID_DATA;
+    }
+    uintmax_t padding = min_padding;
+    for (;;)
+    {
+        retval = gta_set_header_padding(header, padding);
+        if (retval != GTA_OK)
+        {
+            break;
+        }
+        uintmax_t end = offset + gta_get_header_size(header);
+        if (end < offset)
+        {
+            retval = GTA_OVERFLOW;
+            break;
+        }
+        if (end % alignment == 0)
+        {
+            return GTA_OK;
+        }
+        // Adding padding can add a chunk to the header, so check again
+        uintmax_t missing = alignment - end % alignment;
+        if (padding == 0 && missing < min_tag_size)
+        {
+            missing += ((min_tag_size - missing) / alignment + 1) * alignment;
+        }
+        if (padding + missing < padding)
+        {
+            retval = GTA_OVERFLOW;
+            break;
+        }
+        padding += missing;
+    }
+    header->padding = old_padding;
+    return retval;
+}
+
 
 /*
  *
@@ -3278,37 +4248,55 @@ gta_read_data(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data,
 #if WITH_COMPRESSION
         char *data_ptr = data;
         size_t remaining_size = gta_get_data_size(header);
+        struct gta_chunk_buffers buffers;
         void *chunk;
         size_t chunk_size;
-        gta_result_t retval;
+        gta_result_t retval = GTA_OK;
 
-        for (;;)
+#ifdef HAVE_PTHREAD
+        if (remaining_size > gta_max_chunk_size)
         {
-            retval = gta_read_chunk(header, &chunk, &chunk_size, read_fn, userdata);
+            retval = gta_read_data_pipelined(header, read_fn, userdata, data, NULL, 0);
             if (retval != GTA_OK)
             {
                 return retval;
             }
-            if (chunk_size == 0)
+        }
+        else
+#endif
+        {
+            // Chunks that fit are read directly into the data; only an oversized
+            // (and therefore invalid) chunk ends up in the buffers.
+            gta_init_chunk_buffers(&buffers);
+            for (;;)
             {
-                if (remaining_size == 0)
+                retval = gta_read_chunk(header, &buffers, data_ptr, remaining_size,
+                        &chunk, &chunk_size, read_fn, userdata);
+                if (retval != GTA_OK)
                 {
                     break;
                 }
-                else
+                if (chunk_size == 0)
+                {
+                    if (remaining_size > 0)
+                    {
+                        retval = GTA_INVALID_DATA;
+                    }
+                    break;
+                }
+                if (chunk_size > remaining_size)
                 {
-                    return GTA_INVALID_DATA;
+                    retval = GTA_INVALID_DATA;
+                    break;
                 }
+                remaining_size -= chunk_size;
+                data_ptr += chunk_size;
             }
-            if (chunk_size > remaining_size)
+            gta_free_chunk_buffers(&buffers);
+            if (retval != GTA_OK)
             {
-                free(chunk);
-                return GTA_INVALID_DATA;
+                return retval;
             }
-            memcpy(data_ptr, chunk, chunk_size);
-            free(chunk);
-            remaining_size -= chunk_size;
-            data_ptr += chunk_size;
         }
 #else
         return GTA_UNSUPPORTED_DATA;
@@ -3329,11 +4317,7 @@ gta_read_data(const gta_header_t *GTA_RESTRICT header, void *GTA_RESTRICT data,
     }
     if (gta_data_needs_endianness_swapping(header))
     {
-        for (uintmax_t i = 0; i < gta_get_elements(header); i++)
-        {
-            void *e = gta_get_element_linear(header, data, i);
-            gta_swap_element_endianness(header, e);
-        }
+        gta_swap_elements_endianness(header, data, gta_get_elements(header));
     }
     return GTA_OK;
 }
@@ -3496,20 +4480,27 @@ gta_copy_data(const gta_header_t *GTA_RESTRICT read_header, gta_read_t read_fn,
     if (gta_get_compression(read_header) != GTA_NONE)
     {
 #if WITH_COMPRESSION
-        void *chunk = NULL;
+        struct gta_chunk_buffers buffers;
+        void *chunk;
         size_t chunk_size = 0;
+#ifdef HAVE_PTHREAD
+        if (size > gta_max_chunk_size)
+        {
+            return gta_read_data_pipelined(read_header, read_fn, read_userdata, NULL, write_fn, write_userdata);
+        }
+#endif
+        gta_init_chunk_buffers(&buffers);
         do
         {
-            retval = gta_read_chunk(read_header, &chunk, &chunk_size, read_fn, read_userdata);
+            retval = gta_read_chunk(read_header, &buffers, NULL, 0, &chunk, &chunk_size, read_fn, read_userdata);
             if (retval != GTA_OK)
             {
-                free(chunk);
-                return retval;
+                break;
             }
             if (chunk_size > size)
             {
-                free(chunk);
-                return GTA_INVALID_DATA;
+                retval = GTA_INVALID_DATA;
+                break;
             }
             int error = false;
             errno = 0;
@@ -3521,15 +4512,16 @@ gta_copy_data(const gta_header_t *GTA_RESTRICT read_header, gta_read_t read_fn,
                     errno = EIO;
                 }
                 retval = GTA_SYSTEM_ERROR;
-            }
-            free(chunk);
-            if (retval != GTA_OK)
-            {
-                return retval;
+                break;
             }
             size -= chunk_size;
         }
         while (chunk_size > 0);
+        gta_free_chunk_buffers(&buffers);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
         if (size > 0)
         {
             return GTA_UNEXPECTED_EOF;
@@ -3613,6 +4605,155 @@ gta_copy_data_fd(
  *
  */
 
+/*
+ * Asynchronous element input/output.
+ *
+ * In asynchronous mode, a background job reads the next input chunk while the
+ * caller consumes the current one, or writes a full output chunk while the caller
+ * fills the next one. A state has at most one job in progress, so the input/output
+ * functions are never called concurrently.
+ */
+
+struct gta_io_job
+{
+#ifdef HAVE_PTHREAD
+    pthread_t thread;
+#endif
+    bool running;               // whether the thread was started and not yet joined
+    bool pending;               // whether the job was started and its result not yet collected
+    const gta_header_t *header; // only for input
+    gta_read_t read_fn;         // the custom input function, or NULL for output
+    gta_write_t write_fn;       // the custom output function, or NULL for input
+    intptr_t userdata;
+    struct gta_chunk_buffers buffers; // the chunk that is read or written
+    uintmax_t already_read;     // only for input: number of data bytes read before this chunk
+    size_t size;                // size of the chunk that is read or written
+    gta_result_t result;
+    int errnum;                 // errno value if result is GTA_SYSTEM_ERROR
+};
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_create_io_job(struct gta_io_job **job)
+{
+    *job = malloc(sizeof(struct gta_io_job));
+    if (!*job)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    (*job)->running = false;
+    (*job)->pending = false;
+    gta_init_chunk_buffers(&((*job)->buffers));
+    return GTA_OK;
+}
+
+/* Read the next chunk of element-based input into the given buffers. */
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL3(1, 2, 4)
+gta_result_t
+gta_read_elements_chunk(const gta_header_t *GTA_RESTRICT header, struct gta_chunk_buffers *GTA_RESTRICT buffers,
+        uintmax_t already_read, size_t *chunk_size, gta_read_t read_fn, intptr_t userdata)
+{
+    uintmax_t remaining_size = gta_get_data_size(header) - already_read;
+    gta_result_t retval = GTA_OK;
+
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+#if WITH_COMPRESSION
+        void *chunk;
+        retval = gta_read_chunk(header, buffers, NULL, 0, &chunk, chunk_size, read_fn, userdata);
+        if (retval == GTA_OK && (*chunk_size == 0 || *chunk_size > remaining_size))
+        {
+            retval = GTA_INVALID_DATA;
+        }
+#else
+        retval = GTA_UNSUPPORTED_DATA;
+#endif
+    }
+    else
+    {
+        *chunk_size = (remaining_size < gta_max_chunk_size ? remaining_size : gta_max_chunk_size);
+        retval = gta_reserve_buffer(&(buffers->chunk), &(buffers->chunk_alloc), *chunk_size);
+        if (retval == GTA_OK)
+        {
+            retval = gta_read_fully(buffers->chunk, *chunk_size, read_fn, userdata);
+        }
+    }
+    return retval;
+}
+
+static GTA_ATTR_NOTHROW
+void *gta_io_job_run(void *arg)
+{
+    struct gta_io_job *job = arg;
+
+    errno = 0;
+    if (job->read_fn)
+    {
+        job->result = gta_read_elements_chunk(job->header, &(job->buffers), job->already_read,
+                &(job->size), job->read_fn, job->userdata);
+    }
+    else
+    {
+        job->result = gta_write_fully(job->buffers.chunk, job->size, job->write_fn, job->userdata);
+    }
+    job->errnum = errno;
+    return NULL;
+}
+
+/* Start the job in a background thread, or run it right away if that is not possible. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_io_job_start(struct gta_io_job *job)
+{
+    job->pending = true;
+#ifdef HAVE_PTHREAD
+    job->running = (pthread_create(&(job->thread), NULL, gta_io_job_run, job) == 0);
+#endif
+    if (!job->running)
+    {
+        gta_io_job_run(job);
+    }
+}
+
+/* Wait until the job is finished and collect its result. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_io_job_wait(struct gta_io_job *job)
+{
+#ifdef HAVE_PTHREAD
+    if (job->running)
+    {
+        pthread_join(job->thread, NULL);
+        job->running = false;
+    }
+#endif
+    if (!job->pending)
+    {
+        return GTA_OK;
+    }
+    job->pending = false;
+    if (job->result == GTA_SYSTEM_ERROR)
+    {
+        errno = job->errnum;
+    }
+    return job->result;
+}
+
+/* Finish all background input/output and free the chunk buffers of the state. */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void
+gta_io_state_free_buffers(gta_io_state_t *GTA_RESTRICT io_state)
+{
+    if (io_state->job)
+    {
+        int errnum = errno;
+        (void)gta_io_job_wait(io_state->job);
+        gta_free_chunk_buffers(&(io_state->job->buffers));
+        errno = errnum;
+    }
+    gta_free_chunk_buffers(&(io_state->buffers));
+}
+
 gta_result_t
 gta_create_io_state(gta_io_state_t *GTA_RESTRICT *GTA_RESTRICT io_state)
 {
@@ -3624,17 +4765,46 @@ gta_create_io_state(gta_io_state_t *GTA_RESTRICT *GTA_RESTRICT io_state)
     (*io_state)->io_type = 0;
     (*io_state)->failure = false;
     (*io_state)->counter = 0;
-    (*io_state)->chunk = NULL;
+    gta_init_chunk_buffers(&((*io_state)->buffers));
     (*io_state)->chunk_size = 0;
     (*io_state)->chunk_index = 0;
     (*io_state)->already_read = 0;
+    (*io_state)->lent = 0;
+    (*io_state)->lent_from_buf = false;
+    (*io_state)->lend_buf = NULL;
+    (*io_state)->lend_buf_size = 0;
+    (*io_state)->job = NULL;
+    return GTA_OK;
+}
+
+gta_result_t
+gta_set_io_state_async(gta_io_state_t *GTA_RESTRICT io_state, int async)
+{
+    if (io_state->io_type != 0)
+    {
+        return GTA_INVALID_DATA;
+    }
+#ifdef HAVE_PTHREAD
+    if (async && !io_state->job)
+    {
+        return gta_create_io_job(&(io_state->job));
+    }
+#endif
+    if (!async && io_state->job)
+    {
+        gta_io_state_free_buffers(io_state);
+        free(io_state->job);
+        io_state->job = NULL;
+    }
     return GTA_OK;
 }
 
 void
 gta_destroy_io_state(gta_io_state_t *GTA_RESTRICT io_state)
 {
-    free(io_state->chunk);
+    gta_io_state_free_buffers(io_state);
+    free(io_state->job);
+    free(io_state->lend_buf);
     free(io_state);
 }
 
@@ -3643,46 +4813,210 @@ gta_clone_io_state(gta_io_state_t *GTA_RESTRICT dst_io_state,
         const gta_io_state_t *GTA_RESTRICT src_io_state)
 {
     void *chunk = NULL;
+    void *lend_buf = NULL;
+    struct gta_io_job *job = NULL;
 
-    if (src_io_state->chunk)
+    if (src_io_state->job && src_io_state->job->pending)
+    {
+        // the state of the input/output is not known yet
+        return GTA_INVALID_DATA;
+    }
+    if (src_io_state->buffers.chunk)
     {
         chunk = malloc(src_io_state->chunk_size);
         if (!chunk)
         {
             return GTA_SYSTEM_ERROR;
         }
-        memcpy(chunk, src_io_state->chunk, src_io_state->chunk_size);
+        memcpy(chunk, src_io_state->buffers.chunk, src_io_state->chunk_size);
+    }
+    if (src_io_state->lend_buf)
+    {
+        lend_buf = malloc(src_io_state->lend_buf_size);
+        if (!lend_buf)
+        {
+            free(chunk);
+            return GTA_SYSTEM_ERROR;
+        }
+        memcpy(lend_buf, src_io_state->lend_buf, src_io_state->lend_buf_size);
+    }
+    if (src_io_state->job && gta_create_io_job(&job) != GTA_OK)
+    {
+        free(chunk);
+        free(lend_buf);
+        return GTA_SYSTEM_ERROR;
     }
-    free(dst_io_state->chunk);
+    gta_io_state_free_buffers(dst_io_state);
+    free(dst_io_state->job);
+    free(dst_io_state->lend_buf);
     dst_io_state->io_type = src_io_state->io_type;
     dst_io_state->failure = src_io_state->failure;
     dst_io_state->counter = src_io_state->counter;
-    dst_io_state->chunk = chunk;
+    dst_io_state->buffers.chunk = chunk;
+    dst_io_state->buffers.chunk_alloc = (chunk ? src_io_state->chunk_size : 0);
     dst_io_state->chunk_size = src_io_state->chunk_size;
     dst_io_state->chunk_index = src_io_state->chunk_index;
     dst_io_state->already_read = src_io_state->already_read;
+    dst_io_state->lent = src_io_state->lent;
+    dst_io_state->lent_from_buf = src_io_state->lent_from_buf;
+    dst_io_state->lend_buf = lend_buf;
+    dst_io_state->lend_buf_size = src_io_state->lend_buf_size;
+    dst_io_state->job = job;
     return GTA_OK;
 }
 
-gta_result_t
-gta_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
-        uintmax_t n, void *GTA_RESTRICT buf, gta_read_t read_fn, intptr_t userdata)
+/* Replace the current input chunk with the next one. */
+static gta_result_t
+gta_read_elements_next_chunk(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_read_t read_fn, intptr_t userdata)
 {
-    gta_result_t retval = GTA_OK;
+    struct gta_io_job *job = io_state->job;
+    gta_result_t retval;
 
-    if (io_state->io_type == 0)
+    if (job && job->pending)
     {
-        io_state->io_type = 1;
+        // the chunk was read ahead
+        struct gta_chunk_buffers tmp = io_state->buffers;
+        retval = gta_io_job_wait(job);
+        io_state->buffers = job->buffers;
+        io_state->chunk_size = job->size;
+        job->buffers = tmp;
     }
-    if (io_state->io_type != 1)
+    else
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        retval = gta_read_elements_chunk(header, &(io_state->buffers), io_state->already_read,
+                &(io_state->chunk_size), read_fn, userdata);
     }
-    if (io_state->failure)
+    if (retval != GTA_OK)
     {
-        retval = GTA_INVALID_DATA;
-        goto exit;
+        return retval;
+    }
+    io_state->already_read += io_state->chunk_size;
+    io_state->chunk_index = 0;
+    if (job && io_state->already_read < gta_get_data_size(header))
+    {
+        // read the next chunk ahead
+        job->header = header;
+        job->read_fn = read_fn;
+        job->write_fn = NULL;
+        job->userdata = userdata;
+        job->already_read = io_state->already_read;
+        gta_io_job_start(job);
+    }
+    return GTA_OK;
+}
+
+/* Finish reading after the last element was consumed. */
+static gta_result_t
+gta_read_elements_finish(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+#if WITH_COMPRESSION
+        if (io_state->chunk_index != io_state->chunk_size)
+        {
+            return GTA_INVALID_DATA;
+        }
+        // read the last, empty chunk
+        void *chunk;
+        retval = gta_read_chunk(header, &(io_state->buffers), NULL, 0,
+                &chunk, &(io_state->chunk_size), read_fn, userdata);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        if (io_state->chunk_size != 0)
+        {
+            return GTA_INVALID_DATA;
+        }
+        // free the buffers; they will not be needed anymore
+        gta_io_state_free_buffers(io_state);
+#else
+        (void)read_fn;
+        (void)userdata;
+        return GTA_UNSUPPORTED_DATA;
+#endif
+    }
+    else
+    {
+        // free the chunk; it will not be needed anymore
+        gta_io_state_free_buffers(io_state);
+    }
+    return retval;
+}
+
+/* Write the first size bytes of the current output chunk. Unless this is the final
+ * chunk, asynchronous output writes it in the background and continues with a
+ * new buffer of chunk_size bytes. */
+static gta_result_t
+gta_write_elements_flush(gta_io_state_t *GTA_RESTRICT io_state, size_t size, bool final,
+        gta_write_t write_fn, intptr_t userdata)
+{
+    struct gta_io_job *job = io_state->job;
+
+    if (job)
+    {
+        gta_result_t retval = gta_io_job_wait(job);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        if (!final)
+        {
+            struct gta_chunk_buffers tmp = io_state->buffers;
+            io_state->buffers = job->buffers;
+            job->buffers = tmp;
+            job->read_fn = NULL;
+            job->write_fn = write_fn;
+            job->userdata = userdata;
+            job->size = size;
+            gta_io_job_start(job);
+            return gta_reserve_buffer(&(io_state->buffers.chunk), &(io_state->buffers.chunk_alloc),
+                    io_state->chunk_size);
+        }
+    }
+    return (size > 0 ? gta_write_fully(io_state->buffers.chunk, size, write_fn, userdata) : GTA_OK);
+}
+
+/* Make sure the lend buffer can hold one element of the given size. */
+static gta_result_t
+gta_lend_buf_reserve(gta_io_state_t *GTA_RESTRICT io_state, size_t size)
+{
+    if (io_state->lend_buf_size < size)
+    {
+        void *lend_buf = realloc(io_state->lend_buf, size);
+        if (!lend_buf)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        io_state->lend_buf = lend_buf;
+        io_state->lend_buf_size = size;
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, void *GTA_RESTRICT buf, gta_read_t read_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (io_state->io_type == 0)
+    {
+        io_state->io_type = 1;
+    }
+    if (io_state->io_type != 1)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (io_state->failure || io_state->lent > 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
     }
     if (n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
     {
@@ -3706,119 +5040,39 @@ gta_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_R
     {
         if (io_state->chunk_index == io_state->chunk_size)
         {
-            if (gta_get_compression(header) != GTA_NONE)
-            {
-#if WITH_COMPRESSION
-                free(io_state->chunk);
-                io_state->chunk = NULL;
-                gta_result_t retval = gta_read_chunk(header, &(io_state->chunk),
-                        &(io_state->chunk_size), read_fn, userdata);
-#else
-                gta_result_t retval = GTA_UNSUPPORTED_DATA;
-
-#endif
-                if (retval != GTA_OK)
-                {
-                    goto exit;
-                }
-            }
-            else
+            retval = gta_read_elements_next_chunk(header, io_state, read_fn, userdata);
+            if (retval != GTA_OK)
             {
-                size_t chunk_size = gta_max_chunk_size;
-                if (!io_state->chunk)
-                {
-                    if (gta_get_data_size(header) < chunk_size)
-                    {
-                        chunk_size = gta_get_data_size(header);
-                    }
-                    io_state->chunk = malloc(chunk_size);
-                    if (!io_state->chunk)
-                    {
-                        retval = GTA_SYSTEM_ERROR;
-                        goto exit;
-                    }
-                }
-                uintmax_t read_size = gta_get_data_size(header) - io_state->already_read;
-                if (read_size > chunk_size)
-                {
-                    read_size = chunk_size;
-                }
-                int error = false;
-                size_t r = read_fn(userdata, io_state->chunk, read_size, &error);
-                if (error)
-                {
-                    retval = GTA_SYSTEM_ERROR;
-                    goto exit;
-                }
-                if (r < read_size)
-                {
-                    retval = GTA_UNEXPECTED_EOF;
-                    goto exit;
-                }
-                io_state->chunk_size = read_size;
-                io_state->already_read += read_size;
+                goto exit;
             }
-            io_state->chunk_index = 0;
         }
         size_t l = size - i;
         if (l > io_state->chunk_size - io_state->chunk_index)
         {
             l = io_state->chunk_size - io_state->chunk_index;
         }
-        memcpy((char *)buf + i, (char *)(io_state->chunk) + io_state->chunk_index, l);
+        memcpy((char *)buf + i, (char *)(io_state->buffers.chunk) + io_state->chunk_index, l);
         i += l;
         io_state->chunk_index += l;
     }
     io_state->counter += n;
     if (io_state->counter == gta_get_elements(header))
     {
-        if (gta_get_compression(header) != GTA_NONE)
+        retval = gta_read_elements_finish(header, io_state, read_fn, userdata);
+        if (retval != GTA_OK)
         {
-#if WITH_COMPRESSION
-            if (io_state->chunk_index != io_state->chunk_size)
-            {
-                retval = GTA_INVALID_DATA;
-                goto exit;
-            }
-            // read the last, empty chunk
-            free(io_state->chunk);
-            io_state->chunk = NULL;
-            retval = gta_read_chunk(header, &(io_state->chunk),
-                    &(io_state->chunk_size), read_fn, userdata);
-            if (retval != GTA_OK)
-            {
-                goto exit;
-            }
-            if (io_state->chunk_size != 0)
-            {
-                retval = GTA_INVALID_DATA;
-                goto exit;
-            }
-#else
-            retval = GTA_UNSUPPORTED_DATA;
             goto exit;
-#endif
-        }
-        else
-        {
-            // free the chunk; it will not be needed anymore
-            free(io_state->chunk);
-            io_state->chunk = NULL;
         }
     }
     if (gta_data_needs_endianness_swapping(header))
     {
-        for (uintmax_t i = 0; i < n; i++)
-        {
-            gta_swap_element_endianness(header, (char *)buf + i * s);
-        }
+        gta_swap_elements_endianness(header, buf, n);
     }
 exit:
     if (retval != GTA_OK)
     {
         io_state->failure = true;
-        free(io_state->chunk);
-        io_state->chunk = NULL;
+        gta_io_state_free_buffers(io_state);
     }
     return retval;
 }
@@ -3852,7 +5106,7 @@ gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_
         retval = GTA_INVALID_DATA;
         goto exit;
     }
-    if (io_state->failure)
+    if (io_state->failure || io_state->lent > 0)
     {
         retval = GTA_INVALID_DATA;
         goto exit;
@@ -3874,15 +5128,14 @@ gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_
     {
         if (io_state->chunk_index == io_state->chunk_size)
         {
-            if (!io_state->chunk)
+            if (!io_state->buffers.chunk)
             {
                 size_t chunk_size = gta_max_chunk_size;
                 if (gta_get_data_size(header) < chunk_size)
                 {
                     chunk_size = gta_get_data_size(header);
                 }
-                io_state->chunk = malloc(chunk_size);
-                if (!io_state->chunk)
+                if (gta_reserve_buffer(&(io_state->buffers.chunk), &(io_state->buffers.chunk_alloc), chunk_size) != GTA_OK)
                 {
                     retval = GTA_SYSTEM_ERROR;
                     goto exit;
@@ -3891,16 +5144,9 @@ gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_
             }
             if (io_state->chunk_index > 0)
             {
-                int error = false;
-                errno = 0;
-                size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_size, &error);
-                if (error || r < io_state->chunk_size)
+                retval = gta_write_elements_flush(io_state, io_state->chunk_size, false, write_fn, userdata);
+                if (retval != GTA_OK)
                 {
-                    if (errno == 0)
-                    {
-                        errno = EIO;
-                    }
-                    retval = GTA_SYSTEM_ERROR;
                     goto exit;
                 }
             }
@@ -3911,7 +5157,7 @@ gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_
         {
             l = io_state->chunk_size - io_state->chunk_index;
         }
-        memcpy((char *)(io_state->chunk) + io_state->chunk_index, (char *)buf + i, l);
+        memcpy((char *)(io_state->buffers.chunk) + io_state->chunk_index, (char *)buf + i, l);
         i += l;
         io_state->chunk_index += l;
     }
@@ -3919,31 +5165,19 @@ gta_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_
     if (io_state->counter == gta_get_elements(header))
     {
         // flush
-        if (io_state->chunk_index > 0)
+        retval = gta_write_elements_flush(io_state, io_state->chunk_index, true, write_fn, userdata);
+        if (retval != GTA_OK)
         {
-            int error = false;
-            errno = 0;
-            size_t r = write_fn(userdata, io_state->chunk, io_state->chunk_index, &error);
-            if (error || r < io_state->chunk_index)
-            {
-                if (errno == 0)
-                {
-                    errno = EIO;
-                }
-                retval = GTA_SYSTEM_ERROR;
-                goto exit;
-            }
+            goto exit;
         }
         // free the chunk; it will not be needed anymore
-        free(io_state->chunk);
-        io_state->chunk = NULL;
+        gta_io_state_free_buffers(io_state);
     }
 exit:
     if (retval != GTA_OK)
     {
         io_state->failure = true;
-        free(io_state->chunk);
-        io_state->chunk = NULL;
+        gta_io_state_free_buffers(io_state);
     }
     return retval;
 }
@@ -3962,249 +5196,1609 @@ gta_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t
     return gta_write_elements(header, io_state, n, buf, gta_write_fd, fd);
 }
 
-
-/*
- *
- * Read and Write Array Blocks
- *
- */
-
-
-/**
- * \brief               Get the offset of an array element.
- * \param header        The header.
- * \param indices       The indices for each dimension of the array.
- * \return              The offset of the element, relative to the start of the data.
- */
-static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
-intmax_t
-gta_get_element_offset(const gta_header_t *GTA_RESTRICT header, const uintmax_t *GTA_RESTRICT indices)
+gta_result_t
+gta_lend_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf,
+        gta_read_t read_fn, intptr_t userdata)
 {
-    uintmax_t index = 0;
-    uintmax_t dim_product = 1;
-    for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
+    gta_result_t retval = GTA_OK;
+
+    *lent = 0;
+    *buf = NULL;
+    if (io_state->io_type == 0)
     {
-        if (i > 0)
-        {
-            dim_product *= gta_get_dimension_size(header, i - 1);
-        }
-        index += indices[i] * dim_product;
+        io_state->io_type = 1;
     }
-    return index * gta_get_element_size(header);
-}
-
-gta_result_t
-gta_read_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
-{
-    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    if (io_state->io_type != 1)
     {
-        return GTA_UNSUPPORTED_DATA;
+        retval = GTA_INVALID_DATA;
+        goto exit;
     }
-    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
-            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
-            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    if (io_state->failure || io_state->lent > 0)
     {
-        return GTA_OVERFLOW;
+        retval = GTA_INVALID_DATA;
+        goto exit;
     }
-
-    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
-    if (!coords)
+    if (n == 0 || n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
     {
-        return GTA_SYSTEM_ERROR;
+        retval = GTA_INVALID_DATA;
+        goto exit;
     }
-
-    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
-    uintmax_t dim0_len = higher_coordinates[0] - lower_coordinates[0] + 1;
-    uintmax_t dim0_datalen = dim0_len * gta_get_element_size(header);
-    char *block_ptr = block;
-    gta_result_t retval = GTA_OK;
-
-    for (;;)
+    uintmax_t s = gta_get_element_size(header);
+    if (s == 0)
     {
-        intmax_t o = gta_get_element_offset(header, coords);
-        // Read data
-        int error = false;
-        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
-        if (error)
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (s > SIZE_MAX)
+    {
+        retval = GTA_OVERFLOW;
+        goto exit;
+    }
+    if (io_state->chunk_index == io_state->chunk_size)
+    {
+        retval = gta_read_elements_next_chunk(header, io_state, read_fn, userdata);
+        if (retval != GTA_OK)
         {
-            retval = GTA_SYSTEM_ERROR;
-            break;
+            goto exit;
         }
-        size_t r = read_fn(userdata, block_ptr, dim0_datalen, &error);
-        if (error)
+    }
+    uintmax_t m = (io_state->chunk_size - io_state->chunk_index) / s;
+    if (m == 0)
+    {
+        // The next element crosses a chunk boundary. Read it into the lend buffer.
+        retval = gta_lend_buf_reserve(io_state, s);
+        if (retval != GTA_OK)
         {
-            retval = GTA_SYSTEM_ERROR;
-            break;
+            goto exit;
         }
-        if (r < dim0_datalen)
+        retval = gta_read_elements(header, io_state, 1, io_state->lend_buf, read_fn, userdata);
+        if (retval != GTA_OK)
         {
-            retval = GTA_UNEXPECTED_EOF;
-            break;
+            return retval;
         }
-        // Fix endianness
-        if (gta_data_needs_endianness_swapping(header))
+        io_state->lent = 1;
+        io_state->lent_from_buf = true;
+        *lent = 1;
+        *buf = io_state->lend_buf;
+    }
+    else
+    {
+        if (m > n)
         {
-            for (uintmax_t i = 0; i < dim0_len; i++)
-            {
-                void *e = block_ptr + i * gta_get_element_size(header);
-                gta_swap_element_endianness(header, e);
-            }
+            m = n;
         }
-        // Increase block index and coordinates
-        block_ptr += dim0_datalen;
-        uintmax_t d;
-        for (d = 1; d < gta_get_dimensions(header); d++)
+        char *ptr = (char *)(io_state->buffers.chunk) + io_state->chunk_index;
+        if (gta_data_needs_endianness_swapping(header))
         {
-            if (coords[d] < higher_coordinates[d])
-            {
-                coords[d]++;
-                break;
-            }
+            gta_swap_elements_endianness(header, ptr, m);
+        }
+        io_state->lent = m;
+        io_state->lent_from_buf = false;
+        *lent = m;
+        *buf = ptr;
+    }
+exit:
+    if (retval != GTA_OK)
+    {
+        io_state->failure = true;
+        gta_io_state_free_buffers(io_state);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_lend_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+{
+    return gta_lend_read_elements(header, io_state, n, lent, buf, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_lend_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf, int fd)
+{
+    return gta_lend_read_elements(header, io_state, n, lent, buf, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_commit_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_read_t read_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (io_state->io_type != 1 || io_state->failure || io_state->lent == 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (!io_state->lent_from_buf)
+    {
+        // gta_lend_read_elements() guarantees that this does not overflow
+        io_state->chunk_index += io_state->lent * gta_get_element_size(header);
+        io_state->counter += io_state->lent;
+        if (io_state->counter == gta_get_elements(header))
+        {
+            retval = gta_read_elements_finish(header, io_state, read_fn, userdata);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
+        }
+    }
+    // else: the element was already consumed by gta_read_elements()
+    io_state->lent = 0;
+    io_state->lent_from_buf = false;
+exit:
+    if (retval != GTA_OK)
+    {
+        io_state->failure = true;
+        gta_io_state_free_buffers(io_state);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_commit_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        FILE *GTA_RESTRICT f)
+{
+    return gta_commit_read_elements(header, io_state, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_commit_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        int fd)
+{
+    return gta_commit_read_elements(header, io_state, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_lend_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf,
+        gta_write_t write_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    *lent = 0;
+    *buf = NULL;
+    if (io_state->io_type == 0)
+    {
+        io_state->io_type = 2;
+    }
+    if (io_state->io_type != 2)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (io_state->failure || io_state->lent > 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (n == 0 || n > gta_get_elements(header) || io_state->counter > gta_get_elements(header) - n)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    uintmax_t s = gta_get_element_size(header);
+    if (s == 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (s > SIZE_MAX)
+    {
+        retval = GTA_OVERFLOW;
+        goto exit;
+    }
+    if (!io_state->buffers.chunk)
+    {
+        size_t chunk_size = gta_max_chunk_size;
+        if (gta_get_data_size(header) < chunk_size)
+        {
+            chunk_size = gta_get_data_size(header);
+        }
+        if (gta_reserve_buffer(&(io_state->buffers.chunk), &(io_state->buffers.chunk_alloc), chunk_size) != GTA_OK)
+        {
+            retval = GTA_SYSTEM_ERROR;
+            goto exit;
+        }
+        io_state->chunk_size = chunk_size;
+        io_state->chunk_index = 0;
+    }
+    if (io_state->chunk_index == io_state->chunk_size)
+    {
+        retval = gta_write_elements_flush(io_state, io_state->chunk_size, false, write_fn, userdata);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        io_state->chunk_index = 0;
+    }
+    uintmax_t m = (io_state->chunk_size - io_state->chunk_index) / s;
+    if (m == 0)
+    {
+        // The next element crosses a chunk boundary. Lend the lend buffer instead;
+        // gta_commit_write_elements() will write it with gta_write_elements().
+        retval = gta_lend_buf_reserve(io_state, s);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        io_state->lent = 1;
+        io_state->lent_from_buf = true;
+        *lent = 1;
+        *buf = io_state->lend_buf;
+    }
+    else
+    {
+        if (m > n)
+        {
+            m = n;
+        }
+        io_state->lent = m;
+        io_state->lent_from_buf = false;
+        *lent = m;
+        *buf = (char *)(io_state->buffers.chunk) + io_state->chunk_index;
+    }
+exit:
+    if (retval != GTA_OK)
+    {
+        io_state->failure = true;
+        gta_io_state_free_buffers(io_state);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_lend_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+{
+    return gta_lend_write_elements(header, io_state, n, lent, buf, gta_write_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_lend_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf, int fd)
+{
+    return gta_lend_write_elements(header, io_state, n, lent, buf, gta_write_fd, fd);
+}
+
+gta_result_t
+gta_commit_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_write_t write_fn, intptr_t userdata)
+{
+    gta_result_t retval = GTA_OK;
+
+    if (io_state->io_type != 2 || io_state->failure || io_state->lent == 0)
+    {
+        retval = GTA_INVALID_DATA;
+        goto exit;
+    }
+    if (io_state->lent_from_buf)
+    {
+        io_state->lent = 0;
+        io_state->lent_from_buf = false;
+        return gta_write_elements(header, io_state, 1, io_state->lend_buf, write_fn, userdata);
+    }
+    // gta_lend_write_elements() guarantees that this does not overflow
+    io_state->chunk_index += io_state->lent * gta_get_element_size(header);
+    io_state->counter += io_state->lent;
+    io_state->lent = 0;
+    if (io_state->counter == gta_get_elements(header))
+    {
+        // flush
+        retval = gta_write_elements_flush(io_state, io_state->chunk_index, true, write_fn, userdata);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        // free the chunk; it will not be needed anymore
+        gta_io_state_free_buffers(io_state);
+    }
+exit:
+    if (retval != GTA_OK)
+    {
+        io_state->failure = true;
+        gta_io_state_free_buffers(io_state);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_commit_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        FILE *GTA_RESTRICT f)
+{
+    return gta_commit_write_elements(header, io_state, gta_write_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_commit_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        int fd)
+{
+    return gta_commit_write_elements(header, io_state, gta_write_fd, fd);
+}
+
+
+/*
+ *
+ * Read and Write Array Blocks
+ *
+ */
+
+
+/**
+ * \brief               Get the offset of an array element.
+ * \param header        The header.
+ * \param indices       The indices for each dimension of the array.
+ * \return              The offset of the element, relative to the start of the data.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+intmax_t
+gta_get_element_offset(const gta_header_t *GTA_RESTRICT header, const uintmax_t *GTA_RESTRICT indices)
+{
+    uintmax_t index = 0;
+    uintmax_t dim_product = 1;
+    for (uintmax_t i = 0; i < gta_get_dimensions(header); i++)
+    {
+        if (i > 0)
+        {
+            dim_product *= gta_get_dimension_size(header, i - 1);
+        }
+        index += indices[i] * dim_product;
+    }
+    return index * gta_get_element_size(header);
+}
+
+/*
+ * Block input.
+ *
+ * A block is read as a sequence of runs. A run covers the block range in the
+ * lowest dimension that the block does not span completely, together with all
+ * dimensions below it (which the block does span completely), and is therefore
+ * contiguous in the array data. Runs that are separated by small gaps are
+ * merged into a single span that is read with one call; the gap bytes are
+ * discarded. A gap is only considered small if it is not larger than a run or
+ * a page, so that sparse blocks do not read much more than the block data.
+ */
+
+/* Gaps between runs up to this size are read and discarded instead of skipped,
+ * if they are not larger than a run or than gta_block_page_gap. */
+static const uintmax_t gta_block_max_gap = 64 * 1024;
+static const uintmax_t gta_block_page_gap = 4 * 1024;
+/* Maximum size of a merged span that is read via a scratch buffer. */
+static const uintmax_t gta_block_max_span = 4 * 1024 * 1024;
+/* Number of dimensions up to which the coordinates are kept on the stack. */
+#define GTA_BLOCK_STACK_DIMENSIONS 16
+#ifdef HAVE_PREADV
+/* Maximum number of I/O vectors per preadv() call. */
+#   if defined IOV_MAX && IOV_MAX < 256
+#       define GTA_BLOCK_MAX_IOV IOV_MAX
+#   else
+#       define GTA_BLOCK_MAX_IOV 256
+#   endif
+#endif
+
+/**
+ * \brief                       Advance to the next run of a block.
+ * \param header                The header.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param run_dimension         The highest dimension covered by a run.
+ * \param coords                The coordinates of the first element of the current run.
+ * \return                      Whether there is a next run.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+bool
+gta_block_next_run(const gta_header_t *GTA_RESTRICT header,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        uintmax_t run_dimension, uintmax_t *GTA_RESTRICT coords)
+{
+    for (uintmax_t d = run_dimension + 1; d < gta_get_dimensions(header); d++)
+    {
+        if (coords[d] < higher_coordinates[d])
+        {
+            coords[d]++;
+            return true;
+        }
+        coords[d] = lower_coordinates[d];
+    }
+    return false;
+}
+
+/**
+ * \brief               Make sure that a buffer has at least a given size.
+ * \param buf           The buffer.
+ * \param buf_size      The buffer size.
+ * \param size          The required size.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_block_buf_reserve(char **buf, size_t *buf_size, uintmax_t size)
+{
+    if (size > *buf_size)
+    {
+        if (size > SIZE_MAX)
+        {
+            errno = EOVERFLOW;
+            return GTA_SYSTEM_ERROR;
+        }
+        char *new_buf = realloc(*buf, size);
+        if (!new_buf)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        *buf = new_buf;
+        *buf_size = size;
+    }
+    return GTA_OK;
+}
+
+#ifdef HAVE_PREADV
+/**
+ * \brief               Read into I/O vectors at a given offset, until all vectors are full.
+ * \param fd            The file descriptor.
+ * \param iov           The I/O vectors. These are modified.
+ * \param iovcnt        The number of I/O vectors.
+ * \param offset        The file offset.
+ * \param io_calls      The number of I/O calls, which is incremented.
+ * \return              \a GTA_OK, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_block_preadv(int fd, struct iovec *iov, int iovcnt, intmax_t offset, uintmax_t *io_calls)
+{
+    while (iovcnt > 0)
+    {
+        if (offset > OFF_MAX)
+        {
+            errno = EOVERFLOW;
+            return GTA_SYSTEM_ERROR;
+        }
+        ssize_t r = preadv(fd, iov, iovcnt, offset);
+        (*io_calls)++;
+        if (r < 0)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        if (r == 0)
+        {
+            return GTA_UNEXPECTED_EOF;
+        }
+        offset += r;
+        while (iovcnt > 0 && (size_t)r >= iov->iov_len)
+        {
+            r -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+    return GTA_OK;
+}
+#endif
+
+/**
+ * \brief               Read into a buffer from a given offset, until it is full.
+ * \param fd            The file descriptor.
+ * \param buf           The buffer.
+ * \param size          The size of the buffer.
+ * \param offset        The file offset.
+ * \param io_calls      The number of I/O calls, which is incremented.
+ * \return              \a GTA_OK, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_pread_fully(int fd, void *GTA_RESTRICT buf, uintmax_t size, intmax_t offset, uintmax_t *io_calls)
+{
+#ifdef HAVE_PREAD
+    char *p = buf;
+    while (size > 0)
+    {
+        size_t s = (size > gta_max_chunk_size ? gta_max_chunk_size : size);
+        if (offset > OFF_MAX)
+        {
+            errno = EOVERFLOW;
+            return GTA_SYSTEM_ERROR;
+        }
+        ssize_t r = pread(fd, p, s, offset);
+        (*io_calls)++;
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return GTA_SYSTEM_ERROR;
+        }
+        if (r == 0)
+        {
+            return GTA_UNEXPECTED_EOF;
+        }
+        p += r;
+        size -= r;
+        offset += r;
+    }
+    return GTA_OK;
+#else
+    (void)fd;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    (void)io_calls;
+    errno = ENOSYS;
+    return GTA_SYSTEM_ERROR;
+#endif
+}
+
+/**
+ * \brief                       Read an array block.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param read_fn               The custom input function.
+ * \param seek_fn               The custom seek function.
+ * \param userdata              A parameter to the custom input function.
+ * \param fd                    A file descriptor for positioned vectored input, or -1.
+ * \param pread_fd              A file descriptor for positioned input, or -1.
+ * \param io_calls              The number of I/O calls that were issued.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * If \a fd is not -1 and preadv() is available, it is used instead of
+ * \a read_fn and \a seek_fn. Otherwise, if \a pread_fd is not -1, pread() is
+ * used instead of them. In both cases, the file position is not used.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_read_block_runs(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata,
+        int fd, int pread_fd, uintmax_t *GTA_RESTRICT io_calls)
+{
+    *io_calls = 0;
+    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
+            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
+            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+#ifndef HAVE_PREADV
+    fd = -1;
+#endif
+
+    gta_result_t retval = GTA_OK;
+    uintmax_t dimensions = gta_get_dimensions(header);
+    uintmax_t stack_coords[2 * GTA_BLOCK_STACK_DIMENSIONS];
+    uintmax_t *coords = stack_coords;
+    uintmax_t *span_coords;
+    char *scratch = NULL;
+    size_t scratch_size = 0;
+    char *block_ptr = block;
+    uintmax_t block_elements = 1;
+
+    if (dimensions > GTA_BLOCK_STACK_DIMENSIONS)
+    {
+        coords = malloc(2 * dimensions * sizeof(uintmax_t));
+        if (!coords)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    span_coords = coords + dimensions;
+
+    /* Determine the runs. The block spans dimensions 0 to run_dimension-1
+     * completely, so a run covers these and its range in run_dimension. */
+    uintmax_t run_dimension = 0;
+    while (run_dimension < dimensions - 1
+            && lower_coordinates[run_dimension] == 0
+            && higher_coordinates[run_dimension] == gta_get_dimension_size(header, run_dimension) - 1)
+    {
+        run_dimension++;
+    }
+    uintmax_t run_size = gta_get_element_size(header);
+    for (uintmax_t d = 0; d < dimensions; d++)
+    {
+        uintmax_t extent = higher_coordinates[d] - lower_coordinates[d] + 1;
+        if (d <= run_dimension)
+        {
+            run_size *= extent;
+        }
+        block_elements *= extent;
+    }
+    if (run_size == 0)
+    {
+        goto exit;
+    }
+
+    memcpy(coords, lower_coordinates, dimensions * sizeof(uintmax_t));
+    intmax_t run_offset = data_offset + gta_get_element_offset(header, coords);
+    bool have_run = true;
+    while (have_run)
+    {
+        /* Merge the following runs into the current span as long as the gaps are small */
+        memcpy(span_coords, coords, dimensions * sizeof(uintmax_t));
+        intmax_t span_offset = run_offset;
+        intmax_t span_end = run_offset + run_size;
+        uintmax_t span_runs = 1;
+        for (;;)
+        {
+            have_run = gta_block_next_run(header, lower_coordinates, higher_coordinates, run_dimension, coords);
+            if (!have_run)
+            {
+                break;
+            }
+            run_offset = data_offset + gta_get_element_offset(header, coords);
+            uintmax_t gap = run_offset - span_end;
+            if (gap > gta_block_max_gap || (gap > run_size && gap > gta_block_page_gap))
+            {
+                break;
+            }
+#ifdef HAVE_PREADV
+            if (fd >= 0 ? 2 * span_runs + 1 > GTA_BLOCK_MAX_IOV
+                    : (uintmax_t)(run_offset + run_size - span_offset) > gta_block_max_span)
+#else
+            if ((uintmax_t)(run_offset + run_size - span_offset) > gta_block_max_span)
+#endif
+            {
+                break;
+            }
+            span_runs++;
+            span_end = run_offset + run_size;
+        }
+
+        /* Read the span */
+#ifdef HAVE_PREADV
+        if (fd >= 0)
+        {
+            /* Runs go directly into the block, gaps go into the scratch buffer */
+            struct iovec iov[GTA_BLOCK_MAX_IOV];
+            int iovcnt = 0;
+            intmax_t prev_end = span_offset;
+            if (span_runs > 1)
+            {
+                retval = gta_block_buf_reserve(&scratch, &scratch_size, gta_block_max_gap);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+            }
+            for (uintmax_t i = 0; i < span_runs; i++)
+            {
+                intmax_t o = data_offset + gta_get_element_offset(header, span_coords);
+                if (o > prev_end)
+                {
+                    iov[iovcnt].iov_base = scratch;
+                    iov[iovcnt].iov_len = o - prev_end;
+                    iovcnt++;
+                }
+                iov[iovcnt].iov_base = block_ptr + i * run_size;
+                iov[iovcnt].iov_len = run_size;
+                iovcnt++;
+                prev_end = o + run_size;
+                gta_block_next_run(header, lower_coordinates, higher_coordinates, run_dimension, span_coords);
+            }
+            retval = gta_block_preadv(fd, iov, iovcnt, span_offset, io_calls);
+            if (retval != GTA_OK)
+            {
+                goto exit;
+            }
+        }
+        else
+#endif
+        {
+            uintmax_t span_size = span_end - span_offset;
+            char *dst = block_ptr;
+            if (span_runs > 1)
+            {
+                retval = gta_block_buf_reserve(&scratch, &scratch_size, span_size);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+                dst = scratch;
+            }
+            if (pread_fd >= 0)
+            {
+                retval = gta_pread_fully(pread_fd, dst, span_size, span_offset, io_calls);
+                if (retval != GTA_OK)
+                {
+                    goto exit;
+                }
+            }
+            else
+            {
+                int error = false;
+                seek_fn(userdata, span_offset, SEEK_SET, &error);
+                (*io_calls)++;
+                if (error)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
+                }
+                size_t r = read_fn(userdata, dst, span_size, &error);
+                (*io_calls)++;
+                if (error)
+                {
+                    retval = GTA_SYSTEM_ERROR;
+                    goto exit;
+                }
+                if (r < span_size)
+                {
+                    retval = GTA_UNEXPECTED_EOF;
+                    goto exit;
+                }
+            }
+            if (span_runs > 1)
+            {
+                /* Scatter the runs into the block */
+                for (uintmax_t i = 0; i < span_runs; i++)
+                {
+                    intmax_t o = data_offset + gta_get_element_offset(header, span_coords);
+                    memcpy(block_ptr + i * run_size, scratch + (o - span_offset), run_size);
+                    gta_block_next_run(header, lower_coordinates, higher_coordinates, run_dimension, span_coords);
+                }
+            }
+        }
+        block_ptr += span_runs * run_size;
+    }
+
+    /* Fix endianness */
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_elements_endianness(header, block, block_elements);
+    }
+
+exit:
+    free(scratch);
+    if (coords != stack_coords)
+    {
+        free(coords);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_read_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+{
+    uintmax_t io_calls;
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            read_fn, seek_fn, userdata, -1, -1, &io_calls);
+}
+
+gta_result_t
+gta_read_block_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+{
+    uintmax_t io_calls;
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_stream, gta_seek_stream, (intptr_t)f, -1, -1, &io_calls);
+}
+
+gta_result_t
+gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+{
+    uintmax_t io_calls;
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_fd, gta_seek_fd, fd, fd, -1, &io_calls);
+}
+
+gta_result_t
+gta_read_block_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata,
+        uintmax_t *GTA_RESTRICT io_calls)
+{
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            read_fn, seek_fn, userdata, -1, -1, io_calls);
+}
+
+gta_result_t
+gta_read_block_from_stream_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f, uintmax_t *GTA_RESTRICT io_calls)
+{
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_stream, gta_seek_stream, (intptr_t)f, -1, -1, io_calls);
+}
+
+gta_result_t
+gta_read_block_from_fd_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd, uintmax_t *GTA_RESTRICT io_calls)
+{
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_fd, gta_seek_fd, fd, fd, -1, io_calls);
+}
+
+gta_result_t
+gta_pread_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+{
+    for (uintmax_t d = 0; d < gta_get_dimensions(header); d++)
+    {
+        if (lower_coordinates[d] > higher_coordinates[d]
+                || higher_coordinates[d] >= gta_get_dimension_size(header, d))
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+    if (data_offset < 0)
+    {
+        return GTA_OVERFLOW;
+    }
+    uintmax_t io_calls;
+    return gta_read_block_runs(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_read_fd, gta_seek_fd, fd, fd, fd, &io_calls);
+}
+
+gta_result_t
+gta_pread_elements_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        uintmax_t first_element, uintmax_t n, void *GTA_RESTRICT elements, int fd)
+{
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (first_element > gta_get_elements(header) || n > gta_get_elements(header) - first_element)
+    {
+        return GTA_INVALID_DATA;
+    }
+    if (data_offset < 0 || (uintmax_t)data_offset > (uintmax_t)INTMAX_MAX - gta_get_data_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+    if (n > SIZE_MAX)
+    {
+        return GTA_OVERFLOW;
+    }
+    uintmax_t io_calls = 0;
+    uintmax_t element_size = gta_get_element_size(header);
+    gta_result_t retval = gta_pread_fully(fd, elements, n * element_size,
+            data_offset + first_element * element_size, &io_calls);
+    if (retval == GTA_OK && gta_data_needs_endianness_swapping(header))
+    {
+        gta_swap_elements_endianness(header, elements, n);
+    }
+    return retval;
+}
+
+gta_result_t
+gta_write_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, gta_write_t write_fn, gta_seek_t seek_fn, intptr_t userdata)
+{
+    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
+            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
+            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+
+    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    if (!coords)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+
+    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
+    uintmax_t dim0_len = higher_coordinates[0] - lower_coordinates[0] + 1;
+    uintmax_t dim0_datalen = dim0_len * gta_get_element_size(header);
+    void *temp_block = NULL;
+    if (gta_data_needs_endianness_swapping(header))
+    {
+        temp_block = malloc(dim0_datalen);
+        if (!temp_block)
+        {
+            free(coords);
+            return GTA_OVERFLOW;
+        }
+    }
+    const char *block_ptr = block;
+    gta_result_t retval = GTA_OK;
+
+    for (;;)
+    {
+        intmax_t o = gta_get_element_offset(header, coords);
+        // Fix endianness (we must not change endianness of an existing file)
+        if (gta_data_needs_endianness_swapping(header))
+        {
+            memcpy(temp_block, block_ptr, dim0_datalen);
+            gta_swap_elements_endianness(header, temp_block, dim0_len);
+        }
+        // Write data
+        int error = false;
+        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
+        if (error)
+        {
+            retval = GTA_SYSTEM_ERROR;
+            break;
+        }
+        errno = 0;
+        size_t r = write_fn(userdata,
+                gta_data_needs_endianness_swapping(header) ? temp_block : block_ptr,
+                dim0_datalen, &error);
+        if (error || r < dim0_datalen)
+        {
+            if (errno == 0)
+            {
+                errno = EIO;
+            }
+            retval = GTA_SYSTEM_ERROR;
+            break;
+        }
+        // Increase block index and coordinates
+        block_ptr += dim0_datalen;
+        uintmax_t d;
+        for (d = 1; d < gta_get_dimensions(header); d++)
+        {
+            if (coords[d] < higher_coordinates[d])
+            {
+                coords[d]++;
+                break;
+            }
             else
             {
                 coords[d] = lower_coordinates[d];
             }
         }
-        if (d == gta_get_dimensions(header))
+        if (d == gta_get_dimensions(header))
+        {
+            break;
+        }
+    }
+    free(temp_block);
+    free(coords);
+    return retval;
+}
+
+gta_result_t
+gta_write_block_to_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+{
+    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_stream, gta_seek_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
+{
+    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
+            gta_write_fd, gta_seek_fd, fd);
+}
+
+/*
+ * Positioned output.
+ *
+ * Positioned writes do not use the file position and keep no state between
+ * calls, so several threads can fill disjoint parts of the data of the same
+ * array at the same time. Data that needs endianness swapping is converted in
+ * a bounded buffer that is private to the call.
+ */
+
+/* Maximum size of the buffer for endianness conversion. */
+static const size_t gta_pwrite_max_buf = 1024 * 1024;
+
+/**
+ * \brief               Write a buffer at a given offset, until all of it is written.
+ * \param fd            The file descriptor.
+ * \param buf           The buffer.
+ * \param size          The size of the buffer.
+ * \param offset        The file offset.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_pwrite_fully(int fd, const void *GTA_RESTRICT buf, uintmax_t size, intmax_t offset)
+{
+#ifdef HAVE_PWRITE
+    const char *p = buf;
+    while (size > 0)
+    {
+        size_t s = (size > gta_max_chunk_size ? gta_max_chunk_size : size);
+        if (offset > OFF_MAX)
+        {
+            errno = EOVERFLOW;
+            return GTA_SYSTEM_ERROR;
+        }
+        ssize_t r = pwrite(fd, p, s, offset);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return GTA_SYSTEM_ERROR;
+        }
+        if (r == 0)
+        {
+            errno = EIO;
+            return GTA_SYSTEM_ERROR;
+        }
+        p += r;
+        size -= r;
+        offset += r;
+    }
+    return GTA_OK;
+#else
+    (void)fd;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    errno = ENOSYS;
+    return GTA_SYSTEM_ERROR;
+#endif
+}
+
+/**
+ * \brief               Write consecutive elements at a given offset.
+ * \param header        The header.
+ * \param elements      The elements.
+ * \param n             The number of elements.
+ * \param offset        The file offset.
+ * \param fd            The file descriptor.
+ * \param buf           The conversion buffer, or NULL. This is allocated on demand.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+static GTA_ATTR_NONNULL3(1, 2, 6) GTA_ATTR_NOTHROW
+gta_result_t
+gta_pwrite_run(const gta_header_t *GTA_RESTRICT header, const char *GTA_RESTRICT elements, uintmax_t n,
+        intmax_t offset, int fd, char **GTA_RESTRICT buf)
+{
+    uintmax_t element_size = gta_get_element_size(header);
+    if (!gta_data_needs_endianness_swapping(header) || element_size == 0)
+    {
+        return gta_pwrite_fully(fd, elements, n * element_size, offset);
+    }
+    size_t buf_elements = (element_size >= gta_pwrite_max_buf ? 1 : gta_pwrite_max_buf / element_size);
+    if (!*buf)
+    {
+        *buf = malloc(buf_elements * element_size);
+        if (!*buf)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+    while (n > 0)
+    {
+        size_t k = (n < buf_elements ? n : buf_elements);
+        memcpy(*buf, elements, k * element_size);
+        gta_swap_elements_endianness(header, *buf, k);
+        gta_result_t retval = gta_pwrite_fully(fd, *buf, k * element_size, offset);
+        if (retval != GTA_OK)
+        {
+            return retval;
+        }
+        elements += k * element_size;
+        offset += k * element_size;
+        n -= k;
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_pwrite_elements_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        uintmax_t first_element, uintmax_t n, const void *GTA_RESTRICT elements, int fd)
+{
+    if (gta_get_compression(header) != GTA_NONE)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    if (first_element > gta_get_elements(header) || n > gta_get_elements(header) - first_element)
+    {
+        return GTA_INVALID_DATA;
+    }
+    if (data_offset < 0 || (uintmax_t)data_offset > (uintmax_t)INTMAX_MAX - gta_get_data_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+    char *buf = NULL;
+    gta_result_t retval = gta_pwrite_run(header, elements, n,
+            data_offset + first_element * gta_get_element_size(header), fd, &buf);
+    free(buf);
+    return retval;
+}
+
+gta_result_t
+gta_pwrite_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
+{
+    uintmax_t dimensions = gta_get_dimensions(header);
+    if (gta_get_compression(header) != GTA_NONE || dimensions == 0)
+    {
+        return GTA_UNSUPPORTED_DATA;
+    }
+    for (uintmax_t d = 0; d < dimensions; d++)
+    {
+        if (lower_coordinates[d] > higher_coordinates[d]
+                || higher_coordinates[d] >= gta_get_dimension_size(header, d))
+        {
+            return GTA_INVALID_DATA;
+        }
+    }
+    if (data_offset < 0 || (uintmax_t)data_offset > (uintmax_t)INTMAX_MAX - gta_get_data_size(header))
+    {
+        return GTA_OVERFLOW;
+    }
+
+    gta_result_t retval = GTA_OK;
+    uintmax_t stack_coords[GTA_BLOCK_STACK_DIMENSIONS];
+    uintmax_t *coords = stack_coords;
+    char *buf = NULL;
+    const char *block_ptr = block;
+
+    if (dimensions > GTA_BLOCK_STACK_DIMENSIONS)
+    {
+        coords = malloc(dimensions * sizeof(uintmax_t));
+        if (!coords)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+    }
+
+    /* Write the block run by run; see gta_read_block_runs() */
+    uintmax_t run_dimension = 0;
+    while (run_dimension < dimensions - 1
+            && lower_coordinates[run_dimension] == 0
+            && higher_coordinates[run_dimension] == gta_get_dimension_size(header, run_dimension) - 1)
+    {
+        run_dimension++;
+    }
+    uintmax_t run_elements = 1;
+    for (uintmax_t d = 0; d <= run_dimension; d++)
+    {
+        run_elements *= higher_coordinates[d] - lower_coordinates[d] + 1;
+    }
+    uintmax_t run_size = run_elements * gta_get_element_size(header);
+    memcpy(coords, lower_coordinates, dimensions * sizeof(uintmax_t));
+    do
+    {
+        retval = gta_pwrite_run(header, block_ptr, run_elements,
+                data_offset + gta_get_element_offset(header, coords), fd, &buf);
+        block_ptr += run_size;
+    }
+    while (retval == GTA_OK
+            && gta_block_next_run(header, lower_coordinates, higher_coordinates, run_dimension, coords));
+
+    free(buf);
+    if (coords != stack_coords)
+    {
+        free(coords);
+    }
+    return retval;
+}
+
+
+/*
+ *
+ * Stream Indices
+ *
+ */
+
+
+/* The stream index file format: the 8 byte magic "GTAINDEX", followed by the
+ * number of arrays and the size of the indexed file, followed by the header
+ * offset and the data offset of each array. All numbers are 64 bit unsigned
+ * integers in little endian byte order. */
+
+static const char gta_stream_index_magic[8] = { 'G', 'T', 'A', 'I', 'N', 'D', 'E', 'X' };
+
+/* Input/output wrapper that keeps track of the current position. */
+struct gta_counting_io
+{
+    gta_read_t read_fn;
+    gta_seek_t seek_fn;
+    intptr_t userdata;
+    uintmax_t pos;
+};
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW
+size_t
+gta_read_counting(intptr_t userdata, void *GTA_RESTRICT buffer, size_t size, int *GTA_RESTRICT error)
+{
+    struct gta_counting_io *io = (struct gta_counting_io *)userdata;
+    size_t r = io->read_fn(io->userdata, buffer, size, error);
+    io->pos += r;
+    return r;
+}
+
+static GTA_ATTR_NOTHROW
+void gta_seek_counting(intptr_t userdata, intmax_t offset, int whence, int *GTA_RESTRICT error)
+{
+    struct gta_counting_io *io = (struct gta_counting_io *)userdata;
+    io->seek_fn(io->userdata, offset, whence, error);
+    if (!*error)
+    {
+        io->pos = (whence == SEEK_SET ? (uintmax_t)offset : io->pos + offset);
+    }
+}
+
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+void gta_put_uint64_le(uint8_t *GTA_RESTRICT p, uintmax_t x)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (x >> (8 * i)) & 0xff;
+    }
+}
+
+static inline GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW
+uintmax_t gta_get_uint64_le(const uint8_t *GTA_RESTRICT p)
+{
+    uintmax_t x = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        x |= (uintmax_t)p[i] << (8 * i);
+    }
+    return x;
+}
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW
+gta_result_t
+gta_append_to_stream_index(gta_stream_index_t *GTA_RESTRICT index, uintmax_t header_offset, uintmax_t data_offset)
+{
+    if (index->arrays == index->size)
+    {
+        size_t new_size = (index->size == 0 ? 64 : 2 * index->size);
+        if (new_size < index->size || gta_size_overflow(new_size, sizeof(uintmax_t)))
+        {
+            errno = ENOMEM;
+            return GTA_SYSTEM_ERROR;
+        }
+        uintmax_t *h = realloc(index->header_offsets, new_size * sizeof(uintmax_t));
+        if (!h)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        index->header_offsets = h;
+        uintmax_t *d = realloc(index->data_offsets, new_size * sizeof(uintmax_t));
+        if (!d)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        index->data_offsets = d;
+        index->size = new_size;
+    }
+    index->header_offsets[index->arrays] = header_offset;
+    index->data_offsets[index->arrays] = data_offset;
+    index->arrays++;
+    return GTA_OK;
+}
+
+gta_result_t
+gta_create_stream_index(gta_stream_index_t *GTA_RESTRICT *GTA_RESTRICT index)
+{
+    *index = malloc(sizeof(gta_stream_index_t));
+    if (!*index)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    (*index)->arrays = 0;
+    (*index)->size = 0;
+    (*index)->header_offsets = NULL;
+    (*index)->data_offsets = NULL;
+    (*index)->end = 0;
+    return GTA_OK;
+}
+
+void
+gta_destroy_stream_index(gta_stream_index_t *GTA_RESTRICT index)
+{
+    free(index->header_offsets);
+    free(index->data_offsets);
+    free(index);
+}
+
+uintmax_t
+gta_get_stream_index_arrays(const gta_stream_index_t *GTA_RESTRICT index)
+{
+    return index->arrays;
+}
+
+uintmax_t
+gta_get_stream_index_file_size(const gta_stream_index_t *GTA_RESTRICT index)
+{
+    return index->end;
+}
+
+intmax_t
+gta_get_stream_index_header_offset(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+{
+    return index->header_offsets[i];
+}
+
+intmax_t
+gta_get_stream_index_data_offset(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+{
+    return index->data_offsets[i];
+}
+
+uintmax_t
+gta_get_stream_index_data_size(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+{
+    uintmax_t data_end = (i + 1 < index->arrays ? index->header_offsets[i + 1] : index->end);
+    return data_end - index->data_offsets[i];
+}
+
+static GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(1, 3)
+gta_result_t
+gta_build_stream_index_at(gta_stream_index_t *GTA_RESTRICT index, uintmax_t start,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+{
+    struct gta_counting_io io = { read_fn, seek_fn, userdata, start };
+    gta_header_t *header = NULL;
+    gta_result_t retval;
+
+    index->arrays = 0;
+    index->end = start;
+    retval = gta_create_header(&header);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    for (;;)
+    {
+        uintmax_t header_offset = io.pos;
+        retval = gta_read_header(header, gta_read_counting, (intptr_t)&io);
+        if (retval == GTA_UNEXPECTED_EOF && io.pos == header_offset)
         {
+            /* Clean end of input */
+            retval = GTA_OK;
             break;
         }
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        if (io.pos > (uintmax_t)INTMAX_MAX)
+        {
+            retval = GTA_OVERFLOW;
+            goto exit;
+        }
+        retval = gta_append_to_stream_index(index, header_offset, io.pos);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        retval = gta_skip_data(header, gta_read_counting, seek_fn ? gta_seek_counting : NULL, (intptr_t)&io);
+        if (retval != GTA_OK)
+        {
+            goto exit;
+        }
+        if (io.pos > (uintmax_t)INTMAX_MAX)
+        {
+            retval = GTA_OVERFLOW;
+            goto exit;
+        }
     }
-    free(coords);
+    index->end = io.pos;
+
+exit:
+    if (retval != GTA_OK)
+    {
+        index->arrays = 0;
+    }
+    gta_destroy_header(header);
     return retval;
 }
 
 gta_result_t
-gta_read_block_from_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+gta_build_stream_index(gta_stream_index_t *GTA_RESTRICT index,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
 {
-    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_read_stream, gta_seek_stream, (intptr_t)f);
+    return gta_build_stream_index_at(index, 0, read_fn, seek_fn, userdata);
 }
 
 gta_result_t
-gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        void *GTA_RESTRICT block, int fd)
+gta_build_stream_index_from_stream(gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
 {
-    return gta_read_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_read_fd, gta_seek_fd, fd);
+    off_t start = ftello(f);
+    return gta_build_stream_index_at(index, (start == -1 ? 0 : start),
+            gta_read_stream, (start == -1 ? NULL : gta_seek_stream), (intptr_t)f);
 }
 
 gta_result_t
-gta_write_block(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, gta_write_t write_fn, gta_seek_t seek_fn, intptr_t userdata)
+gta_build_stream_index_from_fd(gta_stream_index_t *GTA_RESTRICT index, int fd)
 {
-    if (gta_get_compression(header) != GTA_NONE || gta_get_dimensions(header) == 0)
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    return gta_build_stream_index_at(index, (start == -1 ? 0 : start),
+            gta_read_fd, (start == -1 ? NULL : gta_seek_fd), fd);
+}
+
+gta_result_t
+gta_read_stream_index(gta_stream_index_t *GTA_RESTRICT index, gta_read_t read_fn, intptr_t userdata)
+{
+    uint8_t buf[256 * 16];      // room for the file header or for 256 index entries
+    const size_t max_entries = sizeof(buf) / 16;
+    int input_error = false;
+    uintmax_t arrays, end, i;
+    gta_result_t retval = GTA_OK;
+    size_t r;
+
+    index->arrays = 0;
+    index->end = 0;
+    r = read_fn(userdata, buf, 24, &input_error);
+    if (input_error)
     {
-        return GTA_UNSUPPORTED_DATA;
+        return GTA_SYSTEM_ERROR;
     }
-    if (data_offset > INTMAX_MAX - gta_get_element_offset(header, higher_coordinates)
-            || gta_get_element_size(header) > (uintmax_t)(INTMAX_MAX)
-            || data_offset + gta_get_element_offset(header, higher_coordinates) > INTMAX_MAX - (intmax_t)gta_get_element_size(header))
+    if (r < 24)
     {
-        return GTA_OVERFLOW;
+        return GTA_UNEXPECTED_EOF;
     }
-
-    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
-    if (!coords)
+    if (memcmp(buf, gta_stream_index_magic, 8) != 0)
     {
-        return GTA_SYSTEM_ERROR;
+        return GTA_INVALID_DATA;
     }
-
-    memcpy(coords, lower_coordinates, gta_get_dimensions(header) * sizeof(uintmax_t));
-    uintmax_t dim0_len = higher_coordinates[0] - lower_coordinates[0] + 1;
-    uintmax_t dim0_datalen = dim0_len * gta_get_element_size(header);
-    void *temp_block = NULL;
-    if (gta_data_needs_endianness_swapping(header))
+    arrays = gta_get_uint64_le(buf + 8);
+    end = gta_get_uint64_le(buf + 16);
+    if (end > (uintmax_t)INTMAX_MAX)
     {
-        temp_block = malloc(dim0_datalen);
-        if (!temp_block)
-        {
-            free(coords);
-            return GTA_OVERFLOW;
-        }
+        return GTA_OVERFLOW;
     }
-    const char *block_ptr = block;
-    gta_result_t retval = GTA_OK;
-
-    for (;;)
+    i = 0;
+    while (i < arrays)
     {
-        intmax_t o = gta_get_element_offset(header, coords);
-        // Fix endianness (we must not change endianness of an existing file)
-        if (gta_data_needs_endianness_swapping(header))
-        {
-            memcpy(temp_block, block_ptr, dim0_datalen);
-            for (uintmax_t i = 0; i < dim0_len; i++)
-            {
-                void *e = (char *)temp_block + i * gta_get_element_size(header);
-                gta_swap_element_endianness(header, e);
-            }
-        }
-        // Write data
-        int error = false;
-        seek_fn(userdata, data_offset + o, SEEK_SET, &error);
-        if (error)
+        size_t n = (arrays - i < max_entries ? arrays - i : max_entries);
+        r = read_fn(userdata, buf, n * 16, &input_error);
+        if (input_error)
         {
             retval = GTA_SYSTEM_ERROR;
-            break;
+            goto exit;
         }
-        errno = 0;
-        size_t r = write_fn(userdata,
-                gta_data_needs_endianness_swapping(header) ? temp_block : block_ptr,
-                dim0_datalen, &error);
-        if (error || r < dim0_datalen)
+        if (r < n * 16)
         {
-            if (errno == 0)
-            {
-                errno = EIO;
-            }
-            retval = GTA_SYSTEM_ERROR;
-            break;
+            retval = GTA_UNEXPECTED_EOF;
+            goto exit;
         }
-        // Increase block index and coordinates
-        block_ptr += dim0_datalen;
-        uintmax_t d;
-        for (d = 1; d < gta_get_dimensions(header); d++)
+        for (size_t j = 0; j < n; j++)
         {
-            if (coords[d] < higher_coordinates[d])
+            uintmax_t header_offset = gta_get_uint64_le(buf + 16 * j);
+            uintmax_t data_offset = gta_get_uint64_le(buf + 16 * j + 8);
+            /* Arrays must be stored one after the other, each with a non-empty header. */
+            if (header_offset >= data_offset || data_offset > end
+                    || (i > 0 && header_offset < index->data_offsets[i - 1]))
             {
-                coords[d]++;
-                break;
+                retval = GTA_INVALID_DATA;
+                goto exit;
             }
-            else
+            retval = gta_append_to_stream_index(index, header_offset, data_offset);
+            if (retval != GTA_OK)
             {
-                coords[d] = lower_coordinates[d];
+                goto exit;
             }
+            i++;
         }
-        if (d == gta_get_dimensions(header))
+    }
+    index->end = end;
+
+exit:
+    if (retval != GTA_OK)
+    {
+        index->arrays = 0;
+    }
+    return retval;
+}
+
+gta_result_t
+gta_read_stream_index_from_stream(gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
+{
+    return gta_read_stream_index(index, gta_read_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_read_stream_index_from_fd(gta_stream_index_t *GTA_RESTRICT index, int fd)
+{
+    return gta_read_stream_index(index, gta_read_fd, fd);
+}
+
+gta_result_t
+gta_write_stream_index(const gta_stream_index_t *GTA_RESTRICT index, gta_write_t write_fn, intptr_t userdata)
+{
+    uint8_t buf[256 * 16];      // room for the file header or for 256 index entries
+    const size_t max_entries = sizeof(buf) / 16;
+    int output_error = false;
+    uintmax_t i;
+    size_t r;
+
+    memcpy(buf, gta_stream_index_magic, 8);
+    gta_put_uint64_le(buf + 8, index->arrays);
+    gta_put_uint64_le(buf + 16, index->end);
+    r = write_fn(userdata, buf, 24, &output_error);
+    if (output_error || r < 24)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    i = 0;
+    while (i < index->arrays)
+    {
+        size_t n = (index->arrays - i < max_entries ? index->arrays - i : max_entries);
+        for (size_t j = 0; j < n; j++)
         {
-            break;
+            gta_put_uint64_le(buf + 16 * j, index->header_offsets[i + j]);
+            gta_put_uint64_le(buf + 16 * j + 8, index->data_offsets[i + j]);
         }
+        r = write_fn(userdata, buf, n * 16, &output_error);
+        if (output_error || r < n * 16)
+        {
+            return GTA_SYSTEM_ERROR;
+        }
+        i += n;
     }
-    free(temp_block);
-    free(coords);
-    return retval;
+    return GTA_OK;
 }
 
 gta_result_t
-gta_write_block_to_stream(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, FILE *GTA_RESTRICT f)
+gta_write_stream_index_to_stream(const gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
 {
-    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_write_stream, gta_seek_stream, (intptr_t)f);
+    return gta_write_stream_index(index, gta_write_stream, (intptr_t)f);
 }
 
 gta_result_t
-gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
-        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
-        const void *GTA_RESTRICT block, int fd)
+gta_write_stream_index_to_fd(const gta_stream_index_t *GTA_RESTRICT index, int fd)
 {
-    return gta_write_block(header, data_offset, lower_coordinates, higher_coordinates, block,
-            gta_write_fd, gta_seek_fd, fd);
+    return gta_write_stream_index(index, gta_write_fd, fd);
+}
+
+gta_result_t
+gta_read_indexed_header(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+{
+    struct gta_counting_io io = { read_fn, seek_fn, userdata, 0 };
+    int error = false;
+    gta_result_t retval;
+
+    gta_seek_counting((intptr_t)&io, index->header_offsets[i], SEEK_SET, &error);
+    if (error)
+    {
+        return GTA_SYSTEM_ERROR;
+    }
+    retval = gta_read_header(header, gta_read_counting, (intptr_t)&io);
+    if (retval != GTA_OK)
+    {
+        return retval;
+    }
+    if (io.pos != index->data_offsets[i])
+    {
+        return GTA_INVALID_DATA;
+    }
+    return GTA_OK;
+}
+
+gta_result_t
+gta_read_indexed_header_from_stream(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, FILE *GTA_RESTRICT f)
+{
+    return gta_read_indexed_header(header, index, i, gta_read_stream, gta_seek_stream, (intptr_t)f);
+}
+
+gta_result_t
+gta_read_indexed_header_from_fd(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, int fd)
+{
+    return gta_read_indexed_header(header, index, i, gta_read_fd, gta_seek_fd, fd);
 }
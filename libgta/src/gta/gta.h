@@ -352,6 +352,13 @@ typedef void (*gta_seek_t)(intptr_t userdata, intmax_t offset, int whence, int *
  */
 typedef struct gta_internal_io_state_struct gta_io_state_t;
 
+/**
+ * \brief       Index of the arrays in a GTA stream
+ *
+ * See gta_build_stream_index() and gta_read_indexed_header().
+ */
+typedef struct gta_internal_stream_index_struct gta_stream_index_t;
+
 
 /**
  *
@@ -405,7 +412,9 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \param src_header    The source header.
  * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
  *
- * Clones \a src_header into \a dst_header.
+ * Clones \a src_header into \a dst_header.\n
+ * The tag lists of both headers share their storage until one of them is modified,
+ * so cloning is cheap even for headers with many tags.
  */
 extern GTA_EXPORT gta_result_t
 gta_clone_header(gta_header_t *GTA_RESTRICT dst_header,
@@ -648,6 +657,20 @@ extern GTA_EXPORT uintmax_t
 gta_get_data_size(const gta_header_t *GTA_RESTRICT header)
 GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Check if the array data is stored in native form.
+ * \param header        The header.
+ * \return              Whether the data is stored in native form.
+ *
+ * The data is stored in native form if it is uncompressed and in host endianness.
+ * In this case, the data section that follows the header in a file is byte-identical
+ * to the array data in memory, and applications can use it directly, e.g. by mapping
+ * it into memory instead of reading it with gta_read_data().
+ */
+extern GTA_EXPORT int
+gta_data_is_native(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Get the compression.
  * \param header        The header.
@@ -675,6 +698,68 @@ extern GTA_EXPORT void
 gta_set_compression(gta_header_t *GTA_RESTRICT header, gta_compression_t compression)
 GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Get the header padding.
+ * \param header        The header.
+ * \return              The number of padding bytes in the header.
+ *
+ * After gta_read_header(), this is the padding that was found in the header and skipped.
+ * See gta_set_header_padding().
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_header_padding(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the header padding.
+ * \param header        The header.
+ * \param padding       The number of padding bytes.
+ * \return              GTA_OK, GTA_INVALID_DATA, or GTA_OVERFLOW.
+ *
+ * Reserves room in the header so that it can later be rewritten in place, e.g. after
+ * tags were changed, without moving the array data that follows it. The padding is
+ * stored as the global tag GTA/PADDING, which is hidden from the global tag list when
+ * a header is read. A padding tag needs at least 13 bytes, so values between 1 and 12
+ * are rejected with GTA_INVALID_DATA. A padding of 0 removes the tag.\n
+ * Headers that are read or cloned keep their padding.\n
+ * The global tag name GTA/PADDING is reserved: applications must not set it themselves,
+ * since such a tag is taken as padding when the header is read again.
+ */
+extern GTA_EXPORT gta_result_t
+gta_set_header_padding(gta_header_t *GTA_RESTRICT header, uintmax_t padding)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the header size.
+ * \param header        The header.
+ * \return              The number of bytes that gta_write_header() writes for this header.
+ *
+ * An application that wants to rewrite a header in place must make sure that the new
+ * header has exactly the size of the old one, by adjusting the padding with
+ * gta_set_header_padding().
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_header_size(const gta_header_t *GTA_RESTRICT header)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Set the header padding so that the array data is aligned.
+ * \param header        The header.
+ * \param offset        The position in the output at which the header will be written.
+ * \param min_padding   The minimum number of padding bytes (0 or at least 13).
+ * \param alignment     The alignment of the data, e.g. 4096.
+ * \return              GTA_OK, GTA_INVALID_DATA, or GTA_OVERFLOW.
+ *
+ * Sets the smallest padding of at least \a min_padding bytes with which the array data
+ * that follows the header starts at a multiple of \a alignment in the output.
+ * Aligned data can be read with O_DIRECT or mapped into memory efficiently.
+ * An \a alignment of 0 is rejected with GTA_INVALID_DATA. On failure, the padding
+ * is unchanged.
+ */
+extern GTA_EXPORT gta_result_t
+gta_align_header(gta_header_t *GTA_RESTRICT header, uintmax_t offset, uintmax_t min_padding, uintmax_t alignment)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NOTHROW;
+
 /*@}*/
 
 
@@ -813,7 +898,9 @@ GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \param src_taglist   The source tag list.
  * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
  *
- * Copies \a src_taglist to \a dst_taglist.
+ * Copies \a src_taglist to \a dst_taglist.\n
+ * Both tag lists share their storage until one of them is modified, so this
+ * takes constant time.
  */
 extern GTA_EXPORT gta_result_t
 gta_clone_taglist(gta_taglist_t *GTA_RESTRICT dst_taglist,
@@ -1122,6 +1209,15 @@ GTA_ATTR_NONNULL1(1) GTA_ATTR_PURE GTA_ATTR_NOTHROW;
  * Element-based input/output needs a state structure. This structure must be allocated with
  * gta_create_io_state() before the first element is read or written, and freed with
  * gta_destroy_io_state() after the last element was read or written, or after an error occured.
+ *
+ * Instead of copying elements from or to a buffer of the caller, the lend/commit functions
+ * give the caller direct access to the internal data buffer of the state structure:
+ * gta_lend_read_elements() returns a pointer to the next elements, already converted to host
+ * endianness, and gta_lend_write_elements() returns a pointer to the location of the next
+ * elements that the caller fills in place. Each lend must be followed by the corresponding
+ * commit function before any other function is called with the same state structure.
+ * A lend may provide fewer elements than requested (at least one) because the internal buffer
+ * holds at most one chunk of data.
  */
 
 /*@{*/
@@ -1137,13 +1233,37 @@ extern GTA_EXPORT gta_result_t
 gta_create_io_state(gta_io_state_t *GTA_RESTRICT *GTA_RESTRICT io_state)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief               Enable or disable asynchronous input/output.
+ * \param io_state      The input/output state.
+ * \param async         Whether input/output should be asynchronous.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * In asynchronous mode, element-based input reads the next chunk of data in a background
+ * thread while the caller processes the current one, and element-based output writes a
+ * complete chunk in a background thread while the caller fills the next one. This overlaps
+ * input/output with computations, at the cost of one additional chunk buffer.\n
+ * The custom input/output functions are then called from a background thread, but never
+ * concurrently. The header, the input/output functions, and their parameters must not change
+ * between calls, and the input/output must not be used otherwise until the last element was
+ * read or written: only then is all background input/output finished. A state that has input
+ * in progress cannot be cloned.\n
+ * This function must be called before the first element is read or written; otherwise,
+ * \a GTA_INVALID_DATA is returned. If libgta was built without thread support, input/output
+ * remains synchronous.
+ */
+extern GTA_EXPORT gta_result_t
+gta_set_io_state_async(gta_io_state_t *GTA_RESTRICT io_state, int async)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /**
  * \brief               Clone an input/output state.
  * \param dst_io_state  The destination state.
  * \param src_io_state  The source state.
- * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
  *
- * Clones \a src_io_state into \a dst_io_state.
+ * Clones \a src_io_state into \a dst_io_state. This fails with \a GTA_INVALID_DATA if
+ * \a src_io_state has asynchronous input in progress; see gta_set_io_state_async().
  */
 extern GTA_EXPORT gta_result_t
 gta_clone_io_state(gta_io_state_t *GTA_RESTRICT dst_io_state,
@@ -1258,6 +1378,204 @@ gta_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t
         uintmax_t n, const void *GTA_RESTRICT buf, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
 
+/**
+ * \brief               Lend array elements for reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+ * The elements are valid until gta_commit_read_elements() is called.
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf,
+        gta_read_t read_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Lend array elements for reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+ * The elements are valid until gta_commit_read_elements_from_stream() is called.
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Lend array elements for reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+ * The elements are valid until gta_commit_read_elements_from_fd() is called.
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, const void *GTA_RESTRICT *GTA_RESTRICT buf, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Marks the elements lent by gta_lend_read_elements() as consumed.
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_read_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_read_t read_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Marks the elements lent by gta_lend_read_elements_from_stream() as consumed.
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_read_elements_from_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after reading.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Marks the elements lent by gta_lend_read_elements_from_fd() as consumed.
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_read_elements_from_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Lend array elements for writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides write access to the location of at least one and at most \a n of the next elements.
+ * The caller must fill all lent elements and then call gta_commit_write_elements().
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf,
+        gta_write_t write_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Lend array elements for writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides write access to the location of at least one and at most \a n of the next elements.
+ * The caller must fill all lent elements and then call gta_commit_write_elements_to_stream().
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Lend array elements for writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param n             The maximum number of elements to lend.
+ * \param lent          The number of elements that were lent.
+ * \param buf           The lent elements.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Provides write access to the location of at least one and at most \a n of the next elements.
+ * The caller must fill all lent elements and then call gta_commit_write_elements_to_fd().
+ */
+extern GTA_EXPORT gta_result_t
+gta_lend_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        uintmax_t n, uintmax_t *GTA_RESTRICT lent, void *GTA_RESTRICT *GTA_RESTRICT buf, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Writes the elements lent by gta_lend_write_elements().
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_write_elements(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        gta_write_t write_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Writes the elements lent by gta_lend_write_elements_to_stream().
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_write_elements_to_stream(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Commit lent array elements after writing.
+ * \param header        The header.
+ * \param io_state      The input/output state.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_INVALID_DATA, \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Writes the elements lent by gta_lend_write_elements_to_fd().
+ */
+extern GTA_EXPORT gta_result_t
+gta_commit_write_elements_to_fd(const gta_header_t *GTA_RESTRICT header, gta_io_state_t *GTA_RESTRICT io_state,
+        int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
 
 /*@}*/
 
@@ -1328,7 +1646,9 @@ GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
  * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
  *
  * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
- * This function modifies the file position indicator of the input.
+ * This function may modify the file position indicator of the input. If the system
+ * supports positioned vectored input (preadv()), it is used and the file position is
+ * left unchanged.
  */
 extern GTA_EXPORT gta_result_t
 gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
@@ -1336,6 +1656,112 @@ gta_read_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_of
         void *GTA_RESTRICT block, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief                       Read an array block and count the I/O calls.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param read_fn               The custom input function.
+ * \param seek_fn               The custom seek function.
+ * \param userdata              A parameter to the custom input function.
+ * \param io_calls              The number of calls to \a read_fn and \a seek_fn.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * This is the same as gta_read_block(), but additionally reports how many I/O calls
+ * were issued. Rows that are contiguous in the array data are read with a single call,
+ * and rows that are separated by small gaps are read together and then scattered into
+ * the block, so the count is usually much lower than the number of rows in the block.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata,
+        uintmax_t *GTA_RESTRICT io_calls)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief                       Read an array block from a stream and count the I/O calls.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param f                     The stream.
+ * \param io_calls              The number of seek and read calls on the stream.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * This is the same as gta_read_block_from_stream(), but additionally reports how many
+ * I/O calls were issued.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_from_stream_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, FILE *GTA_RESTRICT f, uintmax_t *GTA_RESTRICT io_calls)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read an array block from a file descriptor and count the I/O calls.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \param io_calls              The number of system calls on the file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * This is the same as gta_read_block_from_fd(), but additionally reports how many
+ * system calls were issued. With preadv(), each call reads several separate rows.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_block_from_fd_counted(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd, uintmax_t *GTA_RESTRICT io_calls)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read an array block from a file descriptor with positioned input.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_INVALID_DATA (if the block is out of range), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
+ * This function reads with preadv() or pread() only. It does not use or modify the file
+ * position and keeps no state between calls, so it is safe to call it from several threads
+ * at the same time, with the same file descriptor and the same header.\n
+ * If the system provides neither preadv() nor pread(), this function fails with
+ * \a GTA_SYSTEM_ERROR and errno set to ENOSYS.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pread_block_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        void *GTA_RESTRICT block, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Read consecutive array elements from a file descriptor with positioned input.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param first_element         Linear index of the first element to read.
+ * \param n                     The number of elements.
+ * \param elements              The element buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_INVALID_DATA (if the elements are out of range), \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads the elements with pread() and converts them to host endianness.
+ * Like gta_pread_block_from_fd(), this function is safe for concurrent use.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pread_elements_from_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        uintmax_t first_element, uintmax_t n, void *GTA_RESTRICT elements, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /**
  * \brief                       Write an array block.
  * \param header                The header.
@@ -1392,6 +1818,307 @@ gta_write_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_off
         const void *GTA_RESTRICT block, int fd)
 GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
 
+/**
+ * \brief                       Write consecutive array elements with positioned output.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param first_element         Linear index of the first element to write.
+ * \param n                     The number of elements.
+ * \param elements              The elements, in host endianness.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_INVALID_DATA (if the elements are out of range), \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * Writes the elements to their place in the data that starts at \a data_offset, with pwrite().
+ * The header must already have been written. The file position is not used or modified, and
+ * no state is kept between calls, so several threads can write disjoint parts of the data
+ * of the same array at the same time. The elements are converted to the endianness of the
+ * header if necessary, without modifying the given buffer.\n
+ * If the system does not provide pwrite(), this function fails with \a GTA_SYSTEM_ERROR
+ * and errno set to ENOSYS.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pwrite_elements_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        uintmax_t first_element, uintmax_t n, const void *GTA_RESTRICT elements, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief                       Write an array block with positioned output.
+ * \param header                The header.
+ * \param data_offset           Offset of the first data byte.
+ * \param lower_coordinates     Coordinates of the lower corner element of the block.
+ * \param higher_coordinates    Coordinates of the higher corner element of the block.
+ * \param block                 The block buffer.
+ * \param fd                    The file descriptor.
+ * \return                      \a GTA_OK, \a GTA_UNSUPPORTED_DATA (if the data is compressed), \a GTA_INVALID_DATA (if the block is out of range), \a GTA_OVERFLOW, or \a GTA_SYSTEM_ERROR.
+ *
+ * This is the block variant of gta_pwrite_elements_to_fd(): several threads can write
+ * disjoint blocks of the same array at the same time. Unlike gta_write_block_to_fd(),
+ * this function does not modify the file position.
+ */
+extern GTA_EXPORT gta_result_t
+gta_pwrite_block_to_fd(const gta_header_t *GTA_RESTRICT header, intmax_t data_offset,
+        const uintmax_t *GTA_RESTRICT lower_coordinates, const uintmax_t *GTA_RESTRICT higher_coordinates,
+        const void *GTA_RESTRICT block, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/*@}*/
+
+
+/**
+ *
+ * \name Stream Indices
+ *
+ * A GTA file may contain many arrays. Finding array number k normally requires to
+ * read the header of each preceding array and to skip its data.\n
+ * A stream index records the offsets of all arrays in a seekable GTA file. It can be
+ * stored separately from the GTA file, for example in a sidecar file, and it allows
+ * to access each array directly with gta_read_indexed_header().\n
+ * The index is stored in a small binary format that is independent of the host
+ * endianness. It also records the size of the indexed GTA file, so that applications
+ * can detect outdated indices.
+ */
+
+/*@{*/
+
+/**
+ * \brief               Create a new, empty stream index.
+ * \param index         The stream index.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+extern GTA_EXPORT gta_result_t
+gta_create_stream_index(gta_stream_index_t *GTA_RESTRICT *GTA_RESTRICT index)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Destroy a stream index and free its resources.
+ * \param index         The stream index.
+ */
+extern GTA_EXPORT void
+gta_destroy_stream_index(gta_stream_index_t *GTA_RESTRICT index)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the number of arrays in a stream index.
+ * \param index         The stream index.
+ * \return              The number of arrays.
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_stream_index_arrays(const gta_stream_index_t *GTA_RESTRICT index)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the size of the indexed GTA file.
+ * \param index         The stream index.
+ * \return              The offset of the end of the last array.
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_stream_index_file_size(const gta_stream_index_t *GTA_RESTRICT index)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the header offset of an array.
+ * \param index         The stream index.
+ * \param i             The array index.
+ * \return              The offset of the first header byte of array \a i.
+ */
+extern GTA_EXPORT intmax_t
+gta_get_stream_index_header_offset(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the data offset of an array.
+ * \param index         The stream index.
+ * \param i             The array index.
+ * \return              The offset of the first data byte of array \a i.
+ */
+extern GTA_EXPORT intmax_t
+gta_get_stream_index_data_offset(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Get the stored data size of an array.
+ * \param index         The stream index.
+ * \param i             The array index.
+ * \return              The number of bytes that the data of array \a i occupies in the file.
+ *
+ * This is the same as gta_get_data_size() unless the array is compressed.
+ */
+extern GTA_EXPORT uintmax_t
+gta_get_stream_index_data_size(const gta_stream_index_t *GTA_RESTRICT index, uintmax_t i)
+GTA_ATTR_NONNULL_ALL GTA_ATTR_PURE GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Build a stream index.
+ * \param index         The stream index.
+ * \param read_fn       The custom input function.
+ * \param seek_fn       The custom seek function, or NULL.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads all arrays from the input until the end of the input is reached, and records
+ * their offsets in \a index. Previous contents of \a index are discarded.\n
+ * The input must be positioned at the start of the GTA file, because the offsets
+ * are counted from that position. If \a seek_fn is not NULL, it is used to skip
+ * uncompressed array data.
+ */
+extern GTA_EXPORT gta_result_t
+gta_build_stream_index(gta_stream_index_t *GTA_RESTRICT index,
+        gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL2(1, 2);
+
+/**
+ * \brief               Build a stream index from a stream.
+ * \param index         The stream index.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads all arrays from the stream until its end, and records their offsets in
+ * \a index. Previous contents of \a index are discarded.\n
+ * The recorded offsets are file positions as returned by ftello(), so the stream
+ * should be positioned at the start of the GTA file.
+ */
+extern GTA_EXPORT gta_result_t
+gta_build_stream_index_from_stream(gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Build a stream index from a file descriptor.
+ * \param index         The stream index.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads all arrays from the file descriptor until its end, and records their offsets
+ * in \a index. Previous contents of \a index are discarded.\n
+ * The recorded offsets are file positions as returned by lseek(), so the file
+ * descriptor should be positioned at the start of the GTA file.
+ */
+extern GTA_EXPORT gta_result_t
+gta_build_stream_index_from_fd(gta_stream_index_t *GTA_RESTRICT index, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Read a stream index.
+ * \param index         The stream index.
+ * \param read_fn       The custom input function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads a stream index that was written by gta_write_stream_index().
+ * Previous contents of \a index are discarded.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_stream_index(gta_stream_index_t *GTA_RESTRICT index, gta_read_t read_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Read a stream index from a stream.
+ * \param index         The stream index.
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads a stream index that was written by gta_write_stream_index_to_stream().
+ * Previous contents of \a index are discarded.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_stream_index_from_stream(gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Read a stream index from a file descriptor.
+ * \param index         The stream index.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Reads a stream index that was written by gta_write_stream_index_to_fd().
+ * Previous contents of \a index are discarded.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_stream_index_from_fd(gta_stream_index_t *GTA_RESTRICT index, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Write a stream index.
+ * \param index         The stream index.
+ * \param write_fn      The custom output function.
+ * \param userdata      A parameter to the custom output function.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_stream_index(const gta_stream_index_t *GTA_RESTRICT index, gta_write_t write_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Write a stream index to a stream.
+ * \param index         The stream index.
+ * \param f             The stream.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_stream_index_to_stream(const gta_stream_index_t *GTA_RESTRICT index, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Write a stream index to a file descriptor.
+ * \param index         The stream index.
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK or \a GTA_SYSTEM_ERROR.
+ */
+extern GTA_EXPORT gta_result_t
+gta_write_stream_index_to_fd(const gta_stream_index_t *GTA_RESTRICT index, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Read the header of an indexed array.
+ * \param header        The header.
+ * \param index         The stream index.
+ * \param i             The array index; must be less than gta_get_stream_index_arrays().
+ * \param read_fn       The custom input function.
+ * \param seek_fn       The custom seek function.
+ * \param userdata      A parameter to the custom input function.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Seeks to the header of array \a i, reads it, and leaves the input positioned at the
+ * start of the array data, so that the data can be read as usual, e.g. with gta_read_data().\n
+ * If the header does not end at the recorded data offset, the index does not match the
+ * input and \a GTA_INVALID_DATA is returned.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_indexed_header(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, gta_read_t read_fn, gta_seek_t seek_fn, intptr_t userdata)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL;
+
+/**
+ * \brief               Read the header of an indexed array from a stream.
+ * \param header        The header.
+ * \param index         The stream index.
+ * \param i             The array index; must be less than gta_get_stream_index_arrays().
+ * \param f             The stream.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Seeks to the header of array \a i, reads it, and leaves the stream positioned at the
+ * start of the array data.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_indexed_header_from_stream(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, FILE *GTA_RESTRICT f)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
+/**
+ * \brief               Read the header of an indexed array from a file descriptor.
+ * \param header        The header.
+ * \param index         The stream index.
+ * \param i             The array index; must be less than gta_get_stream_index_arrays().
+ * \param fd            The file descriptor.
+ * \return              \a GTA_OK, \a GTA_OVERFLOW, \a GTA_UNSUPPORTED_DATA, \a GTA_UNEXPECTED_EOF, \a GTA_INVALID_DATA, or \a GTA_SYSTEM_ERROR.
+ *
+ * Seeks to the header of array \a i, reads it, and leaves the file descriptor positioned
+ * at the start of the array data.
+ */
+extern GTA_EXPORT gta_result_t
+gta_read_indexed_header_from_fd(gta_header_t *GTA_RESTRICT header, const gta_stream_index_t *GTA_RESTRICT index,
+        uintmax_t i, int fd)
+GTA_ATTR_WARN_UNUSED_RESULT GTA_ATTR_NONNULL_ALL GTA_ATTR_NOTHROW;
+
 /*@}*/
 
 
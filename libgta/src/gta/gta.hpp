@@ -38,6 +38,7 @@
 #include <ostream>
 #include <vector>
 #include <limits>
+#include <utility>
 #include <cerrno>
 #include <cstring>
 #include <cstdio>
@@ -274,6 +275,12 @@ namespace gta
 
     public:
 
+        /** \cond INTERNAL */
+        taglist(const taglist &tl) : _taglist(tl._taglist)
+        {
+        }
+        /** \endcond */
+
         /**
          * \brief       Get the number of tags.
          * \return      The number of tags.
@@ -370,6 +377,25 @@ namespace gta
             return *this;
         }
 
+#if __cplusplus >= 201103L
+        /**
+         * \brief       Move assignment operator.
+         * \param tl    The tag list to move. It is empty afterwards.
+         *
+         * Since this tag list does not share its tags with \a tl afterwards,
+         * modifying it does not require a copy of the tags.
+         */
+        taglist &operator=(taglist &&tl)
+        {
+            if (tl._taglist != _taglist)
+            {
+                *this = static_cast<const taglist &>(tl);
+                gta_unset_all_tags(tl._taglist);
+            }
+            return *this;
+        }
+#endif
+
         friend class header;
     };
 
@@ -665,6 +691,17 @@ namespace gta
         }
         /** \endcond */
 
+#if __cplusplus >= 201103L
+        /**
+         * \brief       Move constructor.
+         * \param s     The state to move. It may only be assigned to or destroyed afterwards.
+         */
+        io_state(io_state &&s) noexcept : _state(s._state)
+        {
+            s._state = NULL;
+        }
+#endif
+
         ~io_state()
         {
             if (_state)
@@ -673,10 +710,30 @@ namespace gta
             }
         }
 
+        /**
+         * \brief       Enable or disable asynchronous input/output.
+         * \param async Whether input/output should be asynchronous.
+         *
+         * See gta_set_io_state_async().
+         */
+        void set_async(bool async)
+        {
+            gta_result_t r = gta_set_io_state_async(_state, async);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot set GTA i/o state mode", static_cast<gta::result>(r));
+            }
+        }
+
         /** \cond INTERNAL */
         io_state &operator=(const io_state &s)
         {
-            gta_result_t r = gta_clone_io_state(_state, s._state);
+            gta_result_t r = (_state ? GTA_OK : gta_create_io_state(&_state));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot initialize GTA i/o state", static_cast<gta::result>(r));
+            }
+            r = gta_clone_io_state(_state, s._state);
             if (r != GTA_OK)
             {
                 throw exception("Cannot clone GTA i/o state", static_cast<gta::result>(r));
@@ -685,6 +742,231 @@ namespace gta
         }
         /** \endcond */
 
+#if __cplusplus >= 201103L
+        /**
+         * \brief       Move assignment operator.
+         * \param s     The state to move.
+         */
+        io_state &operator=(io_state &&s) noexcept
+        {
+            std::swap(_state, s._state);
+            return *this;
+        }
+#endif
+
+        friend class header;
+    };
+
+    /**
+     * \brief   Index of the arrays in a GTA stream.
+     *
+     * A stream index records the header offset, data offset, and stored data size
+     * of each array in a seekable GTA file, so that each array can be accessed
+     * directly with gta::header::read_from(const stream_index &, uintmax_t, FILE *).
+     * See also gta_build_stream_index().
+     */
+    class stream_index
+    {
+    private:
+
+        gta_stream_index_t *_index;
+
+        /* Not copyable */
+        stream_index(const stream_index &);
+        stream_index &operator=(const stream_index &);
+
+    public:
+
+        /**
+         * \brief       Constructor.
+         */
+        stream_index()
+        {
+            gta_result_t r = gta_create_stream_index(&_index);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot initialize GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Destructor.
+         */
+        ~stream_index()
+        {
+            if (_index)
+            {
+                gta_destroy_stream_index(_index);
+            }
+        }
+
+        /**
+         * \brief       Get the number of arrays.
+         * \return      The number of arrays.
+         */
+        uintmax_t arrays() const
+        {
+            return gta_get_stream_index_arrays(_index);
+        }
+
+        /**
+         * \brief       Get the size of the indexed file.
+         * \return      The offset of the end of the last array.
+         */
+        uintmax_t file_size() const
+        {
+            return gta_get_stream_index_file_size(_index);
+        }
+
+        /**
+         * \brief       Get the header offset of an array.
+         * \param i     The array index.
+         * \return      The offset of the first header byte.
+         */
+        intmax_t header_offset(uintmax_t i) const
+        {
+            return gta_get_stream_index_header_offset(_index, i);
+        }
+
+        /**
+         * \brief       Get the data offset of an array.
+         * \param i     The array index.
+         * \return      The offset of the first data byte.
+         */
+        intmax_t data_offset(uintmax_t i) const
+        {
+            return gta_get_stream_index_data_offset(_index, i);
+        }
+
+        /**
+         * \brief       Get the stored data size of an array.
+         * \param i     The array index.
+         * \return      The number of bytes that the data occupies in the file.
+         */
+        uintmax_t data_size(uintmax_t i) const
+        {
+            return gta_get_stream_index_data_size(_index, i);
+        }
+
+        /**
+         * \brief       Build the index.
+         * \param io    Custom input object, positioned at the start of the GTA file.
+         */
+        void build(custom_io &io)
+        {
+            gta_result_t r = gta_build_stream_index(_index, read_custom_io,
+                    (io.seekable() ? seek_custom_io : NULL),
+                    reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot build GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Build the index.
+         * \param f     Input C stream, positioned at the start of the GTA file.
+         */
+        void build(FILE *f)
+        {
+            gta_result_t r = gta_build_stream_index_from_stream(_index, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot build GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Build the index.
+         * \param fd    Input file descriptor, positioned at the start of the GTA file.
+         */
+        void build(int fd)
+        {
+            gta_result_t r = gta_build_stream_index_from_fd(_index, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot build GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Read the index.
+         * \param io    Custom input object.
+         */
+        void read_from(custom_io &io)
+        {
+            gta_result_t r = gta_read_stream_index(_index, read_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Read the index.
+         * \param f     Input C stream.
+         */
+        void read_from(FILE *f)
+        {
+            gta_result_t r = gta_read_stream_index_from_stream(_index, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Read the index.
+         * \param fd    Input file descriptor.
+         */
+        void read_from(int fd)
+        {
+            gta_result_t r = gta_read_stream_index_from_fd(_index, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Write the index.
+         * \param io    Custom output object.
+         */
+        void write_to(custom_io &io) const
+        {
+            gta_result_t r = gta_write_stream_index(_index, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Write the index.
+         * \param f     Output C stream.
+         */
+        void write_to(FILE *f) const
+        {
+            gta_result_t r = gta_write_stream_index_to_stream(_index, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief       Write the index.
+         * \param fd    Output file descriptor.
+         */
+        void write_to(int fd) const
+        {
+            gta_result_t r = gta_write_stream_index_to_fd(_index, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA stream index", static_cast<gta::result>(r));
+            }
+        }
+
         friend class header;
     };
 
@@ -778,6 +1060,21 @@ namespace gta
             reset_taglists();
         }
 
+#if __cplusplus >= 201103L
+        /**
+         * \brief       Move constructor.
+         * \param hdr   The header to move. It may only be assigned to or destroyed afterwards.
+         */
+        header(header &&hdr) noexcept :
+            _header(hdr._header),
+            _global_taglist(hdr._global_taglist),
+            _dimension_taglists(std::move(hdr._dimension_taglists)),
+            _component_taglists(std::move(hdr._component_taglists))
+        {
+            hdr._header = NULL;
+        }
+#endif
+
         /**
          * \brief       Destructor.
          */
@@ -795,7 +1092,12 @@ namespace gta
          */
         const header &operator=(const header &hdr)
         {
-            gta_result_t r = gta_clone_header(_header, hdr._header);
+            gta_result_t r = (_header ? GTA_OK : gta_create_header(&_header));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot initialize GTA header", static_cast<gta::result>(r));
+            }
+            r = gta_clone_header(_header, hdr._header);
             if (r != GTA_OK)
             {
                 throw exception("Cannot clone GTA header", static_cast<gta::result>(r));
@@ -804,6 +1106,21 @@ namespace gta
             return *this;
         }
 
+#if __cplusplus >= 201103L
+        /**
+         * \brief       Move assignment operator.
+         * \param hdr   The header to move.
+         */
+        header &operator=(header &&hdr) noexcept
+        {
+            std::swap(_header, hdr._header);
+            std::swap(_global_taglist._taglist, hdr._global_taglist._taglist);
+            _dimension_taglists.swap(hdr._dimension_taglists);
+            _component_taglists.swap(hdr._component_taglists);
+            return *this;
+        }
+#endif
+
         /*@}*/
 
         /**
@@ -869,6 +1186,61 @@ namespace gta
             reset_taglists();
         }
 
+        /**
+         * \brief       Read the header of an indexed array.
+         * \param index The stream index.
+         * \param i     The array index.
+         * \param io    Custom input object; must be seekable.
+         *
+         * Afterwards, the input is positioned at the start of the array data.
+         */
+        void read_from(const stream_index &index, uintmax_t i, custom_io &io)
+        {
+            gta_result_t r = gta_read_indexed_header(_header, index._index, i,
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA header", static_cast<gta::result>(r));
+            }
+            reset_taglists();
+        }
+
+        /**
+         * \brief       Read the header of an indexed array.
+         * \param index The stream index.
+         * \param i     The array index.
+         * \param f     Input C stream; must be seekable.
+         *
+         * Afterwards, the input is positioned at the start of the array data.
+         */
+        void read_from(const stream_index &index, uintmax_t i, FILE *f)
+        {
+            gta_result_t r = gta_read_indexed_header_from_stream(_header, index._index, i, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA header", static_cast<gta::result>(r));
+            }
+            reset_taglists();
+        }
+
+        /**
+         * \brief       Read the header of an indexed array.
+         * \param index The stream index.
+         * \param i     The array index.
+         * \param fd    Input file descriptor; must be seekable.
+         *
+         * Afterwards, the input is positioned at the start of the array data.
+         */
+        void read_from(const stream_index &index, uintmax_t i, int fd)
+        {
+            gta_result_t r = gta_read_indexed_header_from_fd(_header, index._index, i, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA header", static_cast<gta::result>(r));
+            }
+            reset_taglists();
+        }
+
         /**
          * \brief       Write a header.
          * \param io    Custom output object.
@@ -1063,6 +1435,20 @@ namespace gta
             return gta_get_data_size(_header);
         }
 
+        /**
+         * \brief       Check if the array data is stored in native form.
+         * \return      Whether the data is stored in native form.
+         *
+         * The data is stored in native form if it is uncompressed and in host endianness.
+         * In this case, the data section that follows the header in a file is byte-identical
+         * to the array data in memory, and applications can use it directly, e.g. by mapping
+         * it into memory instead of reading it with read_data().
+         */
+        bool data_is_native() const
+        {
+            return gta_data_is_native(_header);
+        }
+
         /**
          * \brief               Get the compression.
          * \return              The compression type.
@@ -1090,24 +1476,75 @@ namespace gta
             gta_set_compression(_header, static_cast<gta_compression_t>(compression));
         }
 
-        /*@}*/
-
         /**
-         * \name        Define an Array
+         * \brief               Get the header padding.
+         * \return              The number of padding bytes in the header.
          */
-
-        /*@{*/
+        uintmax_t header_padding() const
+        {
+            return gta_get_header_padding(_header);
+        }
 
         /**
-         * \brief        Set the components of an array element.
-         * \param n      The number of components.
-         * \param types  The types of the \a n components.
-         * \param sizes  NULL, or the sizes of the components that have type \a gta::blob.
+         * \brief               Set the header padding.
+         * \param padding       The number of padding bytes.
          *
-         * Set the components of the array elements.\n
-         * The \a sizes parameter can be NULL if no components have the type \a gta::blob.
-         * Otherwise, it must point to a list that contains the sizes of these components (and only
-         * these components). For example, if there are five components, but only two have the type
+         * Reserves room in the header so that it can later be rewritten in place.
+         * See gta_set_header_padding().
+         */
+        void set_header_padding(uintmax_t padding)
+        {
+            gta_result_t r = gta_set_header_padding(_header, padding);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot set GTA header padding", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Get the header size.
+         * \return              The number of bytes that write_to() writes for this header.
+         */
+        uintmax_t header_size() const
+        {
+            return gta_get_header_size(_header);
+        }
+
+        /**
+         * \brief               Set the header padding so that the array data is aligned.
+         * \param offset        The position in the output at which the header will be written.
+         * \param min_padding   The minimum number of padding bytes.
+         * \param alignment     The alignment of the data, e.g. 4096.
+         *
+         * See gta_align_header().
+         */
+        void align(uintmax_t offset, uintmax_t min_padding, uintmax_t alignment)
+        {
+            gta_result_t r = gta_align_header(_header, offset, min_padding, alignment);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot align GTA header", static_cast<gta::result>(r));
+            }
+        }
+
+        /*@}*/
+
+        /**
+         * \name        Define an Array
+         */
+
+        /*@{*/
+
+        /**
+         * \brief        Set the components of an array element.
+         * \param n      The number of components.
+         * \param types  The types of the \a n components.
+         * \param sizes  NULL, or the sizes of the components that have type \a gta::blob.
+         *
+         * Set the components of the array elements.\n
+         * The \a sizes parameter can be NULL if no components have the type \a gta::blob.
+         * Otherwise, it must point to a list that contains the sizes of these components (and only
+         * these components). For example, if there are five components, but only two have the type
          * \a gta::blob, then the \a sizes list must contain two size values.\n
          * All components will initially have an empty tag list.\n
          */
@@ -1750,6 +2187,9 @@ namespace gta
          *
          * Element-based input/output needs a state object gta::io_state. The same state object must be
          * used until all elements are read or written, or until an error occurs.
+         *
+         * The lend/commit functions give direct access to the internal data buffer of the state object
+         * instead of copying elements; see gta_lend_read_elements() and gta_lend_write_elements().
          */
 
         /*@{*/
@@ -1900,6 +2340,314 @@ namespace gta
             }
         }
 
+        /**
+         * \brief               Lend array elements for reading.
+         * \param state         The input/output state.
+         * \param io            Custom input object.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+         * The elements are valid until commit_read_elements() is called.
+         */
+        const void *lend_read_elements(io_state &state, custom_io &io, uintmax_t n, uintmax_t *lent) const
+        {
+            const void *buf;
+            gta_result_t r = gta_lend_read_elements(_header, state._state, n, lent, &buf, read_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after reading.
+         * \param state         The input/output state.
+         * \param io            Custom input object.
+         *
+         * Marks the elements lent by lend_read_elements() as consumed.
+         */
+        void commit_read_elements(io_state &state, custom_io &io) const
+        {
+            gta_result_t r = gta_commit_read_elements(_header, state._state, read_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for reading.
+         * \param state         The input/output state.
+         * \param is            Input stream.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+         * The elements are valid until commit_read_elements() is called.
+         */
+        const void *lend_read_elements(io_state &state, std::istream &is, uintmax_t n, uintmax_t *lent) const
+        {
+            const void *buf;
+            istream_io io(is);
+            gta_result_t r = gta_lend_read_elements(_header, state._state, n, lent, &buf, read_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after reading.
+         * \param state         The input/output state.
+         * \param is            Input stream.
+         *
+         * Marks the elements lent by lend_read_elements() as consumed.
+         */
+        void commit_read_elements(io_state &state, std::istream &is) const
+        {
+            istream_io io(is);
+            gta_result_t r = gta_commit_read_elements(_header, state._state, read_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for reading.
+         * \param state         The input/output state.
+         * \param f             Input stream.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+         * The elements are valid until commit_read_elements() is called.
+         */
+        const void *lend_read_elements(io_state &state, FILE *f, uintmax_t n, uintmax_t *lent) const
+        {
+            const void *buf;
+            gta_result_t r = gta_lend_read_elements_from_stream(_header, state._state, n, lent, &buf, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after reading.
+         * \param state         The input/output state.
+         * \param f             Input stream.
+         *
+         * Marks the elements lent by lend_read_elements() as consumed.
+         */
+        void commit_read_elements(io_state &state, FILE *f) const
+        {
+            gta_result_t r = gta_commit_read_elements_from_stream(_header, state._state, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for reading.
+         * \param state         The input/output state.
+         * \param fd            Input file descriptor.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides read-only access to at least one and at most \a n of the next elements without copying them.
+         * The elements are valid until commit_read_elements() is called.
+         */
+        const void *lend_read_elements(io_state &state, int fd, uintmax_t n, uintmax_t *lent) const
+        {
+            const void *buf;
+            gta_result_t r = gta_lend_read_elements_from_fd(_header, state._state, n, lent, &buf, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after reading.
+         * \param state         The input/output state.
+         * \param fd            Input file descriptor.
+         *
+         * Marks the elements lent by lend_read_elements() as consumed.
+         */
+        void commit_read_elements(io_state &state, int fd) const
+        {
+            gta_result_t r = gta_commit_read_elements_from_fd(_header, state._state, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for writing.
+         * \param state         The input/output state.
+         * \param io            Custom output object.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides write access to the location of at least one and at most \a n of the next elements without copying them.
+         * The caller must fill all lent elements and then call commit_write_elements().
+         */
+        void *lend_write_elements(io_state &state, custom_io &io, uintmax_t n, uintmax_t *lent) const
+        {
+            void *buf;
+            gta_result_t r = gta_lend_write_elements(_header, state._state, n, lent, &buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after writing.
+         * \param state         The input/output state.
+         * \param io            Custom output object.
+         *
+         * Writes the elements lent by lend_write_elements().
+         */
+        void commit_write_elements(io_state &state, custom_io &io) const
+        {
+            gta_result_t r = gta_commit_write_elements(_header, state._state, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for writing.
+         * \param state         The input/output state.
+         * \param os            Output stream.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides write access to the location of at least one and at most \a n of the next elements without copying them.
+         * The caller must fill all lent elements and then call commit_write_elements().
+         */
+        void *lend_write_elements(io_state &state, std::ostream &os, uintmax_t n, uintmax_t *lent) const
+        {
+            void *buf;
+            ostream_io io(os);
+            gta_result_t r = gta_lend_write_elements(_header, state._state, n, lent, &buf, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after writing.
+         * \param state         The input/output state.
+         * \param os            Output stream.
+         *
+         * Writes the elements lent by lend_write_elements().
+         */
+        void commit_write_elements(io_state &state, std::ostream &os) const
+        {
+            ostream_io io(os);
+            gta_result_t r = gta_commit_write_elements(_header, state._state, write_custom_io, reinterpret_cast<intptr_t>(&io));
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for writing.
+         * \param state         The input/output state.
+         * \param f             Output stream.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides write access to the location of at least one and at most \a n of the next elements without copying them.
+         * The caller must fill all lent elements and then call commit_write_elements().
+         */
+        void *lend_write_elements(io_state &state, FILE *f, uintmax_t n, uintmax_t *lent) const
+        {
+            void *buf;
+            gta_result_t r = gta_lend_write_elements_to_stream(_header, state._state, n, lent, &buf, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after writing.
+         * \param state         The input/output state.
+         * \param f             Output stream.
+         *
+         * Writes the elements lent by lend_write_elements().
+         */
+        void commit_write_elements(io_state &state, FILE *f) const
+        {
+            gta_result_t r = gta_commit_write_elements_to_stream(_header, state._state, f);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief               Lend array elements for writing.
+         * \param state         The input/output state.
+         * \param fd            Output file descriptor.
+         * \param n             The maximum number of elements to lend.
+         * \param lent          The number of elements that were lent.
+         * \return              The lent elements.
+         *
+         * Provides write access to the location of at least one and at most \a n of the next elements without copying them.
+         * The caller must fill all lent elements and then call commit_write_elements().
+         */
+        void *lend_write_elements(io_state &state, int fd, uintmax_t n, uintmax_t *lent) const
+        {
+            void *buf;
+            gta_result_t r = gta_lend_write_elements_to_fd(_header, state._state, n, lent, &buf, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+            return buf;
+        }
+
+        /**
+         * \brief               Commit lent array elements after writing.
+         * \param state         The input/output state.
+         * \param fd            Output file descriptor.
+         *
+         * Writes the elements lent by lend_write_elements().
+         */
+        void commit_write_elements(io_state &state, int fd) const
+        {
+            gta_result_t r = gta_commit_write_elements_to_fd(_header, state._state, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
         /*@}*/
 
         /**
@@ -1923,21 +2671,27 @@ namespace gta
          * \param lower_coordinates     Coordinates of the lower corner element of the block.
          * \param higher_coordinates    Coordinates of the higher corner element of the block.
          * \param block                 Block buffer.
+         * \param io_calls              If not NULL, the number of issued I/O calls is stored here.
          *
          * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
          * This function modifies the file position indicator of the input.
          */
         void read_block(custom_io &io, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
-                void *block) const
+                void *block, uintmax_t *io_calls = NULL) const
         {
-            gta_result_t r = gta_read_block(_header, data_offset,
+            uintmax_t calls;
+            gta_result_t r = gta_read_block_counted(_header, data_offset,
                     lower_coordinates, higher_coordinates, block,
-                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io), &calls);
             if (r != GTA_OK)
             {
                 throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
             }
+            if (io_calls)
+            {
+                *io_calls = calls;
+            }
         }
 
         /**
@@ -1947,22 +2701,28 @@ namespace gta
          * \param lower_coordinates     Coordinates of the lower corner element of the block.
          * \param higher_coordinates    Coordinates of the higher corner element of the block.
          * \param block                 Block buffer.
+         * \param io_calls              If not NULL, the number of issued I/O calls is stored here.
          *
          * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
          * This function modifies the file position indicator of the input.
          */
         void read_block(std::istream &is, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
-                void *block) const
+                void *block, uintmax_t *io_calls = NULL) const
         {
+            uintmax_t calls;
             istream_io io(is);
-            gta_result_t r = gta_read_block(_header, data_offset,
+            gta_result_t r = gta_read_block_counted(_header, data_offset,
                     lower_coordinates, higher_coordinates, block,
-                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io));
+                    read_custom_io, seek_custom_io, reinterpret_cast<intptr_t>(&io), &calls);
             if (r != GTA_OK)
             {
                 throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
             }
+            if (io_calls)
+            {
+                *io_calls = calls;
+            }
         }
 
         /**
@@ -1972,20 +2732,26 @@ namespace gta
          * \param lower_coordinates     Coordinates of the lower corner element of the block.
          * \param higher_coordinates    Coordinates of the higher corner element of the block.
          * \param block                 Block buffer.
+         * \param io_calls              If not NULL, the number of issued I/O calls is stored here.
          *
          * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
          * This function modifies the file position indicator of the input.
          */
         void read_block(FILE *f, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
-                void *block) const
+                void *block, uintmax_t *io_calls = NULL) const
         {
-            gta_result_t r = gta_read_block_from_stream(_header, data_offset,
-                    lower_coordinates, higher_coordinates, block, f);
+            uintmax_t calls;
+            gta_result_t r = gta_read_block_from_stream_counted(_header, data_offset,
+                    lower_coordinates, higher_coordinates, block, f, &calls);
             if (r != GTA_OK)
             {
                 throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
             }
+            if (io_calls)
+            {
+                *io_calls = calls;
+            }
         }
 
         /**
@@ -1995,15 +2761,44 @@ namespace gta
          * \param lower_coordinates     Coordinates of the lower corner element of the block.
          * \param higher_coordinates    Coordinates of the higher corner element of the block.
          * \param block                 Block buffer.
+         * \param io_calls              If not NULL, the number of issued I/O calls is stored here.
          *
          * Reads the given array block and copies it to the given block buffer, which must be large enough.\n
-         * This function modifies the file position indicator of the input.
+         * This function may modify the file position indicator of the input.
          */
         void read_block(int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                void *block, uintmax_t *io_calls = NULL) const
+        {
+            uintmax_t calls;
+            gta_result_t r = gta_read_block_from_fd_counted(_header, data_offset,
+                    lower_coordinates, higher_coordinates, block, fd, &calls);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data block", static_cast<gta::result>(r));
+            }
+            if (io_calls)
+            {
+                *io_calls = calls;
+            }
+        }
+
+        /**
+         * \brief                       Read an array block with positioned input.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * This function does not use the file position, so several threads can
+         * read blocks at the same time. See gta_pread_block_from_fd().
+         */
+        void pread_block(int fd, uintmax_t data_offset,
                 const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
                 void *block) const
         {
-            gta_result_t r = gta_read_block_from_fd(_header, data_offset,
+            gta_result_t r = gta_pread_block_from_fd(_header, data_offset,
                     lower_coordinates, higher_coordinates, block, fd);
             if (r != GTA_OK)
             {
@@ -2011,6 +2806,28 @@ namespace gta
             }
         }
 
+        /**
+         * \brief                       Read consecutive array elements with positioned input.
+         * \param fd                    Input file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param first_element         Linear index of the first element to read.
+         * \param n                     The number of elements.
+         * \param elements              Element buffer.
+         *
+         * This function does not use the file position, so several threads can
+         * read at the same time. See gta_pread_elements_from_fd().
+         */
+        void pread_elements(int fd, uintmax_t data_offset,
+                uintmax_t first_element, uintmax_t n, void *elements) const
+        {
+            gta_result_t r = gta_pread_elements_from_fd(_header, data_offset,
+                    first_element, n, elements, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot read GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
         /**
          * \brief                       Write an array block.
          * \param io                    Custom output object.
@@ -2102,6 +2919,53 @@ namespace gta
             }
         }
 
+        /**
+         * \brief                       Write consecutive array elements with positioned output.
+         * \param fd                    Output file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param first_element         Linear index of the first element to write.
+         * \param n                     The number of elements.
+         * \param elements              The elements.
+         *
+         * This function does not use the file position, so several threads can
+         * write disjoint parts of the data at the same time.
+         * See gta_pwrite_elements_to_fd().
+         */
+        void pwrite_elements(int fd, uintmax_t data_offset,
+                uintmax_t first_element, uintmax_t n, const void *elements) const
+        {
+            gta_result_t r = gta_pwrite_elements_to_fd(_header, data_offset,
+                    first_element, n, elements, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data elements", static_cast<gta::result>(r));
+            }
+        }
+
+        /**
+         * \brief                       Write an array block with positioned output.
+         * \param fd                    Output file descriptor.
+         * \param data_offset           Offset of the first data byte.
+         * \param lower_coordinates     Coordinates of the lower corner element of the block.
+         * \param higher_coordinates    Coordinates of the higher corner element of the block.
+         * \param block                 Block buffer.
+         *
+         * This function does not use the file position, so several threads can
+         * write disjoint blocks at the same time.
+         * See gta_pwrite_block_to_fd().
+         */
+        void pwrite_block(int fd, uintmax_t data_offset,
+                const uintmax_t *lower_coordinates, const uintmax_t *higher_coordinates,
+                const void *block) const
+        {
+            gta_result_t r = gta_pwrite_block_to_fd(_header, data_offset,
+                    lower_coordinates, higher_coordinates, block, fd);
+            if (r != GTA_OK)
+            {
+                throw exception("Cannot write GTA data block", static_cast<gta::result>(r));
+            }
+        }
+
         /*@}*/
     };
 
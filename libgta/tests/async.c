@@ -0,0 +1,213 @@
+/*
+ * async.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+/* Three data chunks; elements of 3 bytes cross the chunk boundaries */
+#define ELEMENTS (12 * 1024 * 1024 + 7)
+#define BATCH 9973
+
+static uint8_t value(uintmax_t i, int c)
+{
+    return (uint8_t)((i * 7 + (uintmax_t)c * 131 + i / 65536) % 251);
+}
+
+int main(void)
+{
+    FILE *f;
+    gta_header_t *h, *h2;
+    gta_io_state_t *s, *s2;
+    gta_result_t r;
+    uintmax_t dim = ELEMENTS;
+    uint8_t *buf;
+
+    r = gta_create_header(&h);
+    check(r == GTA_OK);
+    r = gta_create_header(&h2);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT8, GTA_UINT8, GTA_UINT8 };
+    r = gta_set_components(h, 3, types, NULL);
+    check(r == GTA_OK);
+    r = gta_set_dimensions(h, 1, &dim);
+    check(r == GTA_OK);
+    check(gta_get_data_size(h) > 32 * 1024 * 1024);
+    buf = malloc(BATCH * 3);
+    check(buf);
+
+    /* Write the array with write-behind, alternating between copying and lending */
+    f = fopen("test-async.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(h, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    r = gta_set_io_state_async(s, 1);
+    check(r == GTA_OK);
+    for (uintmax_t i = 0; i < ELEMENTS;)
+    {
+        uintmax_t n = (ELEMENTS - i < BATCH ? ELEMENTS - i : BATCH);
+        if (i / BATCH % 2 == 0)
+        {
+            for (uintmax_t j = 0; j < n; j++)
+                for (int c = 0; c < 3; c++)
+                    buf[3 * j + c] = value(i + j, c);
+            r = gta_write_elements_to_stream(h, s, n, buf, f);
+            check(r == GTA_OK);
+        }
+        else
+        {
+            uintmax_t lent;
+            void *lbuf;
+            r = gta_lend_write_elements_to_stream(h, s, n, &lent, &lbuf, f);
+            check(r == GTA_OK);
+            check(lent >= 1 && lent <= n);
+            n = lent;
+            for (uintmax_t j = 0; j < n; j++)
+                for (int c = 0; c < 3; c++)
+                    ((uint8_t *)lbuf)[3 * j + c] = value(i + j, c);
+            r = gta_commit_write_elements_to_stream(h, s, f);
+            check(r == GTA_OK);
+        }
+        i += n;
+    }
+    /* All output must be finished now */
+    r = gta_set_io_state_async(s, 0);
+    check(r == GTA_INVALID_DATA);
+    gta_destroy_io_state(s);
+    r = gta_set_dimensions(h2, 0, NULL);
+    check(r == GTA_OK);
+    r = gta_write_header_to_stream(h2, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+
+    /* Read the array with read-ahead, alternating between copying and lending */
+    f = fopen("test-async.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(h2, f);
+    check(r == GTA_OK);
+    check(gta_get_data_size(h2) == gta_get_data_size(h));
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    r = gta_set_io_state_async(s, 1);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s2);
+    check(r == GTA_OK);
+    r = gta_clone_io_state(s2, s);
+    check(r == GTA_OK);
+    for (uintmax_t i = 0; i < ELEMENTS;)
+    {
+        uintmax_t n = (ELEMENTS - i < BATCH ? ELEMENTS - i : BATCH);
+        const uint8_t *p;
+        uintmax_t lent = 0;
+        if (i / BATCH % 2 == 0)
+        {
+            r = gta_read_elements_from_stream(h2, s, n, buf, f);
+            check(r == GTA_OK);
+            p = buf;
+        }
+        else
+        {
+            const void *lbuf;
+            r = gta_lend_read_elements_from_stream(h2, s, n, &lent, &lbuf, f);
+            check(r == GTA_OK);
+            check(lent >= 1 && lent <= n);
+            n = lent;
+            p = lbuf;
+        }
+        for (uintmax_t j = 0; j < n; j++)
+            for (int c = 0; c < 3; c++)
+                check(p[3 * j + c] == value(i + j, c));
+        if (lent > 0)
+        {
+            r = gta_commit_read_elements_from_stream(h2, s, f);
+            check(r == GTA_OK);
+        }
+        i += n;
+        if (i == BATCH)
+        {
+            /* The next chunk is being read ahead */
+            r = gta_clone_io_state(s2, s);
+            check(r == GTA_INVALID_DATA);
+        }
+    }
+    gta_destroy_io_state(s);
+    gta_destroy_io_state(s2);
+    /* All input must be finished now, and the input positioned after the array */
+    r = gta_read_header_from_stream(h2, f);
+    check(r == GTA_OK);
+    check(gta_get_dimensions(h2) == 0);
+    check(fgetc(f) == EOF);
+    check(fclose(f) == 0);
+
+    /* Errors of the background input must be reported */
+    f = fopen("test-async.tmp", "r");
+    check(f);
+    FILE *g = fopen("test-async-truncated.tmp", "w");
+    check(g);
+    for (int k = 0; k < 20 * 1024 * 1024 / (BATCH * 3); k++)
+    {
+        check(fread(buf, BATCH * 3, 1, f) == 1);
+        check(fwrite(buf, BATCH * 3, 1, g) == 1);
+    }
+    check(fclose(f) == 0);
+    check(fclose(g) == 0);
+    f = fopen("test-async-truncated.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(h2, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    r = gta_set_io_state_async(s, 1);
+    check(r == GTA_OK);
+    uintmax_t i = 0;
+    do
+    {
+        uintmax_t n = (ELEMENTS - i < BATCH ? ELEMENTS - i : BATCH);
+        r = gta_read_elements_from_stream(h2, s, n, buf, f);
+        i += n;
+    }
+    while (r == GTA_OK && i < ELEMENTS);
+    check(r == GTA_UNEXPECTED_EOF);
+    gta_destroy_io_state(s);
+    check(fclose(f) == 0);
+
+    remove("test-async.tmp");
+    remove("test-async-truncated.tmp");
+    free(buf);
+    gta_destroy_header(h);
+    gta_destroy_header(h2);
+    return 0;
+}
@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <gta/gta.h>
 
@@ -36,6 +38,92 @@
         exit(1); \
     }
 
+/* Write the header of a one-dimensional array of uint32 elements in the
+ * endianness that is not the host endianness, and return the data offset. */
+static off_t write_other_endian_header(const char *filename, uint64_t elements)
+{
+    const uint16_t one = 1;
+    int host_is_little_endian = (*(const uint8_t *)&one == 1);
+    unsigned char h[44];
+    memset(h, 0, sizeof(h));
+    memcpy(h, "GTA", 3);
+    h[3] = 1;                                   /* version */
+    h[4] = (host_is_little_endian ? 0x01 : 0x00);
+    h[5] = GTA_NONE;
+    h[host_is_little_endian ? 13 : 6] = 21;     /* chunk size */
+    h[14] = GTA_NONE;
+    h[15] = GTA_UINT32;                         /* component list */
+    h[16] = 0xff;
+    for (int i = 0; i < 8; i++)                 /* dimension list */
+    {
+        h[host_is_little_endian ? 24 - i : 17 + i] = (elements >> (8 * i)) & 0xff;
+    }
+    /* the end of the dimension list, three empty tag lists, and the end chunk are zero */
+    FILE *f = fopen(filename, "w");
+    check(f);
+    check(fwrite(h, sizeof(h), 1, f) == 1);
+    check(fclose(f) == 0);
+    return sizeof(h);
+}
+
+/* Read a block with the stream and file descriptor functions, compare it to the
+ * array data, and check that not more than max_io_calls I/O calls were needed. */
+static void check_block(const gta_header_t *header, const void *data, off_t data_offset,
+        const char *filename, const uintmax_t *lc, const uintmax_t *hc, uintmax_t max_io_calls)
+{
+    gta_result_t r;
+    uintmax_t block_elements = 1;
+    for (uintmax_t d = 0; d < gta_get_dimensions(header); d++)
+    {
+        block_elements *= hc[d] - lc[d] + 1;
+    }
+    size_t element_size = gta_get_element_size(header);
+    char *block = malloc(block_elements * element_size);
+    check(block);
+    uintmax_t *coords = malloc(gta_get_dimensions(header) * sizeof(uintmax_t));
+    check(coords);
+
+    for (int variant = 0; variant < 2; variant++)
+    {
+        uintmax_t io_calls = 0;
+        memset(block, 0xff, block_elements * element_size);
+        if (variant == 0)
+        {
+            FILE *f = fopen(filename, "r");
+            check(f);
+            r = gta_read_block_from_stream_counted(header, data_offset, lc, hc, block, f, &io_calls);
+            check(r == GTA_OK);
+            fclose(f);
+        }
+        else
+        {
+            int fd = open(filename, O_RDONLY);
+            check(fd >= 0);
+            r = gta_read_block_from_fd_counted(header, data_offset, lc, hc, block, fd, &io_calls);
+            check(r == GTA_OK);
+            close(fd);
+        }
+        check(io_calls > 0 && io_calls <= max_io_calls);
+        memcpy(coords, lc, gta_get_dimensions(header) * sizeof(uintmax_t));
+        for (uintmax_t i = 0; i < block_elements; i++)
+        {
+            check(memcmp(block + i * element_size, gta_get_element_const(header, data, coords), element_size) == 0);
+            for (uintmax_t d = 0; d < gta_get_dimensions(header); d++)
+            {
+                if (coords[d] < hc[d])
+                {
+                    coords[d]++;
+                    break;
+                }
+                coords[d] = lc[d];
+            }
+        }
+    }
+
+    free(coords);
+    free(block);
+}
+
 int main(void)
 {
     gta_header_t *header;
@@ -149,8 +237,162 @@ int main(void)
         }
     }
 
+    /* Check that rows are merged into few I/O calls */
+    {
+        uintmax_t lc2[] = { 0, 0, 4 };
+        uintmax_t hc2[] = { 9, 9, 7 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc2, hc2, 2);
+        uintmax_t lc3[] = { 0, 3, 4 };
+        uintmax_t hc3[] = { 9, 6, 7 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc3, hc3, 2);
+        check_block(header, data, data_offset, "test-blocks.tmp", lc, hc, 2);
+    }
     free(data);
     free(block);
+
+    /* A larger array with gaps between slices that are too large to be read over */
+    gta_type_t types2[] = { GTA_UINT32 };
+    r = gta_set_components(header, 1, types2, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims2[] = { 256, 256, 4 };
+    r = gta_set_dimensions(header, 3, dims2);
+    check(r == GTA_OK);
+    data = malloc(gta_get_data_size(header));
+    check(data);
+    for (uintmax_t i = 0; i < gta_get_elements(header); i++)
+    {
+        uint32_t v = i;
+        memcpy(gta_get_element_linear(header, data, i), &v, sizeof(uint32_t));
+    }
+    f = fopen("test-blocks.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    data_offset = ftello(f);
+    check(data_offset != -1);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    fclose(f);
+    {
+        uintmax_t lc2[] = { 10, 10, 0 };
+        uintmax_t hc2[] = { 20, 20, 3 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc2, hc2, 2 * 4);
+        uintmax_t lc3[] = { 255, 0, 1 };
+        uintmax_t hc3[] = { 255, 255, 2 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc3, hc3, 2 * 2);
+        uintmax_t lc4[] = { 0, 0, 0 };
+        uintmax_t hc4[] = { 255, 255, 3 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc4, hc4, 2);
+        uintmax_t lc5[] = { 7, 9, 2 };
+        check_block(header, data, data_offset, "test-blocks.tmp", lc5, lc5, 2);
+    }
+
+    /* Fill the data with positioned writes of blocks and element ranges, in
+     * reverse order */
+    {
+        f = fopen("test-blocks.tmp", "w");
+        check(f);
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        data_offset = ftello(f);
+        check(fclose(f) == 0);
+        int fd = open("test-blocks.tmp", O_WRONLY);
+        check(fd >= 0);
+        uintmax_t lc6[] = { 0, 128, 3 };
+        uintmax_t hc6[] = { 255, 255, 3 };
+        r = gta_pwrite_block_to_fd(header, data_offset, lc6, hc6, gta_get_element_linear(header, data, 3 * 256 * 256 + 128 * 256), fd);
+        check(r == GTA_OK);
+        r = gta_pwrite_elements_to_fd(header, data_offset, 3 * 256 * 256, 128 * 256,
+                gta_get_element_linear(header, data, 3 * 256 * 256), fd);
+        check(r == GTA_OK);
+        uintmax_t lc7[] = { 100, 0, 0 };
+        uintmax_t hc7[] = { 255, 255, 2 };
+        uintmax_t block_elements = 156 * 256 * 3;
+        uint32_t *block7 = malloc(block_elements * sizeof(uint32_t));
+        check(block7);
+        for (uintmax_t i = 0; i < block_elements; i++)
+        {
+            uintmax_t x = 100 + i % 156, y = i / 156 % 256, z = i / (156 * 256);
+            block7[i] = x + 256 * y + 256 * 256 * z;
+        }
+        r = gta_pwrite_block_to_fd(header, data_offset, lc7, hc7, block7, fd);
+        check(r == GTA_OK);
+        free(block7);
+        for (uintmax_t i = 3 * 256 * 256; i > 0; i -= 256)
+        {
+            r = gta_pwrite_elements_to_fd(header, data_offset, i - 256, 100,
+                    gta_get_element_linear(header, data, i - 256), fd);
+            check(r == GTA_OK);
+        }
+        /* Bounds are checked */
+        r = gta_pwrite_elements_to_fd(header, data_offset, gta_get_elements(header) - 1, 2, data, fd);
+        check(r == GTA_INVALID_DATA);
+        uintmax_t hc8[] = { 255, 256, 3 };
+        r = gta_pwrite_block_to_fd(header, data_offset, lc6, hc8, data, fd);
+        check(r == GTA_INVALID_DATA);
+        r = gta_pwrite_block_to_fd(header, data_offset, hc6, lc6, data, fd);
+        check(r == GTA_INVALID_DATA);
+        check(close(fd) == 0);
+        void *data2 = malloc(gta_get_data_size(header));
+        check(data2);
+        f = fopen("test-blocks.tmp", "r");
+        check(f);
+        r = gta_read_header_from_stream(header, f);
+        check(r == GTA_OK);
+        r = gta_read_data_from_stream(header, data2, f);
+        check(r == GTA_OK);
+        check(fgetc(f) == EOF);
+        check(fclose(f) == 0);
+        check(memcmp(data, data2, gta_get_data_size(header)) == 0);
+        free(data2);
+    }
+
+    /* Positioned writes convert the elements to the endianness of the file */
+    {
+        data_offset = write_other_endian_header("test-blocks.tmp", gta_get_elements(header));
+        gta_header_t *header2;
+        r = gta_create_header(&header2);
+        check(r == GTA_OK);
+        f = fopen("test-blocks.tmp", "r");
+        check(f);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        check(ftello(f) == data_offset);
+        check(fclose(f) == 0);
+        check(gta_get_data_size(header2) == gta_get_data_size(header));
+        int fd = open("test-blocks.tmp", O_WRONLY);
+        check(fd >= 0);
+        uintmax_t lc6[] = { 1000 };
+        uintmax_t hc6[] = { gta_get_elements(header2) - 1 };
+        r = gta_pwrite_block_to_fd(header2, data_offset, lc6, hc6, gta_get_element_linear(header, data, 1000), fd);
+        check(r == GTA_OK);
+        r = gta_pwrite_elements_to_fd(header2, data_offset, 0, 1000, data, fd);
+        check(r == GTA_OK);
+        check(close(fd) == 0);
+        void *data2 = malloc(gta_get_data_size(header));
+        check(data2);
+        f = fopen("test-blocks.tmp", "r");
+        check(f);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        r = gta_read_data_from_stream(header2, data2, f);
+        check(r == GTA_OK);
+        check(fgetc(f) == EOF);
+        check(fclose(f) == 0);
+        check(memcmp(data, data2, gta_get_data_size(header)) == 0);
+        /* The file really has the other endianness */
+        f = fopen("test-blocks.tmp", "r");
+        check(f);
+        check(fseeko(f, data_offset + 4, SEEK_SET) == 0);
+        uint32_t v;
+        check(fread(&v, sizeof(uint32_t), 1, f) == 1);
+        check(fclose(f) == 0);
+        check(v == 0x01000000);
+        free(data2);
+        gta_destroy_header(header2);
+    }
+    free(data);
+
     gta_destroy_header(header);
     remove("test-blocks.tmp");
     return 0;
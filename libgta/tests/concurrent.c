@@ -0,0 +1,243 @@
+/*
+ * concurrent.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+#define THREADS 8
+#define REQUESTS 300
+
+/* Shared by all threads */
+static gta_header_t *header;
+static const unsigned char *data;
+static off_t data_offset;
+static int fd_in;
+static int fd_out;
+/* The sequential reader, which needs a lock */
+static FILE *f_in;
+static pthread_mutex_t f_in_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1103515245 + 12345;
+    return (*state >> 8);
+}
+
+static void *reader(void *arg)
+{
+    uint32_t state = (uint32_t)(uintptr_t)arg;
+    size_t element_size = gta_get_element_size(header);
+    uintmax_t lc[3], hc[3];
+
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        /* A random block, compared to the sequential reader */
+        uintmax_t block_elements = 1;
+        for (int d = 0; d < 3; d++)
+        {
+            uintmax_t size = gta_get_dimension_size(header, d);
+            uintmax_t a = next_random(&state) % size;
+            uintmax_t b = next_random(&state) % size;
+            lc[d] = (a < b ? a : b);
+            hc[d] = (a < b ? b : a);
+            block_elements *= hc[d] - lc[d] + 1;
+        }
+        unsigned char *block = malloc(block_elements * element_size);
+        unsigned char *block2 = malloc(block_elements * element_size);
+        check(block && block2);
+        gta_result_t r = gta_pread_block_from_fd(header, data_offset, lc, hc, block, fd_in);
+        check(r == GTA_OK);
+        pthread_mutex_lock(&f_in_mutex);
+        r = gta_read_block_from_stream(header, data_offset, lc, hc, block2, f_in);
+        pthread_mutex_unlock(&f_in_mutex);
+        check(r == GTA_OK);
+        check(memcmp(block, block2, block_elements * element_size) == 0);
+        free(block);
+        free(block2);
+
+        /* A random element range, compared to the data */
+        uintmax_t first = next_random(&state) % gta_get_elements(header);
+        uintmax_t n = next_random(&state) % (gta_get_elements(header) - first) + 1;
+        unsigned char *elements = malloc(n * element_size);
+        check(elements);
+        r = gta_pread_elements_from_fd(header, data_offset, first, n, elements, fd_in);
+        check(r == GTA_OK);
+        check(memcmp(elements, data + first * element_size, n * element_size) == 0);
+        free(elements);
+    }
+    return NULL;
+}
+
+static void *writer(void *arg)
+{
+    uintmax_t t = (uintptr_t)arg;
+    size_t element_size = gta_get_element_size(header);
+    uintmax_t slice_elements = gta_get_dimension_size(header, 0) * gta_get_dimension_size(header, 1);
+
+    /* Every thread writes every THREADS-th slice, as a block and as an element range */
+    for (uintmax_t z = t; z < gta_get_dimension_size(header, 2); z += THREADS)
+    {
+        gta_result_t r;
+        if (z % 2 == 0)
+        {
+            uintmax_t lc[3] = { 0, 0, z };
+            uintmax_t hc[3] = { gta_get_dimension_size(header, 0) - 1, gta_get_dimension_size(header, 1) - 1, z };
+            r = gta_pwrite_block_to_fd(header, data_offset, lc, hc, data + z * slice_elements * element_size, fd_out);
+        }
+        else
+        {
+            r = gta_pwrite_elements_to_fd(header, data_offset, z * slice_elements, slice_elements,
+                    data + z * slice_elements * element_size, fd_out);
+        }
+        check(r == GTA_OK);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    gta_header_t *header2;
+    gta_result_t r;
+    FILE *f;
+    pthread_t threads[THREADS];
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT16, GTA_FLOAT32, GTA_UINT8 };
+    r = gta_set_components(header, 3, types, NULL);
+    check(r == GTA_OK);
+    uintmax_t dims[] = { 97, 61, 23 };
+    r = gta_set_dimensions(header, 3, dims);
+    check(r == GTA_OK);
+    size_t size = gta_get_data_size(header);
+    unsigned char *buf = malloc(size);
+    check(buf);
+    for (size_t i = 0; i < size; i++)
+    {
+        buf[i] = (i * 7 + i / 251) % 256;
+    }
+    data = buf;
+
+    /* Write the array, and check it with the sequential reader */
+    f = fopen("test-concurrent.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    data_offset = ftello(f);
+    r = gta_write_data_to_stream(header, data, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    f = fopen("test-concurrent.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(ftello(f) == data_offset);
+    unsigned char *data2 = malloc(size);
+    check(data2);
+    r = gta_read_data_from_stream(header2, data2, f);
+    check(r == GTA_OK);
+    check(memcmp(data, data2, size) == 0);
+    check(fclose(f) == 0);
+
+    /* Read random blocks and element ranges from many threads with one file descriptor */
+    f_in = fopen("test-concurrent.tmp", "r");
+    check(f_in);
+    fd_in = open("test-concurrent.tmp", O_RDONLY);
+    check(fd_in >= 0);
+    for (uintptr_t t = 0; t < THREADS; t++)
+    {
+        check(pthread_create(&threads[t], NULL, reader, (void *)(t + 1)) == 0);
+    }
+    for (int t = 0; t < THREADS; t++)
+    {
+        check(pthread_join(threads[t], NULL) == 0);
+    }
+    check(close(fd_in) == 0);
+    check(fclose(f_in) == 0);
+
+    /* Read beyond the end of the file */
+    check(truncate("test-concurrent.tmp", data_offset + size - 1) == 0);
+    fd_in = open("test-concurrent.tmp", O_RDONLY);
+    check(fd_in >= 0);
+    r = gta_pread_elements_from_fd(header, data_offset, 0, gta_get_elements(header), data2, fd_in);
+    check(r == GTA_UNEXPECTED_EOF);
+    uintmax_t lc[] = { 0, 0, 0 };
+    uintmax_t hc[] = { 96, 60, 23 };
+    r = gta_pread_block_from_fd(header, data_offset, lc, hc, data2, fd_in);
+    check(r == GTA_INVALID_DATA);
+    r = gta_pread_elements_from_fd(header, data_offset, 1, gta_get_elements(header), data2, fd_in);
+    check(r == GTA_INVALID_DATA);
+    check(close(fd_in) == 0);
+
+    /* Write the array from many threads with one file descriptor */
+    f = fopen("test-concurrent.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    check(fclose(f) == 0);
+    fd_out = open("test-concurrent.tmp", O_WRONLY);
+    check(fd_out >= 0);
+    for (uintptr_t t = 0; t < THREADS; t++)
+    {
+        check(pthread_create(&threads[t], NULL, writer, (void *)t) == 0);
+    }
+    for (int t = 0; t < THREADS; t++)
+    {
+        check(pthread_join(threads[t], NULL) == 0);
+    }
+    check(close(fd_out) == 0);
+    f = fopen("test-concurrent.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    memset(data2, 0, size);
+    r = gta_read_data_from_stream(header2, data2, f);
+    check(r == GTA_OK);
+    check(fgetc(f) == EOF);
+    check(memcmp(data, data2, size) == 0);
+    check(fclose(f) == 0);
+
+    remove("test-concurrent.tmp");
+    free(buf);
+    free(data2);
+    gta_destroy_header(header);
+    gta_destroy_header(header2);
+    return 0;
+}
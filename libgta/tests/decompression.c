@@ -0,0 +1,222 @@
+/*
+ * decompression.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define ELEMENTS (20 * 1024 * 1024 + 123)
+
+/* Write a compressed GTA with three data chunks. Since libgta does not write
+ * compressed data anymore, the chunk list is written by hand: the first and
+ * last chunks are zlib-compressed, the second is stored uncompressed.
+ * If 'corrupt' is set, the compressed stream of the last chunk is damaged.
+ * Another small uncompressed array follows. */
+static void write_test_file(const char *filename, gta_header_t *header, const uint8_t *data, int corrupt)
+{
+    FILE *f = fopen(filename, "w");
+    check(f);
+    gta_result_t r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    check(fseek(f, 5, SEEK_SET) == 0);
+    check(fputc(GTA_ZLIB, f) != EOF);
+    check(fseek(f, 0, SEEK_END) == 0);
+    size_t size = gta_get_data_size(header);
+    uint8_t *buf = malloc(compressBound(CHUNK_SIZE));
+    check(buf);
+    for (size_t offset = 0, i = 0; offset < size; offset += CHUNK_SIZE, i++)
+    {
+        uint64_t chunk_size = (size - offset < CHUNK_SIZE ? size - offset : CHUNK_SIZE);
+        uint8_t compression = (i == 1 ? GTA_NONE : GTA_ZLIB);
+        check(fwrite(&chunk_size, sizeof(uint64_t), 1, f) == 1);
+        check(fwrite(&compression, sizeof(uint8_t), 1, f) == 1);
+        if (compression == GTA_NONE)
+        {
+            check(fwrite(data + offset, 1, chunk_size, f) == chunk_size);
+        }
+        else
+        {
+            uLongf compressed_size = compressBound(CHUNK_SIZE);
+            check(compress2(buf, &compressed_size, data + offset, chunk_size, 1) == Z_OK);
+            if (corrupt && offset + chunk_size == size)
+            {
+                buf[compressed_size / 2] ^= 0xff;
+            }
+            uint64_t s = compressed_size;
+            check(fwrite(&s, sizeof(uint64_t), 1, f) == 1);
+            check(fwrite(buf, 1, compressed_size, f) == compressed_size);
+        }
+    }
+    uint64_t end = 0;
+    check(fwrite(&end, sizeof(uint64_t), 1, f) == 1);
+    free(buf);
+
+    gta_header_t *small;
+    r = gta_create_header(&small);
+    check(r == GTA_OK);
+    gta_type_t type = GTA_UINT8;
+    uintmax_t dim = 5;
+    check(gta_set_components(small, 1, &type, NULL) == GTA_OK);
+    check(gta_set_dimensions(small, 1, &dim) == GTA_OK);
+    check(gta_write_header_to_stream(small, f) == GTA_OK);
+    check(fwrite("abcde", 1, 5, f) == 5);
+    gta_destroy_header(small);
+    check(fclose(f) == 0);
+}
+
+int main(void)
+{
+    gta_header_t *header, *header2;
+    gta_result_t r;
+    FILE *f, *g;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    gta_type_t type = GTA_UINT16;
+    r = gta_set_components(header, 1, &type, NULL);
+    check(r == GTA_OK);
+    uintmax_t dim = ELEMENTS;
+    r = gta_set_dimensions(header, 1, &dim);
+    check(r == GTA_OK);
+    size_t size = gta_get_data_size(header);
+    check(size > 2 * CHUNK_SIZE);
+    uint16_t *data = malloc(size);
+    uint16_t *data2 = malloc(size);
+    check(data && data2);
+    for (size_t i = 0; i < ELEMENTS; i++)
+    {
+        data[i] = (i / 3) % 1000 + (i % 5 == 0 ? i % 7 : 0);
+    }
+    write_test_file("test-decompression.tmp", header, (const uint8_t *)data, 0);
+
+    /* Read the data, and check that the input is positioned after it */
+    f = fopen("test-decompression.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(gta_get_compression(header2) == GTA_ZLIB);
+    r = gta_read_data_from_stream(header2, data2, f);
+    check(r == GTA_OK);
+    check(memcmp(data, data2, size) == 0);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(gta_get_data_size(header2) == 5);
+    char small[5];
+    r = gta_read_data_from_stream(header2, small, f);
+    check(r == GTA_OK);
+    check(memcmp(small, "abcde", 5) == 0);
+    check(fgetc(f) == EOF);
+
+    /* Copy the data to an uncompressed file */
+    rewind(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    g = fopen("test-decompression-copy.tmp", "w");
+    check(g);
+    r = gta_copy_data_stream(header2, f, header, g);
+    check(r == GTA_OK);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(gta_get_data_size(header2) == 5);
+    check(fclose(f) == 0);
+    check(fclose(g) == 0);
+    g = fopen("test-decompression-copy.tmp", "r");
+    check(g);
+    memset(data2, 0, size);
+    check(fread(data2, 1, size, g) == size);
+    check(memcmp(data, data2, size) == 0);
+    check(fgetc(g) == EOF);
+    check(fclose(g) == 0);
+
+    /* Read the data element-wise, in portions that cross chunk boundaries,
+     * both synchronously and with read-ahead */
+    for (int async = 0; async <= 1; async++)
+    {
+        f = fopen("test-decompression.tmp", "r");
+        check(f);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        gta_io_state_t *io_state;
+        r = gta_create_io_state(&io_state);
+        check(r == GTA_OK);
+        r = gta_set_io_state_async(io_state, async);
+        check(r == GTA_OK);
+        memset(data2, 0, size);
+        uintmax_t elements = gta_get_elements(header2);
+        for (uintmax_t i = 0; i < elements; i += 12345)
+        {
+            uintmax_t n = (elements - i < 12345 ? elements - i : 12345);
+            r = gta_read_elements_from_stream(header2, io_state, n, (char *)data2 + i * 2, f);
+            check(r == GTA_OK);
+        }
+        gta_destroy_io_state(io_state);
+        check(memcmp(data, data2, size) == 0);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        check(gta_get_data_size(header2) == 5);
+        check(fclose(f) == 0);
+    }
+
+    /* Errors in the compressed data must be detected */
+    write_test_file("test-decompression.tmp", header, (const uint8_t *)data, 1);
+    f = fopen("test-decompression.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    r = gta_read_data_from_stream(header2, data2, f);
+    check(r == GTA_INVALID_DATA);
+    rewind(f);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    g = fopen("test-decompression-copy.tmp", "w");
+    check(g);
+    r = gta_copy_data_stream(header2, f, header, g);
+    check(r == GTA_INVALID_DATA);
+    check(fclose(f) == 0);
+    check(fclose(g) == 0);
+
+    remove("test-decompression.tmp");
+    remove("test-decompression-copy.tmp");
+    free(data);
+    free(data2);
+    gta_destroy_header(header);
+    gta_destroy_header(header2);
+
+    return 0;
+}
@@ -402,6 +402,23 @@ int main(void)
     check(c == EOF && feof(f));
     check_data(be_header, be_data);
     check(memcmp(data, be_data, gta_get_data_size(header)) == 0);
+    /* Read the big endian file again, element-wise */
+    rewind(f);
+    r = gta_read_header_from_stream(be_header, f);
+    check(r == GTA_OK);
+    gta_io_state_t *io_state;
+    r = gta_create_io_state(&io_state);
+    check(r == GTA_OK);
+    memset(be_data, 0, gta_get_data_size(be_header));
+    for (uintmax_t i = 0; i < elements; i += 7)
+    {
+        uintmax_t n = (elements - i < 7 ? elements - i : 7);
+        r = gta_read_elements_from_stream(be_header, io_state, n,
+                gta_get_element_linear(be_header, be_data, i), f);
+        check(r == GTA_OK);
+    }
+    gta_destroy_io_state(io_state);
+    check(memcmp(data, be_data, gta_get_data_size(header)) == 0);
     fclose(f);
 
     free(data);
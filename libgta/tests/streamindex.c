@@ -0,0 +1,175 @@
+/*
+ * streamindex.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2013
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+#define ARRAYS 300
+
+int main(void)
+{
+    gta_header_t *header;
+    gta_stream_index_t *index, *index2;
+    gta_result_t r;
+    FILE *f;
+    int fd;
+
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_create_stream_index(&index);
+    check(r == GTA_OK);
+    r = gta_create_stream_index(&index2);
+    check(r == GTA_OK);
+
+    /* Write a stream of arrays with different header and data sizes */
+    f = fopen("test-streamindex.tmp", "w");
+    check(f);
+    gta_type_t type = GTA_UINT16;
+    r = gta_set_components(header, 1, &type, NULL);
+    check(r == GTA_OK);
+    for (uintmax_t i = 0; i < ARRAYS; i++)
+    {
+        uintmax_t size = i % 17 + 1;
+        r = gta_set_dimensions(header, 1, &size);
+        check(r == GTA_OK);
+        char value[32];
+        snprintf(value, sizeof(value), "%d", (int)i);
+        r = gta_set_tag(gta_get_global_taglist(header), "INDEX", value);
+        check(r == GTA_OK);
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        for (uintmax_t j = 0; j < size; j++)
+        {
+            uint16_t v = i + j;
+            check(fwrite(&v, sizeof(v), 1, f) == 1);
+        }
+    }
+    check(fclose(f) == 0);
+
+    /* Build the index from a stream and from a file descriptor */
+    f = fopen("test-streamindex.tmp", "r");
+    check(f);
+    r = gta_build_stream_index_from_stream(index, f);
+    check(r == GTA_OK);
+    check(gta_get_stream_index_arrays(index) == ARRAYS);
+    check(gta_get_stream_index_header_offset(index, 0) == 0);
+    check(gta_get_stream_index_file_size(index) == (uintmax_t)ftello(f));
+    fd = open("test-streamindex.tmp", O_RDONLY);
+    check(fd != -1);
+    r = gta_build_stream_index_from_fd(index2, fd);
+    check(r == GTA_OK);
+    check(gta_get_stream_index_arrays(index2) == ARRAYS);
+    check(gta_get_stream_index_file_size(index2) == gta_get_stream_index_file_size(index));
+    for (uintmax_t i = 0; i < ARRAYS; i++)
+    {
+        check(gta_get_stream_index_header_offset(index2, i) == gta_get_stream_index_header_offset(index, i));
+        check(gta_get_stream_index_data_offset(index2, i) == gta_get_stream_index_data_offset(index, i));
+        check(gta_get_stream_index_data_size(index, i) == (i % 17 + 1) * sizeof(uint16_t));
+    }
+
+    /* Write the index and read it back */
+    FILE *fi = fopen("test-streamindex-idx.tmp", "w");
+    check(fi);
+    r = gta_write_stream_index_to_stream(index, fi);
+    check(r == GTA_OK);
+    check(fclose(fi) == 0);
+    fi = fopen("test-streamindex-idx.tmp", "r");
+    check(fi);
+    r = gta_read_stream_index_from_stream(index2, fi);
+    check(r == GTA_OK);
+    check(fgetc(fi) == EOF);
+    check(fclose(fi) == 0);
+    check(gta_get_stream_index_arrays(index2) == ARRAYS);
+    check(gta_get_stream_index_file_size(index2) == gta_get_stream_index_file_size(index));
+    for (uintmax_t i = 0; i < ARRAYS; i++)
+    {
+        check(gta_get_stream_index_header_offset(index2, i) == gta_get_stream_index_header_offset(index, i));
+        check(gta_get_stream_index_data_offset(index2, i) == gta_get_stream_index_data_offset(index, i));
+    }
+
+    /* Access the arrays in reverse order */
+    for (uintmax_t k = 0; k < ARRAYS; k++)
+    {
+        uintmax_t i = ARRAYS - 1 - k;
+        r = gta_read_indexed_header_from_stream(header, index2, i, f);
+        check(r == GTA_OK);
+        check(gta_get_dimension_size(header, 0) == i % 17 + 1);
+        check(atoi(gta_get_tag(gta_get_global_taglist_const(header), "INDEX")) == (int)i);
+        for (uintmax_t j = 0; j < i % 17 + 1; j++)
+        {
+            uint16_t v;
+            check(fread(&v, sizeof(v), 1, f) == 1);
+            check(v == i + j);
+        }
+        r = gta_read_indexed_header_from_fd(header, index2, i, fd);
+        check(r == GTA_OK);
+        check(lseek(fd, 0, SEEK_CUR) == gta_get_stream_index_data_offset(index2, i));
+    }
+    close(fd);
+    check(fclose(f) == 0);
+
+    /* An index that does not match the file must be detected */
+    fi = fopen("test-streamindex-idx.tmp", "r+");
+    check(fi);
+    check(fseeko(fi, 24 + 16 * 5 + 8, SEEK_SET) == 0);
+    check(fputc(0xff, fi) != EOF);
+    check(fclose(fi) == 0);
+    fi = fopen("test-streamindex-idx.tmp", "r");
+    check(fi);
+    r = gta_read_stream_index_from_stream(index2, fi);
+    check(r == GTA_INVALID_DATA);
+    check(fclose(fi) == 0);
+    fi = fopen("test-streamindex-idx.tmp", "r+");
+    check(fi);
+    check(fputc('X', fi) != EOF);
+    check(fclose(fi) == 0);
+    fi = fopen("test-streamindex-idx.tmp", "r");
+    check(fi);
+    r = gta_read_stream_index_from_stream(index2, fi);
+    check(r == GTA_INVALID_DATA);
+    check(fclose(fi) == 0);
+
+    remove("test-streamindex.tmp");
+    remove("test-streamindex-idx.tmp");
+    gta_destroy_stream_index(index);
+    gta_destroy_stream_index(index2);
+    gta_destroy_header(header);
+
+    return 0;
+}
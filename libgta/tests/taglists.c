@@ -224,7 +224,230 @@ int main(void)
     check(gta_set_tag(gtl, "name", "val\xf0\x80\x80\x87ue") == GTA_INVALID_DATA);
     check(gta_set_tag(gtl, "name", "val\xf0\xbf\xbf\xbfue") == GTA_OK);
 
+    /* Write and reread a large tag list, with values that make the header
+     * span several chunks, in reverse alphabetical order */
+    gta_unset_all_tags(gtl);
+    char *bigval = malloc(1024 * 1024 + 1);
+    check(bigval);
+    memset(bigval, 'x', 1024 * 1024);
+    bigval[1024 * 1024] = '\0';
+    for (int i = 99999; i >= 0; i--)
+    {
+        sprintf(namebuf, "tag-%06d", i);
+        sprintf(valbuf, "value-%d", i);
+        r = gta_set_tag(gtl, namebuf, i % 5000 == 0 ? bigval : valbuf);
+        check(r == GTA_OK);
+    }
+    r = gta_set_tag(dtl3, "dup-a", "1");
+    check(r == GTA_OK);
+    r = gta_set_tag(dtl3, "dup-b", "2");
+    check(r == GTA_OK);
+    f = fopen("test-taglists.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    long header_size = ftell(f);
+    check(header_size > 16 * 1024 * 1024);
+    fclose(f);
+    /* Turn dup-b into a second dup-a, which must behave as if set twice */
+    f = fopen("test-taglists.tmp", "r+");
+    check(f);
+    char *buf = malloc(header_size);
+    check(buf);
+    check(fread(buf, 1, header_size, f) == (size_t)header_size);
+    char *dup = NULL;
+    for (long i = header_size - 6; i >= 0 && !dup; i--)
+    {
+        if (memcmp(buf + i, "dup-b", 6) == 0)
+        {
+            dup = buf + i;
+        }
+    }
+    check(dup);
+    check(fseek(f, dup - buf + 4, SEEK_SET) == 0);
+    check(fputc('a', f) != EOF);
+    fclose(f);
+    free(buf);
+    f = fopen("test-taglists.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(header, f);
+    check(r == GTA_OK);
+    fclose(f);
+    remove("test-taglists.tmp");
+    gtl = gta_get_global_taglist(header);
+    check(gta_get_tags(gtl) == 100000);
+    for (int i = 0; i < 100000; i++)
+    {
+        sprintf(namebuf, "tag-%06d", i);
+        sprintf(valbuf, "value-%d", i);
+        check(strcmp(gta_get_tag_name(gtl, 99999 - i), namebuf) == 0);
+        check(gta_get_tag(gtl, namebuf));
+        check(strcmp(gta_get_tag(gtl, namebuf), i % 5000 == 0 ? bigval : valbuf) == 0);
+    }
+    check(gta_get_tag(gtl, "tag-100000") == NULL);
+    free(bigval);
+    dtl3 = gta_get_dimension_taglist(header, 3);
+    check(gta_get_tags(dtl3) == 1);
+    check(strcmp(gta_get_tag_name(dtl3, 0), "dup-a") == 0);
+    check(strcmp(gta_get_tag(dtl3, "dup-a"), "2") == 0);
+
+    /* Clones share tags until they are modified */
+    gta_header_t *clone, *clone2;
+    r = gta_create_header(&clone);
+    check(r == GTA_OK);
+    r = gta_create_header(&clone2);
+    check(r == GTA_OK);
+    r = gta_clone_header(clone, header);
+    check(r == GTA_OK);
+    r = gta_clone_header(clone2, clone);
+    check(r == GTA_OK);
+    gta_taglist_t *cgtl = gta_get_global_taglist(clone);
+    check(gta_get_tags(cgtl) == 100000);
+    check(gta_get_tag_name(cgtl, 0) == gta_get_tag_name(gtl, 0));
+    r = gta_set_tag(cgtl, "tag-000001", "changed");
+    check(r == GTA_OK);
+    r = gta_unset_tag(cgtl, "tag-000002");
+    check(r == GTA_OK);
+    r = gta_set_tag(cgtl, "new-tag", "new");
+    check(r == GTA_OK);
+    check(gta_get_tags(cgtl) == 100000);
+    check(strcmp(gta_get_tag(cgtl, "tag-000001"), "changed") == 0);
+    check(gta_get_tag(cgtl, "tag-000002") == NULL);
+    check(strcmp(gta_get_tag(gtl, "tag-000001"), "value-1") == 0);
+    check(strcmp(gta_get_tag(gtl, "tag-000002"), "value-2") == 0);
+    check(gta_get_tag(gtl, "new-tag") == NULL);
+    gta_destroy_header(header);
+    gta_taglist_t *c2gtl = gta_get_global_taglist(clone2);
+    check(gta_get_tags(c2gtl) == 100000);
+    check(strcmp(gta_get_tag(c2gtl, "tag-000001"), "value-1") == 0);
+    r = gta_clone_taglist(gta_get_dimension_taglist(clone2, 0), c2gtl);
+    check(r == GTA_OK);
+    gta_unset_all_tags(c2gtl);
+    check(gta_get_tags(c2gtl) == 0);
+    check(gta_get_tags(gta_get_dimension_taglist(clone2, 0)) == 100000);
+    check(strcmp(gta_get_tag(gta_get_dimension_taglist(clone2, 0), "tag-099999"), "value-99999") == 0);
+    gta_destroy_header(clone);
+    gta_destroy_header(clone2);
+
+    /* Header padding: the size is known in advance, the padding tag is hidden,
+     * and a header can be rewritten in place with adjusted padding */
+    gta_header_t *header2;
+    uintmax_t paddings[] = { 0, 13, 1000, 20 * 1024 * 1024 };
+    for (size_t i = 0; i < sizeof(paddings) / sizeof(paddings[0]); i++)
+    {
+        r = gta_create_header(&header);
+        check(r == GTA_OK);
+        r = gta_create_header(&header2);
+        check(r == GTA_OK);
+        gta_type_t type = GTA_UINT8;
+        uintmax_t dim = 3;
+        r = gta_set_components(header, 1, &type, NULL);
+        check(r == GTA_OK);
+        r = gta_set_dimensions(header, 1, &dim);
+        check(r == GTA_OK);
+        r = gta_set_tag(gta_get_global_taglist(header), "X-FOO", "bar");
+        check(r == GTA_OK);
+        r = gta_set_header_padding(header, 12);
+        check(r == GTA_INVALID_DATA);
+        r = gta_set_header_padding(header, paddings[i]);
+        check(r == GTA_OK);
+        check(gta_get_header_padding(header) == paddings[i]);
+        f = fopen("test-taglists.tmp", "w+");
+        check(f);
+        r = gta_write_header_to_stream(header, f);
+        check(r == GTA_OK);
+        check((uintmax_t)ftell(f) == gta_get_header_size(header));
+        check(fwrite("abc", 1, 3, f) == 3);
+        rewind(f);
+        r = gta_read_header_from_stream(header2, f);
+        check(r == GTA_OK);
+        check((uintmax_t)ftell(f) == gta_get_header_size(header2));
+        check(gta_get_header_padding(header2) == paddings[i]);
+        gtl = gta_get_global_taglist(header2);
+        check(gta_get_tags(gtl) == 1);
+        check(gta_get_tag(gtl, "GTA/PADDING") == NULL);
+        if (paddings[i] >= 100)
+        {
+            uintmax_t size = gta_get_header_size(header2);
+            r = gta_set_tag(gtl, "X-BAZ", "a value that takes some room");
+            check(r == GTA_OK);
+            r = gta_set_header_padding(header2, 0);
+            check(r == GTA_OK);
+            uintmax_t padding = size - gta_get_header_size(header2);
+            r = gta_set_header_padding(header2, padding);
+            check(r == GTA_OK);
+            if (gta_get_header_size(header2) > size)
+            {
+                /* The padding added a chunk to the header */
+                r = gta_set_header_padding(header2, padding - 9);
+                check(r == GTA_OK);
+            }
+            check(gta_get_header_size(header2) == size);
+            rewind(f);
+            r = gta_write_header_to_stream(header2, f);
+            check(r == GTA_OK);
+            rewind(f);
+            r = gta_read_header_from_stream(header, f);
+            check(r == GTA_OK);
+            check(gta_get_tags(gta_get_global_taglist(header)) == 2);
+            check(strcmp(gta_get_tag(gta_get_global_taglist(header), "X-BAZ"), "a value that takes some room") == 0);
+            char data[3];
+            r = gta_read_data_from_stream(header, data, f);
+            check(r == GTA_OK);
+            check(memcmp(data, "abc", 3) == 0);
+        }
+        check(fclose(f) == 0);
+        gta_destroy_header(header);
+        gta_destroy_header(header2);
+    }
+    remove("test-taglists.tmp");
+
+    /* Header alignment */
+    r = gta_create_header(&header);
+    check(r == GTA_OK);
+    r = gta_set_tag(gta_get_global_taglist(header), "X-FOO", "bar");
+    check(r == GTA_OK);
+    r = gta_align_header(header, 0, 0, 0);
+    check(r == GTA_INVALID_DATA);
+    r = gta_align_header(header, 0, 5, 4096);
+    check(r == GTA_INVALID_DATA);
+    uintmax_t offsets[] = { 0, 1, 4000, 4096 * 3 - 40, 123457 };
+    uintmax_t alignments[] = { 1, 2, 16, 4096, 1000 };
+    for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+    {
+        for (size_t j = 0; j < sizeof(alignments) / sizeof(alignments[0]); j++)
+        {
+            r = gta_align_header(header, offsets[i], 0, alignments[j]);
+            check(r == GTA_OK);
+            uintmax_t padding = gta_get_header_padding(header);
+            check(padding == 0 || padding >= 13);
+            check((offsets[i] + gta_get_header_size(header)) % alignments[j] == 0);
+            r = gta_align_header(header, offsets[i], 4096, alignments[j]);
+            check(r == GTA_OK);
+            check(gta_get_header_padding(header) >= 4096);
+            check((offsets[i] + gta_get_header_size(header)) % alignments[j] == 0);
+        }
+    }
+    f = fopen("test-taglists.tmp", "w+");
+    check(f);
+    check(fwrite("xyz", 1, 3, f) == 3);
+    r = gta_align_header(header, 3, 0, 4096);
+    check(r == GTA_OK);
+    r = gta_write_header_to_stream(header, f);
+    check(r == GTA_OK);
+    check(ftell(f) == 4096);
+    check(fseek(f, 3, SEEK_SET) == 0);
+    r = gta_create_header(&header2);
+    check(r == GTA_OK);
+    r = gta_read_header_from_stream(header2, f);
+    check(r == GTA_OK);
+    check(ftell(f) == 4096);
+    check(gta_get_header_padding(header2) == gta_get_header_padding(header));
+    check(gta_get_tags(gta_get_global_taglist(header2)) == 1);
+    check(fclose(f) == 0);
+    remove("test-taglists.tmp");
     gta_destroy_header(header);
+    gta_destroy_header(header2);
 
     return 0;
 }
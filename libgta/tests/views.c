@@ -0,0 +1,156 @@
+/*
+ * views.c
+ *
+ * This file is part of libgta, a library that implements the Generic Tagged
+ * Array (GTA) file format.
+ *
+ * Copyright (C) 2010, 2011
+ * Martin Lambers <marlam@marlam.de>
+ *
+ * Libgta is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * Libgta is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+ * A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Libgta. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gta/gta.h>
+
+#define check(condition) \
+    /* fprintf(stderr, "%s:%d: %s: Checking '%s'.\n", __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); */ \
+    if (!(condition)) \
+    { \
+        fprintf(stderr, "%s:%d: %s: Check '%s' failed.\n", \
+                __FILE__, __LINE__, __PRETTY_FUNCTION__, #condition); \
+        exit(1); \
+    }
+
+/* The elements have three bytes, so that one of them crosses the boundary
+ * of the first 16 MiB chunk. */
+
+static void set_element(uint8_t *element, uintmax_t index)
+{
+    element[0] = index;
+    element[1] = index >> 8;
+    element[2] = index >> 16;
+}
+
+static int check_element(const uint8_t *element, uintmax_t index)
+{
+    return element[0] == (uint8_t)index
+        && element[1] == (uint8_t)(index >> 8)
+        && element[2] == (uint8_t)(index >> 16);
+}
+
+int main(void)
+{
+    FILE *f;
+    gta_header_t *h;
+    gta_io_state_t *s;
+    gta_result_t r;
+    uintmax_t dims[] = { 3000, 2000 };
+    const uintmax_t batch = 100000;
+    uintmax_t index, lent;
+    void *wbuf;
+    const void *rbuf;
+    uint8_t element[3];
+
+    r = gta_create_header(&h);
+    check(r == GTA_OK);
+    gta_type_t types[] = { GTA_UINT8, GTA_UINT8, GTA_UINT8 };
+    r = gta_set_components(h, 3, types, NULL);
+    check(r == GTA_OK);
+    r = gta_set_dimensions(h, 2, dims);
+    check(r == GTA_OK);
+
+    /* Write the array in place */
+    f = fopen("test-views.tmp", "w");
+    check(f);
+    r = gta_write_header_to_stream(h, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    index = 0;
+    while (index < gta_get_elements(h))
+    {
+        uintmax_t n = gta_get_elements(h) - index;
+        if (n > batch)
+            n = batch;
+        r = gta_lend_write_elements_to_stream(h, s, n, &lent, &wbuf, f);
+        check(r == GTA_OK);
+        check(lent >= 1 && lent <= n);
+        for (uintmax_t i = 0; i < lent; i++)
+            set_element((uint8_t *)wbuf + 3 * i, index + i);
+        r = gta_commit_write_elements_to_stream(h, s, f);
+        check(r == GTA_OK);
+        index += lent;
+    }
+    gta_destroy_io_state(s);
+    fclose(f);
+
+    /* Read the array with copies */
+    f = fopen("test-views.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(h, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    for (index = 0; index < gta_get_elements(h); index++)
+    {
+        r = gta_read_elements_from_stream(h, s, 1, element, f);
+        check(r == GTA_OK);
+        check(check_element(element, index));
+    }
+    gta_destroy_io_state(s);
+    fclose(f);
+
+    /* Read the array in place, alternating with copies */
+    f = fopen("test-views.tmp", "r");
+    check(f);
+    r = gta_read_header_from_stream(h, f);
+    check(r == GTA_OK);
+    r = gta_create_io_state(&s);
+    check(r == GTA_OK);
+    index = 0;
+    while (index < gta_get_elements(h))
+    {
+        uintmax_t n = gta_get_elements(h) - index;
+        if (n > batch)
+            n = batch;
+        r = gta_lend_read_elements_from_stream(h, s, n, &lent, &rbuf, f);
+        check(r == GTA_OK);
+        check(lent >= 1 && lent <= n);
+        for (uintmax_t i = 0; i < lent; i++)
+            check(check_element((const uint8_t *)rbuf + 3 * i, index + i));
+        r = gta_commit_read_elements_from_stream(h, s, f);
+        check(r == GTA_OK);
+        index += lent;
+        if (index < gta_get_elements(h))
+        {
+            r = gta_read_elements_from_stream(h, s, 1, element, f);
+            check(r == GTA_OK);
+            check(check_element(element, index));
+            index++;
+        }
+    }
+    /* Commit without lend is an error */
+    r = gta_commit_read_elements_from_stream(h, s, f);
+    check(r == GTA_INVALID_DATA);
+    gta_destroy_io_state(s);
+    fclose(f);
+
+    gta_destroy_header(h);
+    remove("test-views.tmp");
+    return 0;
+}